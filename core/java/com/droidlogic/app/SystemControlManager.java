@@ -69,6 +69,10 @@ public class SystemControlManager {
     private static final int SET_OSD_3D_FORMAT              = IBinder.FIRST_CALL_TRANSACTION + 32;
     private static final int SWITCH_3DTO2D                  = IBinder.FIRST_CALL_TRANSACTION + 33;
     private static final int SWITCH_2DTO3D                  = IBinder.FIRST_CALL_TRANSACTION + 34;
+    private static final int AUTO_DETECT_3D                 = IBinder.FIRST_CALL_TRANSACTION + 35;
+    private static final int GET_PROPERTIES                 = IBinder.FIRST_CALL_TRANSACTION + 36;
+    private static final int READ_SYSFS_BATCH               = IBinder.FIRST_CALL_TRANSACTION + 37;
+    private static final int WRITE_SYSFS_BATCH              = IBinder.FIRST_CALL_TRANSACTION + 38;
 
     private Context mContext;
     private IBinder mIBinder = null;
@@ -250,6 +254,96 @@ public class SystemControlManager {
         return false;
     }
 
+    //the batch call is done and the service accepted the items, the status is the first int of reply.
+    //the service return BAD_VALUE for bad items, it is thrown as IllegalArgumentException
+    private boolean transactBatch(int code, Parcel data, Parcel reply, String name) {
+        try {
+            if (!mIBinder.transact(code, data, reply, 0)) {
+                Log.e(TAG, name + ": unknown transaction");
+                return false;
+            }
+        } catch (RemoteException ex) {
+            Log.e(TAG, name + ":" + ex);
+            return false;
+        } catch (IllegalArgumentException ex) {
+            Log.e(TAG, name + " bad items:" + ex);
+            return false;
+        }
+
+        int result = reply.readInt();
+        if (result < 0) {
+            Log.e(TAG, name + " fail:" + result);
+            return false;
+        }
+        return true;
+    }
+
+    //all the props in one call, "" if the prop is not set. null if the call fail
+    public String[] getProperties(String[] props) {
+        String[] values = null;
+        if (null != mIBinder) {
+            Parcel data = Parcel.obtain();
+            Parcel reply = Parcel.obtain();
+            data.writeInterfaceToken(SYS_TOKEN);
+            data.writeStringArray(props);
+            if (transactBatch(GET_PROPERTIES, data, reply, "getProperties")) {
+                values = new String[props.length];
+                for (int i = 0; i < props.length; i++) {
+                    reply.readInt();
+                    values[i] = reply.readString();
+                }
+            }
+            reply.recycle();
+            data.recycle();
+        }
+
+        return values;
+    }
+
+    //all the nodes in one call, null if the node can not be read. null if the call fail
+    public String[] readSysFsBatch(String[] paths) {
+        String[] values = null;
+        if (null != mIBinder) {
+            Parcel data = Parcel.obtain();
+            Parcel reply = Parcel.obtain();
+            data.writeInterfaceToken(SYS_TOKEN);
+            data.writeStringArray(paths);
+            if (transactBatch(READ_SYSFS_BATCH, data, reply, "readSysFsBatch")) {
+                values = new String[paths.length];
+                for (int i = 0; i < paths.length; i++) {
+                    boolean ok = reply.readInt() != 0;
+                    String value = reply.readString();
+                    values[i] = ok?value:null;
+                }
+            }
+            reply.recycle();
+            data.recycle();
+        }
+
+        return values;
+    }
+
+    //false for the nodes not written. null if the call fail
+    public boolean[] writeSysFsBatch(String[] paths, String[] vals) {
+        boolean[] result = null;
+        if (null != mIBinder) {
+            Parcel data = Parcel.obtain();
+            Parcel reply = Parcel.obtain();
+            data.writeInterfaceToken(SYS_TOKEN);
+            data.writeStringArray(paths);
+            data.writeStringArray(vals);
+            if (transactBatch(WRITE_SYSFS_BATCH, data, reply, "writeSysFsBatch")) {
+                result = new boolean[paths.length];
+                for (int i = 0; i < paths.length; i++)
+                    result[i] = reply.readInt() != 0;
+            }
+            reply.recycle();
+            data.recycle();
+        }
+
+        return result;
+    }
+
     public String getBootenv(String prop, String def) {
         try {
             if (null != mIBinder) {
@@ -27,7 +27,20 @@ LOCAL_SRC_FILES:= \
   main_imageserver.cpp \
   ImagePlayerService.cpp  \
   RGBPicture.c  \
-  TIFF2RGBA.cpp
+  TIFF2RGBA.cpp \
+  TiledImage.cpp \
+  FrameBufferPool.cpp \
+  MovieFrameCache.cpp \
+  MipPyramid.cpp \
+  HttpCache.cpp \
+  ColorConvert.cpp \
+  ColorConvert_sse.cpp
+
+ifeq ($(TARGET_ARCH),arm)
+LOCAL_SRC_FILES += ColorConvert_neon.cpp.neon
+LOCAL_CFLAGS += -DCOLOR_CONVERT_NEON
+LOCAL_STATIC_LIBRARIES += cpufeatures
+endif
 
 LOCAL_SHARED_LIBRARIES := \
   libimageplayerservice \
@@ -58,3 +71,70 @@ LOCAL_REQUIRED_MODULES := libtiff
 LOCAL_32_BIT_ONLY := true
 
 include $(BUILD_EXECUTABLE)
+
+# build color convert benchmark for host
+# =========================================================
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+  tests/colorconvert_benchmark.cpp \
+  ColorConvert.cpp \
+  ColorConvert_sse.cpp
+
+LOCAL_C_INCLUDES += \
+  $(LOCAL_PATH)
+
+LOCAL_STATIC_LIBRARIES := \
+  liblog
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= colorconvert_benchmark
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# build image cache test for host
+# =========================================================
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+  tests/imagecache_test.cpp
+
+LOCAL_C_INCLUDES += \
+  $(LOCAL_PATH)
+
+LOCAL_STATIC_LIBRARIES := \
+  libutils \
+  libcutils \
+  liblog
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= imagecache_test
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# build http cache test for host
+# =========================================================
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+  tests/httpcache_test.cpp \
+  HttpCache.cpp
+
+LOCAL_C_INCLUDES += \
+  $(LOCAL_PATH)
+
+LOCAL_STATIC_LIBRARIES := \
+  libutils \
+  libcutils \
+  liblog
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= httpcache_test
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
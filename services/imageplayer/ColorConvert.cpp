@@ -0,0 +1,265 @@
+/** @file ColorConvert.cpp
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/03/14
+ *  @par function description:
+ *  - 1 C reference rows of the pixel format conversion
+ *  - 2 select the fastest kernel table by cpu feature at runtime
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ImagePlayerService"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "utils/Log.h"
+#include "ColorConvertRow.h"
+
+#if defined(COLOR_CONVERT_NEON) && !defined(__aarch64__)
+#include <cpu-features.h>
+#endif
+
+namespace android {
+
+void RGBA8888ToRGBRow_C(const uint8_t *src, uint8_t *dst, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[3*x+0] = src[4*x+0];//B
+        dst[3*x+1] = src[4*x+1];//G
+        dst[3*x+2] = src[4*x+2];//R
+                    //src[4*x+3]; A
+    }
+}
+
+void RGBA8888ToBGRRow_C(const uint8_t *src, uint8_t *dst, int width) {
+    //bitmap888 need BGR
+    //RGBA -> BGR
+    for (int x = 0; x < width; x++) {
+        for (int j = 0; j < 3; j++) {
+            dst[3*x+j] = src[4*x + 2 - j];
+        }
+    }
+}
+
+void ARGB8888ToRGB565Row_C(const uint8_t *src, uint8_t *dst, int width) {
+    //BGRA -> RGB
+    for (int x = 0; x < width; x++) {
+        int R = src[4*x + 0];
+        int G = src[4*x + 1];
+        int B = src[4*x + 2];
+
+        dst[2*x + 1] = ((R&0xF8) | ((G>>5)&0x07));
+        dst[2*x] = (((G<<3)&0xE0) | ((B>>3)&0x1F));
+    }
+}
+
+void ARGBToYUV422Row_C(const uint8_t* src_argb, uint8_t* dst_yuyv, int width) {
+    for (int x = 0; x < width - 1; x += 2) {
+        uint8_t ar = (src_argb[0] + src_argb[4]) >> 1;
+        uint8_t ag = (src_argb[1] + src_argb[5]) >> 1;
+        uint8_t ab = (src_argb[2] + src_argb[6]) >> 1;
+        dst_yuyv[0] = RGBToY(src_argb[2], src_argb[1], src_argb[0]);
+        dst_yuyv[1] = RGBToU(ar, ag, ab);
+        dst_yuyv[2] = RGBToY(src_argb[6], src_argb[5], src_argb[4]);
+        dst_yuyv[3] = RGBToV(ar, ag, ab);
+        src_argb += 8;
+        dst_yuyv += 4;
+    }
+
+    if (width & 1) {
+        dst_yuyv[0] = RGBToY(src_argb[2], src_argb[1], src_argb[0]);
+        dst_yuyv[1] = RGBToU(src_argb[2], src_argb[1], src_argb[0]);
+        dst_yuyv[2] = 0x00;     // garbage, needs crop
+        dst_yuyv[3] = RGBToV(src_argb[2], src_argb[1], src_argb[0]);
+    }
+}
+
+void RGB565ToYUV422Row_C(const uint8_t* src_rgb565, const uint8_t* next_rgb565,
+        uint8_t* dst_yuyv, int width) {
+    for (int x = 0; x < width - 1; x += 2) {
+        uint8_t b0 = src_rgb565[0] & 0x1f;
+        uint8_t g0 = (src_rgb565[0] >> 5) | ((src_rgb565[1] & 0x07) << 3);
+        uint8_t r0 = src_rgb565[1] >> 3;
+        uint8_t b1 = src_rgb565[2] & 0x1f;
+        uint8_t g1 = (src_rgb565[2] >> 5) | ((src_rgb565[3] & 0x07) << 3);
+        uint8_t r1 = src_rgb565[3] >> 3;
+        uint8_t b2 = next_rgb565[0] & 0x1f;
+        uint8_t g2 = (next_rgb565[0] >> 5) | ((next_rgb565[1] & 0x07) << 3);
+        uint8_t r2 = next_rgb565[1] >> 3;
+        uint8_t b3 = next_rgb565[2] & 0x1f;
+        uint8_t g3 = (next_rgb565[2] >> 5) | ((next_rgb565[3] & 0x07) << 3);
+        uint8_t r3 = next_rgb565[3] >> 3;
+        uint8_t b = (b0 + b1 + b2 + b3);  // 565 * 4 = 787.
+        uint8_t g = (g0 + g1 + g2 + g3);
+        uint8_t r = (r0 + r1 + r2 + r3);
+        b = (b << 1) | (b >> 6);  // 787 -> 888.
+        r = (r << 1) | (r >> 6);
+        dst_yuyv[0] = RGBToY(r, g, b);
+        dst_yuyv[1] = RGBToV(r, g, b);
+        dst_yuyv[2] = RGBToY(r, g, b);
+        dst_yuyv[3] = RGBToU(r, g, b);
+        src_rgb565 += 4;
+        next_rgb565 += 4;
+        dst_yuyv += 4;
+    }
+
+    if (width & 1) {
+        uint8_t b0 = src_rgb565[0] & 0x1f;
+        uint8_t g0 = (src_rgb565[0] >> 5) | ((src_rgb565[1] & 0x07) << 3);
+        uint8_t r0 = src_rgb565[1] >> 3;
+        uint8_t b2 = next_rgb565[0] & 0x1f;
+        uint8_t g2 = (next_rgb565[0] >> 5) | ((next_rgb565[1] & 0x07) << 3);
+        uint8_t r2 = next_rgb565[1] >> 3;
+        uint8_t b = (b0 + b2);  // 565 * 2 = 676.
+        uint8_t g = (g0 + g2);
+        uint8_t r = (r0 + r2);
+        b = (b << 2) | (b >> 4);  // 676 -> 888
+        g = (g << 1) | (g >> 6);
+        r = (r << 2) | (r >> 4);
+        dst_yuyv[0] = RGBToY(r, g, b);
+        dst_yuyv[1] = RGBToV(r, g, b);
+        dst_yuyv[2] = 0x00; // garbage, needs crop
+        dst_yuyv[3] = RGBToU(r, g, b);
+    }
+}
+
+//luma of every palette entry comes from the table, only chroma is computed per pair
+void Index8ToYUV422Row_C(const uint8_t* src_index, uint8_t* dst_yuyv, int width,
+        const Index8Palette_t *palette) {
+    const uint8_t *pr = palette->r;
+    const uint8_t *pg = palette->g;
+    const uint8_t *pb = palette->b;
+
+    for (int x = 0; x < width - 1; x += 2) {
+        uint8_t pre = src_index[0];
+        uint8_t late = src_index[1];
+
+        uint8_t ar = (pr[pre] + pr[late]) >> 1;
+        uint8_t ag = (pg[pre] + pg[late]) >> 1;
+        uint8_t ab = (pb[pre] + pb[late]) >> 1;
+
+        dst_yuyv[0] = palette->y[pre];
+        dst_yuyv[1] = RGBToU(ar, ag, ab);
+        dst_yuyv[2] = palette->y[late];
+        dst_yuyv[3] = RGBToV(ar, ag, ab);
+        src_index += 2;
+        dst_yuyv += 4;
+    }
+
+    if (width & 1) {
+        uint8_t pre = src_index[0];
+        dst_yuyv[0] = palette->y[pre];
+        dst_yuyv[1] = RGBToU(pb[pre], pg[pre], pr[pre]);
+        dst_yuyv[2] = 0x00;     // garbage, needs crop
+        dst_yuyv[3] = RGBToV(pb[pre], pg[pre], pr[pre]);
+    }
+}
+
+const ColorConvertKernels_t kColorConvertC = {
+    "C",
+    RGBA8888ToRGBRow_C,
+    RGBA8888ToBGRRow_C,
+    ARGB8888ToRGB565Row_C,
+    ARGBToYUV422Row_C,
+    RGB565ToYUV422Row_C,
+    Index8ToYUV422Row_C,
+};
+
+static pthread_once_t sKernelsOnce = PTHREAD_ONCE_INIT;
+static const ColorConvertKernels_t *sKernels = &kColorConvertC;
+
+static bool isKernelSupported(int type) {
+    switch (type) {
+        case COLOR_CONVERT_KERNEL_C:
+            return true;
+
+#if defined(COLOR_CONVERT_NEON)
+        case COLOR_CONVERT_KERNEL_NEON:
+#if defined(__aarch64__)
+            return true;
+#else
+            return (android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM)
+                && (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON);
+#endif
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+        case COLOR_CONVERT_KERNEL_SSSE3:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("ssse3");
+#endif
+
+        default:
+            break;
+    }
+    return false;
+}
+
+static const ColorConvertKernels_t *kernelsByType(int type) {
+    switch (type) {
+#if defined(COLOR_CONVERT_NEON)
+        case COLOR_CONVERT_KERNEL_NEON:
+            return &kColorConvertNeon;
+#endif
+#if defined(__i386__) || defined(__x86_64__)
+        case COLOR_CONVERT_KERNEL_SSSE3:
+            return &kColorConvertSsse3;
+#endif
+        default:
+            break;
+    }
+    return &kColorConvertC;
+}
+
+static void selectKernels() {
+    for (int type = COLOR_CONVERT_KERNEL_TOTAL - 1; type > COLOR_CONVERT_KERNEL_C; type--) {
+        if (isKernelSupported(type)) {
+            sKernels = kernelsByType(type);
+            break;
+        }
+    }
+    ALOGI("color convert use %s kernels", sKernels->name);
+}
+
+}  // namespace android
+
+using namespace android;
+
+const ColorConvertKernels_t *ColorConvertGetKernels(void) {
+    pthread_once(&sKernelsOnce, selectKernels);
+    return sKernels;
+}
+
+const ColorConvertKernels_t *ColorConvertGetKernelsByType(int type) {
+    if (!isKernelSupported(type))
+        return &kColorConvertC;
+
+    return kernelsByType(type);
+}
+
+void Index8PaletteInit(Index8Palette_t *palette, const uint32_t *colors, int count,
+        int rShift, int gShift, int bShift) {
+    memset(palette, 0, sizeof(Index8Palette_t));
+
+    if (count > 256)
+        count = 256;
+
+    for (int i = 0; i < count; i++) {
+        palette->r[i] = (colors[i] >> rShift) & 0xFF;
+        palette->g[i] = (colors[i] >> gShift) & 0xFF;
+        palette->b[i] = (colors[i] >> bShift) & 0xFF;
+    }
+
+    //index8 luma swap r and b, keep the same with the former per pixel kernel
+    for (int i = 0; i < 256; i++) {
+        palette->y[i] = RGBToY(palette->b[i], palette->g[i], palette->r[i]);
+    }
+}
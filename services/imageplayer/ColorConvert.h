@@ -0,0 +1,73 @@
+/** @file ColorConvert.h
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/03/14
+ *  @par function description:
+ *  - 1 pixel format conversion rows used by picdec render path
+ *  - 2 C, NEON and SSSE3 kernels, selected at runtime, all bit-exact
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#ifndef _COLOR_CONVERT_H_
+#define _COLOR_CONVERT_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    COLOR_CONVERT_KERNEL_C          = 0,
+    COLOR_CONVERT_KERNEL_NEON       = 1,
+    COLOR_CONVERT_KERNEL_SSSE3      = 2,
+    COLOR_CONVERT_KERNEL_TOTAL      = 3
+};
+
+/*
+ * index8 palette prepared once per frame, entries are the r, g, b of the
+ * color table as stored, y holds the luma of every entry
+ */
+typedef struct {
+    uint8_t r[256];
+    uint8_t g[256];
+    uint8_t b[256];
+    uint8_t y[256];
+} Index8Palette_t;
+
+typedef struct {
+    const char *name;
+    //byte 0,1,2 kept, byte 3 (alpha) dropped
+    void (*RGBA8888ToRGBRow)(const uint8_t *src, uint8_t *dst, int width);
+    //byte 2,1,0 written, byte 3 (alpha) dropped, used by bmp dump
+    void (*RGBA8888ToBGRRow)(const uint8_t *src, uint8_t *dst, int width);
+    void (*ARGB8888ToRGB565Row)(const uint8_t *src, uint8_t *dst, int width);
+    void (*ARGBToYUV422Row)(const uint8_t *src, uint8_t *dst, int width);
+    //next is the second source row, chroma and luma are 2x2 averaged
+    void (*RGB565ToYUV422Row)(const uint8_t *src, const uint8_t *next, uint8_t *dst, int width);
+    void (*Index8ToYUV422Row)(const uint8_t *src, uint8_t *dst, int width, const Index8Palette_t *palette);
+} ColorConvertKernels_t;
+
+/*
+ * kernels are chosen once by cpu feature, the returned table is the C
+ * reference table when the request type is not supported on this cpu
+ */
+const ColorConvertKernels_t *ColorConvertGetKernels(void);
+const ColorConvertKernels_t *ColorConvertGetKernelsByType(int type);
+
+//colors are SkPMColor like packed 32bit, shift of every channel is given by caller
+void Index8PaletteInit(Index8Palette_t *palette, const uint32_t *colors, int count,
+    int rShift, int gShift, int bShift);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif/*_COLOR_CONVERT_H_*/
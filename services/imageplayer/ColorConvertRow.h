@@ -0,0 +1,53 @@
+/** @file ColorConvertRow.h
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/03/14
+ *  @par function description:
+ *  - 1 row kernels shared by the C, NEON and SSSE3 conversion tables,
+ *    only ColorConvert*.cpp include this file
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#ifndef _COLOR_CONVERT_ROW_H_
+#define _COLOR_CONVERT_ROW_H_
+
+#include "ColorConvert.h"
+
+namespace android {
+
+static inline int RGBToY(uint8_t r, uint8_t g, uint8_t b) {
+    return (66 * r + 129 * g +  25 * b + 0x1080) >> 8;
+}
+static inline int RGBToU(uint8_t r, uint8_t g, uint8_t b) {
+    return (112 * b - 74 * g - 38 * r + 0x8080) >> 8;
+}
+static inline int RGBToV(uint8_t r, uint8_t g, uint8_t b) {
+    return (112 * r - 94 * g - 18 * b + 0x8080) >> 8;
+}
+
+//the SIMD kernels finish the row tail with these
+void RGBA8888ToRGBRow_C(const uint8_t *src, uint8_t *dst, int width);
+void RGBA8888ToBGRRow_C(const uint8_t *src, uint8_t *dst, int width);
+void ARGB8888ToRGB565Row_C(const uint8_t *src, uint8_t *dst, int width);
+void ARGBToYUV422Row_C(const uint8_t *src, uint8_t *dst, int width);
+void RGB565ToYUV422Row_C(const uint8_t *src, const uint8_t *next, uint8_t *dst, int width);
+void Index8ToYUV422Row_C(const uint8_t *src, uint8_t *dst, int width, const Index8Palette_t *palette);
+
+extern const ColorConvertKernels_t kColorConvertC;
+#if defined(COLOR_CONVERT_NEON)
+extern const ColorConvertKernels_t kColorConvertNeon;
+#endif
+#if defined(__i386__) || defined(__x86_64__)
+extern const ColorConvertKernels_t kColorConvertSsse3;
+#endif
+
+}  // namespace android
+
+#endif/*_COLOR_CONVERT_ROW_H_*/
@@ -0,0 +1,173 @@
+/** @file ColorConvert_neon.cpp
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/03/14
+ *  @par function description:
+ *  - 1 NEON rows of the pixel format conversion
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#if defined(COLOR_CONVERT_NEON)
+
+#include <arm_neon.h>
+
+#include "ColorConvertRow.h"
+
+namespace android {
+
+static void RGBA8888ToRGBRow_NEON(const uint8_t *src, uint8_t *dst, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t pixel = vld4q_u8(src + 4*x);
+        uint8x16x3_t rgb;
+        rgb.val[0] = pixel.val[0];
+        rgb.val[1] = pixel.val[1];
+        rgb.val[2] = pixel.val[2];
+        vst3q_u8(dst + 3*x, rgb);
+    }
+    RGBA8888ToRGBRow_C(src + 4*x, dst + 3*x, width - x);
+}
+
+static void RGBA8888ToBGRRow_NEON(const uint8_t *src, uint8_t *dst, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t pixel = vld4q_u8(src + 4*x);
+        uint8x16x3_t bgr;
+        bgr.val[0] = pixel.val[2];
+        bgr.val[1] = pixel.val[1];
+        bgr.val[2] = pixel.val[0];
+        vst3q_u8(dst + 3*x, bgr);
+    }
+    RGBA8888ToBGRRow_C(src + 4*x, dst + 3*x, width - x);
+}
+
+static void ARGB8888ToRGB565Row_NEON(const uint8_t *src, uint8_t *dst, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x4_t pixel = vld4_u8(src + 4*x);
+        //byte 0 to bits 11~15, byte 1 to bits 5~10, byte 2 to bits 0~4
+        uint16x8_t rgb = vshll_n_u8(pixel.val[0], 8);
+        rgb = vsriq_n_u16(rgb, vshll_n_u8(pixel.val[1], 8), 5);
+        rgb = vsriq_n_u16(rgb, vshll_n_u8(pixel.val[2], 8), 11);
+        vst1q_u8(dst + 2*x, vreinterpretq_u8_u16(rgb));
+    }
+    ARGB8888ToRGB565Row_C(src + 4*x, dst + 2*x, width - x);
+}
+
+static inline uint8x8_t RGBToY_NEON(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+    uint16x8_t y = vmull_u8(r, vdup_n_u8(66));
+    y = vmlal_u8(y, g, vdup_n_u8(129));
+    y = vmlal_u8(y, b, vdup_n_u8(25));
+    return vshrn_n_u16(vaddq_u16(y, vdupq_n_u16(0x1080)), 8);
+}
+
+//all terms are unsigned 16 bits, the positive part is added first so nothing wraps
+static inline uint8x8_t RGBToU_NEON(uint16x8_t r, uint16x8_t g, uint16x8_t b) {
+    uint16x8_t u = vmlaq_n_u16(vdupq_n_u16(0x8080), b, 112);
+    u = vmlsq_n_u16(u, g, 74);
+    u = vmlsq_n_u16(u, r, 38);
+    return vshrn_n_u16(u, 8);
+}
+
+static inline uint8x8_t RGBToV_NEON(uint16x8_t r, uint16x8_t g, uint16x8_t b) {
+    uint16x8_t v = vmlaq_n_u16(vdupq_n_u16(0x8080), r, 112);
+    v = vmlsq_n_u16(v, g, 94);
+    v = vmlsq_n_u16(v, b, 18);
+    return vshrn_n_u16(v, 8);
+}
+
+static void ARGBToYUV422Row_NEON(const uint8_t *src, uint8_t *dst, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t pixel = vld4q_u8(src + 4*x);
+
+        uint8x8_t yLow = RGBToY_NEON(vget_low_u8(pixel.val[2]),
+            vget_low_u8(pixel.val[1]), vget_low_u8(pixel.val[0]));
+        uint8x8_t yHigh = RGBToY_NEON(vget_high_u8(pixel.val[2]),
+            vget_high_u8(pixel.val[1]), vget_high_u8(pixel.val[0]));
+        //val[0] is the even pixels, val[1] is the odd pixels
+        uint8x8x2_t y = vuzp_u8(yLow, yHigh);
+
+        //average of pixel pair, truncated the same as (a + b) >> 1
+        uint16x8_t ar = vshrq_n_u16(vpaddlq_u8(pixel.val[0]), 1);
+        uint16x8_t ag = vshrq_n_u16(vpaddlq_u8(pixel.val[1]), 1);
+        uint16x8_t ab = vshrq_n_u16(vpaddlq_u8(pixel.val[2]), 1);
+
+        uint8x8x4_t yuyv;
+        yuyv.val[0] = y.val[0];
+        yuyv.val[1] = RGBToU_NEON(ar, ag, ab);
+        yuyv.val[2] = y.val[1];
+        yuyv.val[3] = RGBToV_NEON(ar, ag, ab);
+        vst4_u8(dst + 2*x, yuyv);
+    }
+    ARGBToYUV422Row_C(src + 4*x, dst + 2*x, width - x);
+}
+
+//sum of the 2x2 block for 8 pixels of two rows, 4 results
+static inline void sumRGB565_NEON(const uint8_t *src, const uint8_t *next,
+        uint16x4_t *b, uint16x4_t *g, uint16x4_t *r) {
+    uint16x8_t p0 = vreinterpretq_u16_u8(vld1q_u8(src));
+    uint16x8_t p1 = vreinterpretq_u16_u8(vld1q_u8(next));
+    uint16x8_t mask5 = vdupq_n_u16(0x1F);
+    uint16x8_t mask6 = vdupq_n_u16(0x3F);
+
+    uint16x8_t sb = vaddq_u16(vandq_u16(p0, mask5), vandq_u16(p1, mask5));
+    uint16x8_t sg = vaddq_u16(vandq_u16(vshrq_n_u16(p0, 5), mask6),
+                              vandq_u16(vshrq_n_u16(p1, 5), mask6));
+    uint16x8_t sr = vaddq_u16(vshrq_n_u16(p0, 11), vshrq_n_u16(p1, 11));
+
+    *b = vpadd_u16(vget_low_u16(sb), vget_high_u16(sb));
+    *g = vpadd_u16(vget_low_u16(sg), vget_high_u16(sg));
+    *r = vpadd_u16(vget_low_u16(sr), vget_high_u16(sr));
+}
+
+static void RGB565ToYUV422Row_NEON(const uint8_t *src, const uint8_t *next, uint8_t *dst, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint16x4_t b0, g0, r0, b1, g1, r1;
+        sumRGB565_NEON(src + 2*x, next + 2*x, &b0, &g0, &r0);
+        sumRGB565_NEON(src + 2*x + 16, next + 2*x + 16, &b1, &g1, &r1);
+
+        uint16x8_t b = vcombine_u16(b0, b1);
+        uint16x8_t g = vcombine_u16(g0, g1);
+        uint16x8_t r = vcombine_u16(r0, r1);
+        // 787 -> 888.
+        b = vorrq_u16(vshlq_n_u16(b, 1), vshrq_n_u16(b, 6));
+        r = vorrq_u16(vshlq_n_u16(r, 1), vshrq_n_u16(r, 6));
+
+        uint16x8_t y16 = vmlaq_n_u16(vdupq_n_u16(0x1080), r, 66);
+        y16 = vmlaq_n_u16(y16, g, 129);
+        y16 = vmlaq_n_u16(y16, b, 25);
+        uint8x8_t y = vshrn_n_u16(y16, 8);
+
+        uint8x8x4_t yvyu;
+        yvyu.val[0] = y;
+        yvyu.val[1] = RGBToV_NEON(r, g, b);
+        yvyu.val[2] = y;
+        yvyu.val[3] = RGBToU_NEON(r, g, b);
+        vst4_u8(dst + 2*x, yvyu);
+    }
+    RGB565ToYUV422Row_C(src + 2*x, next + 2*x, dst + 2*x, width - x);
+}
+
+const ColorConvertKernels_t kColorConvertNeon = {
+    "NEON",
+    RGBA8888ToRGBRow_NEON,
+    RGBA8888ToBGRRow_NEON,
+    ARGB8888ToRGB565Row_NEON,
+    ARGBToYUV422Row_NEON,
+    RGB565ToYUV422Row_NEON,
+    //palette lookup has no gather on NEON, the table driven C row is used
+    Index8ToYUV422Row_C,
+};
+
+}  // namespace android
+
+#endif
@@ -0,0 +1,167 @@
+/** @file ColorConvert_sse.cpp
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/03/14
+ *  @par function description:
+ *  - 1 SSSE3 rows of the pixel format conversion, used by x86 host build
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#if defined(__i386__) || defined(__x86_64__)
+
+#include <tmmintrin.h>
+
+#include "ColorConvertRow.h"
+
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+
+namespace android {
+
+//4 pixels in, 12 bytes out, the 16 bytes store overlap next pixels, so keep 2 pixels spare
+SSSE3_TARGET
+static void RGBA8888ToRGBRow_SSSE3(const uint8_t *src, uint8_t *dst, int width) {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    int x = 0;
+    for (; x + 6 <= width; x += 4) {
+        __m128i pixel = _mm_loadu_si128((const __m128i *)(src + 4*x));
+        _mm_storeu_si128((__m128i *)(dst + 3*x), _mm_shuffle_epi8(pixel, shuffle));
+    }
+    RGBA8888ToRGBRow_C(src + 4*x, dst + 3*x, width - x);
+}
+
+SSSE3_TARGET
+static void RGBA8888ToBGRRow_SSSE3(const uint8_t *src, uint8_t *dst, int width) {
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    int x = 0;
+    for (; x + 6 <= width; x += 4) {
+        __m128i pixel = _mm_loadu_si128((const __m128i *)(src + 4*x));
+        _mm_storeu_si128((__m128i *)(dst + 3*x), _mm_shuffle_epi8(pixel, shuffle));
+    }
+    RGBA8888ToBGRRow_C(src + 4*x, dst + 3*x, width - x);
+}
+
+SSSE3_TARGET
+static void ARGB8888ToRGB565Row_SSSE3(const uint8_t *src, uint8_t *dst, int width) {
+    const __m128i maskR = _mm_set1_epi32(0xF800);
+    const __m128i maskG = _mm_set1_epi32(0x07E0);
+    const __m128i maskB = _mm_set1_epi32(0x001F);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i out[2];
+        for (int i = 0; i < 2; i++) {
+            __m128i pixel = _mm_loadu_si128((const __m128i *)(src + 4*(x + 4*i)));
+            __m128i r = _mm_and_si128(_mm_slli_epi32(pixel, 8), maskR);
+            __m128i g = _mm_and_si128(_mm_srli_epi32(pixel, 5), maskG);
+            __m128i b = _mm_and_si128(_mm_srli_epi32(pixel, 19), maskB);
+            __m128i rgb = _mm_or_si128(_mm_or_si128(r, g), b);
+            //sign extend low 16 bits, so signed pack keep the bit pattern
+            out[i] = _mm_srai_epi32(_mm_slli_epi32(rgb, 16), 16);
+        }
+        _mm_storeu_si128((__m128i *)(dst + 2*x), _mm_packs_epi32(out[0], out[1]));
+    }
+    ARGB8888ToRGB565Row_C(src + 4*x, dst + 2*x, width - x);
+}
+
+SSSE3_TARGET
+static void ARGBToYUV422Row_SSSE3(const uint8_t *src, uint8_t *dst, int width) {
+    const __m128i zero = _mm_setzero_si128();
+    //lane order is byte 0, 1, 2, 3 of the pixel
+    const __m128i coefY = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+    const __m128i coefU = _mm_setr_epi16(-38, -74, 112, 0, -38, -74, 112, 0);
+    const __m128i coefV = _mm_setr_epi16(112, -94, -18, 0, 112, -94, -18, 0);
+    const __m128i biasY = _mm_set1_epi32(0x1080);
+    const __m128i biasUV = _mm_set1_epi32(0x8080);
+    const __m128i order = _mm_setr_epi8(0, 4, 1, 6, 2, 5, 3, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i pixel = _mm_loadu_si128((const __m128i *)(src + 4*x));
+        __m128i lo = _mm_unpacklo_epi8(pixel, zero);
+        __m128i hi = _mm_unpackhi_epi8(pixel, zero);
+
+        __m128i y = _mm_hadd_epi32(_mm_madd_epi16(lo, coefY), _mm_madd_epi16(hi, coefY));
+        y = _mm_srai_epi32(_mm_add_epi32(y, biasY), 8);
+
+        //average of pixel pair, truncated the same as (a + b) >> 1
+        __m128i sumLo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+        __m128i sumHi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+        __m128i avg = _mm_srli_epi16(_mm_unpacklo_epi64(sumLo, sumHi), 1);
+
+        __m128i uv = _mm_hadd_epi32(_mm_madd_epi16(avg, coefU), _mm_madd_epi16(avg, coefV));
+        uv = _mm_srai_epi32(_mm_add_epi32(uv, biasUV), 8);
+
+        //Y0 Y1 Y2 Y3 U0 U1 V0 V1 -> Y0 U0 Y1 V0 Y2 U1 Y3 V1
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(y, uv), zero);
+        _mm_storel_epi64((__m128i *)(dst + 2*x), _mm_shuffle_epi8(packed, order));
+    }
+    ARGBToYUV422Row_C(src + 4*x, dst + 2*x, width - x);
+}
+
+SSSE3_TARGET
+static void RGB565ToYUV422Row_SSSE3(const uint8_t *src, const uint8_t *next, uint8_t *dst, int width) {
+    const __m128i mask5 = _mm_set1_epi16(0x1F);
+    const __m128i mask6 = _mm_set1_epi16(0x3F);
+    const __m128i one = _mm_set1_epi16(1);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i b[2], g[2], r[2];
+        for (int i = 0; i < 2; i++) {
+            __m128i p0 = _mm_loadu_si128((const __m128i *)(src + 2*(x + 8*i)));
+            __m128i p1 = _mm_loadu_si128((const __m128i *)(next + 2*(x + 8*i)));
+            __m128i sb = _mm_add_epi16(_mm_and_si128(p0, mask5), _mm_and_si128(p1, mask5));
+            __m128i sg = _mm_add_epi16(_mm_and_si128(_mm_srli_epi16(p0, 5), mask6),
+                                       _mm_and_si128(_mm_srli_epi16(p1, 5), mask6));
+            __m128i sr = _mm_add_epi16(_mm_srli_epi16(p0, 11), _mm_srli_epi16(p1, 11));
+            //add horizontal pair, 4 sums of 2x2 block
+            b[i] = _mm_madd_epi16(sb, one);
+            g[i] = _mm_madd_epi16(sg, one);
+            r[i] = _mm_madd_epi16(sr, one);
+        }
+        __m128i vb = _mm_packs_epi32(b[0], b[1]);
+        __m128i vg = _mm_packs_epi32(g[0], g[1]);
+        __m128i vr = _mm_packs_epi32(r[0], r[1]);
+        // 787 -> 888.
+        vb = _mm_or_si128(_mm_slli_epi16(vb, 1), _mm_srli_epi16(vb, 6));
+        vr = _mm_or_si128(_mm_slli_epi16(vr, 1), _mm_srli_epi16(vr, 6));
+
+        //16 bits wrap around, the real results are in 0 ~ 0xFFFF, so logical shift is exact
+        __m128i y = _mm_add_epi16(_mm_mullo_epi16(vr, _mm_set1_epi16(66)),
+                    _mm_add_epi16(_mm_mullo_epi16(vg, _mm_set1_epi16(129)),
+                    _mm_add_epi16(_mm_mullo_epi16(vb, _mm_set1_epi16(25)), _mm_set1_epi16(0x1080))));
+        __m128i u = _mm_sub_epi16(_mm_add_epi16(_mm_mullo_epi16(vb, _mm_set1_epi16(112)), _mm_set1_epi16(0x8080)),
+                    _mm_add_epi16(_mm_mullo_epi16(vg, _mm_set1_epi16(74)), _mm_mullo_epi16(vr, _mm_set1_epi16(38))));
+        __m128i v = _mm_sub_epi16(_mm_add_epi16(_mm_mullo_epi16(vr, _mm_set1_epi16(112)), _mm_set1_epi16(0x8080)),
+                    _mm_add_epi16(_mm_mullo_epi16(vg, _mm_set1_epi16(94)), _mm_mullo_epi16(vb, _mm_set1_epi16(18))));
+        y = _mm_srli_epi16(y, 8);
+        u = _mm_srli_epi16(u, 8);
+        v = _mm_srli_epi16(v, 8);
+
+        //Y V Y U for every 2x2 block
+        __m128i yv = _mm_or_si128(y, _mm_slli_epi16(v, 8));
+        __m128i yu = _mm_or_si128(y, _mm_slli_epi16(u, 8));
+        _mm_storeu_si128((__m128i *)(dst + 2*x), _mm_unpacklo_epi16(yv, yu));
+        _mm_storeu_si128((__m128i *)(dst + 2*x + 16), _mm_unpackhi_epi16(yv, yu));
+    }
+    RGB565ToYUV422Row_C(src + 2*x, next + 2*x, dst + 2*x, width - x);
+}
+
+const ColorConvertKernels_t kColorConvertSsse3 = {
+    "SSSE3",
+    RGBA8888ToRGBRow_SSSE3,
+    RGBA8888ToBGRRow_SSSE3,
+    ARGB8888ToRGB565Row_SSSE3,
+    ARGBToYUV422Row_SSSE3,
+    RGB565ToYUV422Row_SSSE3,
+    //palette lookup has no gather on SSSE3, the table driven C row is used
+    Index8ToYUV422Row_C,
+};
+
+}  // namespace android
+
+#endif
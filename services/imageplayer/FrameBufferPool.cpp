@@ -0,0 +1,153 @@
+/** @file FrameBufferPool.cpp
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/04/05
+ *  @par function description:
+ *  - 1 size classed pool of pixel buffers for render, crop and transform
+ *  - 2 SkBitmap allocator, the pixels go back to the pool when the bitmap is freed
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ImagePlayerService"
+
+#include <stdlib.h>
+
+#include "utils/Log.h"
+#include "FrameBufferPool.h"
+
+namespace android {
+
+//keep the class size in front of the pixels, pixels are still 16 bytes aligned
+#define FRAME_POOL_HEADER           16
+//small buffers are rounded to page
+#define FRAME_POOL_MIN_CLASS        4096
+
+FrameBufferPool::FrameBufferPool()
+    : mFreeBytes(0), mUsedBytes(0), mPeakBytes(0),
+    mAllocs(0), mReuses(0), mFrees(0) {
+}
+
+FrameBufferPool::~FrameBufferPool() {
+    Mutex::Autolock autoLock(mLock);
+    trimLocked(FRAME_POOL_FREE_BYTES);
+}
+
+//round up to one of FRAME_POOL_CLASS_STEPS sizes between 2 powers of 2
+size_t FrameBufferPool::classSize(size_t bytes) {
+    if (bytes <= FRAME_POOL_MIN_CLASS)
+        return FRAME_POOL_MIN_CLASS;
+
+    size_t base = FRAME_POOL_MIN_CLASS;
+    while (base*2 < bytes)
+        base *= 2;
+
+    size_t step = base/FRAME_POOL_CLASS_STEPS;
+    return (bytes + step - 1)/step*step;
+}
+
+void* FrameBufferPool::acquire(size_t bytes) {
+    size_t size = classSize(bytes);
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        //the most recently released one is still hot in cache
+        for (ssize_t i = (ssize_t)mFree.size() - 1; i >= 0; i--) {
+            if (mFree[i].bytes == size) {
+                void *addr = mFree[i].addr;
+                mFree.removeAt(i);
+                mFreeBytes -= size;
+                mUsedBytes += size;
+                mReuses++;
+                this->ref();
+                return addr;
+            }
+        }
+
+        //make room before the new buffer, the peak is the whole pool
+        trimLocked(size);
+    }
+
+    char *buffer = (char *)malloc(size + FRAME_POOL_HEADER);
+    if (NULL == buffer) {
+        ALOGE("frame buffer pool, not enough memory for %d bytes", (int)size);
+        return NULL;
+    }
+    *(size_t *)buffer = size;
+
+    Mutex::Autolock autoLock(mLock);
+    mUsedBytes += size;
+    if (mUsedBytes + mFreeBytes > mPeakBytes)
+        mPeakBytes = mUsedBytes + mFreeBytes;
+    mAllocs++;
+    this->ref();
+    return buffer + FRAME_POOL_HEADER;
+}
+
+void FrameBufferPool::release(void *addr) {
+    if (NULL == addr)
+        return;
+
+    char *buffer = (char *)addr - FRAME_POOL_HEADER;
+    FreeBuffer freeBuffer;
+    freeBuffer.bytes = *(size_t *)buffer;
+    freeBuffer.addr = addr;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        mUsedBytes -= freeBuffer.bytes;
+        mFree.push(freeBuffer);
+        mFreeBytes += freeBuffer.bytes;
+        trimLocked(0);
+    }
+    this->unref();
+}
+
+void FrameBufferPool::releasePixels(void *addr, void *context) {
+    ((FrameBufferPool *)context)->release(addr);
+}
+
+bool FrameBufferPool::allocPixelRef(SkBitmap *bitmap, SkColorTable *ctable) {
+    const SkImageInfo& info = bitmap->info();
+    size_t rowBytes = bitmap->rowBytes();
+    if ((info.width() <= 0) || (info.height() <= 0) || (rowBytes < info.minRowBytes()))
+        return false;
+
+    void *addr = acquire(bitmap->getSize());
+    if (NULL == addr)
+        return false;
+
+    //release proc is called even if install fail
+    return bitmap->installPixels(info, addr, rowBytes, ctable, releasePixels, this);
+}
+
+void FrameBufferPool::trim() {
+    Mutex::Autolock autoLock(mLock);
+    trimLocked(FRAME_POOL_FREE_BYTES);
+}
+
+void FrameBufferPool::trimLocked(size_t reserve) {
+    while ((mFree.size() > 0) && (mFreeBytes + reserve > FRAME_POOL_FREE_BYTES)) {
+        mFreeBytes -= mFree[0].bytes;
+        free((char *)mFree[0].addr - FRAME_POOL_HEADER);
+        mFree.removeAt(0);
+        mFrees++;
+    }
+}
+
+void FrameBufferPool::dump(String8& result) {
+    Mutex::Autolock autoLock(mLock);
+    result.appendFormat("FrameBufferPool: allocs:%d, reuses:%d, frees:%d\n",
+        mAllocs, mReuses, mFrees);
+    result.appendFormat("FrameBufferPool: used bytes:%d, free bytes:%d(%d buffers), peak:%d\n",
+        (int)mUsedBytes, (int)mFreeBytes, (int)mFree.size(), (int)mPeakBytes);
+}
+
+}  // namespace android
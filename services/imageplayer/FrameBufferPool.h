@@ -0,0 +1,77 @@
+/** @file FrameBufferPool.h
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/04/05
+ *  @par function description:
+ *  - 1 size classed pool of pixel buffers for render, crop and transform
+ *  - 2 SkBitmap allocator, the pixels go back to the pool when the bitmap is freed
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#ifndef ANDROID_FRAME_BUFFER_POOL_H
+#define ANDROID_FRAME_BUFFER_POOL_H
+
+#include <utils/Mutex.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+#include <SkBitmap.h>
+
+//free buffers kept for reuse, in bytes, the oldest is freed when over
+#define FRAME_POOL_FREE_BYTES       (64*1024*1024)
+//size classes per power of 2, more classes waste less but reuse less
+#define FRAME_POOL_CLASS_STEPS      4
+
+namespace android {
+
+/*
+ * Thread safe, it is used by binder, decode and movie threads.
+ * Every buffer hold a reference of the pool, so the pool is freed
+ * after the last bitmap allocated from it.
+ */
+class FrameBufferPool : public SkBitmap::Allocator {
+  public:
+    FrameBufferPool();
+
+    //raw buffer, at least bytes, NULL if no memory
+    void* acquire(size_t bytes);
+    void release(void *addr);
+
+    //install pooled pixels into the bitmap which info is set
+    virtual bool allocPixelRef(SkBitmap *bitmap, SkColorTable *ctable);
+
+    void trim();
+    void dump(String8& result);
+
+  private:
+    virtual ~FrameBufferPool();
+
+    struct FreeBuffer {
+        size_t bytes;
+        void *addr;
+    };
+
+    static size_t classSize(size_t bytes);
+    static void releasePixels(void *addr, void *context);
+    void trimLocked(size_t reserve);
+
+    Mutex mLock;
+    //least recently released at the front
+    Vector<FreeBuffer> mFree;
+    size_t mFreeBytes;
+    size_t mUsedBytes;
+    size_t mPeakBytes;
+    int mAllocs;
+    int mReuses;
+    int mFrees;
+};
+
+}  // namespace android
+
+#endif // ANDROID_FRAME_BUFFER_POOL_H
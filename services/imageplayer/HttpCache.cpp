@@ -0,0 +1,508 @@
+/** @file HttpCache.cpp
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/04/25
+ *  @par function description:
+ *  - 1 block cache of remote images, shared by all the streams of one url
+ *  - 2 optional disk cache of the whole images, bounded by bytes, LRU eviction
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ImagePlayerService"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <cutils/atomic.h>
+#include "utils/Log.h"
+#include "HttpCache.h"
+
+//'IPHC', disk file is header, url, then the body
+#define HTTP_CACHE_MAGIC            0x43485049
+#define HTTP_CACHE_URL_MAX          4096
+#define HTTP_CACHE_SUFFIX           ".img"
+
+namespace android {
+
+struct HttpDiskHeader {
+    uint32_t magic;
+    uint32_t urlLength;
+    int64_t size;
+};
+
+struct HttpDiskFile {
+    String8 path;
+    off64_t size;
+    struct timespec mtime;
+};
+
+static Mutex gInstanceLock;
+static sp<HttpCache> gInstance;
+
+//FNV-1a of the url as the file name
+static String8 diskPath(const String8& dir, const String8& url) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < url.length(); i++) {
+        hash ^= (uint8_t)url.string()[i];
+        hash *= 1099511628211ULL;
+    }
+
+    String8 path(dir);
+    path.appendFormat("/%016llx%s", (unsigned long long)hash, HTTP_CACHE_SUFFIX);
+    return path;
+}
+
+static bool writeFully(int fd, const void *data, size_t size) {
+    const uint8_t *p = (const uint8_t *)data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static int compareMtime(const void *a, const void *b) {
+    const HttpDiskFile *fa = *(const HttpDiskFile * const *)a;
+    const HttpDiskFile *fb = *(const HttpDiskFile * const *)b;
+    if (fa->mtime.tv_sec != fb->mtime.tv_sec)
+        return (fa->mtime.tv_sec < fb->mtime.tv_sec)?-1:1;
+    if (fa->mtime.tv_nsec != fb->mtime.tv_nsec)
+        return (fa->mtime.tv_nsec < fb->mtime.tv_nsec)?-1:1;
+    return 0;
+}
+
+HttpCacheEntry::HttpCacheEntry(const String8& url, const sp<HttpSource>& source)
+    : mUrl(url), mFetching(false), mSource(source), mSize(-1), mBytes(0),
+    mFd(-1), mFdOffset(0), mSaved(false) {
+}
+
+HttpCacheEntry::~HttpCacheEntry() {
+    for (size_t i = 0; i < mBlocks.size(); i++) {
+        free(mBlocks[i]);
+    }
+    mBlocks.clear();
+
+    if (mFd >= 0)
+        close(mFd);
+}
+
+off64_t HttpCacheEntry::getSize() {
+    Mutex::Autolock lock(mLock);
+
+    if ((mSize >= 0) || (mSource == NULL))
+        return mSize;
+
+    //the source know the size after the first request
+    fetchBlockLocked(0);
+    waitFetchLocked();
+    if ((mSize < 0) && (mSource != NULL)) {
+        off64_t size = mSource->getSize();
+        if (size >= 0)
+            mSize = size;
+    }
+    return mSize;
+}
+
+ssize_t HttpCacheEntry::readAt(off64_t offset, void *data, size_t size) {
+    Mutex::Autolock lock(mLock);
+
+    if (offset < 0)
+        return -1;
+
+    if (mFd >= 0) {
+        if (offset >= mSize)
+            return 0;
+        if ((off64_t)size > mSize - offset)
+            size = mSize - offset;
+        return pread64(mFd, data, size, mFdOffset + offset);
+    }
+
+    uint8_t *dst = (uint8_t *)data;
+    size_t done = 0;
+    while (done < size) {
+        off64_t pos = offset + done;
+        size_t index = pos/HTTP_CACHE_BLOCK;
+        if (!fetchBlockLocked(index))
+            break;
+        if ((mSize >= 0) && (pos >= mSize))
+            break;
+
+        off64_t start = (off64_t)index*HTTP_CACHE_BLOCK;
+        off64_t end = start + HTTP_CACHE_BLOCK;
+        if ((mSize >= 0) && (end > mSize))
+            end = mSize;
+
+        size_t count = end - pos;
+        if (count > size - done)
+            count = size - done;
+        memcpy(dst + done, mBlocks[index] + (pos - start), count);
+        done += count;
+    }
+
+    if ((done == 0) && (mSize < 0))
+        return -1;
+    return done;
+}
+
+size_t HttpCacheEntry::bytes() const {
+    return (size_t)android_atomic_acquire_load(&mBytes);
+}
+
+void HttpCacheEntry::waitFetchLocked() {
+    while (mFetching)
+        mFetchCond.wait(mLock);
+}
+
+//with mLock, it is released during the network read, the blocks already
+//fetched can still be read by the other streams
+bool HttpCacheEntry::fetchBlockLocked(size_t index) {
+    while (true) {
+        if ((index < mBlocks.size()) && (NULL != mBlocks[index]))
+            return true;
+        if (!mFetching)
+            break;
+        mFetchCond.wait(mLock);
+    }
+    if (mSource == NULL)
+        return false;
+
+    off64_t offset = (off64_t)index*HTTP_CACHE_BLOCK;
+    size_t size = HTTP_CACHE_BLOCK;
+    if (mSize >= 0) {
+        if (offset >= mSize)
+            return false;
+        if (mSize - offset < (off64_t)size)
+            size = mSize - offset;
+    }
+
+    uint8_t *block = (uint8_t *)malloc(HTTP_CACHE_BLOCK);
+    if (NULL == block) {
+        ALOGE("http cache, not enough memory for block %d of %s", (int)index, mUrl.string());
+        return false;
+    }
+
+    sp<HttpSource> source = mSource;
+    mFetching = true;
+    mLock.unlock();
+
+    size_t filled = 0;
+    ssize_t n = 0;
+    while (filled < size) {
+        n = source->readAt(offset + filled, block + filled, size - filled);
+        if (n <= 0)
+            break;
+        filled += n;
+    }
+
+    mLock.lock();
+    mFetching = false;
+    mFetchCond.broadcast();
+
+    if (filled < size) {
+        //the end of a body without content length
+        if ((mSize < 0) && (n == 0))
+            mSize = offset + filled;
+
+        if ((filled == 0) || (mSize != offset + (off64_t)filled)) {
+            if ((n < 0) || (mSize != offset + (off64_t)filled))
+                ALOGE("http cache, read block %d of %s fail, got %d bytes",
+                    (int)index, mUrl.string(), (int)filled);
+            free(block);
+            return false;
+        }
+    }
+
+    if (mBlocks.size() <= index)
+        mBlocks.insertAt(NULL, mBlocks.size(), index + 1 - mBlocks.size());
+    mBlocks.editItemAt(index) = block;
+    android_atomic_add((int32_t)filled, &mBytes);
+    ALOGV("http cache, fetch block %d of %s, %d bytes", (int)index, mUrl.string(), (int)filled);
+    return true;
+}
+
+bool HttpCacheEntry::isCompleteLocked() const {
+    if (mSize < 0)
+        return false;
+
+    size_t count = (mSize + HTTP_CACHE_BLOCK - 1)/HTTP_CACHE_BLOCK;
+    if (mBlocks.size() < count)
+        return false;
+    for (size_t i = 0; i < count; i++) {
+        if (NULL == mBlocks[i])
+            return false;
+    }
+    return true;
+}
+
+HttpCache::HttpCache()
+    : mDiskBytes(0), mMemoryHits(0), mDiskHits(0), mMisses(0),
+    mDiskWrites(0), mDiskEvictions(0) {
+}
+
+HttpCache::~HttpCache() {
+    mEntries.clear();
+}
+
+sp<HttpCache> HttpCache::getInstance() {
+    Mutex::Autolock lock(gInstanceLock);
+    if (gInstance == NULL)
+        gInstance = new HttpCache();
+    return gInstance;
+}
+
+void HttpCache::setDiskCache(const char *dir, size_t bytes) {
+    Mutex::Autolock lock(mLock);
+
+    mDiskDir = (NULL != dir)?dir:"";
+    mDiskBytes = bytes;
+    if (mDiskDir.isEmpty())
+        return;
+
+    if ((mkdir(mDiskDir.string(), 0770) < 0) && (errno != EEXIST)) {
+        ALOGE("http cache, can not create disk cache dir %s, errno:%d", mDiskDir.string(), errno);
+        mDiskDir = "";
+        return;
+    }
+
+    ALOGI("http cache, disk cache dir %s, %d bytes", mDiskDir.string(), (int)mDiskBytes);
+    trimDiskLocked();
+}
+
+sp<HttpCacheEntry> HttpCache::open(const char *url, const sp<HttpSource>& source) {
+    Mutex::Autolock lock(mLock);
+    String8 key(url);
+
+    for (size_t i = 0; i < mEntries.size(); i++) {
+        if (mEntries[i]->url() == key) {
+            sp<HttpCacheEntry> entry = mEntries[i];
+            mEntries.removeAt(i);
+            mEntries.push(entry);
+            mMemoryHits++;
+            return entry;
+        }
+    }
+
+    sp<HttpCacheEntry> entry = new HttpCacheEntry(key, source);
+    off64_t size = 0;
+    off64_t offset = 0;
+    int fd = openDisk(key, &size, &offset);
+    if (fd >= 0) {
+        entry->mFd = fd;
+        entry->mFdOffset = offset;
+        entry->mSize = size;
+        entry->mSaved = true;
+        entry->mSource.clear();
+        mDiskHits++;
+    } else {
+        mMisses++;
+    }
+
+    mEntries.push(entry);
+    trimMemoryLocked();
+    return entry;
+}
+
+int HttpCache::openDisk(const String8& url, off64_t *size, off64_t *offset) {
+    if (mDiskDir.isEmpty())
+        return -1;
+
+    String8 path = diskPath(mDiskDir, url);
+    int fd = ::open(path.string(), O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    HttpDiskHeader header;
+    char name[HTTP_CACHE_URL_MAX];
+    struct stat st;
+    if ((read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header))
+        || (header.magic != HTTP_CACHE_MAGIC)
+        || (header.urlLength != url.length()) || (header.urlLength >= HTTP_CACHE_URL_MAX)
+        || (read(fd, name, header.urlLength) != (ssize_t)header.urlLength)
+        || memcmp(name, url.string(), header.urlLength)
+        || (fstat(fd, &st) < 0)
+        || (st.st_size != (off64_t)(sizeof(header) + header.urlLength + header.size))) {
+        //another url with the same hash, or a broken file
+        ALOGW("http cache, drop invalid disk file %s", path.string());
+        close(fd);
+        return -1;
+    }
+
+    //last access time for LRU
+    utimensat(AT_FDCWD, path.string(), NULL, 0);
+    *size = header.size;
+    *offset = sizeof(header) + header.urlLength;
+    return fd;
+}
+
+void HttpCache::save(const sp<HttpCacheEntry>& entry) {
+    String8 dir;
+    size_t bytes;
+    {
+        Mutex::Autolock lock(mLock);
+        dir = mDiskDir;
+        bytes = mDiskBytes;
+    }
+    if (dir.isEmpty() || (entry == NULL))
+        return;
+
+    {
+        Mutex::Autolock entryLock(entry->mLock);
+        if (entry->mSaved || !entry->isCompleteLocked())
+            return;
+        //not worth to evict every other image
+        if ((size_t)entry->mSize > bytes/2)
+            return;
+
+        String8 path = diskPath(dir, entry->mUrl);
+        String8 temp(path);
+        temp.append(".tmp");
+        int fd = ::open(temp.string(), O_WRONLY | O_CREAT | O_TRUNC, 0660);
+        if (fd < 0) {
+            ALOGE("http cache, can not create %s, errno:%d", temp.string(), errno);
+            return;
+        }
+
+        HttpDiskHeader header;
+        header.magic = HTTP_CACHE_MAGIC;
+        header.urlLength = entry->mUrl.length();
+        header.size = entry->mSize;
+        bool ok = (header.urlLength < HTTP_CACHE_URL_MAX)
+            && writeFully(fd, &header, sizeof(header))
+            && writeFully(fd, entry->mUrl.string(), header.urlLength);
+        for (size_t i = 0; ok && (i < entry->mBlocks.size()); i++) {
+            off64_t left = entry->mSize - (off64_t)i*HTTP_CACHE_BLOCK;
+            if (left <= 0)
+                break;
+            ok = writeFully(fd, entry->mBlocks[i],
+                (left > HTTP_CACHE_BLOCK)?HTTP_CACHE_BLOCK:(size_t)left);
+        }
+        close(fd);
+
+        if (!ok || (rename(temp.string(), path.string()) < 0)) {
+            ALOGE("http cache, write %s fail, errno:%d", path.string(), errno);
+            unlink(temp.string());
+            return;
+        }
+        entry->mSaved = true;
+        ALOGI("http cache, save %s to disk, %lld bytes", entry->mUrl.string(), (long long)entry->mSize);
+    }
+
+    Mutex::Autolock lock(mLock);
+    mDiskWrites++;
+    trimDiskLocked();
+}
+
+void HttpCache::clear() {
+    Mutex::Autolock lock(mLock);
+    //entries still read by streams are freed by them
+    mEntries.clear();
+}
+
+void HttpCache::trimMemoryLocked() {
+    //the entry locks are not taken, a fetch hold one for a network read
+    size_t total = 0;
+    for (size_t i = 0; i < mEntries.size(); i++) {
+        total += mEntries[i]->bytes();
+    }
+
+    //the newest entry is just opened, never evict it
+    size_t i = 0;
+    while ((total > HTTP_CACHE_MEM_BYTES) && (i + 1 < mEntries.size())) {
+        sp<HttpCacheEntry> entry = mEntries[i];
+        //held by the list and this function, no stream read it
+        if (entry->getStrongCount() > 2) {
+            i++;
+            continue;
+        }
+
+        total -= entry->bytes();
+        ALOGV("http cache, evict %s from memory", entry->url().string());
+        mEntries.removeAt(i);
+    }
+}
+
+void HttpCache::trimDiskLocked() {
+    if (mDiskDir.isEmpty())
+        return;
+
+    DIR *dir = opendir(mDiskDir.string());
+    if (NULL == dir)
+        return;
+
+    Vector<HttpDiskFile*> files;
+    off64_t total = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        size_t length = strlen(ent->d_name);
+        size_t suffix = strlen(HTTP_CACHE_SUFFIX);
+        if ((length <= suffix) || strcmp(ent->d_name + length - suffix, HTTP_CACHE_SUFFIX))
+            continue;
+
+        HttpDiskFile *file = new HttpDiskFile();
+        file->path = mDiskDir;
+        file->path.appendFormat("/%s", ent->d_name);
+        struct stat st;
+        if (stat(file->path.string(), &st) < 0) {
+            delete file;
+            continue;
+        }
+        file->size = st.st_size;
+        file->mtime = st.st_mtim;
+        total += file->size;
+        files.push(file);
+    }
+    closedir(dir);
+
+    if (total > (off64_t)mDiskBytes) {
+        qsort(files.editArray(), files.size(), sizeof(HttpDiskFile*), compareMtime);
+        //open entries keep their fd, unlink does not break them
+        for (size_t i = 0; (i < files.size()) && (total > (off64_t)mDiskBytes); i++) {
+            ALOGD("http cache, evict %s from disk", files[i]->path.string());
+            unlink(files[i]->path.string());
+            total -= files[i]->size;
+            mDiskEvictions++;
+        }
+    }
+
+    for (size_t i = 0; i < files.size(); i++) {
+        delete files[i];
+    }
+}
+
+void HttpCache::dump(String8& result) {
+    Mutex::Autolock lock(mLock);
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < mEntries.size(); i++) {
+        bytes += mEntries[i]->bytes();
+    }
+
+    result.appendFormat("HttpCache: entries:%d, memory bytes:%d, budget:%d\n",
+        (int)mEntries.size(), (int)bytes, HTTP_CACHE_MEM_BYTES);
+    result.appendFormat("HttpCache: disk dir:%s, budget:%d, writes:%d, evictions:%d\n",
+        mDiskDir.isEmpty()?"disabled":mDiskDir.string(), (int)mDiskBytes, mDiskWrites, mDiskEvictions);
+    result.appendFormat("HttpCache: memory hits:%d, disk hits:%d, misses:%d\n",
+        mMemoryHits, mDiskHits, mMisses);
+}
+
+}  // namespace android
@@ -0,0 +1,128 @@
+/** @file HttpCache.h
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/04/25
+ *  @par function description:
+ *  - 1 block cache of remote images, shared by all the streams of one url
+ *  - 2 optional disk cache of the whole images, bounded by bytes, LRU eviction
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#ifndef ANDROID_HTTP_CACHE_H
+#define ANDROID_HTTP_CACHE_H
+
+#include <sys/types.h>
+#include <utils/Condition.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+//remote bytes are fetched by blocks
+#define HTTP_CACHE_BLOCK            (64*1024)
+//bodies kept in memory, entries which are still read are not evicted
+#define HTTP_CACHE_MEM_BYTES        (32*1024*1024)
+//default disk cache size, can be changed by property media.imageplayer.httpcache.mb
+#define HTTP_CACHE_DISK_DEFAULT_MB  64
+
+namespace android {
+
+/*
+ * Remote bytes of one url, connect when it is read at the first time.
+ * Size may be unknown (-1) until the end is read.
+ */
+class HttpSource : public RefBase {
+  public:
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) = 0;
+    virtual off64_t getSize() = 0;
+
+  protected:
+    virtual ~HttpSource() {}
+};
+
+//body of one url, every block is fetched only once
+class HttpCacheEntry : public RefBase {
+  public:
+    ssize_t readAt(off64_t offset, void *data, size_t size);
+    //-1 if the source can not tell the size
+    off64_t getSize();
+    const String8& url() const { return mUrl; }
+
+  protected:
+    virtual ~HttpCacheEntry();
+
+  private:
+    friend class HttpCache;
+
+    HttpCacheEntry(const String8& url, const sp<HttpSource>& source);
+    bool fetchBlockLocked(size_t index);
+    void waitFetchLocked();
+    bool isCompleteLocked() const;
+    //bytes in memory, read by the cache without mLock
+    size_t bytes() const;
+
+    String8 mUrl;
+    Mutex mLock;
+    //a fetch is done without mLock, only one at a time use the source
+    Condition mFetchCond;
+    bool mFetching;
+    sp<HttpSource> mSource;
+    off64_t mSize;
+    //NULL if the block is not fetched
+    Vector<uint8_t*> mBlocks;
+    volatile int32_t mBytes;
+    //whole body in the disk cache, read it instead of the blocks
+    int mFd;
+    off64_t mFdOffset;
+    bool mSaved;
+};
+
+class HttpCache : public RefBase {
+  public:
+    HttpCache();
+
+    //process wide cache used by SkHttpStream
+    static sp<HttpCache> getInstance();
+
+    //empty dir disable the disk cache
+    void setDiskCache(const char *dir, size_t bytes);
+
+    //source is used only if the url is not cached
+    sp<HttpCacheEntry> open(const char *url, const sp<HttpSource>& source);
+    //save the entry to disk if it is complete
+    void save(const sp<HttpCacheEntry>& entry);
+    void clear();
+
+    void dump(String8& result);
+
+  protected:
+    virtual ~HttpCache();
+
+  private:
+    int openDisk(const String8& url, off64_t *size, off64_t *offset);
+    void trimMemoryLocked();
+    void trimDiskLocked();
+
+    Mutex mLock;
+    //least recently used at the front
+    Vector<sp<HttpCacheEntry> > mEntries;
+    String8 mDiskDir;
+    size_t mDiskBytes;
+
+    int mMemoryHits;
+    int mDiskHits;
+    int mMisses;
+    int mDiskWrites;
+    int mDiskEvictions;
+};
+
+}  // namespace android
+
+#endif // ANDROID_HTTP_CACHE_H
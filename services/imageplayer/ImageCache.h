@@ -0,0 +1,217 @@
+/** @file ImageCache.h
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/03/28
+ *  @par function description:
+ *  - 1 LRU cache of decoded and surface fitted images, bounded by bytes
+ *  - 2 prefetch slots which are not evicted until they are shown
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#ifndef ANDROID_IMAGE_CACHE_H
+#define ANDROID_IMAGE_CACHE_H
+
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+//default cache budget, can be changed by property media.imageplayer.cachemb
+#define IMAGE_CACHE_DEFAULT_MB      96
+//default prefetch slots, can be changed by property media.imageplayer.prefetch
+#define IMAGE_PREFETCH_SLOTS        2
+
+namespace android {
+
+/*
+ * Bitmap only need getSize(), the cache own the bitmaps it holds.
+ * put() move the ownership into the cache, take() move it out again,
+ * so showing a cached image never copy the pixels.
+ */
+template <typename Bitmap>
+class ImageCache {
+  public:
+    ImageCache(size_t budget, int slots)
+        : mBudget(budget), mSlots(slots), mBytes(0), mPeakBytes(0),
+        mHits(0), mMisses(0), mEvictions(0), mRefused(0) {
+    }
+
+    ~ImageCache() {
+        clear();
+    }
+
+    void setBudget(size_t budget, int slots) {
+        mBudget = budget;
+        mSlots = (slots > 0)?slots:1;
+        while (mPrefetch.size() > (size_t)mSlots)
+            mPrefetch.removeAt(0);
+        trim(0);
+    }
+
+    //false if the bitmap does not fit in the budget, even after the unpinned images are
+    //evicted, then the caller still own it
+    bool put(const String8& key, Bitmap *bitmap) {
+        if (NULL == bitmap)
+            return false;
+
+        size_t bytes = bitmap->getSize();
+        if (bytes > mBudget)
+            return false;
+
+        remove(key);
+        trim(bytes);
+        if (mBytes + bytes > mBudget) {
+            mRefused++;
+            return false;
+        }
+
+        Entry entry;
+        entry.key = key;
+        entry.bitmap = bitmap;
+        entry.bytes = bytes;
+        mEntries.push(entry);
+        mBytes += bytes;
+        if (mBytes > mPeakBytes)
+            mPeakBytes = mBytes;
+        return true;
+    }
+
+    //ownership move to the caller, NULL if not cached
+    Bitmap* take(const String8& key) {
+        ssize_t index = indexOf(key);
+        if (index < 0) {
+            mMisses++;
+            return NULL;
+        }
+
+        Bitmap *bitmap = mEntries[index].bitmap;
+        mBytes -= mEntries[index].bytes;
+        mEntries.removeAt(index);
+        unpin(key);
+        mHits++;
+        return bitmap;
+    }
+
+    int slots() const {
+        return mSlots;
+    }
+
+    bool contains(const String8& key) const {
+        return indexOf(key) >= 0;
+    }
+
+    //pin the prefetched image, the oldest slot is unpinned when all slots are used
+    void prefetch(const String8& key) {
+        unpin(key);
+        if (mPrefetch.size() >= (size_t)mSlots)
+            mPrefetch.removeAt(0);
+        mPrefetch.push(key);
+
+        //prefetched image is the most recently used
+        ssize_t index = indexOf(key);
+        if (index >= 0) {
+            Entry entry = mEntries[index];
+            mEntries.removeAt(index);
+            mEntries.push(entry);
+        }
+    }
+
+    void clear() {
+        for (size_t i = 0; i < mEntries.size(); i++) {
+            delete mEntries[i].bitmap;
+        }
+        mEntries.clear();
+        mPrefetch.clear();
+        mBytes = 0;
+    }
+
+    void dump(String8& result) const {
+        result.appendFormat("ImageCache: entries:%d, bytes:%d, peak:%d, budget:%d, slots:%d/%d\n",
+            (int)mEntries.size(), (int)mBytes, (int)mPeakBytes, (int)mBudget,
+            (int)mPrefetch.size(), mSlots);
+        result.appendFormat("ImageCache: hits:%d, misses:%d, evictions:%d, refused:%d\n",
+            mHits, mMisses, mEvictions, mRefused);
+        for (size_t i = 0; i < mEntries.size(); i++) {
+            result.appendFormat("ImageCache: [%d]%s %s, bytes:%d\n", (int)i,
+                isPinned(mEntries[i].key)?"*":" ", mEntries[i].key.string(), (int)mEntries[i].bytes);
+        }
+    }
+
+  private:
+    struct Entry {
+        String8 key;
+        Bitmap *bitmap;
+        size_t bytes;
+    };
+
+    ssize_t indexOf(const String8& key) const {
+        for (size_t i = 0; i < mEntries.size(); i++) {
+            if (mEntries[i].key == key)
+                return i;
+        }
+        return -1;
+    }
+
+    bool isPinned(const String8& key) const {
+        for (size_t i = 0; i < mPrefetch.size(); i++) {
+            if (mPrefetch[i] == key)
+                return true;
+        }
+        return false;
+    }
+
+    void unpin(const String8& key) {
+        for (size_t i = 0; i < mPrefetch.size(); i++) {
+            if (mPrefetch[i] == key) {
+                mPrefetch.removeAt(i);
+                return;
+            }
+        }
+    }
+
+    void remove(const String8& key) {
+        ssize_t index = indexOf(key);
+        if (index >= 0) {
+            delete mEntries[index].bitmap;
+            mBytes -= mEntries[index].bytes;
+            mEntries.removeAt(index);
+        }
+    }
+
+    //evict from the least recently used, prefetch slots are skipped
+    void trim(size_t reserve) {
+        size_t i = 0;
+        while ((mBytes + reserve > mBudget) && (i < mEntries.size())) {
+            if (isPinned(mEntries[i].key)) {
+                i++;
+                continue;
+            }
+            delete mEntries[i].bitmap;
+            mBytes -= mEntries[i].bytes;
+            mEntries.removeAt(i);
+            mEvictions++;
+        }
+    }
+
+    size_t mBudget;
+    int mSlots;
+    size_t mBytes;
+    size_t mPeakBytes;
+    int mHits;
+    int mMisses;
+    int mEvictions;
+    int mRefused;
+
+    //least recently used at the front
+    Vector<Entry> mEntries;
+    Vector<String8> mPrefetch;
+};
+
+}  // namespace android
+
+#endif // ANDROID_IMAGE_CACHE_H
@@ -52,6 +52,8 @@
 #include <fcntl.h>
 
 #include "RGBPicture.h"
+#include "HttpCache.h"
+#include "ColorConvert.h"
 #include "ISystemControlService.h"
 
 #define CHECK assert
@@ -88,52 +90,71 @@ class DeathNotifier: public IBinder::DeathRecipient
     private:
         sp<ImagePlayerService> mImagePlayService;
 };
-class SkHttpStream : public SkStreamRewindable {
+//connect when the http cache need bytes of the url
+class DataSourceHttpSource : public HttpSource {
 public:
-    SkHttpStream(const char url[] = NULL, const sp<IMediaHTTPService> &httpservice = NULL)
-        : fURL(strdup(url)), dataSource(NULL),totalSize(0),
-        isConnect(false), haveRead(0), httpsService(httpservice) {
-        connect();
-        getLength();
+    DataSourceHttpSource(const char *url, const sp<IMediaHTTPService> &httpservice)
+        : fURL(url), dataSource(NULL), isConnect(false), httpsService(httpservice) {
     }
 
-    virtual ~SkHttpStream() {
-        if (dataSource != NULL) {
-            dataSource.clear();
-            dataSource = NULL;
-            isConnect = false;
-            haveRead = 0;
-        }
-        free(fURL);
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        if (!connect())
+            return -1;
+        return dataSource->readAt(offset, data, size);
+    }
+
+    virtual off64_t getSize() {
+        off64_t size;
+        if (!connect() || (dataSource->getSize(&size) != OK))
+            return -1;
+        return size;
     }
 
+private:
     bool connect() {
-        dataSource = DataSource::CreateFromURI(httpsService, fURL);
+        if (isConnect)
+            return true;
 
+        dataSource = DataSource::CreateFromURI(httpsService, fURL.string());
         if (dataSource == NULL) {
             ALOGE("data source create from URI is NULL");
-            isConnect = false;
             return false;
-        } else {
-            isConnect = true;
-            return true;
         }
+        isConnect = true;
+        return true;
     }
 
-    bool rewind() {
-        if (dataSource != NULL) {
-            dataSource.clear();
-            dataSource = NULL;
-            isConnect = false;
-            haveRead = 0;
-        }
+    String8 fURL;
+    sp<DataSource> dataSource;
+    bool isConnect;
+    sp<IMediaHTTPService> httpsService;
+};
+
+/*
+ * All the streams of one url read the same http cache entry,
+ * rewind and duplicate do not connect again.
+ */
+class SkHttpStream : public SkStreamRewindable {
+public:
+    SkHttpStream(const char url[] = NULL, const sp<IMediaHTTPService> &httpservice = NULL)
+        : haveRead(0), totalSize(0) {
+        entry = HttpCache::getInstance()->open(url, new DataSourceHttpSource(url, httpservice));
+        getLength();
+    }
 
-        return connect();
+    virtual ~SkHttpStream() {
+        //whole image is read, keep it on disk for the next time
+        HttpCache::getInstance()->save(entry);
+        entry.clear();
     }
 
+    bool rewind() {
+        haveRead = 0;
+        return entry != NULL;
+    }
 
     SkHttpStream* duplicate() const {
-        return new SkHttpStream(fURL, httpsService);
+        return new SkHttpStream(entry);
     }
 
     size_t read(void* buffer, size_t size) {
@@ -151,29 +172,21 @@ public:
             getLength();
         }
 
-        if (isConnect && (dataSource != NULL) && (buffer != NULL)) {
-            ret = dataSource->readAt(haveRead, buffer, size);
-            if ((ret <= 0) || (ret > (int)size)) {
-                return 0;
-            }
-            haveRead += ret;
-            return ret;
-        } else {
+        ret = entry->readAt(haveRead, buffer, size);
+        if ((ret <= 0) || (ret > (int)size)) {
             return 0;
         }
+        haveRead += ret;
+        return ret;
     }
 
     size_t getLength() {
-        off64_t size;
-        if (isConnect && (dataSource != NULL)) {
-            int ret = dataSource->getSize(&size);
-
-            if (ERROR_UNSUPPORTED == ret) {
-                return 8192;
-            } else if ( size > 0 ) {
-                totalSize = size;
-                return (size_t)size;
-            }
+        off64_t size = entry->getSize();
+        if (size < 0) {
+            return 8192;
+        } else if ( size > 0 ) {
+            totalSize = size;
+            return (size_t)size;
         }
         return 0;
     }
@@ -184,12 +197,14 @@ public:
     }
 
 private:
-    char *fURL;
-    sp<DataSource> dataSource;
-    bool isConnect;
+    SkHttpStream(const sp<HttpCacheEntry> &cacheEntry)
+        : entry(cacheEntry), haveRead(0), totalSize(0) {
+        getLength();
+    }
+
+    sp<HttpCacheEntry> entry;
     off64_t haveRead;
     off64_t totalSize;
-    sp<IMediaHTTPService> httpsService;
 };
 
 }  // namespace android
@@ -402,7 +417,8 @@ static SkBitmap* cropBitmapRect(SkBitmap *srcBitmap, int x, int y, int width, in
     return dstBitmap;
 }
 
-static SkBitmap* cropAndFillBitmap(SkBitmap *srcBitmap, int dstWidth, int dstHeight) {
+static SkBitmap* cropAndFillBitmap(SkBitmap *srcBitmap, int dstWidth, int dstHeight,
+        SkBitmap::Allocator *allocator) {
     if (srcBitmap == NULL)
         return NULL;
 
@@ -413,7 +429,7 @@ static SkBitmap* cropAndFillBitmap(SkBitmap *srcBitmap, int dstWidth, int dstHei
     devBitmap->setInfo(SkImageInfo::Make(dstWidth, dstHeight,
             colorType, srcBitmap->alphaType()));
 
-    devBitmap->allocPixels();
+    devBitmap->allocPixels(allocator, NULL);
     devBitmap->eraseARGB(0, 0, 0, 0);
 
     canvas = new SkCanvas(*devBitmap);
@@ -437,7 +453,8 @@ static SkBitmap* cropAndFillBitmap(SkBitmap *srcBitmap, int dstWidth, int dstHei
     return devBitmap;
 }
 
-static SkBitmap* translateAndCropAndFillBitmap(SkBitmap *srcBitmap, int dstWidth, int dstHeight, int tx, int ty) {
+static SkBitmap* translateAndCropAndFillBitmap(SkBitmap *srcBitmap, int dstWidth, int dstHeight, int tx, int ty,
+        SkBitmap::Allocator *allocator) {
     if (srcBitmap == NULL)
         return NULL;
 
@@ -446,7 +463,7 @@ static SkBitmap* translateAndCropAndFillBitmap(SkBitmap *srcBitmap, int dstWidth
     SkColorType colorType = colorTypeForScaledOutput(srcBitmap->colorType());
     devBitmap->setInfo(SkImageInfo::Make(dstWidth, dstHeight,
             colorType, srcBitmap->alphaType()));
-    devBitmap->allocPixels();
+    devBitmap->allocPixels(allocator, NULL);
     devBitmap->eraseARGB(0, 0, 0, 0);
 
     canvas = new SkCanvas(*devBitmap);
@@ -490,121 +507,6 @@ static SkBitmap* translateAndCropAndFillBitmap(SkBitmap *srcBitmap, int dstWidth
     return devBitmap;
 }
 
-static __inline int RGBToY(uint8_t r, uint8_t g, uint8_t b) {
-    return (66 * r + 129 * g +  25 * b + 0x1080) >> 8;
-}
-static __inline int RGBToU(uint8_t r, uint8_t g, uint8_t b) {
-    return (112 * b - 74 * g - 38 * r + 0x8080) >> 8;
-}
-static __inline int RGBToV(uint8_t r, uint8_t g, uint8_t b) {
-    return (112 * r - 94 * g - 18 * b + 0x8080) >> 8;
-}
-
-static __inline void ARGBToYUV422Row_C(const uint8_t* src_argb,
-                      uint8_t* dst_yuyv, int width) {
-    for (int x = 0; x < width - 1; x += 2) {
-        uint8_t ar = (src_argb[0] + src_argb[4]) >> 1;
-        uint8_t ag = (src_argb[1] + src_argb[5]) >> 1;
-        uint8_t ab = (src_argb[2] + src_argb[6]) >> 1;
-        dst_yuyv[0] = RGBToY(src_argb[2], src_argb[1], src_argb[0]);
-        dst_yuyv[1] = RGBToU(ar, ag, ab);
-        dst_yuyv[2] = RGBToY(src_argb[6], src_argb[5], src_argb[4]);
-        dst_yuyv[3] = RGBToV(ar, ag, ab);
-        src_argb += 8;
-        dst_yuyv += 4;
-    }
-
-    if (width & 1) {
-        dst_yuyv[0] = RGBToY(src_argb[2], src_argb[1], src_argb[0]);
-        dst_yuyv[1] = RGBToU(src_argb[2], src_argb[1], src_argb[0]);
-        dst_yuyv[2] = 0x00;     // garbage, needs crop
-        dst_yuyv[3] = RGBToV(src_argb[2], src_argb[1], src_argb[0]);
-    }
-}
-
-static __inline void RGB565ToYUVRow_C(const uint8_t* src_rgb565,
-                     uint8_t* dst_yuyv, int width) {
-    const uint8_t* next_rgb565 = src_rgb565 + width * 2;
-    for (int x = 0; x < width - 1; x += 2) {
-        uint8_t b0 = src_rgb565[0] & 0x1f;
-        uint8_t g0 = (src_rgb565[0] >> 5) | ((src_rgb565[1] & 0x07) << 3);
-        uint8_t r0 = src_rgb565[1] >> 3;
-        uint8_t b1 = src_rgb565[2] & 0x1f;
-        uint8_t g1 = (src_rgb565[2] >> 5) | ((src_rgb565[3] & 0x07) << 3);
-        uint8_t r1 = src_rgb565[3] >> 3;
-        uint8_t b2 = next_rgb565[0] & 0x1f;
-        uint8_t g2 = (next_rgb565[0] >> 5) | ((next_rgb565[1] & 0x07) << 3);
-        uint8_t r2 = next_rgb565[1] >> 3;
-        uint8_t b3 = next_rgb565[2] & 0x1f;
-        uint8_t g3 = (next_rgb565[2] >> 5) | ((next_rgb565[3] & 0x07) << 3);
-        uint8_t r3 = next_rgb565[3] >> 3;
-        uint8_t b = (b0 + b1 + b2 + b3);  // 565 * 4 = 787.
-        uint8_t g = (g0 + g1 + g2 + g3);
-        uint8_t r = (r0 + r1 + r2 + r3);
-        b = (b << 1) | (b >> 6);  // 787 -> 888.
-        r = (r << 1) | (r >> 6);
-        dst_yuyv[0] = RGBToY(r, g, b);
-        dst_yuyv[1] = RGBToV(r, g, b);
-        dst_yuyv[2] = RGBToY(r, g, b);
-        dst_yuyv[3] = RGBToU(r, g, b);
-        src_rgb565 += 4;
-        next_rgb565 += 4;
-        dst_yuyv += 4;
-    }
-
-    if (width & 1) {
-        uint8_t b0 = src_rgb565[0] & 0x1f;
-        uint8_t g0 = (src_rgb565[0] >> 5) | ((src_rgb565[1] & 0x07) << 3);
-        uint8_t r0 = src_rgb565[1] >> 3;
-        uint8_t b2 = next_rgb565[0] & 0x1f;
-        uint8_t g2 = (next_rgb565[0] >> 5) | ((next_rgb565[1] & 0x07) << 3);
-        uint8_t r2 = next_rgb565[1] >> 3;
-        uint8_t b = (b0 + b2);  // 565 * 2 = 676.
-        uint8_t g = (g0 + g2);
-        uint8_t r = (r0 + r2);
-        b = (b << 2) | (b >> 4);  // 676 -> 888
-        g = (g << 1) | (g >> 6);
-        r = (r << 2) | (r >> 4);
-        dst_yuyv[0] = RGBToY(r, g, b);
-        dst_yuyv[1] = RGBToV(r, g, b);
-        dst_yuyv[2] = 0x00; // garbage, needs crop
-        dst_yuyv[3] = RGBToU(r, g, b);
-    }
-}
-
-static __inline void Index8ToYUV422Row_C(const uint8_t* src_argb,
-                      uint8_t* dst_yuyv, int width, SkColorTable* table) {
-    uint8_t ar = 0;
-    uint8_t ag = 0;
-    uint8_t ab = 0;
-    SkPMColor pre = 0;
-    SkPMColor late = 0;
-
-    for (int x = 0; x < width - 1; x += 2) {
-        pre = (*table)[src_argb[0]];
-        late = (*table)[src_argb[1]];
-
-        ar = (SkGetPackedR32(pre)  + SkGetPackedR32(late)) >> 1;
-        ag = (SkGetPackedG32(pre) + SkGetPackedG32(late)) >> 1;
-        ab = (SkGetPackedB32(pre) + SkGetPackedB32(late)) >> 1;
-
-        dst_yuyv[0] = RGBToY(SkGetPackedB32(pre), SkGetPackedG32(pre), SkGetPackedR32(pre));
-        dst_yuyv[1] = RGBToU(ar, ag, ab);
-        dst_yuyv[2] = RGBToY(SkGetPackedB32(late), SkGetPackedG32(late), SkGetPackedR32(late));
-        dst_yuyv[3] = RGBToV(ar, ag, ab);
-        src_argb += 2;
-        dst_yuyv += 4;
-    }
-
-    if (width & 1) {
-        pre = (*table)[src_argb[0]];
-        dst_yuyv[0] = RGBToY(SkGetPackedB32(pre) , SkGetPackedG32(pre), SkGetPackedR32(pre));
-        dst_yuyv[1] = RGBToU(SkGetPackedB32(pre) , SkGetPackedG32(pre), SkGetPackedR32(pre));
-        dst_yuyv[2] = 0x00;     // garbage, needs crop
-        dst_yuyv[3] = RGBToV(SkGetPackedB32(pre) , SkGetPackedG32(pre), SkGetPackedR32(pre));
-    }
-}
-
 static void chmodSysfs(const char *sysfs, int mode) {
     char sysCmd[1024];
     sprintf(sysCmd, "chmod %d %s", mode, sysfs);
@@ -644,6 +546,9 @@ void ImagePlayerService::instantiate() {
 
 ImagePlayerService::ImagePlayerService()
     : mWidth(0), mHeight(0), mBitmap(NULL), mBufBitmap(NULL),
+    mTiledImage(new TiledImage()), mBufTiledImage(new TiledImage()),
+    mImageCache(new ImageCache<SkBitmap>(IMAGE_CACHE_DEFAULT_MB*1024*1024, IMAGE_PREFETCH_SLOTS)),
+    mBufferPool(new FrameBufferPool()), mMipPyramid(new MipPyramid(mBufferPool)),
     mSampleSize(1), mFileDescription(-1),
     surfaceWidth(SURFACE_4K_WIDTH), surfaceHeight(SURFACE_4K_HEIGHT),
     mScalingDirect(SCALE_NORMAL), mScalingStep(1.0f), mScalingBitmap(NULL),
@@ -651,10 +556,19 @@ ImagePlayerService::ImagePlayerService()
     mTranslatingDirect(TRANSLATE_NORMAL), mTranslateImage(false), mTx(0.0f), mTy(0.0f),
     mTranslateToXLEdge(false), mTranslateToXREdge(false), mTranslateToYTEdge(false), mTranslateToYBEdge(false),
     mMovieDegree(0), mMovieScale(1.0f), mMovieThread(NULL),
+    mMovieCache(new MovieFrameCache()), mMovieDeadline(0),
+    mJobsDone(0), mJobsCancelled(0), mLastDecodeMs(0),
     mParameter(NULL), mDisplayFd(-1), mHttpService(NULL) {
 }
 
 ImagePlayerService::~ImagePlayerService() {
+    delete mTiledImage;
+    delete mBufTiledImage;
+    delete mImageCache;
+    delete mMovieCache;
+    delete mMipPyramid;
+    //freed after the last pooled bitmap
+    mBufferPool->unref();
 }
 
 void ImagePlayerService::initVideoAxis() {
@@ -715,6 +629,24 @@ int ImagePlayerService::init() {
     free(bitmap_addr);
 #endif
 
+    char value[PROPERTY_VALUE_MAX];
+    int cacheMB = IMAGE_CACHE_DEFAULT_MB;
+    int slots = IMAGE_PREFETCH_SLOTS;
+    if (property_get("media.imageplayer.cachemb", value, NULL) > 0)
+        cacheMB = atoi(value);
+    if (property_get("media.imageplayer.prefetch", value, NULL) > 0)
+        slots = atoi(value);
+    if (cacheMB < 0)
+        cacheMB = 0;
+    mImageCache->setBudget((size_t)cacheMB*1024*1024, slots);
+
+    //remote images cache on disk, disabled if no dir is set
+    int httpCacheMB = HTTP_CACHE_DISK_DEFAULT_MB;
+    if (property_get("media.imageplayer.httpcache.mb", value, NULL) > 0)
+        httpCacheMB = atoi(value);
+    if ((property_get("media.imageplayer.httpcache.dir", value, NULL) > 0) && (httpCacheMB > 0))
+        HttpCache::getInstance()->setDiskCache(value, (size_t)httpCacheMB*1024*1024);
+
     mMovieThread = new MovieThread(this);
     mDeathNotifier = new DeathNotifier(this);
     mSystemControl = interface_cast<ISystemControlService>(
@@ -732,7 +664,10 @@ int ImagePlayerService::setDataSource (const sp<IMediaHTTPService> &httpService,
         return RET_ERR_PARAMETER;
     }
 
-    mHttpService = httpService;
+    {
+        Mutex::Autolock autoLock(mLock);
+        mHttpService = httpService;
+    }
     setDataSource(srcUrl);
     return RET_OK;
 }
@@ -748,34 +683,51 @@ int ImagePlayerService::notifyProcessDied (const sp<IBinder> &binder) {
 }
 
 int ImagePlayerService::setDataSource(const char *uri) {
-    Mutex::Autolock autoLock(mLock);
-
     ALOGI("setDataSource uri:%s", uri);
 
-    if (mBitmap != NULL) {
-        delete mBitmap;
-        mBitmap = NULL;
-    }
+    //the showing image is kept until prepare replace it, it still can be rotated or scaled
+    SkBitmap *bitmap = NULL;
+    char path[MAX_FILE_PATH_LEN];
+    memset(path, 0, MAX_FILE_PATH_LEN);
 
     if (!strncasecmp("file://", uri, 7)) {
-        strncpy(mImageUrl, uri + 7, MAX_FILE_PATH_LEN - 1);
+        strncpy(path, uri + 7, MAX_FILE_PATH_LEN - 1);
     } else if (!strncasecmp("http://", uri, 7) || !strncasecmp("https://", uri, 8)) {
-        strncpy(mImageUrl, uri, MAX_FILE_PATH_LEN - 1);
+        strncpy(path, uri, MAX_FILE_PATH_LEN - 1);
     } else {
         ALOGE("setDataSource error uri:%s", uri);
         return RET_ERR_INVALID_OPERATION;
     }
 
-    if (!isSupportFromat(uri, &mBitmap) && !isTiffByExtenName(uri)) {
+    sp<IMediaHTTPService> httpService;
+    {
+        Mutex::Autolock autoLock(mLock);
+        httpService = mHttpService;
+    }
+
+    //probe without mLock, a slow server must not stall the other calls
+    if (!isSupportFromat(uri, httpService, &bitmap) && !isTiffByExtenName(uri)) {
         ALOGE("setDataSource codec can not support it");
         return RET_ERR_INVALID_OPERATION;
     }
 
-    if (mBitmap != NULL) {
-        mWidth = mBitmap->width();
-        mHeight = mBitmap->height();
-        delete mBitmap;
-        mBitmap = NULL;
+    bool hasBounds = false;
+    int width = 0, height = 0;
+    if (bitmap != NULL) {
+        width = bitmap->width();
+        height = bitmap->height();
+        hasBounds = true;
+        delete bitmap;
+    }
+    else if (isTiffByExtenName(uri) && (path[0] == '/')) {
+        hasBounds = (TIFF2RGBA::tiffDecodeBound(path, &width, &height) == 0);
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    strncpy(mImageUrl, path, MAX_FILE_PATH_LEN - 1);
+    if (hasBounds) {
+        mWidth = width;
+        mHeight = height;
     }
 
     return RET_OK;
@@ -786,10 +738,7 @@ int ImagePlayerService::setDataSource(int fd, int64_t offset, int64_t length) {
 
     ALOGI("setDataSource fd:%d, offset:%d, length:%d", fd, (int)offset, (int)length);
 
-    if (mBitmap != NULL) {
-        delete mBitmap;
-        mBitmap = NULL;
-    }
+    SkBitmap *bitmap = NULL;
 
     if (mFileDescription >= 0) {
         close(mFileDescription);
@@ -797,15 +746,14 @@ int ImagePlayerService::setDataSource(int fd, int64_t offset, int64_t length) {
     }
     mFileDescription = dup(fd);
 
-    if (!isFdSupportedBySkImageDecoder(fd, &mBitmap)) {
+    if (!isFdSupportedBySkImageDecoder(fd, &bitmap)) {
         return RET_ERR_INVALID_OPERATION;
     }
 
-    if (mBitmap != NULL) {
-        mWidth = mBitmap->width();
-        mHeight = mBitmap->height();
-        delete mBitmap;
-        mBitmap = NULL;
+    if (bitmap != NULL) {
+        mWidth = bitmap->width();
+        mHeight = bitmap->height();
+        delete bitmap;
     }
 
     return RET_OK;
@@ -863,7 +811,7 @@ int ImagePlayerService::setRotate(float degrees, int autoCrop) {
 
         ALOGD("After rotate, Width: %d, Height: %d", dstBitmap->width(), dstBitmap->height());
         if ((dstBitmap->width() > surfaceWidth) || (dstBitmap->height() > surfaceHeight)) {
-            SkBitmap *dstCrop = cropAndFillBitmap(dstBitmap, surfaceWidth, surfaceHeight);
+            SkBitmap *dstCrop = cropAndFillBitmap(dstBitmap, surfaceWidth, surfaceHeight, mBufferPool);
             if (NULL != dstCrop) {
                 delete dstBitmap;
                 dstBitmap = dstCrop;
@@ -896,6 +844,24 @@ int ImagePlayerService::setScale(float sx, float sy, int autoCrop) {
         return RET_OK;
     }
 
+    if (mTiledImage->isOpen()) {
+        //the viewport has one scale and is always cut to the surface, a stretch to fill with
+        //autoCrop need the full bitmap, which a tiled image does not have
+        if (sx != sy) {
+            ALOGE("setScale, tiled image can not scale x and y apart, sx:%f, sy:%f, autoCrop:%d",
+                sx, sy, isAutoCrop);
+            return RET_ERR_INVALID_OPERATION;
+        }
+
+        //zoom re-decode the viewport from the tile index, no full bitmap to scale
+        int ret = RET_OK;
+        if (!mTiledImage->scaleBy(sx))
+            ret = (sx > 1.0f)?RET_OK_OPERATION_SCALE_MAX:RET_OK_OPERATION_SCALE_MIN;
+
+        int showRet = showTiledView();
+        return (showRet != RET_OK)?showRet:ret;
+    }
+
     if (sx != sy) {
         ALOGW("scale x and y not the same");
 
@@ -921,66 +887,38 @@ int ImagePlayerService::setScale(float sx, float sy, int autoCrop) {
         ALOGD("setScale, current direction:%d [0:normal, 1:up, 2:down], current step: %f",
             mScalingDirect, mScalingStep);
 
-        float realScale = 1.0f;
-        if (SCALE_NORMAL == mScalingDirect) {
-            if (mScalingBitmap != NULL)
-                delete mScalingBitmap;
-            mScalingBitmap = scaleAndCrop((mRotateBitmap != NULL)?mRotateBitmap:mBitmap, sx, sy);
-            realScale = mScalingStep*sx;
-            if (realScale > mScalingStep)
-                mScalingDirect = SCALE_UP;
-            else if (realScale < mScalingStep)
-                mScalingDirect = SCALE_DOWN;
-        }
-        else if (SCALE_UP == mScalingDirect) {
-            realScale = mScalingStep*sx;
-            if (realScale > mScalingStep) {
-                //still scale up, can use the scaling bitmap
-                SkBitmap *retBitmap = scaleAndCrop(mScalingBitmap, sx, sy);
-                if (retBitmap != NULL) {
-                    if (mScalingBitmap != NULL)
-                        delete mScalingBitmap;
-                    mScalingBitmap = retBitmap;
-                }
-            }
-            else if (realScale < mScalingStep) {
-                //now is scale down, can not use the scaling bitmap, must use the origin bitmap to scale
-                if (mScalingBitmap != NULL)
-                    delete mScalingBitmap;
-                mScalingBitmap = scaleStep((mRotateBitmap != NULL)?mRotateBitmap:mBitmap, realScale, realScale);
-            }
-
-            if (realScale < 1.0f)
-                mScalingDirect = SCALE_DOWN;
-            else if (realScale == 1.0f)
-                mScalingDirect = SCALE_NORMAL;
-        }
-        else if (SCALE_DOWN == mScalingDirect) {
-            realScale = mScalingStep*sx;
-            if (realScale > mScalingStep) {
-                //now is scale up, can not use the scaling bitmap, must use the origin bitmap to scale
-                if (mScalingBitmap != NULL)
-                    delete mScalingBitmap;
-                mScalingBitmap = scaleStep((mRotateBitmap != NULL)?mRotateBitmap:mBitmap, realScale, realScale);
-            }
-            else if (realScale < mScalingStep) {
-                //still scale down, can use the scaling bitmap
-                SkBitmap *retBitmap = scaleAndCrop(mScalingBitmap, sx, sy);
-                if (retBitmap != NULL) {
-                    if (mScalingBitmap != NULL)
-                        delete mScalingBitmap;
-                    mScalingBitmap = retBitmap;
-                }
-            }
+        //every step resample once from the mip level nearest to the real scale
+        int ret = RET_OK;
+        float realScale = mScalingStep*sx;
+        if (realScale > MIP_MAX_ZOOM) {
+            realScale = MIP_MAX_ZOOM;
+            ret = RET_OK_OPERATION_SCALE_MAX;
+        }
 
-            if (realScale > 1.0f)
-                mScalingDirect = SCALE_UP;
-            else if (realScale == 1.0f)
-                mScalingDirect = SCALE_NORMAL;
+        SkBitmap *srcBitmap = (mRotateBitmap != NULL)?mRotateBitmap:mBitmap;
+        if ((srcBitmap == NULL) || ((int)(srcBitmap->width()*realScale) <= 0)
+            || ((int)(srcBitmap->height()*realScale) <= 0)) {
+            return RET_OK_OPERATION_SCALE_MIN;
         }
 
+        SkBitmap *retBitmap = scaleByPyramid(srcBitmap, realScale);
+        if (retBitmap == NULL)
+            return RET_ERR_DECORDER;
+
+        if (mScalingBitmap != NULL)
+            delete mScalingBitmap;
+        mScalingBitmap = retBitmap;
+
+        if (realScale > 1.0f)
+            mScalingDirect = SCALE_UP;
+        else if (realScale < 1.0f)
+            mScalingDirect = SCALE_DOWN;
+        else
+            mScalingDirect = SCALE_NORMAL;
+
         mScalingStep = realScale;
         renderAndShow(mScalingBitmap);
+        return ret;
     }
     return RET_OK;
 }
@@ -1032,6 +970,11 @@ int ImagePlayerService::setTranslate(float tx, float ty) {
 
     ALOGD("setTranslate tx:%f, ty:%f", tx, ty);
 
+    if (mTiledImage->isOpen()) {
+        mTiledImage->translateBy(tx, ty);
+        return showTiledView();
+    }
+
     if (mScalingBitmap == NULL)
         return RET_ERR_INVALID_OPERATION;
 
@@ -1143,9 +1086,13 @@ int ImagePlayerService::setTranslate(float tx, float ty) {
 
     float realScale = 1.0f;
     realScale = mScalingStep*1.0f;
+    SkBitmap *retBitmap = scaleByPyramid((mRotateBitmap != NULL)?mRotateBitmap:mBitmap, realScale);
+    if (retBitmap == NULL)
+        return RET_ERR_DECORDER;
+
     if (mScalingBitmap != NULL)
         delete mScalingBitmap;
-    mScalingBitmap = scaleStep((mRotateBitmap != NULL)?mRotateBitmap:mBitmap, realScale, realScale);
+    mScalingBitmap = retBitmap;
     mScalingStep = realScale;
     renderAndShow(mScalingBitmap);
     return RET_OK;
@@ -1190,18 +1137,21 @@ int ImagePlayerService::setRotateScale(float degrees, float sx, float sy, int au
         //save the origin rotate bitmap
         SkBitmap *rotBitmap = rotate(mBitmap, degrees);
         if ((rotBitmap->width() > surfaceWidth) || (rotBitmap->height() > surfaceHeight)) {
-            SkBitmap *dstCrop = cropAndFillBitmap(rotBitmap, surfaceWidth, surfaceHeight);
+            SkBitmap *dstCrop = cropAndFillBitmap(rotBitmap, surfaceWidth, surfaceHeight, mBufferPool);
             if (NULL != dstCrop) {
                 delete rotBitmap;
                 rotBitmap = dstCrop;
             }
         }
-        if (mRotateBitmap != NULL)
+        if (mRotateBitmap != NULL) {
+            //the pyramid may be built on the former rotation
+            mMipPyramid->reset();
             delete mRotateBitmap;
+        }
         mRotateBitmap = rotBitmap;
 
         if ((dstBitmap->width() > surfaceWidth) || (dstBitmap->height() > surfaceHeight)) {
-            SkBitmap *dstCrop = cropAndFillBitmap(dstBitmap, surfaceWidth, surfaceHeight);
+            SkBitmap *dstCrop = cropAndFillBitmap(dstBitmap, surfaceWidth, surfaceHeight, mBufferPool);
             if (NULL != dstCrop) {
                 delete dstBitmap;
                 dstBitmap = dstCrop;
@@ -1234,6 +1184,16 @@ int ImagePlayerService::setCropRect(int cropX, int cropY, int cropWidth, int cro
         return RET_ERR_BAD_VALUE;
     }
 
+    if (mTiledImage->isOpen()) {
+        //crop rect is in the origin image, mBitmap is only the viewport
+        if (!mTiledImage->setViewRect(cropX, cropY, cropWidth, cropHeight)) {
+            ALOGD("Warning: parameters is not valid, image w:%d, h:%d",
+                mTiledImage->width(), mTiledImage->height());
+            return RET_ERR_PARAMETER;
+        }
+        return showTiledView();
+    }
+
     if ((-1 < cropX) && (cropX < mBitmap->width()) && (-1 < cropY) && (cropY < mBitmap->height())
         && (0 < cropWidth) && (0 < cropHeight) && ((cropX + cropWidth) <= mBitmap->width())
         && ((cropY + cropHeight) <= mBitmap->height())) {
@@ -1266,8 +1226,22 @@ int ImagePlayerService::start() {
 }
 
 int ImagePlayerService::release() {
+    Mutex::Autolock autoLock(mLock);
+
     ALOGI("release");
 
+    //decode in progress is dropped when it is done
+    if (mPrepareJob != NULL) {
+        cancelJob(mPrepareJob);
+        mPrepareJob.clear();
+    }
+    for (size_t i = 0; i < mBufJobs.size(); i++) {
+        cancelJob(mBufJobs[i]);
+    }
+    mBufJobs.clear();
+    mBufJob.clear();
+
+    mMipPyramid->reset();
     if (mBitmap != NULL) {
         delete mBitmap;
         mBitmap = NULL;
@@ -1277,6 +1251,14 @@ int ImagePlayerService::release() {
         delete mBufBitmap;
         mBufBitmap = NULL;
     }
+    mTiledImage->close();
+    mBufTiledImage->close();
+    mImageCache->clear();
+    HttpCache::getInstance()->clear();
+    mBitmapKey.clear();
+    mBufKey.clear();
+    //give the idle frame buffers back to system
+    mBufferPool->trim();
 
     delete mParameter;
     mParameter = NULL;
@@ -1297,6 +1279,7 @@ int ImagePlayerService::release() {
         mMovieThread.clear();
         delete mSkMovie;
         mSkMovie = NULL;
+        mMovieCache->reset(0);
     }
 
     resetRotateScale();
@@ -1305,7 +1288,7 @@ int ImagePlayerService::release() {
     return RET_OK;
 }
 
-SkBitmap* ImagePlayerService::decode(SkStreamRewindable *stream, InitParameter *mParameter) {
+SkBitmap* ImagePlayerService::decode(SkStreamRewindable *stream, InitParameter *mParameter, DecodeJob *job) {
     SkImageDecoder::Format format = SkImageDecoder::kUnknown_Format;
     SkImageDecoder* codec = NULL;
     bool ret = false;
@@ -1318,10 +1301,8 @@ SkBitmap* ImagePlayerService::decode(SkStreamRewindable *stream, InitParameter *
     //SkASSERT(bufferedStream.get() != NULL);
     codec = SkImageDecoder::Factory(stream);
     if (codec) {
-        ret = codec->buildTileIndex(stream->duplicate(), &imageW, &imageH);
-        if (!ret) {
-            ALOGE("buildTileIndex failed to decode using %s decoder", codec->getFormatName());
-        }
+        //a newer prepare can cancel this codec
+        setJobCodec(job, codec);
 
         //in order to free the pointer
         //SkAutoTDelete<SkImageDecoder> add(codec);
@@ -1329,8 +1310,8 @@ SkBitmap* ImagePlayerService::decode(SkStreamRewindable *stream, InitParameter *
         ALOGI("decode using %s decoder", codec->getFormatName());
         if (format != SkImageDecoder::kUnknown_Format) {
             bitmap = new SkBitmap();
-            if (mSampleSize > 0) {
-                codec->setSampleSize(mSampleSize);
+            if (job->sampleSize > 0) {
+                codec->setSampleSize(job->sampleSize);
             } else {
                 codec->setSampleSize(1);
             }
@@ -1345,14 +1326,14 @@ SkBitmap* ImagePlayerService::decode(SkStreamRewindable *stream, InitParameter *
             ret = codec->decode(stream, &decodingBitmap,
                     kN32_SkColorType,
                     SkImageDecoder::kDecodePixels_Mode);
-            if (!ret) {
-                ALOGW("decode fail result:%d, try to use decodeSubset, uri:%s", ret, mImageUrl);
+            if (!ret && !isJobCancelled(job)) {
+                ALOGW("decode fail result:%d, try to use decodeSubset, uri:%s", ret, job->path.string());
 
-                SkFILEStream fstream(mImageUrl);
+                SkFILEStream fstream(job->path.string());
                 SkImageDecoder* decoder = SkImageDecoder::Factory(&fstream);
                 if (NULL != decoder) {
-                    if (mSampleSize > 0)
-                        decoder->setSampleSize(mSampleSize);
+                    if (job->sampleSize > 0)
+                        decoder->setSampleSize(job->sampleSize);
                     else
                         decoder->setSampleSize(1);
 
@@ -1378,6 +1359,7 @@ SkBitmap* ImagePlayerService::decode(SkStreamRewindable *stream, InitParameter *
         } else {
             ALOGE("format is SkImageDecoder::kUnknown_Format!");
         }
+        setJobCodec(job, NULL);
         delete codec;
     } else {
         ALOGE("decode: codec is NULL!: '%s' (%d)", strerror(errno), errno);
@@ -1413,41 +1395,95 @@ SkBitmap* ImagePlayerService::decode(SkStreamRewindable *stream, InitParameter *
     }
 
     if (bitmap != NULL ) {
-        mWidth = bitmap->width();
-        mHeight = bitmap->height();
-        ALOGD("Image raw size, width:%d, height:%d", mWidth, mHeight);
+        job->width = bitmap->width();
+        job->height = bitmap->height();
+        ALOGD("Image raw size, width:%d, height:%d", job->width, job->height);
     }
 
     return bitmap;
 }
 
-SkBitmap* ImagePlayerService::decodeTiff(const char *filePath) {
-    int width = 0;
-    int height = 0;
+//tiff is read by strips or tiles and downsampled on the fly, the peak memory
+//follow the output, larger tiff is shown by viewport tiles as other formats
+SkBitmap* ImagePlayerService::decodeTiff(const char *filePath, DecodeJob *job) {
+    //one open for the bounds and the pixels
+    TiffImage tiff;
+    if (!tiff.open(filePath)) {
+        ALOGE("decode tiff, can not get the size of %s", filePath);
+        return NULL;
+    }
+    int width = tiff.width();
+    int height = tiff.height();
 
-    TIFF2RGBA::tiffDecodeBound(filePath, &width, &height);
     if ((width > MAX_PIC_SIZE) || (height > MAX_PIC_SIZE)) {
-        ALOGE("decode tiff size is too large, we only support w < %d and h < %d, now image size w:%d, h:%d",
-            MAX_PIC_SIZE, MAX_PIC_SIZE, width, height);
+        tiff.close();
+        ALOGI("decode tiff w:%d, h:%d is larger than %d, decode it by tiles",
+            width, height, MAX_PIC_SIZE);
+
+        TiledImage *tiledImage = new TiledImage();
+        if (!tiledImage->openTiff(filePath)) {
+            delete tiledImage;
+            return NULL;
+        }
+        job->isTiled = true;
+        return renderTiled(tiledImage, job);
     }
-    else {
-        SkBitmap *bitmap = new SkBitmap();
-        int ret = TIFF2RGBA::tiffDecoder(filePath, bitmap);
-        ALOGI("decode tiff result:%d, width:%d, height:%d", ret, bitmap->width(), bitmap->height());
 
-        mWidth = bitmap->width();
-        mHeight = bitmap->height();
-        if ((bitmap->width() > 0) && (bitmap->height() > 0)) {
-            return bitmap;
-        }
-        else {
-            delete bitmap;
-        }
+    //the result is fit to surface later, more pixels than that are useless
+    float fitScale = 1.0f;
+    if ((job->surfaceW > 0) && (job->surfaceH > 0)) {
+        float scaleX = (float)job->surfaceW/width;
+        float scaleY = (float)job->surfaceH/height;
+        fitScale = (scaleX < scaleY)?scaleX:scaleY;
     }
+    int sample = (job->sampleSize > 1)?job->sampleSize:1;
+    while (sample*2*fitScale <= 1.0f)
+        sample *= 2;
+
+    SkBitmap *bitmap = new SkBitmap();
+    int ret = tiff.decodeRegion(0, 0, width, height, sample, bitmap);
+    ALOGI("decode tiff result:%d, sample:%d, width:%d, height:%d", ret, sample, bitmap->width(), bitmap->height());
 
+    job->width = bitmap->width();
+    job->height = bitmap->height();
+    if ((ret == 0) && (bitmap->width() > 0) && (bitmap->height() > 0)) {
+        return bitmap;
+    }
+
+    delete bitmap;
     return NULL;
 }
 
+SkBitmap* ImagePlayerService::decodeTiled(SkStreamRewindable *stream, DecodeJob *job) {
+    TiledImage *tiledImage = new TiledImage();
+    if (!tiledImage->open(stream)) {
+        ALOGE("decode tiled image, can not build tile index");
+        delete tiledImage;
+        return NULL;
+    }
+
+    return renderTiled(tiledImage, job);
+}
+
+//render the first viewport, the job take the tiled image if it is OK
+SkBitmap* ImagePlayerService::renderTiled(TiledImage *tiledImage, DecodeJob *job) {
+    tiledImage->setSurfaceSize(job->surfaceW, job->surfaceH);
+    SkBitmap *bitmap = tiledImage->render(mBufferPool);
+    if (NULL == bitmap) {
+        delete tiledImage;
+        return NULL;
+    }
+
+    //the job own the tile index until the image is shown
+    job->tiledImage = tiledImage;
+    job->width = tiledImage->width();
+    job->height = tiledImage->height();
+
+    ALOGI("decode tiled image w:%d, h:%d, viewport w:%d, h:%d",
+        tiledImage->width(), tiledImage->height(), bitmap->width(), bitmap->height());
+    return bitmap;
+}
+
 SkBitmap* ImagePlayerService::scale(SkBitmap *srcBitmap, float sx, float sy) {
     if (srcBitmap == NULL)
         return NULL;
@@ -1461,18 +1497,17 @@ SkBitmap* ImagePlayerService::scale(SkBitmap *srcBitmap, float sx, float sy) {
     }
 
     SkBitmap *devBitmap = new SkBitmap();
-    SkMatrix *matrix = new SkMatrix();
-    SkCanvas *canvas = NULL;
+    SkMatrix matrix;
 
     SkColorType colorType = colorTypeForScaledOutput(srcBitmap->colorType());
     devBitmap->setInfo(SkImageInfo::Make(dstWidth, dstHeight,
             colorType, srcBitmap->alphaType()));
 
-    devBitmap->allocPixels();
+    devBitmap->allocPixels(mBufferPool, NULL);
 
-    canvas = new SkCanvas(*devBitmap);
+    SkCanvas canvas(*devBitmap);
 
-    matrix->postScale(sx, sy);
+    matrix.postScale(sx, sy);
 
     SkPaint paint;
     paint.setAntiAlias(true);
@@ -1481,11 +1516,8 @@ SkBitmap* ImagePlayerService::scale(SkBitmap *srcBitmap, float sx, float sy) {
     //canvas->drawBitmapMatrix(*srcBitmap, *matrix, &paint);
 
     //SkAutoCanvasRestore acr(canvas, true);
-    canvas->concat(*matrix);
-    canvas->drawBitmap(*srcBitmap, 0, 0, &paint);
-
-    delete canvas;
-    delete matrix;
+    canvas.concat(matrix);
+    canvas.drawBitmap(*srcBitmap, 0, 0, &paint);
 
     return devBitmap;
 }
@@ -1495,8 +1527,7 @@ SkBitmap* ImagePlayerService::rotate(SkBitmap *srcBitmap, float degrees) {
         return NULL;
 
     SkBitmap *devBitmap = new SkBitmap();
-    SkMatrix *matrix = new SkMatrix();
-    SkCanvas *canvas = NULL;
+    SkMatrix matrix;
 
     int sourceWidth = srcBitmap->width();
     int sourceHeight = srcBitmap->height();
@@ -1509,12 +1540,12 @@ SkBitmap* ImagePlayerService::rotate(SkBitmap *srcBitmap, float degrees) {
     devBitmap->setInfo(SkImageInfo::Make(dstWidth, dstHeight,
             colorType, srcBitmap->alphaType()));
 
-    devBitmap->allocPixels();
+    devBitmap->allocPixels(mBufferPool, NULL);
 
-    canvas = new SkCanvas(*devBitmap);
+    SkCanvas canvas(*devBitmap);
 
-    matrix->postRotate(degrees, sourceWidth / 2, sourceHeight / 2);
-    matrix->postTranslate((dstWidth - sourceWidth) / 2, (dstHeight - sourceHeight) / 2);
+    matrix.postRotate(degrees, sourceWidth / 2, sourceHeight / 2);
+    matrix.postTranslate((dstWidth - sourceWidth) / 2, (dstHeight - sourceHeight) / 2);
 
     SkPaint paint;
     paint.setAntiAlias(true);
@@ -1522,11 +1553,8 @@ SkBitmap* ImagePlayerService::rotate(SkBitmap *srcBitmap, float degrees) {
     //canvas->drawBitmapMatrix(*srcBitmap, *matrix, &paint);
 
     //SkAutoCanvasRestore acr(canvas, true);
-    canvas->concat(*matrix);
-    canvas->drawBitmap(*srcBitmap, 0, 0, &paint);
-
-    delete canvas;
-    delete matrix;
+    canvas.concat(matrix);
+    canvas.drawBitmap(*srcBitmap, 0, 0, &paint);
 
     return devBitmap;
 }
@@ -1549,20 +1577,19 @@ SkBitmap* ImagePlayerService::rotateAndScale(SkBitmap *srcBitmap, float degrees,
     }
 
     SkBitmap *devBitmap = new SkBitmap();
-    SkMatrix *matrix = new SkMatrix();
-    SkCanvas *canvas = NULL;
+    SkMatrix matrix;
 
     SkColorType colorType = colorTypeForScaledOutput(srcBitmap->colorType());
     devBitmap->setInfo(SkImageInfo::Make(dstWidthAfterScale, dstHeightAfterScale,
             colorType, srcBitmap->alphaType()));
 
-    devBitmap->allocPixels();
+    devBitmap->allocPixels(mBufferPool, NULL);
 
-    canvas = new SkCanvas(*devBitmap);
+    SkCanvas canvas(*devBitmap);
 
-    matrix->postRotate(degrees, sourceWidth / 2, sourceHeight / 2);
-    matrix->postTranslate((dstWidthAfterRotate - sourceWidth) / 2, (dstHeightAfterRotate - sourceHeight) / 2);
-    matrix->postScale(sx, sy);
+    matrix.postRotate(degrees, sourceWidth / 2, sourceHeight / 2);
+    matrix.postTranslate((dstWidthAfterRotate - sourceWidth) / 2, (dstHeightAfterRotate - sourceHeight) / 2);
+    matrix.postScale(sx, sy);
 
     SkPaint paint;
     paint.setAntiAlias(true);
@@ -1570,153 +1597,216 @@ SkBitmap* ImagePlayerService::rotateAndScale(SkBitmap *srcBitmap, float degrees,
     //canvas->drawBitmapMatrix(*srcBitmap, *matrix, &paint);
 
     //SkAutoCanvasRestore acr(canvas, true);
-    canvas->concat(*matrix);
-    canvas->drawBitmap(*srcBitmap, 0, 0, &paint);
-
-    delete canvas;
-    delete matrix;
+    canvas.concat(matrix);
+    canvas.drawBitmap(*srcBitmap, 0, 0, &paint);
 
     return devBitmap;
 }
 
 //render to video layer
 int ImagePlayerService::prepare() {
-    Mutex::Autolock autoLock(mLock);
-    FrameInfo_t info;
-
-    ALOGI("prepare image path:%s", mImageUrl);
-    if ((mFileDescription < 0) && (0 == strlen(mImageUrl))) {
-        ALOGE("prepare decode image fd error");
-        return RET_ERR_BAD_VALUE;
-    }
+    sp<DecodeJob> job;
+    {
+        Mutex::Autolock autoLock(mLock);
 
-    if (mWidth > MAX_PIC_SIZE || mHeight > MAX_PIC_SIZE) {
-        ALOGE("prepare image size is too large, we only support w < %d and h < %d, now image size w:%d, h:%d",
-            MAX_PIC_SIZE, MAX_PIC_SIZE, mWidth, mHeight);
-        return RET_ERR_NO_MEMORY;
-    }
-
-    SkStreamRewindable *stream;
-    if (mFileDescription >= 0) {
-        SkAutoTUnref<SkData> data(SkData::NewFromFD(mFileDescription));
-        if (data.get() == NULL) {
+        ALOGI("prepare image path:%s", mImageUrl);
+        if ((mFileDescription < 0) && (0 == strlen(mImageUrl))) {
+            ALOGE("prepare decode image fd error");
             return RET_ERR_BAD_VALUE;
         }
-        stream = new SkMemoryStream(data);
-    } else if (!strncasecmp("http://", mImageUrl, 7) || !strncasecmp("https://", mImageUrl, 8)) {
-        stream = new SkHttpStream(mImageUrl, mHttpService);
-    } else {
-        stream = new SkFILEStream(mImageUrl);
-    }
 
-    if (mBitmap != NULL) {
-        delete mBitmap;
-        mBitmap = NULL;
-    }
+        //larger image only can be shown by tiles, movie has no tile index
+        bool isTiled = (mWidth > MAX_PIC_SIZE || mHeight > MAX_PIC_SIZE);
+        if (isTiled && isMovieByExtenName(mImageUrl)) {
+            ALOGE("prepare image size is too large, we only support w < %d and h < %d, now image size w:%d, h:%d",
+                MAX_PIC_SIZE, MAX_PIC_SIZE, mWidth, mHeight);
+            return RET_ERR_NO_MEMORY;
+        }
 
-    mMovieImage = false;
-    if (isMovieByExtenName(mImageUrl)) {
-        ALOGI("it's a movie image, show it with thread");
+        //fd has no uri, tiled and movie image are not kept as a whole bitmap
+        String8 key;
+        if ((mFileDescription < 0) && !isTiled && !isMovieByExtenName(mImageUrl))
+            key = cacheKey(mImageUrl);
 
-        mMovieImage = true;
-        if (MovieInit(mImageUrl)) {
-            delete stream;
-            return RET_OK;
+        //the stale decode is useless now
+        if (mPrepareJob != NULL) {
+            cancelJob(mPrepareJob);
+            mPrepareJob.clear();
+        }
+
+        if (!key.isEmpty()) {
+            SkBitmap *bitmap = NULL;
+            if ((NULL != mBitmap) && (mBitmapKey == key)) {
+                //the showing image is asked again
+                bitmap = mBitmap;
+            } else {
+                //only a hit replace the showing image here, on a miss it is kept
+                //and can be rotated or scaled until the decode hand over the new one
+                bitmap = mImageCache->take(key);
+                if (NULL != bitmap)
+                    releaseBitmap();
+            }
+            if (NULL != bitmap) {
+                ALOGI("prepare image from cache, w:%d, h:%d", bitmap->width(), bitmap->height());
+                mTiledImage->close();
+                mMovieImage = false;
+                mBitmap = bitmap;
+                mBitmapKey = key;
+
+                resetRotateScale();
+                resetTranslate();
+                render(VIDEO_LAYER_FORMAT_RGBA, mBitmap);
+                return RET_OK;
+            }
         }
-        else{
-            //delete stream;
-            //return RET_ERR_BAD_VALUE;
+
+        mMovieImage = false;
+        if (isMovieByExtenName(mImageUrl)) {
+            ALOGI("it's a movie image, show it with thread");
+
+            mMovieImage = true;
+            if (MovieInit(mImageUrl)) {
+                return RET_OK;
+            }
             mMovieImage = false;
-            mBitmap = decode(stream, NULL);
         }
-    }
-    else if (isTiffByExtenName(mImageUrl)) {
-        mBitmap = decodeTiff(mImageUrl);
-    }
-    else {
-        mBitmap = decode(stream, NULL);
-    }
-    delete stream;
 
-    if (mBitmap == NULL) {
-        ALOGE("prepare decode result bitmap is NULL");
-        return RET_ERR_BAD_VALUE;
-    }
+        job = new DecodeJob();
+        job->path = mImageUrl;
+        if (mFileDescription >= 0)
+            job->fd = dup(mFileDescription);
+        job->isTiled = isTiled;
+        job->sampleSize = mSampleSize;
+        job->surfaceW = surfaceWidth;
+        job->surfaceH = surfaceHeight;
+        job->key = key;
 
-    if (mWidth <= 0 || mHeight <= 0) {
-        ALOGE("prepare decode result bitmap size error");
-        return RET_ERR_BAD_VALUE;
+        mPrepareJob = job;
+        submitJob(job);
     }
 
-    if (mWidth > MAX_PIC_SIZE || mHeight > MAX_PIC_SIZE) {
-        ALOGE("prepare image size is too large, we only support w < %d and h < %d, now image size w:%d, h:%d",
-            MAX_PIC_SIZE, MAX_PIC_SIZE, mWidth, mHeight);
-        return RET_ERR_NO_MEMORY;
+    //decode without mLock, the showing image still can be rotated, scaled or released
+    waitJob(job);
+
+    Mutex::Autolock autoLock(mLock);
+    if (mPrepareJob != job) {
+        ALOGW("prepare image path:%s is cancelled", job->path.string());
+        return RET_ERR_INVALID_OPERATION;
     }
+    mPrepareJob.clear();
+
+    if (job->result != RET_OK)
+        return job->result;
 
     if (mDisplayFd < 0) {
         ALOGE("render, but displayFd can not ready");
         return RET_ERR_BAD_VALUE;
     }
 
-#if 0
-    float scaleX = 1.0f;
-    float scaleY = 1.0f;
-    if(mWidth > surfaceWidth){
-        scaleX = (float)surfaceWidth/mWidth;
-    }
+    //the showing image go back to cache, then move the decoded one to show
+    releaseBitmap();
+    mBitmap = job->bitmap;
+    job->bitmap = NULL;
+    //the viewport of a tiled image is never cached
+    mBitmapKey = (NULL == job->tiledImage)?job->key:String8();
+    mWidth = job->width;
+    mHeight = job->height;
 
-    if(mHeight > surfaceHeight){
-        scaleY = (float)surfaceHeight/mHeight;
+    mTiledImage->close();
+    if (NULL != job->tiledImage) {
+        TiledImage *tiledImage = mTiledImage;
+        mTiledImage = job->tiledImage;
+        job->tiledImage = tiledImage;
     }
 
-    if(scaleX < scaleY) scaleY = scaleX;
-    else if(scaleX > scaleY) scaleX = scaleY;
+    resetRotateScale();
+    resetTranslate();
+    render(VIDEO_LAYER_FORMAT_RGBA, mBitmap);
+    ALOGI("prepare render is OK");
+    return RET_OK;
+}
 
-    if ((scaleX != 1.0f) || (scaleY != 1.0f)) {
-        SkBitmap *dstBitmap = scale(mBitmap, scaleX, scaleY);
-        if (dstBitmap != NULL) {
-            delete mBitmap;
-            mBitmap = dstBitmap;
+//check the format and bounds of a prefetch, it run without mLock
+int ImagePlayerService::probeBuf(const char *path, const sp<IMediaHTTPService>& httpService,
+        bool *isTiled) {
+    bool isHttp = !strncasecmp("http://", path, 7) || !strncasecmp("https://", path, 8);
+    *isTiled = false;
+
+    //tiff choose whole image or tiles by itself
+    if (isTiffByExtenName(path)) {
+        int width = 0, height = 0;
+        if (!isHttp && (TIFF2RGBA::tiffDecodeBound(path, &width, &height) != 0)) {
+            ALOGE("prepare buffer tiff can not be opened");
+            return RET_ERR_INVALID_OPERATION;
         }
+        return RET_OK;
+    }
 
-        ALOGD("prepare scale sx:%f, sy:%f", scaleX, scaleY);
+    //prefetch has no bounds from setDataSource, larger image use tiles
+    SkBitmap *bounds = NULL;
+    bool isSupport = false;
+    if (isHttp) {
+        SkHttpStream httpStream(path, httpService);
+        isSupport = verifyBySkImageDecoder(&httpStream, &bounds);
+    } else {
+        SkFILEStream stream(path);
+        isSupport = verifyBySkImageDecoder(&stream, &bounds);
     }
-#endif
 
-    SkBitmap *dstBitmap = fillSurface(mBitmap);
-    if (dstBitmap != NULL) {
-        delete mBitmap;
-        mBitmap = dstBitmap;
+    if (!isSupport) {
+        ALOGE("prepare buffer codec can not support it");
+        return RET_ERR_INVALID_OPERATION;
     }
 
-    resetRotateScale();
-    resetTranslate();
-    render(VIDEO_LAYER_FORMAT_RGBA, mBitmap);
-    ALOGI("prepare render is OK");
+    if (bounds != NULL) {
+        if ((bounds->width() > MAX_PIC_SIZE) || (bounds->height() > MAX_PIC_SIZE)) {
+            ALOGI("prepare buffer image w:%d, h:%d is larger than %d, decode it by tiles",
+                bounds->width(), bounds->height(), MAX_PIC_SIZE);
+            *isTiled = true;
+        }
+        delete bounds;
+    }
     return RET_OK;
 }
 
 int ImagePlayerService::prepareBuf(const char *uri) {
-    Mutex::Autolock autoLock(mLock);
-
     ALOGI("prepare buffer image path:%s", uri);
     char path[MAX_FILE_PATH_LEN];
-    SkStreamRewindable *stream;
+    memset(path, 0, MAX_FILE_PATH_LEN);
     if (!strncasecmp("file://", uri, 7)) {
         strncpy(path, uri + 7, MAX_FILE_PATH_LEN - 1);
-        stream = new SkFILEStream(path);
     } else if (!strncasecmp("http://", uri, 7) || !strncasecmp("https://", uri, 8)) {
         strncpy(path, uri, MAX_FILE_PATH_LEN - 1);
-        stream = new SkHttpStream(path, mHttpService);
     } else {
         return RET_ERR_INVALID_OPERATION;
     }
 
+    //the format error is returned here, only the decode itself is left to showBuf
+    bool isTiled = false;
+    if (!isMovieByExtenName(uri)) {
+        if (!isPhotoByExtenName(uri) && !isTiffByExtenName(uri)) {
+            ALOGE("prepare buffer codec can not support it");
+            return RET_ERR_INVALID_OPERATION;
+        }
+
+        sp<IMediaHTTPService> httpService;
+        {
+            Mutex::Autolock autoLock(mLock);
+            httpService = mHttpService;
+        }
+        int ret = probeBuf(path, httpService, &isTiled);
+        if (ret != RET_OK)
+            return ret;
+    }
+
+    Mutex::Autolock autoLock(mLock);
     if (mBufBitmap != NULL) {
         delete mBufBitmap;
         mBufBitmap = NULL;
     }
+    mBufTiledImage->close();
+    mBufKey.clear();
+    mBufJob.clear();
 
     mMovieImage = false;
     if (isMovieByExtenName(uri)) {
@@ -1724,71 +1814,100 @@ int ImagePlayerService::prepareBuf(const char *uri) {
 
         mMovieImage = true;
         if (MovieInit(path)) {
-            delete stream;
             return RET_OK;
         }
-        else {
-            //delete stream;
-            //return RET_ERR_INVALID_OPERATION;
-            mMovieImage = false;
-            mBufBitmap = decode(stream, NULL);
-        }
-    }
-    else if (isTiffByExtenName(uri)) {
-        mBufBitmap = decodeTiff(path);
+        mMovieImage = false;
     }
-    else {
-        bool canDecode = true;
-        SkBitmap *bitmap = NULL;
-        if (!isSupportFromat(uri, &bitmap)) {
-            ALOGE("prepare buffer codec can not support it");
-            delete stream;
-            return RET_ERR_INVALID_OPERATION;
-        }
 
-        if (bitmap != NULL) {
-            if ((bitmap->width() > MAX_PIC_SIZE) || (bitmap->height() > MAX_PIC_SIZE)) {
-                canDecode = false;//too large, can not decode because no enough memory
-                ALOGE("prepare buffer image size is too large, we only support w < %d and h < %d, now image size w:%d, h:%d",
-                    MAX_PIC_SIZE, MAX_PIC_SIZE, bitmap->width(), bitmap->height());
-            }
-            delete bitmap;
-            bitmap = NULL;
-        }
-
-        if (canDecode)
-            mBufBitmap = decode(stream, NULL);
+    if (!isPhotoByExtenName(uri) && !isTiffByExtenName(uri)) {
+        ALOGE("prepare buffer codec can not support it");
+        return RET_ERR_INVALID_OPERATION;
     }
-    delete stream;
 
-    if (mBufBitmap == NULL) {
-        ALOGI("prepare buffer decode result bitmap is NULL");
-        return RET_ERR_BAD_VALUE;
+    //the former prefetched images stay in the cache slots
+    String8 key;
+    if (!isMovieByExtenName(uri))
+        key = cacheKey(path);
+    if (!key.isEmpty() && mImageCache->contains(key)) {
+        ALOGI("prepare buffer image from cache");
+        mImageCache->prefetch(key);
+        mBufKey = key;
+        return RET_OK;
     }
 
-    ALOGI("prepare buffer image w:%d, w:%d", mBufBitmap->width(), mBufBitmap->height());
-    if (mBufBitmap->width() <= 0 || mBufBitmap->height() <= 0){
-        ALOGI("prepare buffer decode result bitmap size error");
-        return RET_ERR_BAD_VALUE;
-    }
+    sp<DecodeJob> job = new DecodeJob();
+    job->path = path;
+    job->isBuffer = true;
+    job->isTiled = isTiled;
+    job->sampleSize = mSampleSize;
+    job->surfaceW = surfaceWidth;
+    job->surfaceH = surfaceHeight;
+    job->key = key;
 
-    SkBitmap *dstBitmap = fillSurface(mBufBitmap);
-    if (dstBitmap != NULL) {
-        delete mBufBitmap;
-        mBufBitmap = dstBitmap;
+    //only the newest slots are decoded, older prefetch is cancelled
+    for (size_t i = 0; i < mBufJobs.size(); ) {
+        if (isJobDone(mBufJobs[i]))
+            mBufJobs.removeAt(i);
+        else
+            i++;
+    }
+    mBufJobs.push(job);
+    while (mBufJobs.size() > (size_t)mImageCache->slots()) {
+        cancelJob(mBufJobs[0]);
+        mBufJobs.removeAt(0);
     }
 
+    mBufJob = job;
+    mBufKey = key;
+    submitJob(job);
     return RET_OK;
 }
 
 //post buffer to display device
 int ImagePlayerService::showBuf() {
+    sp<DecodeJob> job;
+    {
+        Mutex::Autolock autoLock(mLock);
+        job = mBufJob;
+    }
+
+    //prepareBuf return at once, wait the decode here without mLock
+    if (job != NULL)
+        waitJob(job);
+
+    Mutex::Autolock autoLock(mLock);
+    if (job != NULL) {
+        if (mBufJob != job) {
+            ALOGW("show buffer, decode is cancelled");
+            return RET_ERR_INVALID_OPERATION;
+        }
+        mBufJob.clear();
+
+        if (job->result != RET_OK) {
+            ALOGE("show buffer, decode result:%d", job->result);
+            mBufKey.clear();
+            return job->result;
+        }
+
+        //it is not in a prefetch slot, the job still own it
+        if (NULL != job->bitmap) {
+            mBufBitmap = job->bitmap;
+            job->bitmap = NULL;
+            mBufKey.clear();
+        }
+        if (NULL != job->tiledImage) {
+            TiledImage *tiledImage = mBufTiledImage;
+            mBufTiledImage = job->tiledImage;
+            job->tiledImage = tiledImage;
+        }
+    }
+
     if (mDisplayFd < 0) {
         ALOGE("show buffer, but displayFd has not ready");
         return RET_ERR_BAD_VALUE;
     }
 
-    if (NULL == mBufBitmap) {
+    if ((NULL == mBufBitmap) && (mBufKey.isEmpty() || !mImageCache->contains(mBufKey))) {
         ALOGE("show buffer, but bitmap buffer is NULL");
         return RET_ERR_BAD_VALUE;
     }
@@ -1798,32 +1917,214 @@ int ImagePlayerService::showBuf() {
 
     MovieThreadStop();
 
-    if (NULL != mBitmap)
-        delete mBitmap;
-    else
-        ALOGW("mBitmap is NULL, need first new a object");
-    mBitmap = new SkBitmap();
+    //swap the buffer to show without copy, the showing image go back to cache
+    releaseBitmap();
+    if (NULL != mBufBitmap) {
+        mBitmap = mBufBitmap;
+        mBufBitmap = NULL;
+    }
+    else {
+        mBitmap = mImageCache->take(mBufKey);
+        mBitmapKey = mBufKey;
+    }
+    mBufKey.clear();
 
-    //copy bitmap data to showing bitmap
-    bool ret = false;
-    ret = mBufBitmap->copyTo(mBitmap, kN32_SkColorType);
+    //the showing image keep the tile index of the buffer, if it has one
+    TiledImage *tiledImage = mTiledImage;
+    mTiledImage = mBufTiledImage;
+    mBufTiledImage = tiledImage;
+    mBufTiledImage->close();
 
-    if (!ret) {
-        ALOGE("show buffer, copy buffer to show bitmap error");
-        return RET_ERR_BAD_VALUE;
-    }
     resetRotateScale();
     resetTranslate();
 
-    render(VIDEO_LAYER_FORMAT_RGBA, mBufBitmap);
+    render(VIDEO_LAYER_FORMAT_RGBA, mBitmap);
     post();
-
-    //delete buffer bitmap to save memory
-    delete mBufBitmap;
-    mBufBitmap = NULL;
     return RET_OK;
 }
 
+bool ImagePlayerService::decodeThreadLoop() {
+    sp<DecodeJob> job;
+    {
+        Mutex::Autolock autoLock(mJobLock);
+        while (mJobQueue.empty()) {
+            mJobCond.wait(mJobLock);
+        }
+        job = *mJobQueue.begin();
+        mJobQueue.erase(mJobQueue.begin());
+        job->state = DECODE_JOB_RUNNING;
+    }
+
+    nsecs_t begin = systemTime(SYSTEM_TIME_MONOTONIC);
+    runJob(job);
+    job->decodeMs = (int)ns2ms(systemTime(SYSTEM_TIME_MONOTONIC) - begin);
+
+    //prefetched image go into its slot at once, then the prefetch is not evicted
+    if (job->isBuffer && (RET_OK == job->result) && !job->key.isEmpty() && (NULL == job->tiledImage)) {
+        Mutex::Autolock autoLock(mLock);
+        if (!isJobCancelled(job.get()) && mImageCache->put(job->key, job->bitmap)) {
+            mImageCache->prefetch(job->key);
+            job->bitmap = NULL;
+        }
+    }
+
+    Mutex::Autolock autoLock(mJobLock);
+    if (job->cancelled)
+        job->result = RET_ERR_INVALID_OPERATION;
+    else
+        mJobsDone++;
+    mLastDecodeMs = job->decodeMs;
+    job->state = DECODE_JOB_DONE;
+    mJobDoneCond.broadcast();
+    ALOGI("decode job path:%s, result:%d, cost:%dms", job->path.string(), job->result, job->decodeMs);
+    return true;
+}
+
+//run in decode thread, only the job and the read only members are used
+void ImagePlayerService::runJob(const sp<DecodeJob>& job) {
+    const char *path = job->path.string();
+    bool isHttp = !strncasecmp("http://", path, 7) || !strncasecmp("https://", path, 8);
+
+    job->result = RET_ERR_BAD_VALUE;
+    if (isJobCancelled(job.get()))
+        return;
+
+    SkBitmap *bitmap = NULL;
+    if (isTiffByExtenName(path)) {
+        //tiff choose whole image or tiles by itself, libtiff read the path, no stream
+        bitmap = decodeTiff(path, job.get());
+    }
+    else {
+        SkStreamRewindable *stream;
+        if (job->fd >= 0) {
+            SkAutoTUnref<SkData> data(SkData::NewFromFD(job->fd));
+            if (data.get() == NULL) {
+                return;
+            }
+            stream = new SkMemoryStream(data);
+        } else if (isHttp) {
+            stream = new SkHttpStream(path, job->httpService);
+        } else {
+            stream = new SkFILEStream(path);
+        }
+
+        if (job->isTiled) {
+            //tile index take the ownership of stream
+            bitmap = decodeTiled(stream, job.get());
+            if (bitmap == NULL) {
+                ALOGE("decode image size is too large, we only support w < %d and h < %d, and it can not be tiled",
+                    MAX_PIC_SIZE, MAX_PIC_SIZE);
+                job->result = RET_ERR_NO_MEMORY;
+                return;
+            }
+        }
+        else {
+            bitmap = decode(stream, NULL, job.get());
+            delete stream;
+        }
+    }
+
+    if (bitmap == NULL) {
+        ALOGE("decode result bitmap is NULL");
+        return;
+    }
+
+    if (isJobCancelled(job.get()) || (job->width <= 0) || (job->height <= 0)) {
+        ALOGE("decode is cancelled or result bitmap size error");
+        delete bitmap;
+        return;
+    }
+
+    if (!job->isTiled && (job->width > MAX_PIC_SIZE || job->height > MAX_PIC_SIZE)) {
+        ALOGE("decode image size is too large, we only support w < %d and h < %d, now image size w:%d, h:%d",
+            MAX_PIC_SIZE, MAX_PIC_SIZE, job->width, job->height);
+        delete bitmap;
+        job->result = RET_ERR_NO_MEMORY;
+        return;
+    }
+
+    SkBitmap *dstBitmap = fillSurface(bitmap, job->surfaceW, job->surfaceH);
+    if (dstBitmap != NULL) {
+        delete bitmap;
+        bitmap = dstBitmap;
+    }
+
+    job->bitmap = bitmap;
+    job->result = RET_OK;
+}
+
+void ImagePlayerService::submitJob(const sp<DecodeJob>& job) {
+    Mutex::Autolock autoLock(mJobLock);
+
+    if (mDecodeThreads.size() == 0) {
+        for (int i = 0; i < DECODE_THREAD_COUNT; i++) {
+            sp<DecodeThread> thread = new DecodeThread(this);
+            status_t result = thread->run("ImageDecodeThread", PRIORITY_DISPLAY);
+            if (result) {
+                ALOGE("Could not start DecodeThread due to error %d.", result);
+                continue;
+            }
+            mDecodeThreads.push(thread);
+        }
+    }
+
+    //the image to show now go ahead of the prefetch
+    job->state = DECODE_JOB_QUEUED;
+    job->httpService = mHttpService;
+    if (job->isBuffer)
+        mJobQueue.push_back(job);
+    else
+        mJobQueue.push_front(job);
+    mJobCond.signal();
+}
+
+void ImagePlayerService::cancelJob(const sp<DecodeJob>& job) {
+    Mutex::Autolock autoLock(mJobLock);
+
+    if ((DECODE_JOB_DONE == job->state) || job->cancelled)
+        return;
+
+    job->cancelled = true;
+    mJobsCancelled++;
+    if (DECODE_JOB_QUEUED == job->state) {
+        for (List<sp<DecodeJob> >::iterator it = mJobQueue.begin(); it != mJobQueue.end(); ++it) {
+            if (*it == job) {
+                mJobQueue.erase(it);
+                break;
+            }
+        }
+        job->result = RET_ERR_INVALID_OPERATION;
+        job->state = DECODE_JOB_DONE;
+        mJobDoneCond.broadcast();
+    }
+    else if (NULL != job->codec) {
+        //decoder check it between the scanlines
+        job->codec->cancelDecode();
+    }
+}
+
+void ImagePlayerService::waitJob(const sp<DecodeJob>& job) {
+    Mutex::Autolock autoLock(mJobLock);
+    while (DECODE_JOB_DONE != job->state) {
+        mJobDoneCond.wait(mJobLock);
+    }
+}
+
+bool ImagePlayerService::isJobDone(const sp<DecodeJob>& job) {
+    Mutex::Autolock autoLock(mJobLock);
+    return DECODE_JOB_DONE == job->state;
+}
+
+bool ImagePlayerService::isJobCancelled(DecodeJob *job) {
+    Mutex::Autolock autoLock(mJobLock);
+    return job->cancelled;
+}
+
+void ImagePlayerService::setJobCodec(DecodeJob *job, SkImageDecoder *codec) {
+    Mutex::Autolock autoLock(mJobLock);
+    job->codec = codec;
+}
+
 int ImagePlayerService::render(int format, SkBitmap *bitmap){
     FrameInfo_t info;
 
@@ -1842,12 +2143,11 @@ int ImagePlayerService::render(int format, SkBitmap *bitmap){
         case VIDEO_LAYER_FORMAT_RGB:{
             char* bitmapAddr = NULL;
             int len = bitmap->width()*bitmap->height()*3;//RGBA -> RGB
-            bitmapAddr = (char*)malloc(len);
+            bitmapAddr = (char*)mBufferPool->acquire(len);
             if (NULL == bitmapAddr) {
                 ALOGE("render, not enough memory");
                 return RET_ERR_NO_MEMORY;
             }
-            memset(bitmapAddr, 0, len);
 
             bitmap->lockPixels();
             convertRGBA8888toRGB(bitmapAddr, bitmap);
@@ -1860,8 +2160,7 @@ int ImagePlayerService::render(int format, SkBitmap *bitmap){
 
             ioctl(mDisplayFd, PICDEC_IOC_FRAME_RENDER, &info);
 
-            if(NULL != bitmapAddr)
-                free(bitmapAddr);
+            mBufferPool->release(bitmapAddr);
         }
         break;
 
@@ -1919,9 +2218,47 @@ bool ImagePlayerService::renderAndShow(SkBitmap *bitmap){
     return true;
 }
 
+//the same uri decoded with other sample size or surface size is another image
+String8 ImagePlayerService::cacheKey(const char *uri) {
+    return String8::format("%s#%d#%dx%d", uri, mSampleSize, surfaceWidth, surfaceHeight);
+}
+
+//the showing bitmap go back to cache if it can, otherwise it is deleted
+void ImagePlayerService::releaseBitmap() {
+    if (NULL == mBitmap)
+        return;
+
+    //the pyramid source is not owned, the cache may delete it at any put
+    mMipPyramid->reset();
+    if (mBitmapKey.isEmpty() || !mImageCache->put(mBitmapKey, mBitmap))
+        delete mBitmap;
+    mBitmap = NULL;
+    mBitmapKey.clear();
+}
+
+//render the current viewport of the tiled image, it replace mBitmap
+int ImagePlayerService::showTiledView() {
+    SkBitmap *viewBitmap = mTiledImage->render(mBufferPool);
+    if (NULL == viewBitmap)
+        return RET_ERR_DECORDER;
+
+    mMipPyramid->reset();
+    if (mBitmap != NULL)
+        delete mBitmap;
+    mBitmap = viewBitmap;
+
+    //rotate and scale bitmaps are based on the former viewport
+    resetRotateScale();
+    resetTranslate();
+    renderAndShow(mBitmap);
+    return RET_OK;
+}
+
 void ImagePlayerService::resetRotateScale() {
     mScalingDirect = SCALE_NORMAL;
     mScalingStep = 1.0f;
+    //levels of the former image or rotation are useless now
+    mMipPyramid->reset();
 
     if (NULL != mScalingBitmap) {
         delete mScalingBitmap;
@@ -2077,7 +2414,7 @@ SkBitmap* ImagePlayerService::scaleAndCrop(SkBitmap *srcBitmap, float sx, float
         retBitmap->width(), retBitmap->height(), surfaceWidth, surfaceHeight);
     if ((retBitmap->width() > surfaceWidth) || (retBitmap->height() > surfaceHeight)) {
         if (mTranslateImage) {
-            SkBitmap *dstCrop = translateAndCropAndFillBitmap(retBitmap, surfaceWidth, surfaceHeight, mTx, mTy);
+            SkBitmap *dstCrop = translateAndCropAndFillBitmap(retBitmap, surfaceWidth, surfaceHeight, mTx, mTy, mBufferPool);
             isTranslateToEdge(retBitmap, surfaceWidth, surfaceHeight, mTx, mTy);
             if (NULL != dstCrop) {
                 delete retBitmap;
@@ -2086,7 +2423,7 @@ SkBitmap* ImagePlayerService::scaleAndCrop(SkBitmap *srcBitmap, float sx, float
             mTranslateImage = false;
             return retBitmap;
         }
-        SkBitmap *dstCrop = cropAndFillBitmap(retBitmap, surfaceWidth, surfaceHeight);
+        SkBitmap *dstCrop = cropAndFillBitmap(retBitmap, surfaceWidth, surfaceHeight, mBufferPool);
         if (NULL != dstCrop) {
             delete retBitmap;
             retBitmap = dstCrop;
@@ -2096,7 +2433,91 @@ SkBitmap* ImagePlayerService::scaleAndCrop(SkBitmap *srcBitmap, float sx, float
     return retBitmap;
 }
 
+//the same output as scaleAndCrop with sx == sy, but only one resample from the
+//nearest mip level, the cost is bounded by the surface whatever the scale is
+SkBitmap* ImagePlayerService::scaleByPyramid(SkBitmap *srcBitmap, float scale) {
+    if (srcBitmap == NULL)
+        return NULL;
+
+    int scaledW = srcBitmap->width()*scale;
+    int scaledH = srcBitmap->height()*scale;
+    if ((scaledW <= 0) || (scaledH <= 0))
+        return NULL;
+
+    //larger than surface, only the visible part is resampled
+    bool isCrop = (scaledW > surfaceWidth) || (scaledH > surfaceHeight);
+    int dstWidth = isCrop?surfaceWidth:scaledW;
+    int dstHeight = isCrop?surfaceHeight:scaledH;
+    int minWidth = Min(scaledW, dstWidth);
+    int minHeight = Min(scaledH, dstHeight);
+    int srcx = (scaledW - minWidth) / 2;
+    int srcy = (scaledH - minHeight) / 2;
+    int dstx = (dstWidth - minWidth) / 2;
+    int dsty = (dstHeight - minHeight) / 2;
+
+    if (isCrop && mTranslateImage) {
+        //the same clamp as translateAndCropAndFillBitmap
+        int tx = mTx;
+        int ty = mTy;
+        int aftertranslatesrcx = srcx + tx;
+        int aftertranslatesrcy = srcy + ty;
+        if (tx > 0 && srcx < tx) {
+            aftertranslatesrcx = srcx * 2;
+        } else if (tx < 0 && srcx < (0 - tx)) {
+            aftertranslatesrcx = 0;
+        }
+        if (ty > 0 && srcy < ty) {
+            aftertranslatesrcy = srcy * 2;
+        } else if (ty < 0 && srcy < (0 - ty)) {
+            aftertranslatesrcy = 0;
+        }
+
+        //only the size of the scaled image is needed to check the edge
+        SkBitmap scaledBounds;
+        scaledBounds.setInfo(SkImageInfo::Make(scaledW, scaledH, kN32_SkColorType, kPremul_SkAlphaType));
+        isTranslateToEdge(&scaledBounds, surfaceWidth, surfaceHeight, mTx, mTy);
+        mTranslateImage = false;
+
+        srcx = aftertranslatesrcx;
+        srcy = aftertranslatesrcy;
+    }
+
+    mMipPyramid->setSource(srcBitmap);
+    SkBitmap *level = mMipPyramid->levelFor(scale);
+    if (level == NULL)
+        return NULL;
+
+    //visible rect of the scaled image in level pixels
+    float levelSx = (float)level->width()/srcBitmap->width()/scale;
+    float levelSy = (float)level->height()/srcBitmap->height()/scale;
+    SkRect src = SkRect::MakeXYWH(srcx*levelSx, srcy*levelSy, minWidth*levelSx, minHeight*levelSy);
+    SkRect dst = SkRect::MakeXYWH(dstx, dsty, minWidth, minHeight);
+
+    SkBitmap *devBitmap = new SkBitmap();
+    SkColorType colorType = colorTypeForScaledOutput(srcBitmap->colorType());
+    devBitmap->setInfo(SkImageInfo::Make(dstWidth, dstHeight,
+            colorType, srcBitmap->alphaType()));
+    devBitmap->allocPixels(mBufferPool, NULL);
+    if (isCrop)
+        devBitmap->eraseARGB(0, 0, 0, 0);
+
+    SkCanvas canvas(*devBitmap);
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setDither(true);
+    paint.setFilterQuality(kLow_SkFilterQuality);
+    canvas.drawBitmapRectToRect(*level, &src, dst, &paint);
+
+    ALOGD("scaleByPyramid, scale:%f, level w:%d, h:%d, out w:%d, h:%d",
+        scale, level->width(), level->height(), dstWidth, dstHeight);
+    return devBitmap;
+}
+
 SkBitmap* ImagePlayerService::fillSurface(SkBitmap *bitmap){
+    return fillSurface(bitmap, surfaceWidth, surfaceHeight);
+}
+
+SkBitmap* ImagePlayerService::fillSurface(SkBitmap *bitmap, int surfaceW, int surfaceH){
     float scaleX = 1.0f;
     float scaleY = 1.0f;
 
@@ -2106,12 +2527,12 @@ SkBitmap* ImagePlayerService::fillSurface(SkBitmap *bitmap){
 
     int bitmapW = bitmap->width();
     int bitmapH = bitmap->height();
-    if(bitmapW > surfaceWidth){
-        scaleX = (float)surfaceWidth/bitmapW;
+    if(bitmapW > surfaceW){
+        scaleX = (float)surfaceW/bitmapW;
     }
 
-    if(bitmapH > surfaceHeight){
-        scaleY = (float)surfaceHeight/bitmapH;
+    if(bitmapH > surfaceH){
+        scaleY = (float)surfaceH/bitmapH;
     }
 
     if(scaleX < scaleY) scaleY = scaleX;
@@ -2131,13 +2552,13 @@ bool ImagePlayerService::showBitmapRect(SkBitmap *bitmap, int cropX, int cropY,
     FrameInfo_t info;
     char* bitmapAddr = NULL;
     int len = cropWidth*cropHeight*3;//RGBA -> RGB
-    bitmapAddr = (char*)malloc(len);
+    bitmapAddr = (char*)mBufferPool->acquire(len);
     if(NULL == bitmapAddr){
         ALOGE("showBitmapRect, not enough memory");
         return false;
     }
-    memset(bitmapAddr, 0, len);
 
+    const ColorConvertKernels_t *kernels = ColorConvertGetKernels();
     uint8_t *pDst = (uint8_t*)bitmapAddr;
     uint8_t *pSrc = (uint8_t*)bitmap->getPixels();
     uint32_t u32DstStride = cropWidth*3;
@@ -2145,12 +2566,7 @@ bool ImagePlayerService::showBitmapRect(SkBitmap *bitmap, int cropX, int cropY,
     for (int y = 0; y < cropHeight; y++) {
         uint32_t srcOffset = bitmap->rowBytes()*(cropY + y) + 4*cropX;
 
-        for (int x = 0; x < cropWidth; x++) {
-            pDst[3*x+0] = pSrc[4*x+srcOffset+0];//B
-            pDst[3*x+1] = pSrc[4*x+srcOffset+1];//G
-            pDst[3*x+2] = pSrc[4*x+srcOffset+2];//R
-                        //pSrc[4*x+3]; A
-        }
+        kernels->RGBA8888ToRGBRow(pSrc + srcOffset, pDst, cropWidth);
         pDst += u32DstStride;
     }
 
@@ -2161,14 +2577,14 @@ bool ImagePlayerService::showBitmapRect(SkBitmap *bitmap, int cropX, int cropY,
 
     ioctl(mDisplayFd, PICDEC_IOC_FRAME_RENDER, &info);
 
-    if(NULL != bitmapAddr)
-        free(bitmapAddr);
+    mBufferPool->release(bitmapAddr);
 
     post();
     return true;
 }
 
-bool ImagePlayerService::isSupportFromat(const char *uri, SkBitmap **bitmap) {
+bool ImagePlayerService::isSupportFromat(const char *uri, const sp<IMediaHTTPService>& httpService,
+        SkBitmap **bitmap) {
     bool ret = isPhotoByExtenName(uri);
     if (!ret)
         return false;
@@ -2179,7 +2595,7 @@ bool ImagePlayerService::isSupportFromat(const char *uri, SkBitmap **bitmap) {
     }
 
     if (!strncasecmp("http://", uri, 7) || !strncasecmp("https://", uri, 8)) {
-        SkHttpStream httpStream(uri, mHttpService);
+        SkHttpStream httpStream(uri, httpService);
         return verifyBySkImageDecoder(&httpStream, bitmap);
     }
 
@@ -2187,18 +2603,14 @@ bool ImagePlayerService::isSupportFromat(const char *uri, SkBitmap **bitmap) {
 }
 
 int ImagePlayerService::convertRGBA8888toRGB(void *dst, const SkBitmap *src) {
+    const ColorConvertKernels_t *kernels = ColorConvertGetKernels();
     uint8_t *pDst = (uint8_t*)dst;
     uint8_t *pSrc = (uint8_t*)src->getPixels();
     uint32_t u32SrcStride = src->rowBytes();
     uint32_t u32DstStride = src->width()*3;
 
     for (int y = 0; y < src->height(); y++) {
-        for (int x = 0; x < src->width(); x++) {
-            pDst[3*x+0] = pSrc[4*x+0];//B
-            pDst[3*x+1] = pSrc[4*x+1];//G
-            pDst[3*x+2] = pSrc[4*x+2];//R
-                        //pSrc[4*x+3]; A
-        }
+        kernels->RGBA8888ToRGBRow(pSrc, pDst, src->width());
         pSrc += u32SrcStride;
         pDst += u32DstStride;
     }
@@ -2207,13 +2619,14 @@ int ImagePlayerService::convertRGBA8888toRGB(void *dst, const SkBitmap *src) {
 }
 
 int ImagePlayerService::convertARGB8888toYUYV(void *dst, const SkBitmap *src) {
+    const ColorConvertKernels_t *kernels = ColorConvertGetKernels();
     uint8_t *pDst = (uint8_t*)dst;
     uint8_t *pSrc = (uint8_t*)src->getPixels();
     uint32_t u32SrcStride = src->rowBytes();
     uint32_t u32DstStride = ((src->width() + 15) & ~15) * 2; //YUYV
 
     for (int y = 0; y < src->height(); y++) {
-        ARGBToYUV422Row_C(pSrc, pDst, src->width());
+        kernels->ARGBToYUV422Row(pSrc, pDst, src->width());
         pSrc += u32SrcStride;
         pDst += u32DstStride;
     }
@@ -2222,13 +2635,14 @@ int ImagePlayerService::convertARGB8888toYUYV(void *dst, const SkBitmap *src) {
 }
 
 int ImagePlayerService::convertRGB565toYUYV(void *dst, const SkBitmap *src) {
+    const ColorConvertKernels_t *kernels = ColorConvertGetKernels();
     uint8_t *pDst = (uint8_t*)dst;
     uint8_t *pSrc = (uint8_t*)src->getPixels();
     uint32_t u32SrcStride = src->rowBytes();
     uint32_t u32DstStride = ((src->width() + 15) & ~15) * 2; //YUYV
 
     for (int y = 0; y < src->height() - 1; y++) {
-        RGB565ToYUVRow_C(pSrc, pDst, src->width());
+        kernels->RGB565ToYUV422Row(pSrc, pSrc + src->width() * 2, pDst, src->width());
         pSrc += u32SrcStride;
         pDst += u32DstStride;
     }
@@ -2237,14 +2651,24 @@ int ImagePlayerService::convertRGB565toYUYV(void *dst, const SkBitmap *src) {
 }
 
 int ImagePlayerService::convertIndex8toYUYV(void *dst, const SkBitmap *src) {
+    const ColorConvertKernels_t *kernels = ColorConvertGetKernels();
     uint8_t *pDst = (uint8_t*)dst;
     const uint8_t *pSrc = (const uint8_t *)src->getPixels();
     uint32_t u32SrcStride = src->rowBytes();
     uint32_t u32DstStride = ((src->width() + 15) & ~15) * 2; //YUYV
     SkColorTable* table = src->getColorTable();
 
+    //unpack the color table once per frame, not twice per pixel
+    uint32_t colors[256];
+    int count = Min(table->count(), 256);
+    for (int i = 0; i < count; i++) {
+        colors[i] = (*table)[i];
+    }
+    Index8Palette_t palette;
+    Index8PaletteInit(&palette, colors, count, SK_R32_SHIFT, SK_G32_SHIFT, SK_B32_SHIFT);
+
     for (int y = 0; y < src->height(); y++) {
-        Index8ToYUV422Row_C(pSrc, pDst, src->width(), table);
+        kernels->Index8ToYUV422Row(pSrc, pDst, src->width(), &palette);
         pSrc += u32SrcStride;
         pDst += u32DstStride;
     }
@@ -2263,6 +2687,8 @@ bool ImagePlayerService::MovieInit(const char path[]) {
         delete mSkMovie;
 
     mMovieTime = 0;
+    mMovieDeadline = 0;
+    mMovieCache->reset(0);
     mSkMovie = SkMovie::DecodeFile(path);
     if (mSkMovie && mSkMovie->width() > 0 && mSkMovie->height() > 0) {
         int duration = mSkMovie->duration();
@@ -2277,71 +2703,129 @@ bool ImagePlayerService::MovieInit(const char path[]) {
 }
 
 bool ImagePlayerService::MovieShow() {
+    if (NULL == mSkMovie)
+        return false;
+
     int sysTime = (int)nanoseconds_to_milliseconds(systemTime(SYSTEM_TIME_MONOTONIC));
-    if (0 == mMovieTime)
+    if (0 == mMovieTime) {
         mMovieTime = sysTime;
+        mMovieCache->reset(mSkMovie->duration());
+    }
+    if (0 == mMovieDeadline)
+        mMovieDeadline = sysTime;
 
-    if (mSkMovie) {
-        if (mSkMovie->duration()) {
-            mSkMovie->setTime((sysTime-mMovieTime) % mSkMovie->duration());
-        } else {
-            mSkMovie->setTime(0);
-        }
+    //movie time follow the deadline, then every loop show the same slots
+    int duration = mSkMovie->duration();
+    int movieTime = duration?((mMovieDeadline - mMovieTime) % duration):0;
+    int slot = movieTime/MOVIE_FRAME_MS;
+
+    mMovieCache->setTransform(mMovieDegree, mMovieScale, surfaceWidth, surfaceHeight);
+    SkBitmap *frame = mMovieCache->get(slot);
+    if (NULL == frame) {
+        mSkMovie->setTime(movieTime);
 
-        SkBitmap *scaleBitmap = NULL;
-        SkBitmap *rotateBitmap = NULL;
         SkBitmap bitmap;//= mSkMovie->bitmap();
-        mSkMovie->bitmap().copyTo(&bitmap, kN32_SkColorType);
-        if ((bitmap.width() > surfaceWidth) || (bitmap.height() > surfaceHeight)) {
-            ALOGW("MovieShow, origin width:%d or height:%d > surface w:%d or h:%d",
-                    bitmap.width(), bitmap.height(), surfaceWidth, surfaceHeight);
+        mSkMovie->bitmap().copyTo(&bitmap, kN32_SkColorType, mBufferPool);
 
-            SkBitmap *dstCrop = fillSurface(&bitmap);
-            if (NULL != dstCrop) {
-                dstCrop->copyTo(&bitmap, kN32_SkColorType);
-                delete dstCrop;
-            }
+        //the same source frame shown in another slot is transformed already
+        uint64_t sourceHash = 0;
+        if (mMovieCache->isEnabled()) {
+            sourceHash = MovieFrameCache::hashPixels(bitmap);
+            frame = mMovieCache->getBySource(slot, sourceHash);
         }
 
-        if (1.0f != mMovieScale) {
-            int scaledW = bitmap.width()*mMovieScale;
-            int scaledH = bitmap.height()*mMovieScale;
-            if ((scaledW > surfaceWidth) || (scaledH > surfaceHeight)) {
-                ALOGW("MovieShow, scaled width:%d or height:%d > surface w:%d or h:%d scale delta:%f",
-                    scaledW, scaledH, surfaceWidth, surfaceHeight, mMovieScale);
+        if (NULL == frame) {
+            SkBitmap *output = MovieTransform(&bitmap);
+            if (NULL == output)
+                return true;
 
-                scaleBitmap = scaleStep(&bitmap, mMovieScale, mMovieScale);
+            if (mMovieCache->put(slot, sourceHash, output)) {
+                frame = output;
             }
             else {
-                scaleBitmap = scale(&bitmap, mMovieScale, mMovieScale);
+                MovieRenderPost(output);
+                delete output;
             }
         }
+    }
 
-        if (0 != mMovieDegree) {
-            if (NULL != scaleBitmap) {
-                rotateBitmap = rotate(scaleBitmap, mMovieDegree);
-                delete scaleBitmap;
-                scaleBitmap = NULL;
-            }
-            else
-                rotateBitmap = rotate(&bitmap, mMovieDegree);
-        }
+    if (NULL != frame)
+        MovieRenderPost(frame);
 
-        if (NULL != rotateBitmap) {
-            MovieRenderPost(rotateBitmap);
-            delete rotateBitmap;
-        }
-        else if (NULL != scaleBitmap) {
-            MovieRenderPost(scaleBitmap);
-            delete scaleBitmap;
+    sysTime = (int)nanoseconds_to_milliseconds(systemTime(SYSTEM_TIME_MONOTONIC));
+    mMovieCache->onFramePosted(sysTime - mMovieDeadline);
+
+    //the slots passed already are skipped, never catch up with a burst
+    mMovieDeadline += MOVIE_FRAME_MS;
+    if (sysTime >= mMovieDeadline)
+        mMovieDeadline += ((sysTime - mMovieDeadline)/MOVIE_FRAME_MS + 1)*MOVIE_FRAME_MS;
+    return true;
+}
+
+//fill surface, scale and rotate the movie frame, caller own the result
+SkBitmap* ImagePlayerService::MovieTransform(SkBitmap *bitmap) {
+    SkBitmap *fillBitmap = NULL;
+    SkBitmap *scaleBitmap = NULL;
+    SkBitmap *rotateBitmap = NULL;
+
+    if ((bitmap->width() > surfaceWidth) || (bitmap->height() > surfaceHeight)) {
+        ALOGW("MovieShow, origin width:%d or height:%d > surface w:%d or h:%d",
+                bitmap->width(), bitmap->height(), surfaceWidth, surfaceHeight);
+
+        fillBitmap = fillSurface(bitmap);
+        if (NULL != fillBitmap)
+            bitmap = fillBitmap;
+    }
+
+    if (1.0f != mMovieScale) {
+        int scaledW = bitmap->width()*mMovieScale;
+        int scaledH = bitmap->height()*mMovieScale;
+        if ((scaledW > surfaceWidth) || (scaledH > surfaceHeight)) {
+            ALOGW("MovieShow, scaled width:%d or height:%d > surface w:%d or h:%d scale delta:%f",
+                scaledW, scaledH, surfaceWidth, surfaceHeight, mMovieScale);
+
+            scaleBitmap = scaleStep(bitmap, mMovieScale, mMovieScale);
         }
         else {
-            MovieRenderPost(&bitmap);
+            scaleBitmap = scale(bitmap, mMovieScale, mMovieScale);
         }
-        return true;
     }
 
-    return false;
+    if (0 != mMovieDegree) {
+        if (NULL != scaleBitmap) {
+            rotateBitmap = rotate(scaleBitmap, mMovieDegree);
+            delete scaleBitmap;
+            scaleBitmap = NULL;
+        }
+        else
+            rotateBitmap = rotate(bitmap, mMovieDegree);
+    }
+
+    if (NULL != rotateBitmap) {
+        delete fillBitmap;
+        return rotateBitmap;
+    }
+    else if (NULL != scaleBitmap) {
+        delete fillBitmap;
+        return scaleBitmap;
+    }
+    else if (NULL != fillBitmap) {
+        return fillBitmap;
+    }
+
+    //share the pixels, no copy
+    return new SkBitmap(*bitmap);
+}
+
+//time to sleep before the next frame
+int ImagePlayerService::MovieFrameDelayUs() {
+    //the first frame wait for the display
+    if (0 == mMovieDeadline)
+        return 500*1000;
+
+    int sysTime = (int)nanoseconds_to_milliseconds(systemTime(SYSTEM_TIME_MONOTONIC));
+    int delayMs = mMovieDeadline - sysTime;
+    return (delayMs > 0)?delayMs*1000:0;
 }
 
 void ImagePlayerService::MovieRenderPost(SkBitmap *bitmap) {
@@ -2372,6 +2856,10 @@ void ImagePlayerService::MovieRenderPost(SkBitmap *bitmap) {
 int ImagePlayerService::MovieThreadStart() {
     ALOGI("start movie image thread is running:%d", mMovieThread->isRunning());
 
+    //the deadline restart with the thread
+    if (!mMovieThread->isRunning())
+        mMovieDeadline = 0;
+
     status_t result = mMovieThread->run("MovieThread", PRIORITY_URGENT_DISPLAY);
     if (result) {
         ALOGE("Could not start MovieThread due to error %d.", result);
@@ -2410,11 +2898,30 @@ status_t ImagePlayerService::dump(int fd, const Vector<String16>& args){
                 mImageUrl, mWidth, mHeight);
         result.appendFormat("ImagePlayerService: mSampleSize:%d, surfaceWidth:%d, surfaceHeight:%d\n",
                 mSampleSize, surfaceWidth, surfaceHeight);
+        result.appendFormat("ImagePlayerService: color convert kernels:%s\n",
+                ColorConvertGetKernels()->name);
 
         if (NULL != mBufBitmap)
             result.appendFormat("ImagePlayerService: mBufBitmap width:%d, height:%d\n",
                 mBufBitmap->width(), mBufBitmap->height());
 
+        mTiledImage->dump(result);
+        result.appendFormat("ImagePlayerService: mBitmapKey:%s, mBufKey:%s\n",
+                mBitmapKey.string(), mBufKey.string());
+        mImageCache->dump(result);
+        mBufferPool->dump(result);
+        mMovieCache->dump(result);
+        mMipPyramid->dump(result);
+        HttpCache::getInstance()->dump(result);
+
+        {
+            Mutex::Autolock jobLock(mJobLock);
+            result.appendFormat("ImagePlayerService: decode threads:%d, queued jobs:%d, done:%d, cancelled:%d, last decode:%dms\n",
+                (int)mDecodeThreads.size(), (int)mJobQueue.size(), mJobsDone, mJobsCancelled, mLastDecodeMs);
+            result.appendFormat("ImagePlayerService: prepare job:%s, buffer jobs:%d\n",
+                (mPrepareJob != NULL)?mPrepareJob->path.string():"none", (int)mBufJobs.size());
+        }
+
         int n = args.size();
         for (int i = 0; i + 1 < n; i++) {
             String16 option("-d");
@@ -2525,10 +3032,39 @@ status_t MovieThread::readyToRun() {
     2) once: if returns false, the thread will exit.
 */
 bool MovieThread::threadLoop() {
-    usleep(500*1000);//delay 500ms
+    int delayUs = mPlayer->MovieFrameDelayUs();
+    if (delayUs > 0)
+        usleep(delayUs);
     return mPlayer->MovieShow();
 }
 
+DecodeJob::DecodeJob()
+    : fd(-1), isBuffer(false), isTiled(false), sampleSize(1), surfaceW(0), surfaceH(0),
+    state(DECODE_JOB_QUEUED), cancelled(false), codec(NULL),
+    result(RET_OK), width(0), height(0), decodeMs(0), bitmap(NULL), tiledImage(NULL) {
+}
+
+DecodeJob::~DecodeJob() {
+    //result which is not moved out is dropped with the job
+    if (NULL != bitmap)
+        delete bitmap;
+    if (NULL != tiledImage)
+        delete tiledImage;
+    if (fd >= 0)
+        close(fd);
+}
+
+DecodeThread::DecodeThread(const sp<ImagePlayerService>& player)
+    : Thread(/*canCallJava*/ false), mPlayer(player) {
+}
+
+DecodeThread::~DecodeThread() {
+}
+
+bool DecodeThread::threadLoop() {
+    return mPlayer->decodeThreadLoop();
+}
+
 #if 0
 MovieImageHandler::MovieImageHandler(const sp<ImagePlayerService>& player)
     : mPlayer(player) {
@@ -21,6 +21,8 @@
 #include <utils/String8.h>
 #include <utils/String16.h>
 #include <utils/Vector.h>
+#include <utils/List.h>
+#include <utils/Condition.h>
 //#include <utils/threads.h>
 //#include <utils/Timers.h>
 //#include <utils/RefBase.h>
@@ -32,13 +34,21 @@
 #include <IImagePlayerService.h>
 #include "ISystemControlService.h"
 #include <binder/Binder.h>
+#include "TiledImage.h"
+#include "ImageCache.h"
+#include "FrameBufferPool.h"
+#include "MovieFrameCache.h"
+#include "MipPyramid.h"
 
 #define MAX_FILE_PATH_LEN           1024
 #define MAX_PIC_SIZE                8000
+//decode threads, the showing image and the prefetch can decode at the same time
+#define DECODE_THREAD_COUNT         2
 
 namespace android {
 
 class MovieThread;
+class DecodeThread;
 class DeathNotifier;
 
 typedef struct {
@@ -72,6 +82,42 @@ enum RetType {
     RET_ERR_NO_MEMORY               = -7
 };
 
+enum DecodeJobState {
+    DECODE_JOB_QUEUED               = 0,
+    DECODE_JOB_RUNNING              = 1,
+    DECODE_JOB_DONE                 = 2,
+};
+
+//one decode request, it own the result until prepare or showBuf move it out
+struct DecodeJob : public RefBase {
+    DecodeJob();
+    virtual ~DecodeJob();
+
+    //request, fixed when the job is submitted
+    String8 path;
+    int fd;
+    bool isBuffer;
+    bool isTiled;
+    int sampleSize;
+    int surfaceW;
+    int surfaceH;
+    String8 key;
+    sp<IMediaHTTPService> httpService;
+
+    //guarded by mJobLock
+    int state;
+    bool cancelled;
+    SkImageDecoder *codec;
+
+    //result, only the decode thread write it before the job is done
+    int result;
+    int width;
+    int height;
+    int decodeMs;
+    SkBitmap *bitmap;
+    TiledImage *tiledImage;
+};
+
 enum ScaleDirect {
     SCALE_NORMAL                    = 0,
     SCALE_UP                        = 1,
@@ -132,10 +178,15 @@ class ImagePlayerService :  public BnImagePlayerService {
     //use to show gif etc. images
     bool MovieInit(const char path[]);
     bool MovieShow();
+    int MovieFrameDelayUs();
     void MovieRenderPost(SkBitmap *bitmap);
+    SkBitmap* MovieTransform(SkBitmap *bitmap);
     int MovieThreadStart();
     int MovieThreadStop();
 
+    //called by decode threads
+    bool decodeThreadLoop();
+
     virtual status_t dump(int fd, const Vector<String16>& args);
 
   private:
@@ -147,8 +198,20 @@ class ImagePlayerService :  public BnImagePlayerService {
 
     int post();
     int render(int format, SkBitmap *bitmap);
-    SkBitmap* decode(SkStreamRewindable *stream, InitParameter *parameter);
-    SkBitmap* decodeTiff(const char *filePath);
+    SkBitmap* decode(SkStreamRewindable *stream, InitParameter *parameter, DecodeJob *job);
+    SkBitmap* decodeTiff(const char *filePath, DecodeJob *job);
+    SkBitmap* decodeTiled(SkStreamRewindable *stream, DecodeJob *job);
+    SkBitmap* renderTiled(TiledImage *tiledImage, DecodeJob *job);
+    void runJob(const sp<DecodeJob>& job);
+    void submitJob(const sp<DecodeJob>& job);
+    void cancelJob(const sp<DecodeJob>& job);
+    void waitJob(const sp<DecodeJob>& job);
+    bool isJobDone(const sp<DecodeJob>& job);
+    bool isJobCancelled(DecodeJob *job);
+    void setJobCodec(DecodeJob *job, SkImageDecoder *codec);
+    int showTiledView();
+    String8 cacheKey(const char *uri);
+    void releaseBitmap();
     SkBitmap* scale(SkBitmap *srcBitmap, float sx, float sy);
     SkBitmap* rotate(SkBitmap *srcBitmap, float degrees);
     SkBitmap* rotateAndScale(SkBitmap *srcBitmap, float degrees, float sx, float sy);
@@ -160,13 +223,43 @@ class ImagePlayerService :  public BnImagePlayerService {
     void isTranslateToEdge(SkBitmap *srcBitmap, int dstWidth, int dstHeight, int tx, int ty);
     SkBitmap* scaleStep(SkBitmap *srcBitmap, float sx, float sy);
     SkBitmap* scaleAndCrop(SkBitmap *srcBitmap, float sx, float sy);
+    SkBitmap* scaleByPyramid(SkBitmap *srcBitmap, float scale);
     SkBitmap* fillSurface(SkBitmap *bitmap);
-    bool isSupportFromat(const char *uri, SkBitmap **bitmap);
+    SkBitmap* fillSurface(SkBitmap *bitmap, int surfaceW, int surfaceH);
+    bool isSupportFromat(const char *uri, const sp<IMediaHTTPService>& httpService,
+            SkBitmap **bitmap);
+    int probeBuf(const char *path, const sp<IMediaHTTPService>& httpService, bool *isTiled);
 
     mutable Mutex mLock;
     int mWidth, mHeight;
     SkBitmap *mBitmap;
     SkBitmap *mBufBitmap;
+    //image larger than MAX_PIC_SIZE, mBitmap is only the visible viewport
+    TiledImage *mTiledImage;
+    TiledImage *mBufTiledImage;
+    //decoded and surface fitted images, mBitmapKey is empty if mBitmap can not be cached
+    ImageCache<SkBitmap> *mImageCache;
+    //pixels of render, crop and transform output
+    FrameBufferPool *mBufferPool;
+    //zoom levels of the shown (or rotated) image
+    MipPyramid *mMipPyramid;
+    String8 mBitmapKey;
+    //the prefetch slot which showBuf will show, empty if it is mBufBitmap
+    String8 mBufKey;
+
+    //decode runs in DecodeThread without mLock, lock order is mLock then mJobLock
+    Mutex mJobLock;
+    Condition mJobCond;
+    Condition mJobDoneCond;
+    List<sp<DecodeJob> > mJobQueue;
+    Vector<sp<DecodeThread> > mDecodeThreads;
+    int mJobsDone;
+    int mJobsCancelled;
+    int mLastDecodeMs;
+    //guarded by mLock
+    sp<DecodeJob> mPrepareJob;
+    sp<DecodeJob> mBufJob;
+    Vector<sp<DecodeJob> > mBufJobs;
     // sample-size, if set to > 1, tells the decoder to return a smaller than
     // original bitmap, sampling 1 pixel for every size pixels. e.g. if sample
     // size is set to 3, then the returned bitmap will be 1/3 as wide and high,
@@ -199,6 +292,10 @@ class ImagePlayerService :  public BnImagePlayerService {
     int mTy;
     float mMovieScale;
     sp<MovieThread> mMovieThread;
+    //output frames of the loops, only used in movie thread
+    MovieFrameCache *mMovieCache;
+    //when the next movie frame should be posted, 0 if not started
+    int mMovieDeadline;
 
     //sp<ALooper> mLooper;
 
@@ -222,6 +319,17 @@ private:
     virtual bool threadLoop();
 };
 
+class DecodeThread : public Thread {
+public:
+    DecodeThread(const sp<ImagePlayerService>& player);
+    virtual ~DecodeThread();
+
+private:
+    sp<ImagePlayerService> mPlayer;
+
+    virtual bool threadLoop();
+};
+
 #if 0
 struct MovieImageHandler : public AHandler {
     MovieImageHandler(const sp<ImagePlayerService>& player);
@@ -0,0 +1,119 @@
+/** @file MipPyramid.cpp
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/04/18
+ *  @par function description:
+ *  - 1 half size levels of the shown image, built when a zoom step need it
+ *  - 2 every zoom step resample once from the nearest level
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ImagePlayerService"
+
+#include "utils/Log.h"
+#include <SkCanvas.h>
+#include "MipPyramid.h"
+
+namespace android {
+
+MipPyramid::MipPyramid(SkBitmap::Allocator *allocator)
+    : mAllocator(allocator), mSource(NULL), mSourceGenerationID(0),
+    mBytes(0), mBuilds(0), mRequests(0) {
+}
+
+MipPyramid::~MipPyramid() {
+    reset();
+}
+
+void MipPyramid::setSource(SkBitmap *source) {
+    //the same pointer may be a new bitmap, check the pixels generation too
+    if ((source == mSource) && (NULL != source)
+        && (source->getGenerationID() == mSourceGenerationID))
+        return;
+
+    reset();
+    mSource = source;
+    mSourceGenerationID = (NULL != source)?source->getGenerationID():0;
+}
+
+void MipPyramid::reset() {
+    for (size_t i = 0; i < mLevels.size(); i++) {
+        delete mLevels[i];
+    }
+    mLevels.clear();
+    mBytes = 0;
+    mSource = NULL;
+    mSourceGenerationID = 0;
+}
+
+SkBitmap* MipPyramid::levelFor(float scale) {
+    if ((NULL == mSource) || (scale <= 0.0f))
+        return NULL;
+
+    mRequests++;
+
+    //zoom in always sample the source
+    int level = 0;
+    float size = 1.0f;
+    while ((level < MIP_MAX_LEVELS) && (size/2 >= scale)) {
+        size /= 2;
+        level++;
+    }
+
+    SkBitmap *bitmap = mSource;
+    for (int i = 1; i <= level; i++) {
+        if ((int)mLevels.size() < i) {
+            SkBitmap *lower = buildLevel(bitmap);
+            //use the last level built
+            if (NULL == lower)
+                return bitmap;
+            mLevels.push(lower);
+        }
+        bitmap = mLevels[i - 1];
+    }
+    return bitmap;
+}
+
+//half size, bilinear at 0.5 is a 2x2 box filter
+SkBitmap* MipPyramid::buildLevel(SkBitmap *upper) {
+    int width = upper->width()/2;
+    int height = upper->height()/2;
+    if ((width <= 0) || (height <= 0))
+        return NULL;
+
+    SkBitmap *bitmap = new SkBitmap();
+    bitmap->setInfo(SkImageInfo::Make(width, height, kN32_SkColorType, upper->alphaType()));
+    if (!bitmap->tryAllocPixels(mAllocator, NULL)) {
+        ALOGE("mip pyramid, not enough memory for level w:%d, h:%d", width, height);
+        delete bitmap;
+        return NULL;
+    }
+    bitmap->eraseARGB(0, 0, 0, 0);
+
+    SkCanvas canvas(*bitmap);
+    SkPaint paint;
+    paint.setFilterQuality(kLow_SkFilterQuality);
+    SkRect dst = SkRect::MakeWH(width, height);
+    canvas.drawBitmapRectToRect(*upper, NULL, dst, &paint);
+
+    mBuilds++;
+    mBytes += bitmap->getSize();
+    ALOGD("mip pyramid, build level %d w:%d, h:%d", (int)mLevels.size() + 1, width, height);
+    return bitmap;
+}
+
+void MipPyramid::dump(String8& result) {
+    result.appendFormat("MipPyramid: source w:%d, h:%d, levels:%d, bytes:%d, builds:%d, requests:%d\n",
+        (NULL != mSource)?mSource->width():0, (NULL != mSource)?mSource->height():0,
+        (int)mLevels.size(), (int)mBytes, mBuilds, mRequests);
+}
+
+}  // namespace android
@@ -0,0 +1,62 @@
+/** @file MipPyramid.h
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/04/18
+ *  @par function description:
+ *  - 1 half size levels of the shown image, built when a zoom step need it
+ *  - 2 every zoom step resample once from the nearest level
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#ifndef ANDROID_MIP_PYRAMID_H
+#define ANDROID_MIP_PYRAMID_H
+
+#include <utils/String8.h>
+#include <utils/Vector.h>
+#include <SkBitmap.h>
+
+//levels below the source, 1/256 is enough for the smallest zoom step
+#define MIP_MAX_LEVELS              8
+//max zoom in, the same as setScale limit
+#define MIP_MAX_ZOOM                16.0f
+
+namespace android {
+
+class MipPyramid {
+  public:
+    MipPyramid(SkBitmap::Allocator *allocator);
+    ~MipPyramid();
+
+    //source is not owned, levels are dropped when the source change
+    void setSource(SkBitmap *source);
+    void reset();
+
+    //the smallest level which still has enough pixels for scale, owned by the pyramid
+    SkBitmap* levelFor(float scale);
+
+    void dump(String8& result);
+
+  private:
+    SkBitmap* buildLevel(SkBitmap *upper);
+
+    SkBitmap::Allocator *mAllocator;
+    SkBitmap *mSource;
+    uint32_t mSourceGenerationID;
+
+    //level 1 is half of the source, level n is half of level n-1
+    Vector<SkBitmap*> mLevels;
+    size_t mBytes;
+    int mBuilds;
+    int mRequests;
+};
+
+}  // namespace android
+
+#endif // ANDROID_MIP_PYRAMID_H
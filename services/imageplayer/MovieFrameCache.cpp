@@ -0,0 +1,172 @@
+/** @file MovieFrameCache.cpp
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/04/12
+ *  @par function description:
+ *  - 1 keep the transformed output frames of a movie image, indexed by time slot
+ *  - 2 frame time jitter statistics of the movie thread
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ImagePlayerService"
+
+#include "utils/Log.h"
+#include "MovieFrameCache.h"
+
+namespace android {
+
+MovieFrameCache::MovieFrameCache()
+    : mEnabled(true), mDegree(0), mScale(1.0f), mSurfaceWidth(0), mSurfaceHeight(0),
+    mBytes(0), mHits(0), mMisses(0), mOverBudget(0),
+    mPosted(0), mLate(0), mMaxLateMs(0), mSumLateMs(0) {
+}
+
+MovieFrameCache::~MovieFrameCache() {
+    clearFrames();
+}
+
+void MovieFrameCache::reset(int durationMs) {
+    clearFrames();
+    mEnabled = true;
+
+    //slot 0 only for the movie without duration
+    int slots = (durationMs > 0)?(durationMs + MOVIE_FRAME_MS - 1)/MOVIE_FRAME_MS:1;
+    mSlots.clear();
+    mSlots.insertAt(-1, 0, slots);
+
+    mHits = 0;
+    mMisses = 0;
+    mOverBudget = 0;
+    mPosted = 0;
+    mLate = 0;
+    mMaxLateMs = 0;
+    mSumLateMs = 0;
+}
+
+void MovieFrameCache::setTransform(int degree, float scale, int surfaceW, int surfaceH) {
+    if ((degree == mDegree) && (scale == mScale)
+        && (surfaceW == mSurfaceWidth) && (surfaceH == mSurfaceHeight))
+        return;
+
+    ALOGD("movie frame cache, transform change to degree:%d, scale:%f, surface w:%d, h:%d",
+        degree, scale, surfaceW, surfaceH);
+    mDegree = degree;
+    mScale = scale;
+    mSurfaceWidth = surfaceW;
+    mSurfaceHeight = surfaceH;
+
+    //smaller output may fit the budget again
+    clearFrames();
+    mEnabled = true;
+}
+
+SkBitmap* MovieFrameCache::get(int slot) {
+    if (!mEnabled || (slot < 0) || (slot >= (int)mSlots.size()) || (mSlots[slot] < 0)) {
+        mMisses++;
+        return NULL;
+    }
+
+    mHits++;
+    return mFrames[mSlots[slot]].bitmap;
+}
+
+SkBitmap* MovieFrameCache::getBySource(int slot, uint64_t sourceHash) {
+    if (!mEnabled || (slot < 0) || (slot >= (int)mSlots.size()))
+        return NULL;
+
+    for (size_t i = 0; i < mFrames.size(); i++) {
+        if (mFrames[i].sourceHash == sourceHash) {
+            mSlots.editItemAt(slot) = i;
+            return mFrames[i].bitmap;
+        }
+    }
+    return NULL;
+}
+
+bool MovieFrameCache::put(int slot, uint64_t sourceHash, SkBitmap *frame) {
+    if (!mEnabled || (NULL == frame) || (slot < 0) || (slot >= (int)mSlots.size()))
+        return false;
+
+    size_t bytes = frame->getSize();
+    if (mBytes + bytes > MOVIE_CACHE_BYTES) {
+        ALOGW("movie frame cache, %d frames over budget %d bytes, render on the fly",
+            (int)mFrames.size() + 1, MOVIE_CACHE_BYTES);
+        clearFrames();
+        mEnabled = false;
+        mOverBudget++;
+        return false;
+    }
+
+    Frame entry;
+    entry.sourceHash = sourceHash;
+    entry.bitmap = frame;
+    mSlots.editItemAt(slot) = mFrames.size();
+    mFrames.push(entry);
+    mBytes += bytes;
+    return true;
+}
+
+void MovieFrameCache::onFramePosted(int lateMs) {
+    if (lateMs < 0)
+        lateMs = 0;
+
+    mPosted++;
+    mSumLateMs += lateMs;
+    if (lateMs > mMaxLateMs)
+        mMaxLateMs = lateMs;
+    //the frame is shown in the next slot, it is dropped for the viewer
+    if (lateMs >= MOVIE_FRAME_MS)
+        mLate++;
+}
+
+//FNV-1a over the pixel words, frames of a movie always have the same size
+uint64_t MovieFrameCache::hashPixels(const SkBitmap& bitmap) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    SkAutoLockPixels autoLock(bitmap);
+    const uint8_t *row = (const uint8_t *)bitmap.getPixels();
+    if (NULL == row)
+        return hash;
+
+    size_t words = bitmap.width()*bitmap.bytesPerPixel()/4;
+    for (int y = 0; y < bitmap.height(); y++) {
+        const uint32_t *p = (const uint32_t *)row;
+        for (size_t i = 0; i < words; i++) {
+            hash ^= p[i];
+            hash *= 1099511628211ULL;
+        }
+        row += bitmap.rowBytes();
+    }
+    return hash;
+}
+
+void MovieFrameCache::clearFrames() {
+    for (size_t i = 0; i < mFrames.size(); i++) {
+        delete mFrames[i].bitmap;
+    }
+    mFrames.clear();
+    for (size_t i = 0; i < mSlots.size(); i++) {
+        mSlots.editItemAt(i) = -1;
+    }
+    mBytes = 0;
+}
+
+void MovieFrameCache::dump(String8& result) {
+    result.appendFormat("MovieFrameCache: %s, frames:%d, slots:%d, bytes:%d, budget:%d\n",
+        mEnabled?"enabled":"disabled", (int)mFrames.size(), (int)mSlots.size(),
+        (int)mBytes, MOVIE_CACHE_BYTES);
+    result.appendFormat("MovieFrameCache: hits:%d, misses:%d, over budget:%d\n",
+        mHits, mMisses, mOverBudget);
+    result.appendFormat("MovieFrameCache: posted:%d, late avg:%dms, max:%dms, dropped:%d (slot %dms)\n",
+        mPosted, (mPosted > 0)?(int)(mSumLateMs/mPosted):0, mMaxLateMs, mLate, MOVIE_FRAME_MS);
+}
+
+}  // namespace android
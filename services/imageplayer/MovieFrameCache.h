@@ -0,0 +1,95 @@
+/** @file MovieFrameCache.h
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/04/12
+ *  @par function description:
+ *  - 1 keep the transformed output frames of a movie image, indexed by time slot
+ *  - 2 frame time jitter statistics of the movie thread
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#ifndef ANDROID_MOVIE_FRAME_CACHE_H
+#define ANDROID_MOVIE_FRAME_CACHE_H
+
+#include <stdint.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+#include <SkBitmap.h>
+
+//movie thread show a frame every slot
+#define MOVIE_FRAME_MS              40
+//output frames kept for the loops, in bytes
+#define MOVIE_CACHE_BYTES           (64*1024*1024)
+
+namespace android {
+
+/*
+ * Only used by the movie thread. A slot maps to a cached output frame,
+ * slots with the same source frame share one output frame, so the cache
+ * hold every distinct frame once. If the frames are over the budget,
+ * the cache is disabled and the frames are rendered on the fly until the
+ * transform change.
+ */
+class MovieFrameCache {
+  public:
+    MovieFrameCache();
+    ~MovieFrameCache();
+
+    //new movie, drop the frames and the statistics
+    void reset(int durationMs);
+    //drop the frames if the output is not the same any more
+    void setTransform(int degree, float scale, int surfaceW, int surfaceH);
+
+    bool isEnabled() const { return mEnabled; }
+    //NULL if the slot is not rendered yet, the cache still own it
+    SkBitmap* get(int slot);
+    //the frame of the same source shown in another slot
+    SkBitmap* getBySource(int slot, uint64_t sourceHash);
+    //false if the cache is disabled or over budget, then the caller still own frame
+    bool put(int slot, uint64_t sourceHash, SkBitmap *frame);
+
+    //lateness of the frame to its deadline
+    void onFramePosted(int lateMs);
+
+    static uint64_t hashPixels(const SkBitmap& bitmap);
+
+    void dump(String8& result);
+
+  private:
+    struct Frame {
+        uint64_t sourceHash;
+        SkBitmap *bitmap;
+    };
+
+    void clearFrames();
+
+    bool mEnabled;
+    int mDegree;
+    float mScale;
+    int mSurfaceWidth;
+    int mSurfaceHeight;
+
+    Vector<Frame> mFrames;
+    //frame index of every slot, -1 if not rendered
+    Vector<int> mSlots;
+    size_t mBytes;
+
+    int mHits;
+    int mMisses;
+    int mOverBudget;
+    int mPosted;
+    int mLate;
+    int mMaxLateMs;
+    int64_t mSumLateMs;
+};
+
+}  // namespace android
+
+#endif // ANDROID_MOVIE_FRAME_CACHE_H
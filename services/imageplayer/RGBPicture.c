@@ -28,6 +28,7 @@
 #include "utils/Log.h"
 
 #include "RGBPicture.h"
+#include "ColorConvert.h"
 
 #if 0
 /*---------------------------------------------------------------
@@ -82,18 +83,9 @@ int RGB565toRGB888(const char* src, char* dst, size_t pixel) {
 *
 *---------------------------------------------------------------*/
 int ARGB8888_to_RGB888(const char* src, char* dst, size_t pixel) {
-    int i, j;
-
     //bitmap888 need BGR
     //RGBA -> BGR
-    for (i = 0; i < (int)pixel; i++) {
-        for (j = 0; j < 3; j++) {
-            //dst[3*i+j] = src[4*i+j];
-            //dst[3*i+j] = (((src[4*i+j]*src[4*i+3])>>8)&0xff);
-            //dst[3*i+j] = (((src[4*i+ 2 - j]*src[4*i+3])>>8)&0xff);
-            dst[3*i+j] = src[4*i + 2 - j];
-        }
-    }
+    ColorConvertGetKernels()->RGBA8888ToBGRRow((const uint8_t *)src, (uint8_t *)dst, (int)pixel);
 
     return 0;
 }
@@ -112,30 +104,8 @@ int ARGB8888_to_RGB888(const char* src, char* dst, size_t pixel) {
 *
 *---------------------------------------------------------------*/
 int ARGB8888_to_RGB565(const char* src, char* dst, size_t pixel) {
-    int i;
-
     //BGRA -> RGB
-    for (i = 0; i < (int)pixel; i++) {
-#if 1
-        int id1 = i<<2;
-        int id2 = i<<1;
-
-        int R = src[id1 + 0];
-        int G = src[id1 + 1];
-        int B = src[id1 + 2];
-
-        dst[id2 + 1] = ((R&0xF8) | ((G>>5)&0x07));
-        dst[id2] = (((G<<3)&0xE0) | ((B>>3)&0x1F));
-#else
-
-        int R = src[4*i + 0];
-        int G = src[4*i + 1];
-        int B = src[4*i + 2];
-
-        dst[2*i + 1] = ((R&0xF8) | ((G>>5)&0x07));
-        dst[2*i] = (((G<<3)&0xE0) | ((B>>3)&0x1F));
-#endif
-    }
+    ColorConvertGetKernels()->ARGB8888ToRGB565Row((const uint8_t *)src, (uint8_t *)dst, (int)pixel);
 
     return 0;
 }
@@ -373,18 +343,9 @@ MEM_ERR:
 *
 *---------------------------------------------------------------*/
 int RGBA8888_to_RGB888(const char* src, char* dst, size_t pixel) {
-    int i, j;
-
     //bitmap888 need BGR
     //RGBA -> BGR
-    for (i = 0; i < (int)pixel; i++) {
-        for (j = 0; j < 3; j++) {
-            dst[3*i+j] = src[4*i + 2 - j];
-
-            //ARGB -> BGR
-            //dst[3*i+j] = src[4*i + 3 - j];
-        }
-    }
+    ColorConvertGetKernels()->RGBA8888ToBGRRow((const uint8_t *)src, (uint8_t *)dst, (int)pixel);
 
     return 0;
 }
@@ -390,6 +390,73 @@ tiffcvt(TIFF* in, TIFF* out) {
         return( cvt_whole_image( in, out ) );
 }
 
+/*
+ * box filter of sample x sample source pixels, source rows come one by one
+ * from top to bottom, so only one row of sums is kept
+ */
+typedef struct {
+    uint32  width;          /* region width & height */
+    uint32  height;
+    uint32  sample;
+    uint32  out_width;
+    uint32  *acc;           /* sums of every channel of one output row */
+    uint32  rows;           /* source rows in acc */
+    uint32  out_row;
+    unsigned char *out;     /* output pixels */
+    size_t  out_stride;     /* in bytes */
+} Downsampler;
+
+static void
+flush_row( Downsampler *ds ) {
+    unsigned char *dst = ds->out + ds->out_row * ds->out_stride;
+    uint32 ox, c;
+
+    for ( ox = 0; ox < ds->out_width; ox++ ) {
+        uint32 cols = ds->width - ox * ds->sample;
+        uint32 count;
+
+        if ( cols > ds->sample )
+            cols = ds->sample;
+        count = cols * ds->rows;
+        for ( c = 0; c < 4; c++ )
+            dst[4*ox + c] = (unsigned char)((ds->acc[4*ox + c] + count/2) / count);
+    }
+
+    memset(ds->acc, 0, ds->out_width * 4 * sizeof (uint32));
+    ds->rows = 0;
+    ds->out_row++;
+}
+
+static void
+sample_row( Downsampler *ds, const uint32 *src ) {
+    const unsigned char *p = (const unsigned char *) src;
+    uint32 *a = ds->acc;
+    uint32 x, n = 0;
+
+    if ( ds->sample == 1 ) {
+        memcpy(ds->out + ds->out_row * ds->out_stride, src, 4 * ds->width);
+        ds->out_row++;
+        return;
+    }
+
+    for ( x = 0; x < ds->width; x++ ) {
+        a[0] += p[0];
+        a[1] += p[1];
+        a[2] += p[2];
+        a[3] += p[3];
+        p += 4;
+        if ( ++n == ds->sample ) {
+            n = 0;
+            a += 4;
+        }
+    }
+
+    ds->rows++;
+    if ( ds->rows == ds->sample
+        || ds->out_row * ds->sample + ds->rows == ds->height )
+        flush_row(ds);
+}
+
 static void TIFFErrorHandler(const char* module, const char *fmt, va_list ap) {
     char *strp;
     if (vasprintf(&strp, fmt, ap) != -1) {
@@ -427,8 +494,11 @@ int TIFF2RGBA::tiffDecodeBound(const char *filePath, int *width, int *height) {
         return -1;
     }
 
-    TIFFGetField(in, TIFFTAG_IMAGEWIDTH, &width);
-    TIFFGetField(in, TIFFTAG_IMAGELENGTH, &height);
+    uint32 imageWidth = 0, imageHeight = 0;
+    TIFFGetField(in, TIFFTAG_IMAGEWIDTH, &imageWidth);
+    TIFFGetField(in, TIFFTAG_IMAGELENGTH, &imageHeight);
+    *width = imageWidth;
+    *height = imageHeight;
 
     TIFFClose(in);
     return 0;
@@ -525,6 +595,280 @@ exit:
     return ret;
 }
 
+TiffImage::TiffImage()
+    : mTiff(NULL), mWidth(0), mHeight(0), mScanline(false), mRowsPerStrip(0),
+    mBandY(0), mBandH(0), mBandSample(0) {
+}
+
+TiffImage::~TiffImage() {
+    close();
+}
+
+bool TiffImage::open(const char *filePath) {
+    close();
+
+    if (NULL == filePath) {
+        ALOGE("tiff image, filePath is NULL");
+        return false;
+    }
+
+    TIFFSetErrorHandler(TIFFErrorHandler);
+    TIFF *in = TIFFOpen(filePath, "r");
+    if (NULL == in) {
+        ALOGE("tiff image, open file:%s error", filePath);
+        return false;
+    }
+
+    uint32 width = 0, height = 0;
+    TIFFGetField(in, TIFFTAG_IMAGEWIDTH, &width);
+    TIFFGetField(in, TIFFTAG_IMAGELENGTH, &height);
+    if ((width == 0) || (height == 0)) {
+        ALOGE("tiff image, file:%s has no size", filePath);
+        TIFFClose(in);
+        return false;
+    }
+
+    /*
+     * a compressed strip is decoded from its start for every read, when it is
+     * higher than a block the rows are read by scanlines, the decoder go on
+     * from the last row instead of the strip start
+     */
+    uint16 compress = COMPRESSION_NONE, planar = PLANARCONFIG_CONTIG;
+    uint16 bits = 0, photometric = 0, orientation = ORIENTATION_TOPLEFT;
+    uint32 rowsPerStrip = height;
+    TIFFGetFieldDefaulted(in, TIFFTAG_COMPRESSION, &compress);
+    TIFFGetFieldDefaulted(in, TIFFTAG_PLANARCONFIG, &planar);
+    TIFFGetFieldDefaulted(in, TIFFTAG_BITSPERSAMPLE, &bits);
+    TIFFGetFieldDefaulted(in, TIFFTAG_ORIENTATION, &orientation);
+    TIFFGetFieldDefaulted(in, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+    TIFFGetField(in, TIFFTAG_PHOTOMETRIC, &photometric);
+    if (rowsPerStrip > height)
+        rowsPerStrip = height;
+
+    mTiff = in;
+    mWidth = width;
+    mHeight = height;
+    mRowsPerStrip = rowsPerStrip;
+    mScanline = !TIFFIsTiled(in) && (compress != COMPRESSION_NONE)
+        && (planar == PLANARCONFIG_CONTIG) && (bits == 8)
+        && (photometric != PHOTOMETRIC_YCBCR) && (orientation == ORIENTATION_TOPLEFT)
+        && ((size_t)rowsPerStrip * width * sizeof (uint32) > TIFF_BLOCK_BYTES);
+
+    ALOGI("tiff image open, w:%d, h:%d, rows per strip:%d, scanline:%d",
+        mWidth, mHeight, mRowsPerStrip, mScanline);
+    return true;
+}
+
+void TiffImage::close() {
+    if (NULL != mTiff) {
+        TIFFClose(mTiff);
+        mTiff = NULL;
+    }
+    mWidth = 0;
+    mHeight = 0;
+    mScanline = false;
+    mRowsPerStrip = 0;
+    mBand.reset();
+    mBandH = 0;
+}
+
+/*
+ * the tiles of one row share a band of the whole width, the strip is decoded
+ * once for the row and not once for every tile, the columns must match the
+ * box filter of the band
+ */
+bool TiffImage::useBand(int x, int w, int h, int sampleSize) const {
+    if (!mScanline || (w == mWidth) || (x % sampleSize != 0))
+        return false;
+    if ((w % sampleSize != 0) && (x + w != mWidth))
+        return false;
+
+    size_t bytes = (size_t)howmany(mWidth, sampleSize) * howmany(h, sampleSize) * sizeof (uint32);
+    return bytes <= TIFF_BAND_BYTES;
+}
+
+/*---------------------------------------------------------------
+* FUNCTION NAME: decodeRegion
+* DESCRIPTION:
+*               decoder a region of tif or tiff format file to bitmap,
+*               read it by strips or tiles and downsample on the fly
+* ARGUMENTS:
+*               int x, y, w, h:region in image pixels
+*               int sampleSize:output is 1/sampleSize of the region
+*               SkBitmap *pBitmap:decorder result data, own its pixels
+* Return:
+*               -1:fail 0:success
+* Note:
+*               peak memory is the output and one block of strips or tiles,
+*               or the band of the tile row for large compressed strips
+*---------------------------------------------------------------*/
+int TiffImage::decodeRegion(int x, int y, int w, int h, int sampleSize, SkBitmap *pBitmap) {
+    if ((NULL == mTiff) || (NULL == pBitmap)) {
+        ALOGE("tiff decode region, tiff is not open or pBitmap is NULL");
+        return -1;
+    }
+
+    if ((x < 0) || (y < 0) || (w <= 0) || (h <= 0)
+        || (x + w > mWidth) || (y + h > mHeight)) {
+        ALOGE("tiff decode region x:%d, y:%d, w:%d, h:%d is out of image w:%d, h:%d",
+            x, y, w, h, mWidth, mHeight);
+        return -1;
+    }
+
+    if (sampleSize < 1)
+        sampleSize = 1;
+    if (!useBand(x, w, h, sampleSize))
+        return decodeRows(x, y, w, h, sampleSize, pBitmap);
+
+    if (mBand.isNull() || (mBandY != y) || (mBandH != h) || (mBandSample != sampleSize)) {
+        mBand.reset();
+        mBandH = 0;
+        if (decodeRows(0, y, mWidth, h, sampleSize, &mBand) != 0)
+            return -1;
+        mBandY = y;
+        mBandH = h;
+        mBandSample = sampleSize;
+    }
+
+    int outWidth = howmany(w, sampleSize);
+    pBitmap->setInfo(SkImageInfo::Make(outWidth, mBand.height(),
+            kN32_SkColorType, kPremul_SkAlphaType));
+    if (!pBitmap->tryAllocPixels()) {
+        ALOGE("tiff decode region, not enough memory for output w:%d, h:%d",
+            outWidth, mBand.height());
+        pBitmap->reset();
+        return -1;
+    }
+
+    const unsigned char *src = (const unsigned char *)mBand.getPixels() + (x / sampleSize) * 4;
+    unsigned char *dst = (unsigned char *)pBitmap->getPixels();
+    for (int i = 0; i < mBand.height(); i++) {
+        memcpy(dst, src, outWidth * 4);
+        src += mBand.rowBytes();
+        dst += pBitmap->rowBytes();
+    }
+    return 0;
+}
+
+int TiffImage::decodeRows(int x, int y, int w, int h, int sampleSize, SkBitmap *pBitmap) {
+    TIFF *in = mTiff;
+    TIFFRGBAImage img;
+    char emsg[1024];
+    bool imgBegin = false;
+    uint32* raster = NULL;  /* one block of the region */
+    unsigned char* scanline = NULL;
+    uint32 block, row;
+    Downsampler ds;
+    int ret = -1;
+
+    memset(&ds, 0, sizeof (ds));
+    ds.width = w;
+    ds.height = h;
+    ds.sample = sampleSize;
+    ds.out_width = howmany(w, sampleSize);
+
+    pBitmap->setInfo(SkImageInfo::Make(ds.out_width, howmany(h, sampleSize),
+            kN32_SkColorType, kPremul_SkAlphaType));
+    if (!pBitmap->tryAllocPixels()) {
+        ALOGE("tiff decode region, not enough memory for output w:%d, h:%d",
+            pBitmap->width(), pBitmap->height());
+        goto exit;
+    }
+    ds.out = (unsigned char *) pBitmap->getPixels();
+    ds.out_stride = pBitmap->rowBytes();
+
+    ds.acc = (uint32*)calloc(ds.out_width * 4, sizeof (uint32));
+    if (NULL == ds.acc)
+        goto exit;
+
+    /* read a tile row or some strips a time, the block is limited for single strip image */
+    if (TIFFIsTiled(in))
+        TIFFGetField(in, TIFFTAG_TILELENGTH, &block);
+    else
+        block = mRowsPerStrip;
+    if ((block == 0) || (block > (uint32)mHeight))
+        block = mHeight;
+    if ((size_t)block * w * sizeof (uint32) > TIFF_BLOCK_BYTES) {
+        block = TIFF_BLOCK_BYTES / (w * sizeof (uint32));
+        if (block == 0)
+            block = 1;
+    }
+
+    raster = (uint32*)_TIFFCheckMalloc(in, (size_t)block * w, sizeof (uint32), "block buffer");
+    if (NULL == raster) {
+        ALOGE("tiff decode region, not enough memory for block rows:%d, w:%d", block, w);
+        goto exit;
+    }
+
+    if (!TIFFRGBAImageOK(in, emsg) || !TIFFRGBAImageBegin(&img, in, 0, emsg)) {
+        ALOGE("tiff decode region, can not convert to RGBA, %s", emsg);
+        goto exit;
+    }
+    imgBegin = true;
+    img.req_orientation = ORIENTATION_TOPLEFT;
+
+    if (mScanline && img.isContig && (NULL != img.put.contig)) {
+        /* the rows of the region are decoded once, in order */
+        scanline = (unsigned char*)_TIFFmalloc(TIFFScanlineSize(in));
+        if (NULL == scanline)
+            goto exit;
+
+        for (row = y; row < (uint32)(y + h); row++) {
+            if (TIFFReadScanline(in, scanline, row, 0) < 0) {
+                ALOGE("tiff decode region, read scanline %d fail", row);
+                goto exit;
+            }
+            (*img.put.contig)(&img, raster, 0, 0, w, 1, 0, 0,
+                scanline + (size_t)x * img.samplesperpixel);
+#if HOST_BIGENDIAN
+            TIFFSwabArrayOfLong(raster, w);
+#endif
+            sample_row(&ds, raster);
+        }
+    }
+    else {
+        for (row = y; row < (uint32)(y + h); ) {
+            /* keep blocks aligned to strips or tiles, they are decoded once */
+            uint32 rows = block - row % block;
+            uint32 i;
+
+            if (row + rows > (uint32)(y + h))
+                rows = y + h - row;
+
+            img.row_offset = row;
+            img.col_offset = x;
+            if (!TIFFRGBAImageGet(&img, raster, w, rows)) {
+                ALOGE("tiff decode region, read rows %d - %d fail", row, row + rows);
+                goto exit;
+            }
+
+#if HOST_BIGENDIAN
+            TIFFSwabArrayOfLong(raster, w * rows);
+#endif
+            for (i = 0; i < rows; i++)
+                sample_row(&ds, raster + i * w);
+            row += rows;
+        }
+    }
+
+    ALOGI("tiff decode region x:%d, y:%d, w:%d, h:%d, sample:%d, block rows:%d, out w:%d, h:%d",
+        x, y, w, h, sampleSize, block, pBitmap->width(), pBitmap->height());
+    ret = 0;
+
+exit:
+    if (imgBegin)
+        TIFFRGBAImageEnd(&img);
+    if (NULL != scanline)
+        _TIFFfree(scanline);
+    if (NULL != raster)
+        _TIFFfree(raster);
+    if (NULL != ds.acc)
+        free(ds.acc);
+    if (ret != 0)
+        pBitmap->reset();
+    return ret;
+}
+
 TIFF2RGBA::TIFF2RGBA() {
 }
 
@@ -20,6 +20,12 @@
 #include <SkBitmap.h>
 
 #define MAX_PIC_SIZE                8000
+//rows of strips or tiles read a time when decode by region
+#define TIFF_BLOCK_BYTES            (4*1024*1024)
+//downsampled rows of the whole width kept for the tiles of one row
+#define TIFF_BAND_BYTES             (32*1024*1024)
+
+struct tiff;
 
 namespace android {
 
@@ -33,6 +39,40 @@ class TIFF2RGBA {
 
 };
 
+//one open tiff, the header is parsed once for all the regions of the image
+class TiffImage {
+  public:
+    TiffImage();
+    ~TiffImage();
+
+    bool open(const char *filePath);
+    void close();
+    bool isOpen() const { return mTiff != NULL; }
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+
+    //decode a region by strips or tiles and downsample it on the fly,
+    //the bitmap own its pixels, -1:fail 0:success
+    int decodeRegion(int x, int y, int w, int h, int sampleSize, SkBitmap *pBitmap);
+
+  private:
+    int decodeRows(int x, int y, int w, int h, int sampleSize, SkBitmap *pBitmap);
+    bool useBand(int x, int w, int h, int sampleSize) const;
+
+    struct tiff *mTiff;
+    int mWidth;
+    int mHeight;
+    //compressed strips higher than a block, they are read by scanlines in order
+    bool mScanline;
+    uint32_t mRowsPerStrip;
+
+    //the last band, rows [mBandY, mBandY + mBandH) of the whole width
+    SkBitmap mBand;
+    int mBandY;
+    int mBandH;
+    int mBandSample;
+};
+
 }  // namespace android
 
 #endif // TIFF_2_RGBA_H
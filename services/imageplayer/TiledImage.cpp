@@ -0,0 +1,360 @@
+/** @file TiledImage.cpp
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/03/21
+ *  @par function description:
+ *  - 1 keep the tile index of a large image open
+ *  - 2 decode only the tiles which intersect the visible viewport
+ *  - 3 the tiles of the viewport being rendered are never dropped from the cache
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ImagePlayerService"
+
+#include <math.h>
+
+#include "utils/Log.h"
+#include <SkCanvas.h>
+#include "TiledImage.h"
+#include "TIFF2RGBA.h"
+
+namespace android {
+
+TiledImage::TiledImage()
+    : mDecoder(NULL), mImageWidth(0), mImageHeight(0),
+    mSurfaceWidth(0), mSurfaceHeight(0),
+    mScale(1.0f), mCenterX(0.0f), mCenterY(0.0f),
+    mCacheBytes(0), mCacheBudget(TILE_CACHE_BYTES), mFrame(0),
+    mTileDecodes(0), mTileHits(0) {
+}
+
+TiledImage::~TiledImage() {
+    close();
+}
+
+bool TiledImage::open(SkStreamRewindable *stream) {
+    close();
+
+    if (NULL == stream)
+        return false;
+
+    SkImageDecoder *decoder = SkImageDecoder::Factory(stream);
+    if (NULL == decoder) {
+        ALOGE("tiled image, codec is NULL");
+        delete stream;
+        return false;
+    }
+
+    //tile index take the ownership of stream
+    int imageW = 0, imageH = 0;
+    stream->rewind();
+    if (!decoder->buildTileIndex(stream, &imageW, &imageH)
+        || (imageW <= 0) || (imageH <= 0)) {
+        ALOGE("tiled image, buildTileIndex failed using %s decoder", decoder->getFormatName());
+        delete decoder;
+        return false;
+    }
+
+    mDecoder = decoder;
+    mImageWidth = imageW;
+    mImageHeight = imageH;
+    mTileDecodes = 0;
+    mTileHits = 0;
+    resetView();
+
+    ALOGI("tiled image open, %s decoder, w:%d, h:%d", mDecoder->getFormatName(), imageW, imageH);
+    return true;
+}
+
+bool TiledImage::openTiff(const char *path) {
+    close();
+
+    if (!mTiff.open(path)) {
+        ALOGE("tiled image, can not open tiff %s", path);
+        return false;
+    }
+
+    int imageW = mTiff.width(), imageH = mTiff.height();
+    mImageWidth = imageW;
+    mImageHeight = imageH;
+    mTileDecodes = 0;
+    mTileHits = 0;
+    resetView();
+
+    ALOGI("tiled image open, tiff, w:%d, h:%d", imageW, imageH);
+    return true;
+}
+
+void TiledImage::close() {
+    clearCache();
+
+    if (NULL != mDecoder) {
+        delete mDecoder;
+        mDecoder = NULL;
+    }
+    mTiff.close();
+    mImageWidth = 0;
+    mImageHeight = 0;
+}
+
+void TiledImage::setSurfaceSize(int surfaceW, int surfaceH) {
+    mSurfaceWidth = surfaceW;
+    mSurfaceHeight = surfaceH;
+    resetView();
+}
+
+float TiledImage::fitScale() const {
+    if ((mImageWidth <= 0) || (mImageHeight <= 0) || (mSurfaceWidth <= 0) || (mSurfaceHeight <= 0))
+        return 1.0f;
+
+    float scaleX = (float)mSurfaceWidth/mImageWidth;
+    float scaleY = (float)mSurfaceHeight/mImageHeight;
+    float scale = (scaleX < scaleY)?scaleX:scaleY;
+    //small image show in origin size, the same as fillSurface
+    return (scale < 1.0f)?scale:1.0f;
+}
+
+void TiledImage::resetView() {
+    mScale = fitScale();
+    mCenterX = mImageWidth/2.0f;
+    mCenterY = mImageHeight/2.0f;
+}
+
+void TiledImage::clampCenter(float viewW, float viewH) {
+    float halfW = viewW/2;
+    float halfH = viewH/2;
+
+    if (mCenterX < halfW)
+        mCenterX = halfW;
+    if (mCenterX > mImageWidth - halfW)
+        mCenterX = mImageWidth - halfW;
+    if (mCenterY < halfH)
+        mCenterY = halfH;
+    if (mCenterY > mImageHeight - halfH)
+        mCenterY = mImageHeight - halfH;
+}
+
+bool TiledImage::scaleBy(float scale) {
+    if (scale <= 0.0f)
+        return false;
+
+    float minScale = fitScale();
+    float maxScale = minScale*TILE_MAX_ZOOM;
+    float realScale = mScale*scale;
+    bool ret = true;
+
+    if (realScale < minScale) {
+        realScale = minScale;
+        ret = false;
+    }
+    else if (realScale > maxScale) {
+        realScale = maxScale;
+        ret = false;
+    }
+
+    ALOGD("tiled image scale from %f to %f", mScale, realScale);
+    mScale = realScale;
+    return ret;
+}
+
+void TiledImage::translateBy(float tx, float ty) {
+    mCenterX += tx/mScale;
+    mCenterY += ty/mScale;
+}
+
+bool TiledImage::setViewRect(int x, int y, int w, int h) {
+    if ((w <= 0) || (h <= 0) || (x < 0) || (y < 0)
+        || (x + w > mImageWidth) || (y + h > mImageHeight))
+        return false;
+
+    float scaleX = (float)mSurfaceWidth/w;
+    float scaleY = (float)mSurfaceHeight/h;
+    float scale = (scaleX < scaleY)?scaleX:scaleY;
+    float minScale = fitScale();
+    float maxScale = minScale*TILE_MAX_ZOOM;
+
+    if (scale < minScale)
+        scale = minScale;
+    if (scale > maxScale)
+        scale = maxScale;
+
+    mScale = scale;
+    mCenterX = x + w/2.0f;
+    mCenterY = y + h/2.0f;
+    return true;
+}
+
+SkBitmap* TiledImage::render(SkBitmap::Allocator *allocator) {
+    if (!isOpen())
+        return NULL;
+
+    float viewW = mSurfaceWidth/mScale;
+    float viewH = mSurfaceHeight/mScale;
+    if (viewW > mImageWidth)
+        viewW = mImageWidth;
+    if (viewH > mImageHeight)
+        viewH = mImageHeight;
+    clampCenter(viewW, viewH);
+
+    float left = mCenterX - viewW/2;
+    float top = mCenterY - viewH/2;
+    int outW = (int)(viewW*mScale + 0.5f);
+    int outH = (int)(viewH*mScale + 0.5f);
+    if ((outW <= 0) || (outH <= 0))
+        return NULL;
+
+    //decode in the largest power of 2 sample which still has enough pixels
+    int sample = 1;
+    while (sample*2 <= (int)(1.0f/mScale))
+        sample *= 2;
+    int tileSrc = TILE_SIZE*sample;
+
+    int firstCol = (int)left/tileSrc;
+    int lastCol = ((int)ceilf(left + viewW) - 1)/tileSrc;
+    int firstRow = (int)top/tileSrc;
+    int lastRow = ((int)ceilf(top + viewH) - 1)/tileSrc;
+
+    //a 4k viewport may need more tiles than TILE_CACHE_BYTES, keep room for its neighbours too
+    size_t viewBytes = (size_t)(lastCol - firstCol + 1)*(lastRow - firstRow + 1)
+        *TILE_SIZE*TILE_SIZE*4;
+    mCacheBudget = viewBytes*TILE_CACHE_VIEWS;
+    if (mCacheBudget < TILE_CACHE_BYTES)
+        mCacheBudget = TILE_CACHE_BYTES;
+    mFrame++;
+
+    SkBitmap *devBitmap = new SkBitmap();
+    devBitmap->setInfo(SkImageInfo::Make(outW, outH, kN32_SkColorType, kPremul_SkAlphaType));
+    if (!devBitmap->tryAllocPixels(allocator, NULL)) {
+        ALOGE("tiled image, not enough memory for viewport w:%d, h:%d", outW, outH);
+        delete devBitmap;
+        return NULL;
+    }
+    devBitmap->eraseARGB(0, 0, 0, 0);
+
+    SkCanvas canvas(*devBitmap);
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setDither(true);
+    paint.setFilterQuality(kLow_SkFilterQuality);
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            SkBitmap *tile = getTile(sample, col, row);
+            if (NULL == tile)
+                continue;
+
+            int tileX = col*tileSrc;
+            int tileY = row*tileSrc;
+            int tileW = ((tileX + tileSrc) > mImageWidth)?(mImageWidth - tileX):tileSrc;
+            int tileH = ((tileY + tileSrc) > mImageHeight)?(mImageHeight - tileY):tileSrc;
+
+            SkRect dst = SkRect::MakeXYWH((tileX - left)*mScale, (tileY - top)*mScale,
+                tileW*mScale, tileH*mScale);
+            canvas.drawBitmapRectToRect(*tile, NULL, dst, &paint);
+        }
+    }
+
+    ALOGD("tiled image render, scale:%f, sample:%d, view x:%d, y:%d, w:%d, h:%d, out w:%d, h:%d",
+        mScale, sample, (int)left, (int)top, (int)viewW, (int)viewH, outW, outH);
+    return devBitmap;
+}
+
+SkBitmap* TiledImage::getTile(int sample, int col, int row) {
+    for (size_t i = 0; i < mTiles.size(); i++) {
+        Tile *tile = mTiles[i];
+        if ((tile->sample == sample) && (tile->col == col) && (tile->row == row)) {
+            //move to the most recently used end
+            mTiles.removeAt(i);
+            mTiles.push(tile);
+            tile->frame = mFrame;
+            mTileHits++;
+            return &tile->bitmap;
+        }
+    }
+
+    int tileSrc = TILE_SIZE*sample;
+    SkIRect rect = SkIRect::MakeXYWH(col*tileSrc, row*tileSrc, tileSrc, tileSrc);
+    if (!rect.intersect(SkIRect::MakeWH(mImageWidth, mImageHeight)))
+        return NULL;
+
+    Tile *tile = new Tile();
+    tile->sample = sample;
+    tile->col = col;
+    tile->row = row;
+    tile->frame = mFrame;
+
+    if (!decodeTile(tile, rect)) {
+        ALOGE("tiled image, decodeSubset fail, x:%d, y:%d, w:%d, h:%d, sample:%d",
+            rect.x(), rect.y(), rect.width(), rect.height(), sample);
+        delete tile;
+        return NULL;
+    }
+    mTileDecodes++;
+
+    trimCache(tile->bitmap.getSize());
+    mCacheBytes += tile->bitmap.getSize();
+    mTiles.push(tile);
+    return &tile->bitmap;
+}
+
+bool TiledImage::decodeTile(Tile *tile, const SkIRect& rect) {
+    if (mTiff.isOpen()) {
+        return mTiff.decodeRegion(rect.x(), rect.y(),
+            rect.width(), rect.height(), tile->sample, &tile->bitmap) == 0;
+    }
+
+    mDecoder->setSampleSize(tile->sample);
+    return mDecoder->decodeSubset(&tile->bitmap, rect, kN32_SkColorType);
+}
+
+const char* TiledImage::formatName() const {
+    if (mTiff.isOpen())
+        return "TIFF";
+    return (NULL != mDecoder)?mDecoder->getFormatName():"none";
+}
+
+void TiledImage::trimCache(size_t reserve) {
+    //the tiles of this render are pinned, a viewport over the budget is still drawn whole.
+    //they are at the most recently used end, the older tiles go first
+    size_t i = 0;
+    while ((i < mTiles.size()) && (mCacheBytes + reserve > mCacheBudget)) {
+        Tile *tile = mTiles[i];
+        if (tile->frame == mFrame) {
+            i++;
+            continue;
+        }
+        mCacheBytes -= tile->bitmap.getSize();
+        mTiles.removeAt(i);
+        delete tile;
+    }
+}
+
+void TiledImage::clearCache() {
+    for (size_t i = 0; i < mTiles.size(); i++) {
+        delete mTiles[i];
+    }
+    mTiles.clear();
+    mCacheBytes = 0;
+}
+
+void TiledImage::dump(String8& result) {
+    if (!isOpen()) {
+        result.appendFormat("TiledImage: closed\n");
+        return;
+    }
+
+    result.appendFormat("TiledImage: %s image w:%d, h:%d, scale:%f, center x:%d, y:%d\n",
+        formatName(), mImageWidth, mImageHeight, mScale, (int)mCenterX, (int)mCenterY);
+    result.appendFormat("TiledImage: cached tiles:%d, bytes:%d, budget:%d, decodes:%d, hits:%d\n",
+        (int)mTiles.size(), (int)mCacheBytes, (int)mCacheBudget, mTileDecodes, mTileHits);
+}
+
+}  // namespace android
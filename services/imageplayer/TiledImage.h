@@ -0,0 +1,112 @@
+/** @file TiledImage.h
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/03/21
+ *  @par function description:
+ *  - 1 keep the tile index of a large image open
+ *  - 2 decode only the tiles which intersect the visible viewport
+ *  - 3 the tiles of the viewport being rendered are never dropped from the cache
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#ifndef ANDROID_TILED_IMAGE_H
+#define ANDROID_TILED_IMAGE_H
+
+#include <utils/String8.h>
+#include <utils/Vector.h>
+#include <SkBitmap.h>
+#include <SkStream.h>
+#include <SkImageDecoder.h>
+#include "TIFF2RGBA.h"
+
+//tile edge in decoded (sampled) pixels
+#define TILE_SIZE                   512
+//decoded tiles kept for pan and zoom, in bytes, at least
+#define TILE_CACHE_BYTES            (48*1024*1024)
+//or the tiles of this many viewports, the visible ones and their neighbours
+#define TILE_CACHE_VIEWS            2
+//max zoom in, relative to the fit surface scale
+#define TILE_MAX_ZOOM               16.0f
+
+namespace android {
+
+class TiledImage {
+  public:
+    TiledImage();
+    ~TiledImage();
+
+    //take the ownership of stream, false if the format can not build tile index
+    bool open(SkStreamRewindable *stream);
+    //tiff has no skia decoder, tiles are decoded by strips or tiles of the file
+    bool openTiff(const char *path);
+    void close();
+    bool isOpen() const { return (mDecoder != NULL) || mTiff.isOpen(); }
+    int width() const { return mImageWidth; }
+    int height() const { return mImageHeight; }
+
+    //view fit the whole image to surface, centered
+    void setSurfaceSize(int surfaceW, int surfaceH);
+    void resetView();
+    //scale relative to current, false if clamped by fit or max zoom
+    bool scaleBy(float scale);
+    //translate in surface pixels
+    void translateBy(float tx, float ty);
+    //show the image rect in surface
+    bool setViewRect(int x, int y, int w, int h);
+
+    //compose the visible viewport, caller own the result, pixels from allocator if not NULL
+    SkBitmap* render(SkBitmap::Allocator *allocator = NULL);
+
+    void dump(String8& result);
+
+  private:
+    struct Tile {
+        int sample;
+        int col;
+        int row;
+        //the render which used it last, the tiles of the current one are pinned
+        int frame;
+        SkBitmap bitmap;
+    };
+
+    SkBitmap* getTile(int sample, int col, int row);
+    bool decodeTile(Tile *tile, const SkIRect& rect);
+    const char* formatName() const;
+    void trimCache(size_t reserve);
+    void clearCache();
+    float fitScale() const;
+    void clampCenter(float viewW, float viewH);
+
+    SkImageDecoder *mDecoder;
+    //kept open, the header is not parsed again for every tile
+    TiffImage mTiff;
+    int mImageWidth;
+    int mImageHeight;
+    int mSurfaceWidth;
+    int mSurfaceHeight;
+
+    //surface pixels per image pixel
+    float mScale;
+    //view center in image pixels
+    float mCenterX;
+    float mCenterY;
+
+    //least recently used at the front
+    Vector<Tile*> mTiles;
+    size_t mCacheBytes;
+    size_t mCacheBudget;
+    int mFrame;
+    int mTileDecodes;
+    int mTileHits;
+};
+
+}  // namespace android
+
+#endif // ANDROID_TILED_IMAGE_H
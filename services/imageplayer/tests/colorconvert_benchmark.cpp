@@ -0,0 +1,148 @@
+/** @file colorconvert_benchmark.cpp
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/03/14
+ *  @par function description:
+ *  - 1 check every conversion kernel is bit-exact with the C kernel
+ *  - 2 report MPix/s of every format, usage: colorconvert_benchmark [width height loops]
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ColorConvert.h"
+
+static const char *sKernelName[COLOR_CONVERT_KERNEL_TOTAL] = {"C", "NEON", "SSSE3"};
+
+enum {
+    FORMAT_RGBA_TO_RGB,
+    FORMAT_RGBA_TO_BGR,
+    FORMAT_ARGB_TO_RGB565,
+    FORMAT_ARGB_TO_YUYV,
+    FORMAT_RGB565_TO_YUYV,
+    FORMAT_INDEX8_TO_YUYV,
+    FORMAT_TOTAL
+};
+
+static const char *sFormatName[FORMAT_TOTAL] = {
+    "RGBA8888->RGB", "RGBA8888->BGR", "ARGB8888->RGB565",
+    "ARGB8888->YUYV", "RGB565->YUYV", "Index8->YUYV"
+};
+
+static int64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void convertFrame(const ColorConvertKernels_t *k, int format, const uint8_t *src,
+        uint8_t *dst, int width, int height, const Index8Palette_t *palette) {
+    int srcStride = width * 4;
+    int dstStride = width * 4;
+    for (int y = 0; y < height; y++) {
+        const uint8_t *s = src + y * srcStride;
+        uint8_t *d = dst + y * dstStride;
+        switch (format) {
+            case FORMAT_RGBA_TO_RGB:
+                k->RGBA8888ToRGBRow(s, d, width);
+                break;
+            case FORMAT_RGBA_TO_BGR:
+                k->RGBA8888ToBGRRow(s, d, width);
+                break;
+            case FORMAT_ARGB_TO_RGB565:
+                k->ARGB8888ToRGB565Row(s, d, width);
+                break;
+            case FORMAT_ARGB_TO_YUYV:
+                k->ARGBToYUV422Row(s, d, width);
+                break;
+            case FORMAT_RGB565_TO_YUYV:
+                k->RGB565ToYUV422Row(s, s + width * 2, d, width);
+                break;
+            case FORMAT_INDEX8_TO_YUYV:
+                k->Index8ToYUV422Row(s, d, width, palette);
+                break;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int width = 3840;
+    int height = 2160;
+    int loops = 20;
+    if (argc > 3) {
+        width = atoi(argv[1]);
+        height = atoi(argv[2]);
+        loops = atoi(argv[3]);
+    }
+    if (width <= 0 || height <= 0 || loops <= 0) {
+        fprintf(stderr, "usage: %s [width height loops]\n", argv[0]);
+        return -1;
+    }
+
+    //one spare row for the 2 rows RGB565 kernel
+    size_t size = (size_t)width * (height + 1) * 4;
+    uint8_t *src = (uint8_t *)malloc(size);
+    uint8_t *ref = (uint8_t *)malloc(size);
+    uint8_t *dst = (uint8_t *)malloc(size);
+    if (!src || !ref || !dst) {
+        fprintf(stderr, "not enough memory for %dx%d\n", width, height);
+        return -1;
+    }
+
+    srand(1);
+    for (size_t i = 0; i < size; i++)
+        src[i] = rand() & 0xFF;
+
+    uint32_t colors[256];
+    for (int i = 0; i < 256; i++)
+        colors[i] = ((uint32_t)rand() << 16) ^ rand();
+    Index8Palette_t palette;
+    Index8PaletteInit(&palette, colors, 256, 0, 8, 16);
+
+    const ColorConvertKernels_t *c = ColorConvertGetKernelsByType(COLOR_CONVERT_KERNEL_C);
+    int ret = 0;
+
+    printf("frame %dx%d, loops %d, runtime kernels: %s\n", width, height, loops,
+        ColorConvertGetKernels()->name);
+    for (int type = 0; type < COLOR_CONVERT_KERNEL_TOTAL; type++) {
+        const ColorConvertKernels_t *k = ColorConvertGetKernelsByType(type);
+        if (type != COLOR_CONVERT_KERNEL_C && k == c) {
+            printf("%-6s not supported\n", sKernelName[type]);
+            continue;
+        }
+
+        for (int format = 0; format < FORMAT_TOTAL; format++) {
+            memset(ref, 0, size);
+            memset(dst, 0, size);
+            convertFrame(c, format, src, ref, width, height, &palette);
+            convertFrame(k, format, src, dst, width, height, &palette);
+            bool exact = !memcmp(ref, dst, size);
+            if (!exact)
+                ret = -1;
+
+            int64_t start = nowUs();
+            for (int i = 0; i < loops; i++)
+                convertFrame(k, format, src, dst, width, height, &palette);
+            int64_t cost = nowUs() - start;
+
+            double mpix = (double)width * height * loops / (cost > 0 ? cost : 1);
+            printf("%-6s %-18s %9.1f MPix/s %s\n", k->name, sFormatName[format], mpix,
+                exact ? "bit-exact" : "MISMATCH");
+        }
+    }
+
+    free(src);
+    free(ref);
+    free(dst);
+    return ret;
+}
@@ -0,0 +1,464 @@
+/** @file httpcache_test.cpp
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/04/25
+ *  @par function description:
+ *  - 1 serve images by a loopback http server which count the range requests
+ *  - 2 check every block is fetched once for verify, decode, rewind and duplicate
+ *  - 3 check the disk cache survive a new cache instance and evict the LRU image
+ *  - 4 check a slow fetch block neither the other urls nor the dump
+ *  - usage: httpcache_test
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "HttpCache.h"
+
+using namespace android;
+
+#define IMAGE_COUNT                 3
+#define MAX_RANGES                  256
+//a server which take this long for every range
+#define SLOW_FETCH_US               300000
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+//images served as /0.jpg, /1.jpg ...
+static uint8_t *sImages[IMAGE_COUNT];
+static size_t sImageSizes[IMAGE_COUNT];
+
+/*
+ * One request per connection, only GET with a Range header,
+ * reply 206 with Content-Range like a real image server.
+ */
+class LoopbackServer {
+  public:
+    LoopbackServer() : mFd(-1), mPort(0), mRequests(0), mRanges(0), mRefetched(0) {
+        pthread_mutex_init(&mLock, NULL);
+    }
+
+    bool start() {
+        mFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (mFd < 0)
+            return false;
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t length = sizeof(addr);
+        if ((bind(mFd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+            || (listen(mFd, 8) < 0)
+            || (getsockname(mFd, (struct sockaddr *)&addr, &length) < 0))
+            return false;
+
+        mPort = ntohs(addr.sin_port);
+        return pthread_create(&mThread, NULL, threadLoop, this) == 0;
+    }
+
+    int port() const { return mPort; }
+
+    int requests() {
+        pthread_mutex_lock(&mLock);
+        int count = mRequests;
+        pthread_mutex_unlock(&mLock);
+        return count;
+    }
+
+    int refetched() {
+        pthread_mutex_lock(&mLock);
+        int count = mRefetched;
+        pthread_mutex_unlock(&mLock);
+        return count;
+    }
+
+  private:
+    static void *threadLoop(void *arg) {
+        LoopbackServer *server = (LoopbackServer *)arg;
+        for (;;) {
+            int fd = accept(server->mFd, NULL, NULL);
+            if (fd < 0)
+                break;
+            server->serve(fd);
+            close(fd);
+        }
+        return NULL;
+    }
+
+    void serve(int fd) {
+        char request[1024];
+        size_t length = 0;
+        while (length + 1 < sizeof(request)) {
+            ssize_t n = read(fd, request + length, sizeof(request) - 1 - length);
+            if (n <= 0)
+                return;
+            length += n;
+            request[length] = '\0';
+            if (strstr(request, "\r\n\r\n"))
+                break;
+        }
+
+        int index = -1;
+        long long first = 0, last = -1;
+        const char *range = strstr(request, "Range: bytes=");
+        if ((sscanf(request, "GET /%d.jpg", &index) != 1) || (index < 0) || (index >= IMAGE_COUNT)
+            || (NULL == range) || (sscanf(range, "Range: bytes=%lld-%lld", &first, &last) != 2)) {
+            const char *reply = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+            write(fd, reply, strlen(reply));
+            return;
+        }
+
+        long long total = sImageSizes[index];
+        if (last >= total)
+            last = total - 1;
+
+        pthread_mutex_lock(&mLock);
+        mRequests++;
+        for (int i = 0; i < mRanges; i++) {
+            if ((mRangeImage[i] == index) && (first <= mRangeLast[i]) && (last >= mRangeFirst[i]))
+                mRefetched++;
+        }
+        if (mRanges < MAX_RANGES) {
+            mRangeImage[mRanges] = index;
+            mRangeFirst[mRanges] = first;
+            mRangeLast[mRanges] = last;
+            mRanges++;
+        }
+        pthread_mutex_unlock(&mLock);
+
+        char header[256];
+        int size = snprintf(header, sizeof(header),
+            "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes %lld-%lld/%lld\r\n"
+            "Content-Length: %lld\r\nConnection: close\r\n\r\n",
+            first, last, total, last - first + 1);
+        write(fd, header, size);
+        write(fd, sImages[index] + first, last - first + 1);
+    }
+
+    int mFd;
+    int mPort;
+    pthread_t mThread;
+    pthread_mutex_t mLock;
+    int mRequests;
+    int mRanges;
+    int mRefetched;
+    int mRangeImage[MAX_RANGES];
+    long long mRangeFirst[MAX_RANGES];
+    long long mRangeLast[MAX_RANGES];
+};
+
+static LoopbackServer sServer;
+
+//stand for the DataSource of a http url, a range request for every read
+class LoopbackSource : public HttpSource {
+  public:
+    LoopbackSource(int index) : mIndex(index), mSize(-1) {}
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(sServer.port());
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+
+        char request[256];
+        int length = snprintf(request, sizeof(request),
+            "GET /%d.jpg HTTP/1.1\r\nHost: 127.0.0.1\r\nRange: bytes=%lld-%lld\r\n\r\n",
+            mIndex, (long long)offset, (long long)(offset + size - 1));
+        write(fd, request, length);
+
+        //header and body are small, read all of them
+        size_t capacity = size + 1024;
+        char *reply = (char *)malloc(capacity);
+        size_t got = 0;
+        for (;;) {
+            ssize_t n = read(fd, reply + got, capacity - 1 - got);
+            if (n <= 0)
+                break;
+            got += n;
+        }
+        close(fd);
+        reply[got] = '\0';
+
+        ssize_t ret = -1;
+        long long first, last, total;
+        char *body = strstr(reply, "\r\n\r\n");
+        char *range = strstr(reply, "Content-Range: bytes ");
+        if ((NULL != body) && (NULL != range)
+            && (sscanf(range, "Content-Range: bytes %lld-%lld/%lld", &first, &last, &total) == 3)) {
+            mSize = total;
+            body += 4;
+            ret = got - (body - reply);
+            memcpy(data, body, ret);
+        } else if (offset >= mSize) {
+            ret = 0;
+        }
+        free(reply);
+        return ret;
+    }
+
+    virtual off64_t getSize() { return mSize; }
+
+  private:
+    int mIndex;
+    off64_t mSize;
+};
+
+class SlowSource : public LoopbackSource {
+  public:
+    SlowSource(int index) : LoopbackSource(index), mStarted(0) {}
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        __sync_fetch_and_add(&mStarted, 1);
+        usleep(SLOW_FETCH_US);
+        return LoopbackSource::readAt(offset, data, size);
+    }
+
+    int started() { return __sync_fetch_and_add(&mStarted, 0); }
+
+    volatile int mStarted;
+};
+
+static int64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static String8 urlOf(int index) {
+    String8 url;
+    url.appendFormat("http://127.0.0.1:%d/%d.jpg", sServer.port(), index);
+    return url;
+}
+
+static sp<HttpCacheEntry> openImage(const sp<HttpCache>& cache, int index) {
+    return cache->open(urlOf(index).string(), new LoopbackSource(index));
+}
+
+//the same as a skia stream, read to the end by small pieces
+static bool readAll(const sp<HttpCacheEntry>& entry, int index) {
+    off64_t size = entry->getSize();
+    if (size != (off64_t)sImageSizes[index])
+        return false;
+
+    uint8_t buffer[4000];
+    off64_t offset = 0;
+    while (offset < size) {
+        ssize_t n = entry->readAt(offset, buffer, sizeof(buffer));
+        if ((n <= 0) || memcmp(buffer, sImages[index] + offset, n))
+            return false;
+        offset += n;
+    }
+    return entry->readAt(offset, buffer, sizeof(buffer)) == 0;
+}
+
+static int blocksOf(int index) {
+    return (sImageSizes[index] + HTTP_CACHE_BLOCK - 1)/HTTP_CACHE_BLOCK;
+}
+
+//setDataSource verify, prepare decode, rewind and duplicate of the decoder
+static void testSharedStreams() {
+    sp<HttpCache> cache = new HttpCache();
+    int requests = sServer.requests();
+
+    {
+        sp<HttpCacheEntry> verify = openImage(cache, 0);
+        uint8_t header[4096];
+        CHECK(verify->getSize() == (off64_t)sImageSizes[0]);
+        CHECK(verify->readAt(0, header, sizeof(header)) == (ssize_t)sizeof(header));
+        CHECK(!memcmp(header, sImages[0], sizeof(header)));
+    }
+    CHECK(sServer.requests() - requests == 1);
+
+    sp<HttpCacheEntry> decode = openImage(cache, 0);
+    CHECK(readAll(decode, 0));
+    //rewind
+    CHECK(readAll(decode, 0));
+    sp<HttpCacheEntry> duplicate = openImage(cache, 0);
+    CHECK(duplicate.get() == decode.get());
+    CHECK(readAll(duplicate, 0));
+
+    printf("shared streams: %d blocks, %d requests\n", blocksOf(0), sServer.requests() - requests);
+    CHECK(sServer.requests() - requests == blocksOf(0));
+    CHECK(sServer.refetched() == 0);
+}
+
+struct SlowRead {
+    sp<HttpCacheEntry> entry;
+    int index;
+    bool ok;
+};
+
+static bool readAll(const sp<HttpCacheEntry>& entry, int index);
+
+static void *slowReadThread(void *arg) {
+    SlowRead *read = (SlowRead *)arg;
+    read->ok = readAll(read->entry, read->index);
+    return NULL;
+}
+
+//the network read is done without the entry lock
+static void testSlowFetch() {
+    sp<HttpCache> cache = new HttpCache();
+    SlowSource *source = new SlowSource(2);
+    SlowRead read;
+    read.entry = cache->open(urlOf(2).string(), source);
+    read.index = 2;
+    read.ok = false;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, slowReadThread, &read);
+    while (source->started() == 0)
+        usleep(1000);
+
+    //other urls are opened and read, the cache is dumped while the fetch is in flight
+    int64_t start = nowUs();
+    sp<HttpCacheEntry> other = openImage(cache, 0);
+    CHECK(readAll(other, 0));
+    String8 result;
+    cache->dump(result);
+    int64_t otherUs = nowUs() - start;
+    CHECK(strstr(result.string(), "entries:2") != NULL);
+
+    //a duplicate of the slow url wait for the block in flight, it is fetched once
+    sp<HttpCacheEntry> duplicate = cache->open(urlOf(2).string(), new SlowSource(2));
+    CHECK(duplicate.get() == read.entry.get());
+    CHECK(readAll(duplicate, 2));
+    pthread_join(thread, NULL);
+    CHECK(read.ok);
+    CHECK(source->started() == blocksOf(2));
+
+    printf("slow fetch: other url and dump %dus, slow fetch %dus a block\n",
+        (int)otherUs, SLOW_FETCH_US);
+    CHECK(otherUs < SLOW_FETCH_US/2);
+}
+
+static void testDiskCache(const char *dir) {
+    int requests = sServer.requests();
+    {
+        sp<HttpCache> cache = new HttpCache();
+        cache->setDiskCache(dir, 4*1024*1024);
+        sp<HttpCacheEntry> entry = openImage(cache, 1);
+        CHECK(readAll(entry, 1));
+        cache->save(entry);
+    }
+    CHECK(sServer.requests() - requests == blocksOf(1));
+
+    //a new service process
+    requests = sServer.requests();
+    sp<HttpCache> cache = new HttpCache();
+    cache->setDiskCache(dir, 4*1024*1024);
+    sp<HttpCacheEntry> entry = openImage(cache, 1);
+    CHECK(readAll(entry, 1));
+    printf("disk cache: %d requests after restart\n", sServer.requests() - requests);
+    CHECK(sServer.requests() == requests);
+    CHECK(sServer.refetched() == 0);
+}
+
+static void testDiskEviction(const char *dir) {
+    //any two images fit, the third one evict the least recently used
+    size_t bytes = 700000;
+    {
+        sp<HttpCache> cache = new HttpCache();
+        cache->setDiskCache(dir, bytes);
+        sp<HttpCacheEntry> entry = openImage(cache, 0);
+        CHECK(readAll(entry, 0));
+        cache->save(entry);
+    }
+    {
+        //image 1 is saved by testDiskCache, touch image 0
+        sp<HttpCache> cache = new HttpCache();
+        cache->setDiskCache(dir, bytes);
+        int requests = sServer.requests();
+        sp<HttpCacheEntry> entry = openImage(cache, 0);
+        CHECK(readAll(entry, 0));
+        CHECK(sServer.requests() == requests);
+
+        entry = openImage(cache, 2);
+        CHECK(readAll(entry, 2));
+        cache->save(entry);
+    }
+
+    sp<HttpCache> cache = new HttpCache();
+    cache->setDiskCache(dir, bytes);
+    int requests = sServer.requests();
+    CHECK(readAll(openImage(cache, 0), 0));
+    CHECK(readAll(openImage(cache, 2), 2));
+    CHECK(sServer.requests() == requests);
+    CHECK(readAll(openImage(cache, 1), 1));
+    printf("disk eviction: %d requests for the evicted image\n", sServer.requests() - requests);
+    CHECK(sServer.requests() - requests == blocksOf(1));
+}
+
+int main(int argc, char **argv) {
+    //not block aligned sizes
+    for (int i = 0; i < IMAGE_COUNT; i++) {
+        sImageSizes[i] = 200000 + i*70001;
+        sImages[i] = (uint8_t *)malloc(sImageSizes[i]);
+        uint32_t seed = i*2654435761u + 1;
+        for (size_t j = 0; j < sImageSizes[i]; j++) {
+            seed = seed*1103515245 + 12345;
+            sImages[i][j] = (uint8_t)(seed >> 16);
+        }
+    }
+
+    if (!sServer.start()) {
+        printf("FAIL can not start loopback server\n");
+        return 1;
+    }
+
+    char dir[] = "/tmp/httpcache_test.XXXXXX";
+    if (NULL == mkdtemp(dir)) {
+        printf("FAIL can not create disk cache dir\n");
+        return 1;
+    }
+
+    testSharedStreams();
+    testDiskCache(dir);
+    testDiskEviction(dir);
+    //the other tests count the ranges fetched again, it fetch the images again
+    testSlowFetch();
+
+    //the cache files are test data only
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    system(command);
+
+    for (int i = 0; i < IMAGE_COUNT; i++) {
+        free(sImages[i]);
+    }
+
+    printf("%s, %d failed, %d requests served\n", (sFailed == 0)?"PASS":"FAIL", sFailed, sServer.requests());
+    return (sFailed == 0)?0:1;
+}
@@ -0,0 +1,218 @@
+/** @file imagecache_test.cpp
+ *  @par Copyright:
+ *  - Copyright 2011 Amlogic Inc as unpublished work
+ *  All Rights Reserved
+ *  - The information contained herein is the confidential property
+ *  of Amlogic.  The use, copying, transfer or disclosure of such information
+ *  is prohibited except by express written agreement with Amlogic Inc.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/03/28
+ *  @par function description:
+ *  - 1 check eviction, prefetch slots and ownership of the image cache, the budget is never passed
+ *  - 2 play a slideshow forward then back, report the latency of every step
+ *  - usage: imagecache_test [width height images]
+ *  @warning This class may explode in your face.
+ *  @note If you inherit anything from this class, you're doomed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "ImageCache.h"
+
+using namespace android;
+
+//stand for a decoded and surface fitted SkBitmap
+class FakeBitmap {
+  public:
+    FakeBitmap(int width, int height) : mSize((size_t)width*height*4) {
+        mPixels = (uint8_t *)malloc(mSize);
+        sAlive++;
+    }
+    ~FakeBitmap() {
+        free(mPixels);
+        sAlive--;
+    }
+    size_t getSize() const { return mSize; }
+    uint8_t *getPixels() const { return mPixels; }
+
+    static int sAlive;
+
+  private:
+    size_t mSize;
+    uint8_t *mPixels;
+};
+
+int FakeBitmap::sAlive = 0;
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+static int64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//the real decoder is far slower, this only keep the same order of the cost
+static FakeBitmap *decode(int index, int width, int height) {
+    FakeBitmap *bitmap = new FakeBitmap(width, height);
+    uint8_t *p = bitmap->getPixels();
+    uint32_t seed = index*2654435761u + 1;
+    for (int pass = 0; pass < 4; pass++) {
+        for (size_t i = 0; i < bitmap->getSize(); i++) {
+            seed = seed*1103515245 + 12345;
+            p[i] ^= (uint8_t)(seed >> 16);
+        }
+    }
+    return bitmap;
+}
+
+//picdec render copy the frame once, it is the floor of every step
+static void render(const FakeBitmap *bitmap, uint8_t *frame) {
+    memcpy(frame, bitmap->getPixels(), bitmap->getSize());
+}
+
+static String8 keyOf(int index, int width, int height) {
+    return String8::format("/sdcard/%d.jpg#1#%dx%d", index, width, height);
+}
+
+static void testEviction() {
+    //budget hold 3 images of 100 bytes
+    ImageCache<FakeBitmap> cache(300, 1);
+    for (int i = 0; i < 4; i++) {
+        CHECK(cache.put(keyOf(i, 5, 5), new FakeBitmap(5, 5)));
+    }
+    CHECK(!cache.contains(keyOf(0, 5, 5)));
+    CHECK(cache.contains(keyOf(3, 5, 5)));
+    CHECK(FakeBitmap::sAlive == 3);
+
+    //the prefetch slot is not evicted even it is the oldest
+    cache.prefetch(keyOf(1, 5, 5));
+    cache.put(keyOf(2, 5, 5), new FakeBitmap(5, 5));
+    CHECK(cache.put(keyOf(4, 5, 5), new FakeBitmap(5, 5)));
+    CHECK(cache.put(keyOf(5, 5, 5), new FakeBitmap(5, 5)));
+    CHECK(cache.contains(keyOf(1, 5, 5)));
+
+    //take move the ownership out
+    FakeBitmap *bitmap = cache.take(keyOf(1, 5, 5));
+    CHECK(bitmap != NULL);
+    CHECK(!cache.contains(keyOf(1, 5, 5)));
+    CHECK(cache.take(keyOf(1, 5, 5)) == NULL);
+    delete bitmap;
+
+    //larger than budget, the caller still own it
+    FakeBitmap *large = new FakeBitmap(10, 10);
+    CHECK(!cache.put(keyOf(9, 10, 10), large));
+    delete large;
+
+    //the prefetch slots hold the budget, the new image is refused and not kept over it
+    cache.clear();
+    ImageCache<FakeBitmap> pinned(300, 2);
+    CHECK(pinned.put(keyOf(0, 5, 5), new FakeBitmap(5, 5)));
+    CHECK(pinned.put(keyOf(1, 7, 7), new FakeBitmap(7, 7)));
+    pinned.prefetch(keyOf(0, 5, 5));
+    pinned.prefetch(keyOf(1, 7, 7));
+    FakeBitmap *over = new FakeBitmap(5, 5);
+    CHECK(!pinned.put(keyOf(2, 5, 5), over));
+    CHECK(!pinned.contains(keyOf(2, 5, 5)));
+    CHECK(pinned.contains(keyOf(0, 5, 5)) && pinned.contains(keyOf(1, 7, 7)));
+    CHECK(FakeBitmap::sAlive == 3);
+    delete over;
+
+    //a slot is taken to show, then there is room again
+    delete pinned.take(keyOf(1, 7, 7));
+    CHECK(pinned.put(keyOf(2, 5, 5), new FakeBitmap(5, 5)));
+    pinned.clear();
+
+    cache.clear();
+    CHECK(FakeBitmap::sAlive == 0);
+}
+
+static void testSlideshow(int width, int height, int images) {
+    size_t bytes = (size_t)width*height*4;
+    ImageCache<FakeBitmap> cache(bytes*images, IMAGE_PREFETCH_SLOTS);
+    uint8_t *frame = (uint8_t *)malloc(bytes);
+    FakeBitmap *showing = NULL;
+    String8 showingKey;
+    int64_t forwardUs = 0, backUs = 0, renderUs = 0;
+
+    //the same steps as setDataSource + prepare in ImagePlayerService
+    for (int step = 0; step < 2*images - 1; step++) {
+        int index = (step < images)?step:(2*images - 2 - step);
+        String8 key = keyOf(index, width, height);
+
+        int64_t begin = nowUs();
+        if (NULL != showing && !cache.put(showingKey, showing))
+            delete showing;
+
+        showing = cache.take(key);
+        if (NULL == showing)
+            showing = decode(index, width, height);
+        showingKey = key;
+
+        int64_t renderBegin = nowUs();
+        render(showing, frame);
+        int64_t end = nowUs();
+
+        renderUs += end - renderBegin;
+        if (step < images)
+            forwardUs += end - begin;
+        else
+            backUs += end - begin;
+    }
+
+    int backSteps = images - 1;
+    float forwardMs = forwardUs/1000.0f/images;
+    float backMs = backUs/1000.0f/backSteps;
+    float renderMs = renderUs/1000.0f/(2*images - 1);
+    printf("slideshow %dx%d, %d images\n", width, height, images);
+    printf("  forward step: %8.2f ms (decode + render)\n", forwardMs);
+    printf("  back step:    %8.2f ms (cache + render)\n", backMs);
+    printf("  render only:  %8.2f ms\n", renderMs);
+
+    String8 result;
+    cache.dump(result);
+    printf("%s", result.string());
+
+    //back navigation must not decode again, only the render cost is left
+    CHECK(backMs < forwardMs/2);
+    CHECK(backMs < renderMs*2 + 1.0f);
+
+    delete showing;
+    cache.clear();
+    free(frame);
+    CHECK(FakeBitmap::sAlive == 0);
+}
+
+int main(int argc, char **argv) {
+    int width = 1920;
+    int height = 1080;
+    int images = 6;
+
+    if (argc >= 4) {
+        width = atoi(argv[1]);
+        height = atoi(argv[2]);
+        images = atoi(argv[3]);
+    }
+    if (width <= 0 || height <= 0 || images < 2) {
+        printf("usage: %s [width height images]\n", argv[0]);
+        return -1;
+    }
+
+    testEviction();
+    testSlideshow(width, height, images);
+
+    printf("%s\n", (sFailed == 0)?"PASS":"FAIL");
+    return (sFailed == 0)?0:-1;
+}
@@ -40,11 +40,22 @@ LOCAL_CFLAGS += -DHDCP_AUTHENTICATION
 LOCAL_SRC_FILES:= \
   main_systemcontrol.cpp \
   ubootenv.c \
+  bootenv_index.c \
   VdcLoop.c \
   SysWrite.cpp \
+  SysfsCache.cpp \
+  Metrics.cpp \
+  EdidCaps.cpp \
+  ModePlan.cpp \
+  HdcpAuth.cpp \
+  UeventDispatcher.cpp \
   SystemControl.cpp \
+  CallerCache.cpp \
+  BootInit.cpp \
   DisplayMode.cpp \
+  DisplayConfig.cpp \
   Dimension.cpp \
+  Detect3D.cpp \
   SysTokenizer.cpp \
   HDCPKey/hdcp22_key.cpp \
   HDCPKey/HdcpRx22Key.cpp \
@@ -67,11 +78,35 @@ LOCAL_C_INCLUDES := \
 LOCAL_MODULE:= systemcontrol
 
 LOCAL_STATIC_LIBRARIES := \
+  libsystemcontrol_aes \
   libz
 
 include $(BUILD_EXECUTABLE)
 
 
+# the aes backends, the crypto flags are only for this file
+# =========================================================
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+  HDCPKey/aes_backend.cpp
+
+#aes instructions of the ARMv8 cores, only used when the cpu has them
+LOCAL_CFLAGS_arm64 += -march=armv8-a+crypto
+ifeq ($(TARGET_ARCH_VARIANT), armv8-a)
+LOCAL_CFLAGS_arm += -mfpu=crypto-neon-fp-armv8
+endif
+ifeq ($(TARGET_2ND_ARCH_VARIANT), armv8-a)
+LOCAL_CFLAGS_arm += -mfpu=crypto-neon-fp-armv8
+endif
+
+LOCAL_MODULE:= libsystemcontrol_aes
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_STATIC_LIBRARY)
+
+
 # build for recovery mode
 # =========================================================
 include $(CLEAR_VARS)
@@ -93,8 +128,16 @@ LOCAL_CFLAGS += -DRECOVERY_MODE
 LOCAL_SRC_FILES:= \
   main_recovery.cpp \
   ubootenv.c \
+  bootenv_index.c \
   SysWrite.cpp \
+  SysfsCache.cpp \
+  Metrics.cpp \
+  EdidCaps.cpp \
+  ModePlan.cpp \
+  HdcpAuth.cpp \
+  UeventDispatcher.cpp \
   DisplayMode.cpp \
+  DisplayConfig.cpp \
   SysTokenizer.cpp
 
 LOCAL_STATIC_LIBRARIES := \
@@ -134,8 +177,16 @@ LOCAL_CFLAGS += -DRECOVERY_MODE
 LOCAL_SRC_FILES:= \
   main_recovery.cpp \
   ubootenv.c \
+  bootenv_index.c \
   SysWrite.cpp \
+  SysfsCache.cpp \
+  Metrics.cpp \
+  EdidCaps.cpp \
+  ModePlan.cpp \
+  HdcpAuth.cpp \
+  UeventDispatcher.cpp \
   DisplayMode.cpp \
+  DisplayConfig.cpp \
   SysTokenizer.cpp
 
 LOCAL_STATIC_LIBRARIES := \
@@ -152,3 +203,48 @@ LOCAL_C_INCLUDES := \
 LOCAL_MODULE:= libsystemcontrol_static
 
 include $(BUILD_STATIC_LIBRARY)
+
+
+# mesondisplay.cfg compiler and checker for host
+# =========================================================
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+  main_displaycfg.cpp \
+  DisplayConfig.cpp \
+  SysTokenizer.cpp
+
+LOCAL_C_INCLUDES := \
+  external/zlib
+
+LOCAL_STATIC_LIBRARIES := \
+  libz
+
+LOCAL_SHARED_LIBRARIES := liblog
+
+LOCAL_MODULE:= displaycfg
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# the product set MESON_DISPLAY_CFG to its mesondisplay.cfg,
+# the binary is installed next to the text in /system/etc
+# =========================================================
+ifneq ($(MESON_DISPLAY_CFG),)
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := mesondisplay.bin
+LOCAL_MODULE_CLASS := ETC
+LOCAL_MODULE_PATH := $(TARGET_OUT_ETC)
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_SYSTEM)/base_rules.mk
+
+DISPLAYCFG := $(HOST_OUT_EXECUTABLES)/displaycfg$(HOST_EXECUTABLE_SUFFIX)
+$(LOCAL_BUILT_MODULE): $(MESON_DISPLAY_CFG) $(DISPLAYCFG)
+	@echo "Display config: $@"
+	@mkdir -p $(dir $@)
+	$(hide) $(DISPLAYCFG) -o $@ $<
+endif
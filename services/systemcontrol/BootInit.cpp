@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/06/27
+ *  @par function description:
+ *  - 1 the boot init of the service as stages with dependencies
+ *  - 2 a stage run in its own thread as soon as the stages it depends on are done
+ *  - 3 the callers wait a stage, the service is published before the stages are done
+ *  - 4 time of every stage, in the dump and in the properties
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <cutils/properties.h>
+
+#include "BootInit.h"
+#include "common.h"
+
+static int64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+BootInit::BootInit(const char *propPrefix)
+    :mCount(0),
+    mDoneCount(0),
+    mStarted(false),
+    mStartUs(0) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&mLock, NULL);
+
+    memset(mStages, 0, sizeof(mStages));
+    mPropPrefix[0] = 0;
+    if (propPrefix != NULL) {
+        strncpy(mPropPrefix, propPrefix, sizeof(mPropPrefix) - 1);
+        mPropPrefix[sizeof(mPropPrefix) - 1] = 0;
+    }
+}
+
+//the service live as long as the process, the stage threads are not joined
+BootInit::~BootInit() {
+    wait(-1, -1);
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mLock);
+}
+
+int BootInit::addStage(const char *name, boot_stage_fn_t fn, void *data, unsigned int deps) {
+    pthread_mutex_lock(&mLock);
+    if (mStarted || mCount >= BOOT_INIT_STAGES || (deps >> mCount) != 0) {
+        pthread_mutex_unlock(&mLock);
+        SYS_LOGE("boot init, can not add stage %s\n", name);
+        return -1;
+    }
+
+    int id = mCount++;
+    Stage *stage = &mStages[id];
+    strncpy(stage->name, name, BOOT_STAGE_NAME_LEN - 1);
+    stage->fn = fn;
+    stage->data = data;
+    stage->deps = deps;
+    pthread_mutex_unlock(&mLock);
+    return id;
+}
+
+int BootInit::start() {
+    pthread_mutex_lock(&mLock);
+    if (mStarted) {
+        pthread_mutex_unlock(&mLock);
+        return -1;
+    }
+    mStarted = true;
+    mStartUs = nowUs();
+    int count = mCount;
+    pthread_mutex_unlock(&mLock);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    for (int i = 0; i < count; i++) {
+        pthread_t id;
+        mArgs[i].init = this;
+        mArgs[i].id = i;
+        if (pthread_create(&id, &attr, stageThread, &mArgs[i]) != 0) {
+            //no thread, run it here once the deps are done
+            SYS_LOGE("boot init, create thread of stage %s fail\n", mStages[i].name);
+            runStage(i);
+        }
+    }
+    pthread_attr_destroy(&attr);
+    return 0;
+}
+
+void* BootInit::stageThread(void *data) {
+    StageArg *arg = (StageArg *)data;
+    arg->init->runStage(arg->id);
+    return NULL;
+}
+
+void BootInit::runStage(int id) {
+    Stage *stage = &mStages[id];
+
+    pthread_mutex_lock(&mLock);
+    for (int i = 0; i < mCount; i++) {
+        while ((stage->deps & (1u << i)) && !mStages[i].done)
+            pthread_cond_wait(&mCond, &mLock);
+    }
+    stage->readyUs = nowUs() - mStartUs;
+    pthread_mutex_unlock(&mLock);
+
+    int64_t start = nowUs();
+    int ret = stage->fn(stage->data);
+    int64_t end = nowUs();
+    if (ret < 0)
+        SYS_LOGE("boot init, stage %s fail: %d\n", stage->name, ret);
+
+    pthread_mutex_lock(&mLock);
+    stage->ret = ret;
+    stage->startUs = start - mStartUs;
+    stage->endUs = end - mStartUs;
+    stage->done = true;
+    bool all = (++mDoneCount == mCount);
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mLock);
+
+    SYS_LOGI("boot init, stage %s in %lldms, waited %lldms\n", stage->name,
+        (long long)(end - start)/1000, (long long)stage->readyUs/1000);
+    if (all)
+        exportTimings();
+}
+
+//stage -1 wait all the stages
+bool BootInit::wait(int stage, int timeoutMs) {
+    struct timespec ts;
+    if (timeoutMs >= 0) {
+        int64_t deadline = nowUs() + (int64_t)timeoutMs*1000;
+        ts.tv_sec = deadline/1000000;
+        ts.tv_nsec = (deadline%1000000)*1000;
+    }
+
+    pthread_mutex_lock(&mLock);
+    bool done = false;
+    while (stage < mCount) {
+        done = (stage < 0)?(mDoneCount == mCount):mStages[stage].done;
+        //not started, nothing to wait
+        if (done || !mStarted)
+            break;
+        if (timeoutMs < 0)
+            pthread_cond_wait(&mCond, &mLock);
+        else if (pthread_cond_timedwait(&mCond, &mLock, &ts) != 0)
+            break;
+    }
+    pthread_mutex_unlock(&mLock);
+    return done;
+}
+
+bool BootInit::isDone(int stage) {
+    return wait(stage, 0);
+}
+
+int64_t BootInit::totalUs() {
+    int64_t total = 0;
+    pthread_mutex_lock(&mLock);
+    if (mStarted && mDoneCount == mCount) {
+        for (int i = 0; i < mCount; i++) {
+            if (mStages[i].endUs > total)
+                total = mStages[i].endUs;
+        }
+    }
+    pthread_mutex_unlock(&mLock);
+    return total;
+}
+
+int BootInit::getStats(int stage, boot_stage_stats_t *stats) {
+    pthread_mutex_lock(&mLock);
+    if (stage < 0 || stage >= mCount) {
+        pthread_mutex_unlock(&mLock);
+        return -1;
+    }
+    Stage *s = &mStages[stage];
+    stats->name = s->name;
+    stats->done = s->done;
+    stats->ret = s->ret;
+    stats->readyUs = s->readyUs;
+    stats->startUs = s->startUs;
+    stats->endUs = s->endUs;
+    pthread_mutex_unlock(&mLock);
+    return 0;
+}
+
+//the time of the stages in ms, for the boot time regression
+void BootInit::exportTimings() {
+    char key[PROPERTY_KEY_MAX];
+    char value[PROPERTY_VALUE_MAX];
+
+    if (mPropPrefix[0] == 0)
+        return;
+
+    for (int i = 0; i < mCount; i++) {
+        snprintf(key, sizeof(key), "%s%s", mPropPrefix, mStages[i].name);
+        snprintf(value, sizeof(value), "%lld",
+            (long long)(mStages[i].endUs - mStages[i].startUs)/1000);
+        property_set(key, value);
+    }
+    snprintf(key, sizeof(key), "%stotal", mPropPrefix);
+    snprintf(value, sizeof(value), "%lld", (long long)totalUs()/1000);
+    property_set(key, value);
+}
+
+void BootInit::dump(char *result) {
+    char buf[256];
+
+    pthread_mutex_lock(&mLock);
+    sprintf(buf, "\nboot init %s, %d stages, %d done\n",
+        mStarted?"started":"not started", mCount, mDoneCount);
+    strcat(result, buf);
+    sprintf(buf, "%-12s %-8s %8s %8s %8s %s\n", "stage", "deps", "ready", "start", "end", "ret");
+    strcat(result, buf);
+    for (int i = 0; i < mCount; i++) {
+        Stage *s = &mStages[i];
+        if (!s->done) {
+            sprintf(buf, "%-12s 0x%-6x %8s\n", s->name, s->deps, "running");
+        } else {
+            sprintf(buf, "%-12s 0x%-6x %6lldms %6lldms %6lldms %d\n", s->name, s->deps,
+                (long long)s->readyUs/1000, (long long)s->startUs/1000,
+                (long long)s->endUs/1000, s->ret);
+        }
+        strcat(result, buf);
+    }
+    pthread_mutex_unlock(&mLock);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/06/27
+ *  @par function description:
+ *  - 1 the boot init of the service as stages with dependencies
+ *  - 2 a stage run in its own thread as soon as the stages it depends on are done
+ *  - 3 the callers wait a stage, the service is published before the stages are done
+ *  - 4 time of every stage, in the dump and in the properties
+ */
+
+#ifndef BOOT_INIT_H
+#define BOOT_INIT_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define BOOT_INIT_STAGES        8
+#define BOOT_STAGE_NAME_LEN     16
+
+//return < 0 if the stage failed, the stages depend on it still run
+typedef int (*boot_stage_fn_t)(void *data);
+
+typedef struct boot_stage_stats {
+    const char *name;
+    bool done;
+    int ret;
+    //from the start of the init, the deps were done at readyUs
+    int64_t readyUs;
+    int64_t startUs;
+    int64_t endUs;
+} boot_stage_stats_t;
+
+class BootInit
+{
+public:
+    //the timings are set to the properties prefix + stage name when all the stages are done,
+    //NULL not to set them
+    BootInit(const char *propPrefix);
+    ~BootInit();
+
+    //deps is a mask of the ids of the stages added before, return the id of the stage
+    int addStage(const char *name, boot_stage_fn_t fn, void *data, unsigned int deps);
+    //start the threads of all the stages and return
+    int start();
+    //return true if the stage is done in timeoutMs, -1 wait forever
+    bool wait(int stage, int timeoutMs);
+    bool isDone(int stage);
+    //time from start to the end of the last stage, 0 if not done
+    int64_t totalUs();
+
+    int getStats(int stage, boot_stage_stats_t *stats);
+    void dump(char *result);
+
+private:
+    struct Stage {
+        char name[BOOT_STAGE_NAME_LEN];
+        boot_stage_fn_t fn;
+        void *data;
+        unsigned int deps;
+        bool done;
+        int ret;
+        int64_t readyUs;
+        int64_t startUs;
+        int64_t endUs;
+    };
+    struct StageArg {
+        BootInit *init;
+        int id;
+    };
+
+    static void* stageThread(void *data);
+    void runStage(int id);
+    void exportTimings();
+
+    pthread_mutex_t mLock;
+    pthread_cond_t mCond;
+    Stage mStages[BOOT_INIT_STAGES];
+    StageArg mArgs[BOOT_INIT_STAGES];
+    int mCount;
+    int mDoneCount;
+    bool mStarted;
+    int64_t mStartUs;
+    char mPropPrefix[BOOT_STAGE_NAME_LEN];
+};
+
+#endif // BOOT_INIT_H
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/20
+ *  @par function description:
+ *  - 1 permission decision and process name of the binder callers
+ *  - 2 a caller is dropped when its process is dead or the pid is reused
+ */
+
+#define LOG_TAG "SystemControl"
+//#define LOG_NDEBUG 0
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "CallerCache.h"
+#include "common.h"
+
+namespace android {
+
+static int64_t nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+static int readProcFile(pid_t pid, const char *file, char *buf, int size) {
+    char path[64];
+    sprintf(path, "/proc/%d/%s", pid, file);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    int len = read(fd, buf, size - 1);
+    close(fd);
+    if (len < 0)
+        return -1;
+    buf[len] = 0;
+    return len;
+}
+
+CallerCache::CallerCache()
+    :mClock(0) {
+    memset(mCallers, 0, sizeof(mCallers));
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+CallerCache::~CallerCache() {
+}
+
+//field 22 of /proc/<pid>/stat, after the comm which may have spaces
+int CallerCache::readStartTime(pid_t pid, uint64_t *startTime) {
+    char stat[512];
+
+    mStats.procReads++;
+    if (readProcFile(pid, "stat", stat, sizeof(stat)) < 0)
+        return -1;
+
+    char *pos = strrchr(stat, ')');
+    if (pos == NULL)
+        return -1;
+
+    //state is field 3, start time is 19 fields after it
+    pos += 2;
+    for (int i = 0; i < 19 && pos != NULL; i++) {
+        pos = strchr(pos, ' ');
+        if (pos != NULL)
+            pos++;
+    }
+    if (pos == NULL)
+        return -1;
+
+    *startTime = strtoull(pos, NULL, 10);
+    return 0;
+}
+
+//with mLock, the caller of the pid, created if not found
+CallerCache::Caller *CallerCache::lookup(pid_t pid, uid_t uid) {
+    int64_t now = nowMs();
+    Caller *caller = NULL;
+
+    for (int i = 0; i < CALLER_CACHE_SIZE; i++) {
+        if (mCallers[i].pid == pid) {
+            caller = &mCallers[i];
+            break;
+        }
+    }
+
+    if (caller != NULL) {
+        uint64_t startTime = 0;
+        bool valid = (caller->uid == uid);
+        if (valid && now - caller->checkMs >= CALLER_CHECK_MS) {
+            valid = (readStartTime(pid, &startTime) == 0 && startTime == caller->startTime);
+            caller->checkMs = now;
+        }
+
+        if (!valid) {
+            SYS_LOGV("caller pid:%d uid:%d is gone, %s\n", pid, caller->uid, caller->name);
+            mStats.invalidations++;
+            mStats.callers--;
+            caller->pid = 0;
+            caller = NULL;
+        }
+    }
+
+    if (caller == NULL) {
+        for (int i = 0; i < CALLER_CACHE_SIZE; i++) {
+            if (caller == NULL || mCallers[i].lastUse < caller->lastUse)
+                caller = &mCallers[i];
+            if (mCallers[i].pid == 0) {
+                caller = &mCallers[i];
+                break;
+            }
+        }
+
+        if (caller->pid == 0)
+            mStats.callers++;
+        memset(caller, 0, sizeof(Caller));
+        caller->pid = pid;
+        caller->uid = uid;
+        caller->permission = -1;
+        caller->checkMs = now;
+        readStartTime(pid, &caller->startTime);
+    }
+
+    caller->lastUse = ++mClock;
+    return caller;
+}
+
+int CallerCache::getPermission(pid_t pid, uid_t uid) {
+    Mutex::Autolock _l(mLock);
+
+    Caller *caller = lookup(pid, uid);
+    if (caller->permission < 0)
+        mStats.permissionMisses++;
+    else
+        mStats.permissionHits++;
+    return caller->permission;
+}
+
+void CallerCache::setPermission(pid_t pid, uid_t uid, bool granted) {
+    Mutex::Autolock _l(mLock);
+
+    Caller *caller = lookup(pid, uid);
+    caller->permission = granted?1:0;
+}
+
+int CallerCache::getProcName(pid_t pid, uid_t uid, char *name, int size) {
+    Mutex::Autolock _l(mLock);
+
+    Caller *caller = lookup(pid, uid);
+    if (caller->name[0] == 0) {
+        mStats.nameMisses++;
+        mStats.procReads++;
+        if (readProcFile(pid, "cmdline", caller->name, CALLER_NAME_LEN) <= 0) {
+            caller->name[0] = 0;
+            strncpy(name, "unknown", size - 1);
+            name[size - 1] = 0;
+            return -1;
+        }
+    } else {
+        mStats.nameHits++;
+    }
+
+    strncpy(name, caller->name, size - 1);
+    name[size - 1] = 0;
+    return 0;
+}
+
+void CallerCache::getStats(caller_stats_t *stats) {
+    Mutex::Autolock _l(mLock);
+    *stats = mStats;
+}
+
+void CallerCache::dump(char *result) {
+    Mutex::Autolock _l(mLock);
+    char buf[256];
+
+    sprintf(buf, "caller cache: %d callers, %lld invalidations, %lld /proc reads\n"
+        "permission hits:%lld misses:%lld, process name hits:%lld misses:%lld\n",
+        mStats.callers, (long long)mStats.invalidations, (long long)mStats.procReads,
+        (long long)mStats.permissionHits, (long long)mStats.permissionMisses,
+        (long long)mStats.nameHits, (long long)mStats.nameMisses);
+    strcat(result, buf);
+
+    for (int i = 0; i < CALLER_CACHE_SIZE; i++) {
+        const Caller *caller = &mCallers[i];
+        if (caller->pid == 0)
+            continue;
+        sprintf(buf, "  pid:%-6d uid:%-6d permission:%-2d %s\n", caller->pid, caller->uid,
+            caller->permission, (caller->name[0] != 0)?caller->name:"-");
+        strcat(result, buf);
+    }
+}
+
+} // namespace android
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/20
+ *  @par function description:
+ *  - 1 permission decision and process name of the binder callers
+ *  - 2 a caller is dropped when its process is dead or the pid is reused
+ */
+
+#ifndef CALLER_CACHE_H
+#define CALLER_CACHE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <utils/Mutex.h>
+
+//callers kept, the least recently used one is dropped
+#define CALLER_CACHE_SIZE       64
+#define CALLER_NAME_LEN         64
+//the process of a caller is checked again after this time
+#define CALLER_CHECK_MS         1000
+
+namespace android {
+
+typedef struct caller_stats {
+    int64_t permissionHits;
+    int64_t permissionMisses;
+    int64_t nameHits;
+    int64_t nameMisses;
+    //the process is dead, or the pid is used by another process
+    int64_t invalidations;
+    //files of /proc read
+    int64_t procReads;
+    int callers;
+} caller_stats_t;
+
+class CallerCache
+{
+public:
+    CallerCache();
+    ~CallerCache();
+
+    //-1 if not known, 0 denied, 1 granted
+    int getPermission(pid_t pid, uid_t uid);
+    void setPermission(pid_t pid, uid_t uid, bool granted);
+    //return 0 and the cmdline of the pid, -1 if the process is not found
+    int getProcName(pid_t pid, uid_t uid, char *name, int size);
+
+    void getStats(caller_stats_t *stats);
+    void dump(char *result);
+
+private:
+    struct Caller {
+        pid_t pid;
+        uid_t uid;
+        //start time of the process in clock ticks, tell a reused pid
+        uint64_t startTime;
+        int permission;
+        char name[CALLER_NAME_LEN];
+        int64_t checkMs;
+        int64_t lastUse;
+    };
+
+    Caller *lookup(pid_t pid, uid_t uid);
+    int readStartTime(pid_t pid, uint64_t *startTime);
+
+    mutable Mutex mLock;
+    Caller mCallers[CALLER_CACHE_SIZE];
+    int64_t mClock;
+    caller_stats_t mStats;
+};
+
+} // namespace android
+#endif // CALLER_CACHE_H
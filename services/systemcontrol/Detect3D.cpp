@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   XiaoLiang.Wang
+ *  @version  1.0
+ *  @date     2016/06/13
+ *  @par function description:
+ *  - 1 detect the 3d format of the source video, the video device is kept open
+ *  - 2 a video layer or format change event sample the device at once
+ *  - 3 the format is taken when it is the same for some samples in a row,
+ *       2d only after a video layer event or at the timeout
+ *  - 4 time to detect histogram
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "Detect3D.h"
+
+static const int BUCKET_MS[DETECT3D_BUCKETS - 1] = {
+    50, 100, 200, 500, 1000, 2000
+};
+
+static int64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+Detect3D::Detect3D(const detect3d_backend_t *backend)
+    :mThreadRunning(false),
+    mExit(false),
+    mHandle(-1),
+    mPending(false),
+    mKicked(false),
+    mGeneration(0),
+    mStartUs(0),
+    mCallback(NULL),
+    mCallbackData(NULL) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&mLock, NULL);
+
+    mBackend = *backend;
+    mPolicy.stableSamples = DETECT3D_STABLE_SAMPLES;
+    mPolicy.sampleUs = DETECT3D_SAMPLE_MS*1000;
+    mPolicy.timeoutUs = DETECT3D_TIMEOUT_MS*1000;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+Detect3D::~Detect3D() {
+    stop();
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mLock);
+}
+
+void Detect3D::setPolicy(const detect3d_policy_t *policy) {
+    pthread_mutex_lock(&mLock);
+    mPolicy = *policy;
+    if (mPolicy.stableSamples < 1)
+        mPolicy.stableSamples = 1;
+    if (mPolicy.sampleUs < 1000)
+        mPolicy.sampleUs = 1000;
+    pthread_mutex_unlock(&mLock);
+}
+
+void Detect3D::getPolicy(detect3d_policy_t *policy) {
+    pthread_mutex_lock(&mLock);
+    *policy = mPolicy;
+    pthread_mutex_unlock(&mLock);
+}
+
+int Detect3D::start(detect3d_result_t callback, void *data) {
+    pthread_mutex_lock(&mLock);
+    if (!mThreadRunning) {
+        mExit = false;
+        if (pthread_create(&mThread, NULL, detectLoop, this) != 0) {
+            pthread_mutex_unlock(&mLock);
+            return -1;
+        }
+        mThreadRunning = true;
+    }
+
+    mPending = true;
+    mGeneration++;
+    mStartUs = nowUs();
+    mCallback = callback;
+    mCallbackData = data;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mLock);
+    return 0;
+}
+
+void Detect3D::kick() {
+    pthread_mutex_lock(&mLock);
+    mStats.events++;
+    if (mPending) {
+        mKicked = true;
+        pthread_cond_broadcast(&mCond);
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+int Detect3D::read() {
+    int vppFormat = -1;
+    pthread_mutex_lock(&mLock);
+    if (readLocked(&vppFormat) != 0)
+        vppFormat = -1;
+    pthread_mutex_unlock(&mLock);
+    return vppFormat;
+}
+
+void Detect3D::stop() {
+    pthread_mutex_lock(&mLock);
+    bool running = mThreadRunning;
+    mExit = true;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mLock);
+
+    if (running)
+        pthread_join(mThread, NULL);
+
+    pthread_mutex_lock(&mLock);
+    mThreadRunning = false;
+    mPending = false;
+    if (mHandle >= 0) {
+        mBackend.close(mBackend.data, mHandle);
+        mHandle = -1;
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+//with mLock, the device is opened once and kept open, a failed read close it
+int Detect3D::readLocked(int *vppFormat) {
+    if (mHandle < 0) {
+        mHandle = mBackend.open(mBackend.data);
+        if (mHandle < 0)
+            return -1;
+        mStats.opens++;
+    }
+
+    if (mBackend.getFormat(mBackend.data, mHandle, vppFormat) != 0) {
+        mBackend.close(mBackend.data, mHandle);
+        mHandle = -1;
+        return -1;
+    }
+    mStats.samples++;
+    return 0;
+}
+
+//with mLock
+void Detect3D::record(int64_t us, bool timeout) {
+    int bucket = 0;
+    while (bucket < DETECT3D_BUCKETS - 1 && us > (int64_t)BUCKET_MS[bucket]*1000)
+        bucket++;
+
+    if (timeout)
+        mStats.timeouts++;
+    else
+        mStats.detections++;
+    mStats.count[bucket]++;
+    mStats.lastUs = us;
+    mStats.totalUs += us;
+    if (us > mStats.maxUs)
+        mStats.maxUs = us;
+}
+
+void *Detect3D::detectLoop(void *data) {
+    Detect3D *pThiz = (Detect3D *)data;
+
+    pthread_mutex_lock(&pThiz->mLock);
+    while (!pThiz->mExit) {
+        if (!pThiz->mPending) {
+            pthread_cond_wait(&pThiz->mCond, &pThiz->mLock);
+            continue;
+        }
+
+        int generation = pThiz->mGeneration;
+        int64_t startUs = pThiz->mStartUs;
+        detect3d_policy_t policy = pThiz->mPolicy;
+        int last = -1;
+        int stable = 0;
+        int result = 0;
+        bool timeout = false;
+        //no frame decoded read as 2d too, it is taken once the video layer is up
+        bool videoLayer = false;
+        pThiz->mKicked = false;
+
+        //sample until the format is stable, a kick sample at once
+        while (!pThiz->mExit && generation == pThiz->mGeneration) {
+            int format = -1;
+            if (pThiz->readLocked(&format) == 0) {
+                if (format == last) {
+                    stable++;
+                } else {
+                    last = format;
+                    stable = 1;
+                }
+            } else {
+                last = -1;
+                stable = 0;
+            }
+            bool settled = stable >= policy.stableSamples;
+            if (settled && (last != DETECT3D_FORMAT_NULL || videoLayer)) {
+                result = last;
+                break;
+            }
+
+            int64_t now = nowUs();
+            int64_t deadline = startUs + policy.timeoutUs;
+            if (now >= deadline) {
+                //2d all the way is a 2d source, not a timeout
+                if (settled)
+                    result = last;
+                else
+                    timeout = true;
+                break;
+            }
+
+            int64_t wake = now + policy.sampleUs;
+            if (wake > deadline)
+                wake = deadline;
+            struct timespec ts;
+            ts.tv_sec = wake/1000000;
+            ts.tv_nsec = (wake%1000000)*1000;
+            while (!pThiz->mKicked && !pThiz->mExit && generation == pThiz->mGeneration) {
+                if (pthread_cond_timedwait(&pThiz->mCond, &pThiz->mLock, &ts) != 0)
+                    break;
+            }
+            if (pThiz->mKicked)
+                videoLayer = true;
+            pThiz->mKicked = false;
+        }
+
+        //exit or restarted by start
+        if (pThiz->mExit || generation != pThiz->mGeneration)
+            continue;
+
+        pThiz->mPending = false;
+        pThiz->record(nowUs() - startUs, timeout);
+        detect3d_result_t callback = pThiz->mCallback;
+        void *callbackData = pThiz->mCallbackData;
+
+        //the callback may set the 3d mode for long, start and kick are not blocked
+        pthread_mutex_unlock(&pThiz->mLock);
+        if (callback != NULL)
+            callback(result, timeout, callbackData);
+        pthread_mutex_lock(&pThiz->mLock);
+    }
+    pthread_mutex_unlock(&pThiz->mLock);
+    return NULL;
+}
+
+void Detect3D::getStats(detect3d_stats_t *stats) {
+    pthread_mutex_lock(&mLock);
+    *stats = mStats;
+    pthread_mutex_unlock(&mLock);
+}
+
+void Detect3D::dump(char *result) {
+    detect3d_stats_t stats;
+    detect3d_policy_t policy;
+    char buf[512];
+
+    getStats(&stats);
+    getPolicy(&policy);
+    int64_t total = stats.detections + stats.timeouts;
+    sprintf(buf, "\n3d detect: %d stable samples, sample %dms, timeout %dms\n"
+        "  %lld detections, %lld timeouts, %lld events, %lld samples, %lld opens\n"
+        "  ms:   <=50 <=100 <=200 <=500  <=1s  <=2s   >2s  last   avg   max\n  ",
+        policy.stableSamples, policy.sampleUs/1000, policy.timeoutUs/1000,
+        (long long)stats.detections, (long long)stats.timeouts, (long long)stats.events,
+        (long long)stats.samples, (long long)stats.opens);
+    strcat(result, buf);
+
+    int len = 0;
+    for (int i = 0; i < DETECT3D_BUCKETS; i++)
+        len += sprintf(buf + len, " %5lld", (long long)stats.count[i]);
+    sprintf(buf + len, " %5lld %5lld %5lld\n", (long long)(stats.lastUs/1000),
+        (long long)((total > 0)?stats.totalUs/total/1000:0), (long long)(stats.maxUs/1000));
+    strcat(result, buf);
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   XiaoLiang.Wang
+ *  @version  1.0
+ *  @date     2016/06/13
+ *  @par function description:
+ *  - 1 detect the 3d format of the source video, the video device is kept open
+ *  - 2 a video layer or format change event sample the device at once
+ *  - 3 the format is taken when it is the same for some samples in a row,
+ *       2d only after a video layer event or at the timeout
+ *  - 4 time to detect histogram
+ */
+
+#ifndef DETECT_3D_H
+#define DETECT_3D_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+//default policy, the old detection took 5 samples 200ms apart
+#define DETECT3D_STABLE_SAMPLES     2
+#define DETECT3D_SAMPLE_MS          50
+#define DETECT3D_TIMEOUT_MS         1000
+
+//the vpp format of a 2d source, also read before the first frame is decoded
+#define DETECT3D_FORMAT_NULL        0
+
+//upper bound of the buckets in ms, the last one is the rest
+#define DETECT3D_BUCKETS            7
+
+//the device the format is read from, the video device or a fake one for the host test
+typedef struct detect3d_backend {
+    //return a handle >= 0, or < 0 if the device can not be opened
+    int (*open)(void *data);
+    //read the vpp 3d format of the source, return 0 if ok
+    int (*getFormat)(void *data, int handle, int *vppFormat);
+    void (*close)(void *data, int handle);
+    void *data;
+} detect3d_backend_t;
+
+typedef struct detect3d_policy {
+    int stableSamples;          //the same format in this many samples in a row, 2d need an event too
+    int sampleUs;               //sample period without event
+    int timeoutUs;              //no stable format, the result is 3d off
+} detect3d_policy_t;
+
+//called in the detect thread with the vpp 3d format, 0 if timeout
+typedef void (*detect3d_result_t)(int vppFormat, bool timeout, void *data);
+
+typedef struct detect3d_stats {
+    int64_t detections;
+    int64_t timeouts;
+    int64_t events;             //kicks by the video layer or format change
+    int64_t samples;
+    int64_t opens;
+    int64_t lastUs;
+    int64_t totalUs;
+    int64_t maxUs;
+    int64_t count[DETECT3D_BUCKETS];
+} detect3d_stats_t;
+
+class Detect3D
+{
+public:
+    Detect3D(const detect3d_backend_t *backend);
+    ~Detect3D();
+
+    void setPolicy(const detect3d_policy_t *policy);
+    void getPolicy(detect3d_policy_t *policy);
+
+    //start a detection, a running one is restarted. the thread is created on the first one
+    int start(detect3d_result_t callback, void *data);
+    //the video layer or the source format changed, sample now
+    void kick();
+    //read the format once on the open device, return the vpp format or -1
+    int read();
+    //exit the thread and close the device
+    void stop();
+
+    void getStats(detect3d_stats_t *stats);
+    void dump(char *result);
+
+private:
+    static void *detectLoop(void *data);
+    int readLocked(int *vppFormat);
+    void record(int64_t us, bool timeout);
+
+    pthread_mutex_t mLock;
+    pthread_cond_t mCond;
+    pthread_t mThread;
+    bool mThreadRunning;
+    bool mExit;
+
+    detect3d_backend_t mBackend;
+    int mHandle;                //-1 if not open
+    detect3d_policy_t mPolicy;
+
+    //the pending detection
+    bool mPending;
+    bool mKicked;
+    int mGeneration;            //a restart drop the samples taken so far
+    int64_t mStartUs;
+    detect3d_result_t mCallback;
+    void *mCallbackData;
+
+    detect3d_stats_t mStats;
+};
+
+#endif // DETECT_3D_H
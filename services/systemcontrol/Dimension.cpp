@@ -32,22 +32,50 @@
 #include <unistd.h>
 #include <poll.h>
 
+#include <utils/Log.h>
 #include "Dimension.h"
 
 #ifndef RECOVERY_MODE
 #include <gui/SurfaceComposerClient.h> //for video 3d mode set
+#endif
 
 using namespace android;
-#endif
+
+static int amvideoOpen(void *data) {
+    (void)data;
+    return open(VIDEO_PATH, O_RDWR);
+}
+
+static int amvideoGetFormat(void *data, int fd, int *vppFormat) {
+    (void)data;
+    return (ioctl(fd, AMSTREAM_IOC_GET_SOURCE_VIDEO_3D_TYPE, vppFormat) < 0)?-1:0;
+}
+
+static void amvideoClose(void *data, int fd) {
+    (void)data;
+    close(fd);
+}
+
+static const detect3d_backend_t AMVIDEO_BACKEND = {
+    amvideoOpen, amvideoGetFormat, amvideoClose, NULL
+};
 
 Dimension::Dimension(DisplayMode *displayMode, SysWrite *sysWrite)
     :mDisplay3DFormat(0),
-    mLogLevel(LOG_LEVEL_DEFAULT) {
+    mLogLevel(LOG_LEVEL_DEFAULT),
+    mDetect3D(&AMVIDEO_BACKEND) {
     pDisplayMode = displayMode;
     pSysWrite = sysWrite;
 
     strcpy(mMode3d, VIDEO_3D_OFF);
 
+    detect3d_policy_t policy;
+    policy.stableSamples = pSysWrite->getPropertyInt(PROP_3D_DETECT_STABLE, DETECT3D_STABLE_SAMPLES);
+    policy.sampleUs = pSysWrite->getPropertyInt(PROP_3D_DETECT_SAMPLE, DETECT3D_SAMPLE_MS)*1000;
+    policy.timeoutUs = pSysWrite->getPropertyInt(PROP_3D_DETECT_TIMEOUT, DETECT3D_TIMEOUT_MS)*1000;
+    mDetect3D.setPolicy(&policy);
+    pDisplayMode->setVideoLayerListener(onVideoLayer, this);
+
     ALOGI("init");
 }
 
@@ -62,7 +90,7 @@ int32_t Dimension::set3DMode(const char* mode3d) {
     char is3DSupport[8] = {0}; //"1" means tv support 3d
 
     if (mLogLevel > LOG_LEVEL_1) {
-        ALOGI("set 3d mode :%s", String8(mode3d).string());
+        ALOGI("set 3d mode :%s", mode3d);
     }
 
     pSysWrite->readSysfs(AV_HDMI_3D_SUPPORT, is3DSupport);
@@ -152,17 +180,12 @@ int32_t Dimension::getVideo3DFormat(void) {
         ALOGI("getVideo3DFormat\n");
     }
 
-    int32_t format = -1;
-    int32_t vpp3Dformat = -1;
-    int video_fd = open(VIDEO_PATH, O_RDWR);
-    if (video_fd < 0) {
+    int32_t vpp3Dformat = mDetect3D.read();
+    if (vpp3Dformat < 0) {
         return -1;
     }
-    ioctl(video_fd, AMSTREAM_IOC_GET_SOURCE_VIDEO_3D_TYPE, &vpp3Dformat);
-    format = get3DFormatByVpp(vpp3Dformat);
-    close(video_fd);
 
-    return format;
+    return get3DFormatByVpp(vpp3Dformat);
 }
 
 int32_t Dimension::getDisplay3DTo2DFormat(void) {
@@ -220,7 +243,6 @@ bool Dimension::setDisplay3DTo2DFormat(int format) {
 
 bool Dimension::setDisplay3DFormat(int format) {
     bool ret = false;
-    String16 di3DformatStr;
     if (mLogLevel > LOG_LEVEL_1) {
         ALOGI("setDisplay3DFormat format:%d\n", format);
     }
@@ -285,51 +307,27 @@ bool Dimension::switch2DTo3D(int format) {
     return ret;
 }
 
-void* Dimension::detect3DThread(void* data) {
+//the format was the same in the stable samples, or 3d off if it can't be detected
+void Dimension::on3DDetected(int vppFormat, bool timeout, void *data) {
     Dimension *pThiz = (Dimension*)data;
-    int retry = RETRY_MAX;
-    int di3Dformat[5] = {0};
-    int times[5] = {0};
-    String16 di3DformatStr;
     char format3DStr[64] = {0};
 
-    while (retry > 0) {
-        retry--;
-        di3Dformat[retry] = pThiz->getVideo3DFormat();
-        //ALOGI("[detect3DThread]di3Dformat[%d]:%d\n", retry, di3Dformat[retry]);
-        usleep(200000);//200ms
-    }
-
-    //get the 3d format which was detected most times
-    for (int i = 0; i < RETRY_MAX - 1; i++) {
-        for (int j = i + 1; j < RETRY_MAX; j++) {
-            if (di3Dformat[i] == di3Dformat[j]) {
-                times[i]++;
-            }
-        }
-    }
-    int max = times[0];
-    int idx = 0;
-    for (int i = 0; i < RETRY_MAX - 1; i++) {
-        if (times[i] > max) {
-            max = times[i];
-            idx = i;
-        }
-    }
-    //can't detect 3d format correctly, 3d off
-    if (max == 1) {
-        idx = 0;
-        di3Dformat[0] = 0;
-    }
-
+    int format = pThiz->get3DFormatByVpp(vppFormat);
     if (pThiz->mLogLevel > LOG_LEVEL_1) {
-        ALOGI("[detect3DThread]after queue di3Dformat[%d]:%d\n", idx, di3Dformat[idx]);
+        detect3d_stats_t stats;
+        pThiz->mDetect3D.getStats(&stats);
+        ALOGI("[on3DDetected]format:%d timeout:%d in %lldms\n", format, timeout, (long long)(stats.lastUs/1000));
     }
 
-    pThiz->mDisplay3DFormat = di3Dformat[idx];
-    pThiz->get3DFormatStr(di3Dformat[idx], format3DStr);
+    pThiz->mDisplay3DFormat = format;
+    pThiz->get3DFormatStr(format, format3DStr);
     pThiz->set3DMode(format3DStr);
-    return NULL;
+}
+
+void Dimension::onVideoLayer(const char *state, void *data) {
+    (void)state;
+    Dimension *pThiz = (Dimension*)data;
+    pThiz->mDetect3D.kick();
 }
 
 void Dimension::autoDetect3DForMbox() {
@@ -337,10 +335,9 @@ void Dimension::autoDetect3DForMbox() {
         ALOGI("autoDetect3DForMbox\n");
     }
 
-    pthread_t id;
-    int ret = pthread_create(&id, NULL, detect3DThread, this);
+    int ret = mDetect3D.start(on3DDetected, this);
     if (ret != 0) {
-        ALOGE("[autoDetect3DForMbox:%d]ERROR; pthread_create failed rc=%d\n",__LINE__, ret);
+        ALOGE("[autoDetect3DForMbox:%d]ERROR; detect thread create failed rc=%d\n",__LINE__, ret);
     }
 }
 
@@ -503,5 +500,6 @@ int Dimension::dump(char *result) {
     get3DFormatStr(getDisplay3DFormat(), format3DStr);
     sprintf(buf, "\n display 3d format: %s , display 3d to 2d format:%d\n", format3DStr, getDisplay3DTo2DFormat());
     strcat(result, buf);
+    mDetect3D.dump(result);
     return 0;
 }
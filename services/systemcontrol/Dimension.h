@@ -24,6 +24,7 @@
 
 #include "DisplayMode.h"
 #include "SysWrite.h"
+#include "Detect3D.h"
 #include "common.h"
 
 #include <sys/ioctl.h>
@@ -84,7 +85,10 @@
 #define VPP_3D_MODE_LA 0x3
 #define VPP_3D_MODE_FA 0x4
 
-#define RETRY_MAX 5
+//debounce policy of the 3d auto detect, see Detect3D.h for the default
+#define PROP_3D_DETECT_STABLE           "persist.sys.3d.detect_stable"
+#define PROP_3D_DETECT_SAMPLE           "persist.sys.3d.detect_sample_ms"
+#define PROP_3D_DETECT_TIMEOUT          "persist.sys.3d.detect_timeout_ms"
 
 enum {
     FORMAT_3D_OFF                           = 0,
@@ -123,7 +127,6 @@ public:
     bool switch3DTo2D(int format);
     bool switch2DTo3D(int format);
     void autoDetect3DForMbox();
-    static void* detect3DThread(void* data);
     int dump(char *result);
 
 private:
@@ -133,6 +136,8 @@ private:
     int get3DFormatByOperation(unsigned int operation);
     int get3DFormatByVpp(int vpp3Dformat);
     void setDiBypassAll(int format);
+    static void on3DDetected(int vppFormat, bool timeout, void *data);
+    static void onVideoLayer(const char *state, void *data);
 
     char mMode3d[32];//this used for video 3d set
     char mLastDisMode[32];//last display mode
@@ -140,6 +145,8 @@ private:
     int mDisplay3DFormat;
     DisplayMode *pDisplayMode;
     SysWrite *pSysWrite;
+    //keep /dev/amvideo open, sample it on the video layer event
+    Detect3D mDetect3D;
 };
 // ----------------------------------------------------------------------------
 } // namespace android
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/07/04
+ *  @par function description:
+ *  - 1 mesondisplay.cfg parsed with SysTokenizer, and checked
+ *  - 2 the binary form: a header with version and crc, then the config as it is in memory
+ *  - 3 the binary is read and copied without parsing. the text is only stat if it has the
+ *      size and time it was compiled with, else its crc tell if the binary is stale
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "DisplayConfig.h"
+#include "SysTokenizer.h"
+
+//the text is small, a bigger one is not the config
+#define DISPLAY_CFG_TEXT_MAX        (64*1024)
+
+static const char* WHITESPACE = " \t\r";
+
+void displayCfgDefault(display_config_t *config) {
+    memset(config, 0, sizeof(display_config_t));
+    config->type = DISPLAY_TYPE_MBOX;
+    config->fb0Width = -1;
+    config->fb0Height = -1;
+    config->fb0Bits = -1;
+    config->fb0Triple = 1;
+    config->fb1Width = -1;
+    config->fb1Height = -1;
+    config->fb1Bits = -1;
+    config->fb1Triple = 1;
+}
+
+static void addError(int *errors, char *error, int size, const char *location, const char *msg,
+    const char *token) {
+    if (*errors == 0 && error != NULL)
+        snprintf(error, size, "%s: %s '%s'", location, msg, token);
+    (*errors)++;
+}
+
+//the next token of the line, an empty one is an error
+static const char *nextField(SysTokenizer *tokenizer, int *errors, char *error, int size,
+    const char *name) {
+    tokenizer->skipDelimiters(WHITESPACE);
+    char *token = tokenizer->nextToken(WHITESPACE);
+    if (strlen(token) == 0)
+        addError(errors, error, size, tokenizer->getLocation(), "missing", name);
+    return token;
+}
+
+static void copyField(char *dst, const char *token) {
+    strncpy(dst, token, DISPLAY_CFG_STR_LEN - 1);
+    dst[DISPLAY_CFG_STR_LEN - 1] = 0;
+}
+
+int displayCfgParse(const char *path, display_config_t *config, char *error, int size) {
+    SysTokenizer* tokenizer;
+    int errors = 0;
+
+    displayCfgDefault(config);
+    if (error != NULL && size > 0)
+        error[0] = 0;
+
+    int status = SysTokenizer::open(path, &tokenizer);
+    if (status) {
+        addError(&errors, error, size, path, "can not open", strerror(-status));
+        return errors;
+    }
+
+    while (!tokenizer->isEof()) {
+        tokenizer->skipDelimiters(WHITESPACE);
+
+        if (!tokenizer->isEol() && tokenizer->peekChar() != '#') {
+            char *token = tokenizer->nextToken(WHITESPACE);
+            if (!strcmp(token, DEVICE_STR_MID)) {
+                config->type = DISPLAY_TYPE_TABLET;
+                copyField(config->socType, nextField(tokenizer, &errors, error, size, "soc type"));
+                config->fb0Width = atoi(nextField(tokenizer, &errors, error, size, "fb0 width"));
+                config->fb0Height = atoi(nextField(tokenizer, &errors, error, size, "fb0 height"));
+                config->fb0Bits = atoi(nextField(tokenizer, &errors, error, size, "fb0 bits"));
+                config->fb0Triple = atoi(nextField(tokenizer, &errors, error, size, "fb0 triple")) != 0;
+                config->fb1Width = atoi(nextField(tokenizer, &errors, error, size, "fb1 width"));
+                config->fb1Height = atoi(nextField(tokenizer, &errors, error, size, "fb1 height"));
+                config->fb1Bits = atoi(nextField(tokenizer, &errors, error, size, "fb1 bits"));
+                config->fb1Triple = atoi(nextField(tokenizer, &errors, error, size, "fb1 triple")) != 0;
+            } else if (!strcmp(token, DEVICE_STR_MBOX) || !strcmp(token, DEVICE_STR_TV)) {
+                config->type = strcmp(token, DEVICE_STR_TV)?DISPLAY_TYPE_MBOX:DISPLAY_TYPE_TV;
+                copyField(config->socType, nextField(tokenizer, &errors, error, size, "soc type"));
+                copyField(config->defaultUI, nextField(tokenizer, &errors, error, size, "default UI"));
+            } else {
+                addError(&errors, error, size, tokenizer->getLocation(), "expected keyword, got", token);
+                break;
+            }
+
+            tokenizer->skipDelimiters(WHITESPACE);
+            if (!tokenizer->isEol() && tokenizer->peekChar() != '#')
+                addError(&errors, error, size, tokenizer->getLocation(), "extra token",
+                    tokenizer->peekRemainderOfLine());
+        }
+
+        tokenizer->nextLine();
+    }
+    delete tokenizer;
+    return errors;
+}
+
+int displayCfgCheck(const display_config_t *config, char *error, int size) {
+    int errors = 0;
+    char value[MODE_LEN];
+
+    if (error != NULL && size > 0)
+        error[0] = 0;
+
+    if (config->type == DISPLAY_TYPE_TABLET) {
+        if (config->fb0Width <= 0 || config->fb0Height <= 0 || config->fb1Width <= 0
+            || config->fb1Height <= 0) {
+            sprintf(value, "%dx%d %dx%d", config->fb0Width, config->fb0Height,
+                config->fb1Width, config->fb1Height);
+            addError(&errors, error, size, "MID", "bad fb size", value);
+        }
+        if ((config->fb0Bits != 16 && config->fb0Bits != 24 && config->fb0Bits != 32)
+            || (config->fb1Bits != 16 && config->fb1Bits != 24 && config->fb1Bits != 32)) {
+            sprintf(value, "%d %d", config->fb0Bits, config->fb1Bits);
+            addError(&errors, error, size, "MID", "bad fb bits", value);
+        }
+    } else if (config->type == DISPLAY_TYPE_MBOX || config->type == DISPLAY_TYPE_TV) {
+        //see setMboxDisplay, the UI size is taken from the prefix
+        if (strncmp(config->defaultUI, "720", 3) && strncmp(config->defaultUI, "1080", 4)
+            && strncmp(config->defaultUI, "4k2k", 4))
+            addError(&errors, error, size, (config->type == DISPLAY_TYPE_TV)?"TV":"MBOX",
+                "unknown default UI", config->defaultUI);
+    } else {
+        sprintf(value, "%d", config->type);
+        addError(&errors, error, size, "config", "unknown type", value);
+    }
+
+    if (strlen(config->socType) == 0)
+        addError(&errors, error, size, "config", "missing", "soc type");
+    return errors;
+}
+
+void displayCfgBinPath(const char *path, char *binPath) {
+    int len = strlen(path);
+    const char *dot = strrchr(path, '.');
+    if (dot != NULL && strchr(dot, '/') == NULL)
+        len = dot - path;
+    if (len > DISPLAY_CFG_PATH_LEN - (int)sizeof(DISPLAY_CFG_BIN_SUFFIX))
+        len = DISPLAY_CFG_PATH_LEN - (int)sizeof(DISPLAY_CFG_BIN_SUFFIX);
+    memcpy(binPath, path, len);
+    strcpy(binPath + len, DISPLAY_CFG_BIN_SUFFIX);
+}
+
+//size and crc32 of the text file, -1 if it can not be read
+static int textCrc(const char *path, uint32_t *size, uint32_t *crc) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size > DISPLAY_CFG_TEXT_MAX) {
+        close(fd);
+        return -1;
+    }
+
+    char *buf = new char[st.st_size + 1];
+    int len = read(fd, buf, st.st_size);
+    close(fd);
+    if (len != st.st_size) {
+        delete[] buf;
+        return -1;
+    }
+    *size = len;
+    *crc = crc32(0, (const Bytef *)buf, len);
+    delete[] buf;
+    return 0;
+}
+
+static int64_t mtimeNs(const struct stat *st) {
+    return (int64_t)st->st_mtim.tv_sec*1000000000 + st->st_mtim.tv_nsec;
+}
+
+int displayCfgWriteBin(const char *binPath, const display_config_t *config, const char *srcPath) {
+    display_cfg_header_t header;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = DISPLAY_CFG_MAGIC;
+    header.version = DISPLAY_CFG_VERSION;
+    header.size = sizeof(display_config_t);
+    header.crc = crc32(0, (const Bytef *)config, sizeof(display_config_t));
+    struct stat src;
+    if (textCrc(srcPath, &header.srcSize, &header.srcCrc) < 0 || stat(srcPath, &src) < 0)
+        return -1;
+    header.srcMtimeNs = mtimeNs(&src);
+
+    int fd = open(binPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    int ret = 0;
+    if (write(fd, &header, sizeof(header)) != sizeof(header)
+        || write(fd, config, sizeof(display_config_t)) != sizeof(display_config_t))
+        ret = -1;
+    close(fd);
+    return ret;
+}
+
+int displayCfgReadBin(const char *binPath, const char *srcPath, display_config_t *config) {
+    int fd = open(binPath, O_RDONLY);
+    if (fd < 0)
+        return DISPLAY_CFG_BIN_MISSING;
+
+    //the binary is smaller than a page, one read is cheaper than a map.
+    //one byte more to know if the file is longer than it should be
+    struct {
+        display_cfg_header_t header;
+        display_config_t config;
+        char extra;
+    } bin;
+    int len = read(fd, &bin, sizeof(bin));
+    close(fd);
+    if (len < (int)sizeof(display_cfg_header_t))
+        return DISPLAY_CFG_BIN_CORRUPT;
+
+    const display_cfg_header_t *header = &bin.header;
+    if (header->magic != DISPLAY_CFG_MAGIC)
+        return DISPLAY_CFG_BIN_CORRUPT;
+    if (header->version != DISPLAY_CFG_VERSION || header->size != sizeof(display_config_t))
+        return DISPLAY_CFG_BIN_VERSION;
+    if (len != (int)(sizeof(display_cfg_header_t) + sizeof(display_config_t))
+        || header->crc != crc32(0, (const Bytef *)&bin.config, sizeof(display_config_t)))
+        return DISPLAY_CFG_BIN_CORRUPT;
+
+    //the text as compiled is only stat. the image builder may set another time on it,
+    //the crc is read then. without the text, the binary is the config
+    struct stat src;
+    if (srcPath != NULL && stat(srcPath, &src) == 0) {
+        uint32_t size, crc;
+        if ((uint32_t)src.st_size != header->srcSize)
+            return DISPLAY_CFG_BIN_STALE;
+        if (mtimeNs(&src) != header->srcMtimeNs
+            && (textCrc(srcPath, &size, &crc) < 0 || size != header->srcSize || crc != header->srcCrc))
+            return DISPLAY_CFG_BIN_STALE;
+    }
+
+    memcpy(config, &bin.config, sizeof(display_config_t));
+    return DISPLAY_CFG_BIN_OK;
+}
+
+int displayCfgLoad(const char *path, display_config_t *config, int *status) {
+    char binPath[DISPLAY_CFG_PATH_LEN];
+    char error[MAX_STR_LEN];
+
+    //a text pushed or changed after the binary was compiled is parsed
+    displayCfgBinPath(path, binPath);
+    *status = displayCfgReadBin(binPath, path, config);
+    if (*status == DISPLAY_CFG_BIN_OK)
+        return DISPLAY_CFG_FROM_BIN;
+
+    if (*status != DISPLAY_CFG_BIN_MISSING)
+        SYS_LOGE("display config %s is not used: %d, parse %s\n", binPath, *status, path);
+    if (displayCfgParse(path, config, error, sizeof(error)) > 0) {
+        SYS_LOGE("display config %s\n", error);
+        if (access(path, R_OK) != 0)
+            return DISPLAY_CFG_FROM_NONE;
+    }
+    return DISPLAY_CFG_FROM_TEXT;
+}
+
+void displayCfgDump(const display_config_t *config, char *result) {
+    char buf[256];
+    const char *type = "none";
+
+    if (config->type == DISPLAY_TYPE_TABLET)
+        type = DEVICE_STR_MID;
+    else if (config->type == DISPLAY_TYPE_MBOX)
+        type = DEVICE_STR_MBOX;
+    else if (config->type == DISPLAY_TYPE_TV)
+        type = DEVICE_STR_TV;
+
+    sprintf(buf, "type:%s, soc type:%s, default UI:%s\n", type, config->socType, config->defaultUI);
+    strcat(result, buf);
+    if (config->type == DISPLAY_TYPE_TABLET) {
+        sprintf(buf, "fb0 %dx%d %dbits triple:%d, fb1 %dx%d %dbits triple:%d\n",
+            config->fb0Width, config->fb0Height, config->fb0Bits, config->fb0Triple,
+            config->fb1Width, config->fb1Height, config->fb1Bits, config->fb1Triple);
+        strcat(result, buf);
+    }
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/07/04
+ *  @par function description:
+ *  - 1 mesondisplay.cfg parsed with SysTokenizer, and checked
+ *  - 2 the binary form: a header with version and crc, then the config as it is in memory
+ *  - 3 the binary is read and copied without parsing. the text is only stat if it has the
+ *      size and time it was compiled with, else its crc tell if the binary is stale
+ */
+
+#ifndef DISPLAY_CONFIG_H
+#define DISPLAY_CONFIG_H
+
+#include <stdint.h>
+
+#include "common.h"
+
+#define DISPLAY_CFG_MAGIC           0x47464344  //"DCFG"
+//change it with display_config_t, an old binary is not used
+#define DISPLAY_CFG_VERSION         2
+#define DISPLAY_CFG_STR_LEN         64
+//the binary is the text path with this suffix in place of .cfg
+#define DISPLAY_CFG_BIN_SUFFIX      ".bin"
+#define DISPLAY_CFG_PATH_LEN        256
+
+#define DEVICE_STR_MID                  "MID"
+#define DEVICE_STR_MBOX                 "MBOX"
+#define DEVICE_STR_TV                   "TV"
+
+enum {
+    DISPLAY_TYPE_NONE                   = 0,
+    DISPLAY_TYPE_TABLET                 = 1,
+    DISPLAY_TYPE_MBOX                   = 2,
+    DISPLAY_TYPE_TV                     = 3
+};
+
+//where the config is loaded from
+enum {
+    DISPLAY_CFG_FROM_NONE           = 0,
+    DISPLAY_CFG_FROM_BIN            = 1,
+    DISPLAY_CFG_FROM_TEXT           = 2
+};
+
+//why the binary is not used
+enum {
+    DISPLAY_CFG_BIN_OK              = 0,
+    DISPLAY_CFG_BIN_MISSING         = -1,
+    DISPLAY_CFG_BIN_CORRUPT         = -2,
+    DISPLAY_CFG_BIN_VERSION         = -3,
+    DISPLAY_CFG_BIN_STALE           = -4
+};
+
+//fixed size fields, the binary is this struct, the host and the box are little endian
+typedef struct display_config {
+    int32_t type;                   //DISPLAY_TYPE_xxx
+    char socType[DISPLAY_CFG_STR_LEN];
+    char defaultUI[DISPLAY_CFG_STR_LEN];
+    int32_t fb0Width;
+    int32_t fb0Height;
+    int32_t fb0Bits;
+    int32_t fb0Triple;
+    int32_t fb1Width;
+    int32_t fb1Height;
+    int32_t fb1Bits;
+    int32_t fb1Triple;
+} display_config_t;
+
+typedef struct display_cfg_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                  //sizeof(display_config_t)
+    uint32_t crc;                   //crc32 of the config
+    uint32_t srcSize;               //the text it was compiled from
+    uint32_t srcCrc;
+    int64_t srcMtimeNs;             //the image may give the text another time, the crc is read then
+} display_cfg_header_t;
+
+//the defaults of DisplayMode, used for the lines not in the file
+void displayCfgDefault(display_config_t *config);
+//the text parser, return the count of the errors, the first one is in error.
+//the lines before a bad keyword are kept, as DisplayMode always did
+int displayCfgParse(const char *path, display_config_t *config, char *error, int size);
+//check the values, return the count of the errors, the first one is in error
+int displayCfgCheck(const display_config_t *config, char *error, int size);
+
+//mesondisplay.cfg to mesondisplay.bin
+void displayCfgBinPath(const char *path, char *binPath);
+//write the binary of config compiled from srcPath
+int displayCfgWriteBin(const char *binPath, const display_config_t *config, const char *srcPath);
+//return DISPLAY_CFG_BIN_xxx, srcPath is not checked if it is NULL or missing.
+//the binary is stale if srcPath has another size or crc than it was compiled from
+int displayCfgReadBin(const char *binPath, const char *srcPath, display_config_t *config);
+//the binary if it is good and not stale, or the text. return DISPLAY_CFG_FROM_xxx,
+//and status the DISPLAY_CFG_BIN_xxx
+int displayCfgLoad(const char *path, display_config_t *config, int *status);
+
+void displayCfgDump(const display_config_t *config, char *result);
+
+#endif // DISPLAY_CONFIG_H
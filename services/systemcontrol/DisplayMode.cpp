@@ -31,14 +31,16 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <poll.h>
+#include <time.h>
 
+#include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <linux/netlink.h>
 #include <cutils/properties.h>
 #include "ubootenv.h"
 #include "DisplayMode.h"
-#include "SysTokenizer.h"
+#include "Metrics.h"
 
 #include "HDCPKey/hdcp22_key.h"
 #include "HDCPKey/HdcpRx22Key.h"
@@ -220,28 +222,28 @@ static int uevent_next_event(int fd, char* buffer, int buffer_length)
     return 0;
 }
 
-static bool isMatch(uevent_data_t* ueventData, const char* matchName) {
-    bool matched = false;
-    // Consider all zero-delimited fields of the buffer.
-    const char* field = ueventData->buf;
-    const char* end = ueventData->buf + ueventData->len + 1;
-    do {
-        if (!strcmp(field, matchName)) {
-            SYS_LOGI("Matched uevent message with pattern: %s", matchName);
-            matched = true;
-        }
-        //SWITCH_STATE=1, SWITCH_NAME=hdmi
-        else if (strstr(field, "SWITCH_STATE=")) {
-            strcpy(ueventData->state, field + strlen("SWITCH_STATE="));
-        }
-        else if (strstr(field, "SWITCH_NAME=")) {
-            strcpy(ueventData->name, field + strlen("SWITCH_NAME="));
-        }
-        field += strlen(field) + 1;
-    } while (field != end);
-
-    return matched;
-}
+//"DEVPATH=/devices/virtual/switch/hdmi" to the path the dispatcher match
+static const char* ueventDevpath(const char* match) {
+    const char* value = strchr(match, '=');
+    return (value != NULL)?value + 1:match;
+}
+
+static const mode_plan_nodes_t MBOX_PLAN_NODES = {
+    SYSFS_DISPLAY_MODE,
+    SYSFS_DISPLAY_MODE2,
+    DISPLAY_FB0_FREESCALE_AXIS,
+    DISPLAY_FB0_WINDOW_AXIS,
+    DISPLAY_FB0_BLANK,
+    DISPLAY_FB0_FREESCALE,
+    DISPLAY_HDMI_AVMUTE,
+    DISPLAY_HDMI_HDCP_MODE,
+    DISPLAY_HDMI_HDCP_AUTH,
+    DISPLAY_HDMI_PHY,
+    DISPLAY_HDMI_VIC,
+    UBOOTENV_OUTPUTMODE,
+    UBOOTENV_HDMIMODE,
+    UBOOTENV_CVBSMODE,
+};
 
 #ifndef RECOVERY_MODE
 static void sfRepaintEverything() {
@@ -274,7 +276,10 @@ DisplayMode::DisplayMode(const char *path)
     mLastVideoState(0),
     pthreadIdHdcpTx(0),
     mExitHdcpTxThread(false),
-    mBootAnimDetectFinished(false) {
+    mVideoLayerListener(NULL),
+    mVideoLayerData(NULL),
+    mBootAnimDetectFinished(false),
+    mLastPlanUs(0) {
 
     if (NULL == path) {
         pConfigPath = DISPLAY_CFG_FILE;
@@ -285,16 +290,28 @@ DisplayMode::DisplayMode(const char *path)
 
     SYS_LOGI("display mode config path: %s", pConfigPath);
     pSysWrite = new SysWrite();
+    pthread_mutex_init(&mEdidMutex, NULL);
+    pthread_mutex_init(&mVideoLayerMutex, NULL);
+    memset(&mEdidCaps, 0, sizeof(mEdidCaps));
+    memset(&mLastPlan, 0, sizeof(mLastPlan));
 }
 
 DisplayMode::~DisplayMode() {
     delete pSysWrite;
+    pthread_mutex_destroy(&mEdidMutex);
+    pthread_mutex_destroy(&mVideoLayerMutex);
 
     sem_destroy(&pthreadTxSem);
     sem_destroy(&pthreadBootDetectSem);
 }
 
 void DisplayMode::init() {
+    initConfig();
+    initDisplay();
+}
+
+//the boot init stages: the config, the edid read and the display, see SystemControl
+void DisplayMode::initConfig() {
     if ((sem_init(&pthreadTxSem, 0, 0) < 0) || (sem_init(&pthreadBootDetectSem, 0, 0) < 0)) {
         SYS_LOGE("display mode, sem_init failed\n");
         exit(0);
@@ -304,10 +321,32 @@ void DisplayMode::init() {
 
     SYS_LOGI("display mode init type: %d [0:none 1:tablet 2:mbox 3:tv], soc type:%s, default UI:%s",
         mDisplayType, mSocType, mDefaultUI);
+}
+
+//read the edid of the plugged TV to the cache, it may retry for 2.5s,
+//it run with the bootenv read and the display init find it in the cache
+void DisplayMode::prefetchEdid() {
+    char hpdState[MODE_LEN] = {0};
+    edid_caps_t caps;
+
+    if (DISPLAY_TYPE_MBOX != mDisplayType)
+        return;
+
+    pSysWrite->readSysfs(DISPLAY_HPD_STATE, hpdState);
+    if (strcmp(hpdState, "1"))
+        return;
+
+    memset(&caps, 0, sizeof(edid_caps_t));
+    loadEdidCaps(&caps);
+}
+
+void DisplayMode::initDisplay() {
     if (DISPLAY_TYPE_TABLET == mDisplayType) {
         setTabletDisplay();
     }
     else if (DISPLAY_TYPE_MBOX == mDisplayType) {
+        //the table is ready before the first uevent
+        initUeventHandlers();
         pthread_t id;
         int ret = pthread_create(&id, NULL, HdmiUenventThreadLoop, this);
         if (ret != 0) {
@@ -319,6 +358,7 @@ void DisplayMode::init() {
     else if (DISPLAY_TYPE_TV == mDisplayType) {
         hdcpRxInit();
 
+        initUeventHandlers();
         pthread_t id;
         int ret;
         ret = pthread_create(&id, NULL, HdmiUenventThreadLoop, this);
@@ -406,72 +446,33 @@ void DisplayMode::setBootEnv(const char* key, char* value) {
     bootenv_update(key, value);
 }
 
+//mesondisplay.bin is copied as it is, mesondisplay.cfg is parsed if it is missing, bad or stale
 int DisplayMode::parseConfigFile(){
-    const char* WHITESPACE = " \t\r";
+    display_config_t config;
+    int status;
 
-    SysTokenizer* tokenizer;
-    int status = SysTokenizer::open(pConfigPath, &tokenizer);
-    if (status) {
-        SYS_LOGE("Error %d opening display config file %s.", status, pConfigPath);
-    } else {
-        while (!tokenizer->isEof()) {
-
-            if(mLogLevel > LOG_LEVEL_1)
-                SYS_LOGI("Parsing %s: %s", tokenizer->getLocation(), tokenizer->peekRemainderOfLine());
-
-            tokenizer->skipDelimiters(WHITESPACE);
-
-            if (!tokenizer->isEol() && tokenizer->peekChar() != '#') {
-
-                char *token = tokenizer->nextToken(WHITESPACE);
-                if(!strcmp(token, DEVICE_STR_MID)){
-                    mDisplayType = DISPLAY_TYPE_TABLET;
-
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    strcpy(mSocType, tokenizer->nextToken(WHITESPACE));
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    mFb0Width = atoi(tokenizer->nextToken(WHITESPACE));
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    mFb0Height = atoi(tokenizer->nextToken(WHITESPACE));
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    mFb0FbBits = atoi(tokenizer->nextToken(WHITESPACE));
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    mFb0TripleEnable = (0 == atoi(tokenizer->nextToken(WHITESPACE)))?false:true;
-
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    mFb1Width = atoi(tokenizer->nextToken(WHITESPACE));
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    mFb1Height = atoi(tokenizer->nextToken(WHITESPACE));
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    mFb1FbBits = atoi(tokenizer->nextToken(WHITESPACE));
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    mFb1TripleEnable = (0 == atoi(tokenizer->nextToken(WHITESPACE)))?false:true;
-
-                } else if (!strcmp(token, DEVICE_STR_MBOX)) {
-                    mDisplayType = DISPLAY_TYPE_MBOX;
-
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    strcpy(mSocType, tokenizer->nextToken(WHITESPACE));
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    strcpy(mDefaultUI, tokenizer->nextToken(WHITESPACE));
-                } else if (!strcmp(token, DEVICE_STR_TV)) {
-                    mDisplayType = DISPLAY_TYPE_TV;
-
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    strcpy(mSocType, tokenizer->nextToken(WHITESPACE));
-                    tokenizer->skipDelimiters(WHITESPACE);
-                    strcpy(mDefaultUI, tokenizer->nextToken(WHITESPACE));
-                }else {
-                    SYS_LOGE("%s: Expected keyword, got '%s'.", tokenizer->getLocation(), token);
-                    break;
-                }
-            }
+    int from = displayCfgLoad(pConfigPath, &config, &status);
+    if (DISPLAY_CFG_FROM_NONE == from) {
+        SYS_LOGE("Error opening display config file %s.", pConfigPath);
+        return -1;
+    }
+    SYS_LOGI("display config from %s, binary status:%d\n",
+        (DISPLAY_CFG_FROM_BIN == from)?"binary":"text", status);
 
-            tokenizer->nextLine();
-        }
-        delete tokenizer;
+    mDisplayType = config.type;
+    strcpy(mSocType, config.socType);
+    strcpy(mDefaultUI, config.defaultUI);
+    if (DISPLAY_TYPE_TABLET == mDisplayType) {
+        mFb0Width = config.fb0Width;
+        mFb0Height = config.fb0Height;
+        mFb0FbBits = config.fb0Bits;
+        mFb0TripleEnable = config.fb0Triple != 0;
+        mFb1Width = config.fb1Width;
+        mFb1Height = config.fb1Height;
+        mFb1FbBits = config.fb1Bits;
+        mFb1TripleEnable = config.fb1Triple != 0;
     }
-    return status;
+    return 0;
 }
 
 void DisplayMode::setTabletDisplay() {
@@ -587,116 +588,188 @@ void DisplayMode::setMboxOutputMode(const char* outputmode){
 }
 
 void DisplayMode::setMboxOutputMode(const char* outputmode, output_mode_state state) {
-    char value[MAX_STR_LEN] = {0};
-    char finalMode[MODE_LEN] = {0};
-    int outputx = 0;
-    int outputy = 0;
-    int outputwidth = 0;
-    int outputheight = 0;
-    int position[4] = { 0, 0, 0, 0 };
-    bool cvbsMode = false;
-
-    strcpy(finalMode, outputmode);
-    addSuffixForMode(finalMode, state);
-    if (state == OUPUT_MODE_STATE_SWITCH) {
-        char curDisplayMode[MODE_LEN] = {0};
-        pSysWrite->readSysfs(SYSFS_DISPLAY_MODE, curDisplayMode);
-        if (!strcmp(finalMode, curDisplayMode)) {
-            return;
-        }
+    static int metric = metrics_id("display.setMboxOutputMode");
+    MetricsScope scope(metric);
+    mode_plan_t plan;
+    display_state_t want;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    buildModePlan(outputmode, state, &plan, &want);
+    if (plan.count == 0) {
+        SYS_LOGI("set output mode:%s, nothing changed\n", want.envOutputMode);
+        return;
     }
 
-    if (OUPUT_MODE_STATE_INIT != state) {
-        pSysWrite->writeSysfs(DISPLAY_HDMI_AVMUTE, "1");
-        if (OUPUT_MODE_STATE_POWER != state) {
-            usleep(50000);//50ms
-            pSysWrite->writeSysfs(DISPLAY_HDMI_HDCP_MODE, "-1");
-            usleep(100000);//100ms
-            pSysWrite->writeSysfs(DISPLAY_HDMI_PHY, "0"); /* Turn off TMDS PHY */
-            usleep(50000);//50ms
-        }
+    if (plan.writeMode && (!strcmp(want.envOutputMode, MODE_480CVBS) ||
+            !strcmp(want.envOutputMode, MODE_576CVBS))) {
+        //close deepcolor if HDMI not plugged in, because the next TV maybe not support deepcolor
+        pSysWrite->setProperty(PROP_DEEPCOLOR, "false");
     }
 
-    getPosition(finalMode, position);
-    outputx = position[0];
-    outputy = position[1];
-    outputwidth = position[2];
-    outputheight = position[3];
+    SYS_LOGI("setMboxOutputMode cvbsMode = %d, %d steps, %d writes skipped\n",
+        want.cvbs, plan.count, plan.skipped);
+    runModePlan(&plan, want.envOutputMode);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    memcpy(&mLastPlan, &plan, sizeof(mode_plan_t));
+    mLastPlanUs = (int64_t)(end.tv_sec - start.tv_sec)*1000000 + (end.tv_nsec - start.tv_nsec)/1000;
+    SYS_LOGI("set output mode:%s done, %lldus\n", want.envOutputMode, (long long)mLastPlanUs);
+}
+
+//the wanted state of outputmode, diffed with the one of the driver
+void DisplayMode::buildModePlan(const char* outputmode, output_mode_state state, mode_plan_t* plan,
+    display_state_t* want) {
+    display_state_t cur;
+    int position[4] = { 0, 0, 0, 0 };
+
+    memset(want, 0, sizeof(display_state_t));
+    strcpy(want->envOutputMode, outputmode);
+    want->clearVic = addSuffixForMode(want->envOutputMode, state);
+    const char* finalMode = want->envOutputMode;
 
     if ((!strcmp(finalMode, MODE_480I) || !strcmp(finalMode, MODE_576I)) &&
             (pSysWrite->getPropertyBoolean(PROP_HAS_CVBS_MODE, false))) {
-        const char *mode = "";
-        if (!strcmp(finalMode, MODE_480I)) {
-            mode = MODE_480CVBS;
-        }
-        else if (!strcmp(finalMode, MODE_576I)) {
-            mode = MODE_576CVBS;
-        }
-
-        cvbsMode = true;
-        pSysWrite->writeSysfs(SYSFS_DISPLAY_MODE, mode);
-        pSysWrite->writeSysfs(SYSFS_DISPLAY_MODE2, "null");
+        strcpy(want->mode, !strcmp(finalMode, MODE_480I)?MODE_480CVBS:MODE_576CVBS);
+        strcpy(want->mode2, "null");
+        want->cvbs = true;
+    } else {
+        strcpy(want->mode, finalMode);
+        want->cvbs = !strcmp(finalMode, MODE_480CVBS) || !strcmp(finalMode, MODE_576CVBS);
     }
-    else {
-        if (!strcmp(finalMode, MODE_480CVBS) || !strcmp(finalMode, MODE_576CVBS)) {
-            //close deepcolor if HDMI not plugged in, because the next TV maybe not support deepcolor
-            pSysWrite->setProperty(PROP_DEEPCOLOR, "false");
-            cvbsMode = true;
-        }
 
-        pSysWrite->writeSysfs(SYSFS_DISPLAY_MODE, finalMode);
+    getPosition(finalMode, position);
+    sprintf(want->freeScaleAxis, "%d %d %d %d",
+            0, 0, mDisplayWidth - 1, mDisplayHeight - 1);
+    sprintf(want->windowAxis, "%d %d %d %d",
+            position[0], position[1], position[0] + position[2] - 1, position[1] + position[3] - 1);
+    strcpy(want->fb0Blank, "0");
+    strcpy(want->fb0FreeScale, "0x10001");
+    if (strstr(finalMode, "cvbs") != NULL) {
+        strcpy(want->envCvbsMode, finalMode);
+    } else {
+        strcpy(want->envHdmiMode, finalMode);
     }
 
-    char axis[MAX_STR_LEN] = {0};
-    sprintf(axis, "%d %d %d %d",
-            0, 0, mDisplayWidth - 1, mDisplayHeight - 1);
-    pSysWrite->writeSysfs(DISPLAY_FB0_FREESCALE_AXIS, axis);
+    readDisplayState(&cur, want);
+    modePlanBuild(plan, &MBOX_PLAN_NODES, &cur, want, state);
+}
 
-    sprintf(axis, "%d %d %d %d",
-            outputx, outputy, outputx + outputwidth - 1, outputy + outputheight -1);
-    pSysWrite->writeSysfs(DISPLAY_FB0_WINDOW_AXIS, axis);
-    setVideoPlayingAxis();
+static void readNode(SysWrite* sysWrite, const char* path, char* value) {
+    char buf[MAX_STR_LEN] = {0};
+    sysWrite->readSysfs(path, buf);
+    strncpy(value, buf, MODE_LEN - 1);
+    value[MODE_LEN - 1] = 0;
+}
 
-    SYS_LOGI("setMboxOutputMode cvbsMode = %d\n", cvbsMode);
+//only the nodes the wanted state touch are read
+void DisplayMode::readDisplayState(display_state_t* cur, const display_state_t* want) {
+    memset(cur, 0, sizeof(display_state_t));
+    readNode(pSysWrite, SYSFS_DISPLAY_MODE, cur->mode);
+    if (strlen(want->mode2) > 0)
+        readNode(pSysWrite, SYSFS_DISPLAY_MODE2, cur->mode2);
+    readNode(pSysWrite, DISPLAY_FB0_FREESCALE_AXIS, cur->freeScaleAxis);
+    readNode(pSysWrite, DISPLAY_FB0_WINDOW_AXIS, cur->windowAxis);
+    readNode(pSysWrite, DISPLAY_FB0_BLANK, cur->fb0Blank);
+    readNode(pSysWrite, DISPLAY_FB0_FREESCALE, cur->fb0FreeScale);
 
-    hdcpTxThreadExit();
+    const char* value = bootenv_get(UBOOTENV_OUTPUTMODE);
+    if (value != NULL)
+        strncpy(cur->envOutputMode, value, MODE_LEN - 1);
+    value = bootenv_get(UBOOTENV_HDMIMODE);
+    if (value != NULL)
+        strncpy(cur->envHdmiMode, value, MODE_LEN - 1);
+    value = bootenv_get(UBOOTENV_CVBSMODE);
+    if (value != NULL)
+        strncpy(cur->envCvbsMode, value, MODE_LEN - 1);
+}
 
-    //only HDMI mode need HDCP authenticate
-    if (!cvbsMode) {
-        hdcpTxThreadStart();
-    }
-    else {
-        SYS_LOGI("CVBS mode need stop hdcp tx authenticate\n");
-        hdcpTxStop();
+//poll the node until it reads value, sleep the timeout out if the node can not be read
+void DisplayMode::waitSysfs(const char* path, const char* value, int timeoutUs) {
+    char buf[MAX_STR_LEN] = {0};
+    int waitedUs = 0;
+
+    if (strlen(path) == 0) {
+        usleep(timeoutUs);
+        return;
     }
 
-    if (OUPUT_MODE_STATE_INIT == state) {
-        startBootanimDetectThread();
-    } else {
-        pSysWrite->writeSysfs(DISPLAY_FB0_BLANK, "0");
-        pSysWrite->writeSysfs(DISPLAY_FB0_FREESCALE, "0x10001");
-        setOsdMouse(finalMode);
+    while (waitedUs < timeoutUs) {
+        if (!pSysWrite->readSysfs(path, buf)) {
+            usleep(timeoutUs - waitedUs);
+            return;
+        }
+        if (modePlanSameValue(buf, value))
+            return;
+
+        usleep(MODE_PLAN_POLL_US);
+        waitedUs += MODE_PLAN_POLL_US;
     }
+    SYS_LOGI("wait %s to be %s timeout, read %s\n", path, value, buf);
+}
+
+void DisplayMode::runModePlan(const mode_plan_t* plan, const char* finalMode) {
+    char value[MAX_STR_LEN] = {0};
 
+    //one env write for the mode switch
+    bootenv_transaction_begin();
+    for (int i = 0; i < plan->count; i++) {
+        const mode_plan_step_t* step = &plan->steps[i];
+        switch (step->type) {
+            case PLAN_STEP_WRITE:
+                pSysWrite->writeSysfs(step->path, step->value);
+                break;
+            case PLAN_STEP_WAIT:
+                waitSysfs(step->path, step->value, step->timeoutUs);
+                break;
+            case PLAN_STEP_HDCP_START:
+                hdcpTxThreadExit();
+                hdcpTxThreadStart();
+                break;
+            case PLAN_STEP_HDCP_STOP:
+                hdcpTxThreadExit();
+                SYS_LOGI("CVBS mode need stop hdcp tx authenticate\n");
+                hdcpTxStop();
+                break;
+            case PLAN_STEP_VIDEO_AXIS:
+                setVideoPlayingAxis();
+                break;
+            case PLAN_STEP_OSD_MOUSE:
+                setOsdMouse(finalMode);
+                break;
+            case PLAN_STEP_BOOTANIM:
+                startBootanimDetectThread();
+                break;
+            case PLAN_STEP_NOTIFY:
 #ifndef RECOVERY_MODE
-    notifyEvent(EVENT_OUTPUT_MODE_CHANGE);
+                notifyEvent(EVENT_OUTPUT_MODE_CHANGE);
 #endif
+                break;
+            case PLAN_STEP_AUDIO:
+                getBootEnv(UBOOTENV_DIGITAUDIO, value);
+                setDigitalMode(value);
+                break;
+            case PLAN_STEP_ENV:
+                setBootEnv(step->path, (char*)step->value);
+                break;
+        }
+    }
+    bootenv_transaction_end();
+}
 
-    //audio
-    getBootEnv(UBOOTENV_DIGITAUDIO, value);
-    setDigitalMode(value);
+int DisplayMode::planMboxOutputMode(const char* outputmode, char *result) {
+    mode_plan_t plan;
+    display_state_t want;
 
-    if (OUPUT_MODE_STATE_INIT != state) {
-        pSysWrite->writeSysfs(DISPLAY_HDMI_AVMUTE, "-1");
-    }
+    if (NULL == result)
+        return -1;
 
-    setBootEnv(UBOOTENV_OUTPUTMODE, finalMode);
-    if (strstr(finalMode, "cvbs") != NULL) {
-        setBootEnv(UBOOTENV_CVBSMODE, finalMode);
-    } else {
-        setBootEnv(UBOOTENV_HDMIMODE, finalMode);
-    }
-    SYS_LOGI("set output mode:%s done\n", finalMode);
+    buildModePlan(outputmode, OUPUT_MODE_STATE_SWITCH, &plan, &want);
+    char buf[256] = {0};
+    sprintf(buf, "dry run switch to %s, display mode %s\n", want.envOutputMode, want.mode);
+    strcat(result, buf);
+    modePlanDump(&plan, result);
+    return 0;
 }
 
 void DisplayMode::setDigitalMode(const char* mode) {
@@ -755,96 +828,21 @@ void DisplayMode::setVideoPlayingAxis() {
 
 //get the best hdmi mode by edid
 void DisplayMode::getBestHdmiMode(char* mode, hdmi_data_t* data) {
-    char* pos = strchr(data->edid, '*');
-    if (pos != NULL) {
-        char* findReturn = pos;
-        while (*findReturn != 0x0a && findReturn >= data->edid) {
-            findReturn--;
-        }
-        //*pos = 0;
-        //strcpy(mode, findReturn + 1);
-
-        findReturn = findReturn + 1;
-        strncpy(mode, findReturn, pos - findReturn);
+    if (data->edid.preferred >= 0) {
+        strcpy(mode, data->edid.modes[data->edid.preferred].name);
         SYS_LOGI("set HDMI to best edid mode: %s\n", mode);
     }
 
     if (strlen(mode) == 0) {
         pSysWrite->getPropertyString(PROP_BEST_OUTPUT_MODE, mode, DEFAULT_OUTPUT_MODE);
     }
-
-  /*
-    char* arrayMode[MAX_STR_LEN] = {0};
-    char* tmp;
-
-    int len = strlen(data->edid);
-    tmp = data->edid;
-    int i = 0;
-
-    do {
-        if (strlen(tmp) == 0)
-            break;
-        char* pos = strchr(tmp, 0x0a);
-        *pos = 0;
-
-        arrayMode[i] = tmp;
-        tmp = pos + 1;
-        i++;
-    } while (tmp <= data->edid + len -1);
-
-    for (int j = 0; j < i; j++) {
-        char* pos = strchr(arrayMode[j], '*');
-        if (pos != NULL) {
-            *pos = 0;
-            strcpy(mode, arrayMode[j]);
-            break;
-        }
-    }*/
 }
 
 //get the highest hdmi mode by edid
 void DisplayMode::getHighestHdmiMode(char* mode, hdmi_data_t* data) {
-    const char PMODE = 'p';
-    const char IMODE = 'i';
-    const char* FREQ = "hz";
-    int lenmode = 0, intmode = 0, higmode = 0;
-    char value[MODE_LEN] = {0};
-    char* type;
-    char* start;
-    char* pos = data->edid;
-    do {
-        pos = strstr(pos, FREQ);
-        if (pos == NULL) break;
-        start = pos;
-        while (*start != '\n' && start >= data->edid) {
-            start--;
-        }
-        start++;
-        int len = pos - start;
-        strncpy(value, start, len);
-        pos = strstr(pos, "\n");
-
-        if ((type = strchr(value, PMODE)) != NULL && type - value >= 3) {
-            value[type - value] = '1';
-        } else if ((type = strchr(value, IMODE)) != NULL) {
-            value[type - value] = '0';
-        } else {
-            continue;
-        }
-        value[len] = '\0';
-
-        if ((intmode = atoi(value)) >= higmode) {
-            len = pos - start;
-            if (intmode == higmode && lenmode >= len) continue;
-            lenmode = len;
-            higmode = intmode;
-            strncpy(mode, start, len);
-            if (mode[len - 1] == '*')  mode[len - 1] = '\0';
-            else mode[len] = '\0';
-        }
-    } while (strlen(pos) > 0);
-
-    if (higmode == 0) {
+    if (data->edid.highest >= 0) {
+        strcpy(mode, data->edid.modes[data->edid.highest].name);
+    } else {
         pSysWrite->getPropertyString(PROP_BEST_OUTPUT_MODE, mode, DEFAULT_OUTPUT_MODE);
     }
 
@@ -853,22 +851,9 @@ void DisplayMode::getHighestHdmiMode(char* mode, hdmi_data_t* data) {
 
 //check if the edid support current hdmi mode
 void DisplayMode::filterHdmiMode(char* mode, hdmi_data_t* data) {
-    char *pCmp = data->edid;
-    while ((pCmp - data->edid) < (int)strlen(data->edid)) {
-        char *pos = strchr(pCmp, 0x0a);
-        if (NULL == pos)
-            break;
-
-        int step = 1;
-        if (*(pos - 1) == '*') {
-            pos -= 1;
-            step += 1;
-        }
-        if (!strncmp(pCmp, data->ubootenv_hdmimode, pos - pCmp)) {
-            strcpy(mode, data->ubootenv_hdmimode);
-            return;
-        }
-        pCmp = pos + step;
+    if (edidFindMode(&data->edid, data->ubootenv_hdmimode) != NULL) {
+        strcpy(mode, data->ubootenv_hdmimode);
+        return;
     }
     if (DISPLAY_TYPE_TV == mDisplayType) {
         #ifdef TEST_UBOOT_MODE
@@ -898,11 +883,21 @@ void DisplayMode::standardMode(char* mode) {
     }
 }
 
-void DisplayMode::addSuffixForMode(char* mode, output_mode_state state) {
+//return true if the vic need be cleared before the mode is written
+bool DisplayMode::addSuffixForMode(char* mode, output_mode_state state) {
     char save_mode[MODE_LEN] = {0};
+    bool support10bit = true;
+    bool clearVic = false;
 
     strcpy(save_mode, mode);
     standardMode(mode);
+
+    //without dc_cap keep the 10bit of the deep color property
+    pthread_mutex_lock(&mEdidMutex);
+    if (mEdidCaps.valid && mEdidCaps.deepColorKnown)
+        support10bit = edidSupportDepth(&mEdidCaps, mode, EDID_DEPTH_10BIT);
+    pthread_mutex_unlock(&mEdidMutex);
+
     int index = modeToIndex(mode);
     //only support 4 modes for 10bit now
     switch (index) {
@@ -911,31 +906,9 @@ void DisplayMode::addSuffixForMode(char* mode, output_mode_state state) {
         case DISPLAY_MODE_4K2K50HZ420:
         case DISPLAY_MODE_4K2K60HZ420:
             if (OUPUT_MODE_STATE_INIT != state)
-                pSysWrite->writeSysfs(DISPLAY_HDMI_VIC, "0");
-            if (isDeepColor()) {
-#if 0
-                char deepColor[MAX_STR_LEN];
-                pSysWrite->readSysfsOriginal(DISPLAY_HDMI_DEEP_COLOR, deepColor);
-                char *pCmp = deepColor;
-                while ((pCmp - deepColor) < (int)strlen(deepColor)) {
-                    char *pos = strchr(pCmp, 0x0a);
-                    if (NULL == pos) {
-                        break;
-                    } else {
-                        *pos = 0;
-                    }
-                    if ((strstr(pCmp, "420") != NULL && strstr(pCmp, SUFFIX_10BIT) != NULL && strstr(mode, "420") != NULL)
-                            ||(strstr(pCmp, "422") != NULL && strstr(pCmp, SUFFIX_10BIT) != NULL && strstr(mode, "422") != NULL)
-                            ||(strstr(pCmp, "444") != NULL && strstr(pCmp, SUFFIX_10BIT) != NULL)) {
-                        strcat(mode, SUFFIX_10BIT);
-                        break;
-                    }
-                    *pos = 0x0a;
-                    pCmp = pos + 1;
-                }
-#else
+                clearVic = true;
+            if (isDeepColor() && support10bit) {
                 strcat(mode, SUFFIX_10BIT);
-#endif
             }
             break;
       case DISPLAY_MODE_4K2K50HZ422:
@@ -945,10 +918,11 @@ void DisplayMode::addSuffixForMode(char* mode, output_mode_state state) {
             strcat(mode, SUFFIX_10BIT);
             break;
     }
+    return clearVic;
 }
 
 void DisplayMode::getHdmiOutputMode(char* mode, hdmi_data_t* data) {
-    if (strstr(data->edid, "null") != NULL) {
+    if (!data->edid.valid) {
         pSysWrite->getPropertyString(PROP_BEST_OUTPUT_MODE, mode, DEFAULT_OUTPUT_MODE);
         return;
     }
@@ -974,21 +948,17 @@ void DisplayMode::initHdmiData(hdmi_data_t* data, char* hpdstate){
         strcpy(data->hpd_state, hpdstate);
     }
 
+    data->edid.preferred = -1;
+    data->edid.highest = -1;
     if (!strcmp(data->hpd_state, "1")) {
-        int count = 0;
-        while (true) {
-            pSysWrite->readSysfsOriginal(DISPLAY_HDMI_EDID, data->edid);
-            if (strlen(data->edid) > 0)
-                break;
-
-            if (count >= 5) {
-                strcpy(data->edid, "null edid");
-                break;
-            }
-            count++;
-            usleep(500000);
-        }
+        //the same TV plugged again, the edid nodes are not read
+        loadEdidCaps(&data->edid);
     }
+
+    pthread_mutex_lock(&mEdidMutex);
+    memcpy(&mEdidCaps, &data->edid, sizeof(edid_caps_t));
+    pthread_mutex_unlock(&mEdidMutex);
+
     pSysWrite->readSysfs(SYSFS_DISPLAY_MODE, data->current_mode);
     getBootEnv(UBOOTENV_HDMIMODE, data->ubootenv_hdmimode);
     standardMode(data->ubootenv_hdmimode);
@@ -1091,11 +1061,131 @@ void* DisplayMode::HdmiPlugDetectThread(void* data) {
     return NULL;
 }
 */
+void DisplayMode::onHdmiTxPower(const uevent_msg_t* msg, void* data) {
+    DisplayMode *pThiz = (DisplayMode*)data;
+
+    SYS_LOGI("switch_name: %s switch_state: %s\n", msg->name, msg->state);
+    //0: hdmi suspend  1: hdmi resume
+    if (!strcmp(msg->state, HDMI_TX_RESUME)) {
+        pThiz->setMboxDisplay((char*)msg->state, OUPUT_MODE_STATE_POWER);
+    }
+    if (!strcmp(msg->state, HDMI_TX_SUSPEND)) {
+        pThiz->hdcpTxSuspend();
+    }
+}
+
+void DisplayMode::onHdmiTxPlug(const uevent_msg_t* msg, void* data) {
+    DisplayMode *pThiz = (DisplayMode*)data;
+
+    SYS_LOGI("switch_name: %s switch_state: %s\n", msg->name, msg->state);
+    pThiz->setMboxDisplay((char*)msg->state, OUPUT_MODE_STATE_POWER);
+}
+
+//only post the result, it run in the netlink thread
+void DisplayMode::onHdmiTxHdcp(const uevent_msg_t* msg, void* data) {
+    DisplayMode *pThiz = (DisplayMode*)data;
+
+    SYS_LOGI("switch_name: %s switch_state: %s\n", msg->name, msg->state);
+    if (!strcmp(msg->state, HDMI_TX_HDCP_AUTH_OK)) {
+        pThiz->mHdcpAuth.post(HDCP_AUTH_OK);
+    }
+}
+
+void DisplayMode::onHdmiRxPlug(const uevent_msg_t* msg, void* data) {
+    DisplayMode *pThiz = (DisplayMode*)data;
+
+    SYS_LOGI("switch_name: %s switch_state: %s\n", msg->name, msg->state);
+    if (!strcmp(msg->state, HDMI_RX_PLUG_IN)) {
+        pThiz->hdcpTxThreadExit();
+        pThiz->hdcpTxStopSvc();
+        pThiz->hdcpRxStopSvc();
+        usleep(50*1000);
+        pThiz->hdcpRxStartSvc();
+    } else if (!strcmp(msg->state, HDMI_RX_PLUG_OUT)) {
+        pThiz->hdcpTxThreadExit();
+        pThiz->hdcpTxStopSvc();
+        pThiz->hdcpRxStopSvc();
+        pThiz->hdcpTxThreadStart();
+    }
+}
+
+void DisplayMode::onHdmiRxAuth(const uevent_msg_t* msg, void* data) {
+    DisplayMode *pThiz = (DisplayMode*)data;
+    int version = 0;
+
+    SYS_LOGI("switch_name: %s switch_state: %s\n", msg->name, msg->state);
+    if (!strcmp(msg->state, HDMI_RX_AUTH_HDCP14)) {
+        version = 1;
+    } else if (!strcmp(msg->state, HDMI_RX_AUTH_HDCP22)) {
+        version = 2;
+    } else {
+        return;
+    }
+
+    char hdmiPlugState[MODE_LEN] = {0};
+    pThiz->pSysWrite->readSysfs(HDMI_TX_PLUG_STATE, hdmiPlugState);
+    SYS_LOGI("hdcp_rx %s hdmi is plug in\n", (version == 2)?"2.2":"1.4");
+    if (!strcmp(hdmiPlugState, "1"))
+        pThiz->pSysWrite->writeSysfs(DISPLAY_HDMI_AVMUTE, "1");
+
+    pThiz->mRxSupportHdcpAuth = version;
+    pThiz->hdcpRxForceFlushVideoLayer();
+    if (!strcmp(hdmiPlugState, "1")) {
+        SYS_LOGI("hdcp_tx hdmi is plug in\n");
+        pThiz->hdcpTxThreadExit();
+        pThiz->hdcpTxThreadStart();
+    } else {
+        SYS_LOGI("hdcp_tx hdmi is plug out\n");
+    }
+}
+
+#ifndef RECOVERY_MODE
+void DisplayMode::onVideoLayer(const uevent_msg_t* msg, void* data) {
+    DisplayMode *pThiz = (DisplayMode*)data;
+    //0: no aml video data, 1: aml video data aviliable
+    if (!strcmp(msg->name, "video_layer1") && !strcmp(msg->state, "1")) {
+        SYS_LOGI("Video Layer1 switch_state: %s switch_name: %s\n", msg->state, msg->name);
+        sfRepaintEverything();
+    }
+
+    //take the listener and its data as a pair, call it out of the lock
+    pthread_mutex_lock(&pThiz->mVideoLayerMutex);
+    video_layer_listener_t listener = pThiz->mVideoLayerListener;
+    void *listenerData = pThiz->mVideoLayerData;
+    pthread_mutex_unlock(&pThiz->mVideoLayerMutex);
+    if (listener != NULL)
+        listener(msg->state, listenerData);
+}
+#endif
+
+//the hdmi handlers change the mode and hdcp, they run one by one in the "hdmi" queue.
+//the repaint binder call of the video layer do not wait for them.
+void DisplayMode::initUeventHandlers() {
+    int hdmiQueue = mUevent.addQueue("hdmi");
+    mUevent.add(ueventDevpath(HDMI_TX_POWER_UEVENT), NULL, hdmiQueue, UEVENT_COALESCE,
+        onHdmiTxPower, this, "hdmi_power");
+    mUevent.add(ueventDevpath(HDMI_TX_PLUG_UEVENT), NULL, hdmiQueue, UEVENT_COALESCE,
+        onHdmiTxPlug, this, "hdmi");
+    mUevent.add(ueventDevpath(HDMI_RX_PLUG_UEVENT), NULL, hdmiQueue, UEVENT_COALESCE,
+        onHdmiRxPlug, this, "hdmirx_hpd");
+    mUevent.add(ueventDevpath(HDMI_RX_AUTH_UEVENT), NULL, hdmiQueue, 0,
+        onHdmiRxAuth, this, "hdmirx_auth");
+    mUevent.add(ueventDevpath(HDMI_TX_HDCP_UEVENT), NULL, UEVENT_QUEUE_INLINE, 0,
+        onHdmiTxHdcp, this, "hdcp");
+#ifndef RECOVERY_MODE
+    int videoQueue = mUevent.addQueue("video");
+    mUevent.add(ueventDevpath(VIDEO_LAYER1_UEVENT), NULL, videoQueue, UEVENT_COALESCE,
+        onVideoLayer, this, "video_layer1");
+#endif
+}
+
 // all the hdmi plug checking complete in this loop
 void* DisplayMode::HdmiUenventThreadLoop(void* data) {
     DisplayMode *pThiz = (DisplayMode*)data;
 
     char status[PROPERTY_VALUE_MAX] = {0};
+    char record[PROPERTY_VALUE_MAX] = {0};
+    char recording[PROPERTY_VALUE_MAX] = {0};
 /*
     // reset mode, because hdcp init need too much time, it maybe miss the HDMI plug event
     char curMode[MODE_LEN] = {0};
@@ -1108,9 +1198,7 @@ void* DisplayMode::HdmiUenventThreadLoop(void* data) {
     }
 */
     //use uevent instead of usleep, because it's has some delay
-    uevent_data_t u_data;
-
-    memset(&u_data, 0, sizeof(uevent_data_t));
+    char buf[UEVENT_MSG_LEN];
     int fd = uevent_init();
     while (fd >= 0) {
         if (property_get("instaboot.status", status, "completed") &&
@@ -1119,87 +1207,21 @@ void* DisplayMode::HdmiUenventThreadLoop(void* data) {
             continue;
         }
 
-        u_data.len= uevent_next_event(fd, u_data.buf, sizeof(u_data.buf) - 1);
-        if (u_data.len <= 0)
+        int len = uevent_next_event(fd, buf, sizeof(buf) - 1);
+        if (len <= 0)
             continue;
 
-        u_data.buf[u_data.len] = '\0';
-
-        //printfMsg(u_data.buf, u_data.len);
-
-        if (isMatch(&u_data, HDMI_TX_POWER_UEVENT)) {
-            SYS_LOGI("switch_name: %s switch_state: %s\n", u_data.name, u_data.state);
-            //0: hdmi suspend  1: hdmi resume
-            if (!strcmp(u_data.state, HDMI_TX_RESUME)) {
-                pThiz->setMboxDisplay(u_data.state, OUPUT_MODE_STATE_POWER);
-            }
-            if (!strcmp(u_data.state, HDMI_TX_SUSPEND)) {
-                pThiz->hdcpTxSuspend();
-            }
+        buf[len] = '\0';
+        //the uevents are appended to the file, for uevent_replay
+        //read it every event, so the record can be started and stopped at runtime
+        pThiz->pSysWrite->getPropertyString(PROP_UEVENT_RECORD, record, "");
+        if (strcmp(record, recording)) {
+            //a file failed to open is not tried again until the property change
+            pThiz->mUevent.setRecordFile((strlen(record) > 0)?record:NULL);
+            strcpy(recording, record);
         }
-        else if (isMatch(&u_data, HDMI_RX_PLUG_UEVENT)) {
-            SYS_LOGI("switch_name: %s switch_state: %s\n", u_data.name, u_data.state);
-            if (!strcmp(u_data.state, HDMI_RX_PLUG_IN)) {
-                pThiz->hdcpTxThreadExit();
-                pThiz->hdcpTxStopSvc();
-                pThiz->hdcpRxStopSvc();
-                usleep(50*1000);
-                pThiz->hdcpRxStartSvc();
-            } else if (!strcmp(u_data.state, HDMI_RX_PLUG_OUT)) {
-                pThiz->hdcpTxThreadExit();
-                pThiz->hdcpTxStopSvc();
-                pThiz->hdcpRxStopSvc();
-                pThiz->hdcpTxThreadStart();
-            }
-        }
-        else if (isMatch(&u_data, HDMI_RX_AUTH_UEVENT)) {
-            SYS_LOGI("switch_name: %s switch_state: %s\n", u_data.name, u_data.state);
-            char hdmiPlugState[MODE_LEN] = {0};
-            pThiz->pSysWrite->readSysfs(HDMI_TX_PLUG_STATE, hdmiPlugState);
-            if (!strcmp(u_data.state, HDMI_RX_AUTH_HDCP14)) {
-                SYS_LOGI("hdcp_rx 1.4 hdmi is plug in\n");
-                if (!strcmp(hdmiPlugState, "1"))
-                    pThiz->pSysWrite->writeSysfs(DISPLAY_HDMI_AVMUTE, "1");
-
-                pThiz->mRxSupportHdcpAuth = 1;
-                pThiz->hdcpRxForceFlushVideoLayer();
-                if (!strcmp(hdmiPlugState, "1")) {
-                    SYS_LOGI("hdcp_tx hdmi is plug in\n");
-                    pThiz->hdcpTxThreadExit();
-                    pThiz->hdcpTxThreadStart();
-                } else {
-                    SYS_LOGI("hdcp_tx hdmi is plug out\n");
-                }
-            } else if (!strcmp(u_data.state, HDMI_RX_AUTH_HDCP22)) {
-                SYS_LOGI("hdcp_rx 2.2 hdmi is plug in\n");
-                if (!strcmp(hdmiPlugState, "1"))
-                    pThiz->pSysWrite->writeSysfs(DISPLAY_HDMI_AVMUTE, "1");
-
-                pThiz->mRxSupportHdcpAuth = 2;
-                pThiz->hdcpRxForceFlushVideoLayer();
-                if (!strcmp(hdmiPlugState, "1")) {
-                    SYS_LOGI("hdcp_tx hdmi is plug in\n");
-                    pThiz->hdcpTxThreadExit();
-                    pThiz->hdcpTxThreadStart();
-                } else {
-                    SYS_LOGI("hdcp_tx hdmi is plug out\n");
-                }
-            }
-        }
-        else if (isMatch(&u_data, HDMI_TX_PLUG_UEVENT)) {
-            SYS_LOGI("switch_name: %s switch_state: %s\n", u_data.name, u_data.state);
-            pThiz->setMboxDisplay(u_data.state, OUPUT_MODE_STATE_POWER);
-        }
-
-#ifndef RECOVERY_MODE
-        if (isMatch(&u_data, VIDEO_LAYER1_UEVENT)) {
-            //0: no aml video data, 1: aml video data aviliable
-            if (!strcmp(u_data.name, "video_layer1") && !strcmp(u_data.state, "1")) {
-                SYS_LOGI("Video Layer1 switch_state: %s switch_name: %s\n", u_data.state, u_data.name);
-                sfRepaintEverything();
-            }
-        }
-#endif
+        //printfMsg(buf, len);
+        pThiz->mUevent.dispatch(buf, len);
     }
 
     return NULL;
@@ -1268,17 +1290,97 @@ void* DisplayMode::bootanimDetect(void* data) {
     return NULL;
 }
 
-//get edid crc value to check edid change
-bool DisplayMode::isEdidChange() {
+//read the disp_cap, retry as the edid may not be ready just after plug in
+void DisplayMode::readEdidCaps(edid_caps_t* caps) {
+    char dispCap[MAX_STR_LEN] = {0};
+    char dcCap[MAX_STR_LEN] = {0};
+    char hdrCap[MAX_STR_LEN] = {0};
+    char support3d[MODE_LEN] = {0};
+
+    int count = 0;
+    while (true) {
+        pSysWrite->readSysfsOriginal(DISPLAY_HDMI_EDID, dispCap);
+        if (strlen(dispCap) > 0)
+            break;
+
+        if (count >= 5) {
+            strcpy(dispCap, "null edid");
+            break;
+        }
+        count++;
+        usleep(500000);
+    }
+    pSysWrite->readSysfsOriginal(DISPLAY_HDMI_DEEP_COLOR, dcCap);
+    pSysWrite->readSysfs(AV_HDMI_3D_SUPPORT, support3d);
+    pSysWrite->readSysfsOriginal(DISPLAY_HDMI_HDR, hdrCap);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    edidParseCaps(caps, dispCap, dcCap, support3d, hdrCap);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    mEdidCache.countParse((int64_t)(end.tv_sec - start.tv_sec)*1000000 + (end.tv_nsec - start.tv_nsec)/1000);
+    SYS_LOGI("edid crc:%s, %d modes\n", caps->crc, caps->modeCount);
+}
+
+//the crc of the edid not read yet, 0x00000000 or empty
+static bool isZeroCrc(const char *crc) {
+    if (crc[0] == '0' && (crc[1] == 'x' || crc[1] == 'X'))
+        crc += 2;
+    while (*crc == '0')
+        crc++;
+    return *crc == 0;
+}
+
+//the table of the TV from the cache, or from the edid nodes. the crc is read before the disp_cap
+//which may take 2.5s, the table is kept only under the crc that is still there after it
+void DisplayMode::loadEdidCaps(edid_caps_t* caps) {
+    char crc[EDID_CRC_LEN] = {0};
+
+    getEdidCrc(caps->crc);
+    if (!isZeroCrc(caps->crc) && mEdidCache.get(caps->crc, caps))
+        return;
+
+    readEdidCaps(caps);
+    getEdidCrc(crc);
+    if (strcmp(crc, caps->crc)) {
+        SYS_LOGI("edid crc changed from %s to %s in the read, not kept\n", caps->crc, crc);
+        strcpy(caps->crc, crc);
+        return;
+    }
+    if (isZeroCrc(crc)) {
+        SYS_LOGI("edid crc %s is not ready, not kept\n", crc);
+        return;
+    }
+    mEdidCache.put(caps);
+}
+
+//get the crc value after "checkvalue: " of the edid node
+bool DisplayMode::getEdidCrc(char* crc) {
     char edid[MAX_STR_LEN] = {0};
-    char crcvalue[MAX_STR_LEN] = {0};
     unsigned int crcheadlength = strlen(DEFAULT_EDID_CRCHEAD);
+
+    crc[0] = 0;
     pSysWrite->readSysfs(DISPLAY_EDID_VALUE, edid);
     char *p = strstr(edid, DEFAULT_EDID_CRCHEAD);
-    if (p != NULL && strlen(p) > crcheadlength) {
-        p += crcheadlength;
-        if (!getBootEnv(UBOOTENV_EDIDCRCVALUE, crcvalue) || strncmp(p, crcvalue, strlen(p))) {
-            setBootEnv(UBOOTENV_EDIDCRCVALUE, p);
+    if (p == NULL || strlen(p) <= crcheadlength)
+        return false;
+
+    p += crcheadlength;
+    int len = strcspn(p, " \r\n");
+    if (len >= EDID_CRC_LEN)
+        len = EDID_CRC_LEN - 1;
+    strncpy(crc, p, len);
+    crc[len] = 0;
+    return len > 0;
+}
+
+//get edid crc value to check edid change
+bool DisplayMode::isEdidChange() {
+    char crc[EDID_CRC_LEN] = {0};
+    char crcvalue[MAX_STR_LEN] = {0};
+    if (getEdidCrc(crc)) {
+        if (!getBootEnv(UBOOTENV_EDIDCRCVALUE, crcvalue) || strcmp(crc, crcvalue)) {
+            setBootEnv(UBOOTENV_EDIDCRCVALUE, crc);
             return true;
         }
     }
@@ -1560,6 +1662,7 @@ void DisplayMode::setPosition(int left, int top, int width, int height) {
     pSysWrite->readSysfs(SYSFS_DISPLAY_MODE, curMode);
     standardMode(curMode);
     int index = modeToIndex(curMode);
+    bootenv_transaction_begin();
     switch (index) {
         case DISPLAY_MODE_480I: // 480i
         case DISPLAY_MODE_480CVBS: //480cvbs
@@ -1658,6 +1761,7 @@ void DisplayMode::setPosition(int left, int top, int width, int height) {
         default:
             break;
     }
+    bootenv_transaction_end();
 }
 
 int DisplayMode::modeToIndex(const char *mode) {
@@ -1814,7 +1918,8 @@ bool DisplayMode::hdcpTxInit(bool *pHdcp22, bool *pHdcp14) {
         return false;
     }
 
-    //start hdcp_tx
+    //start hdcp_tx, a result of the last attempt is not taken
+    mHdcpAuth.clear();
     if (useHdcp22) {
         hdcpTxStart22();
     }
@@ -1827,40 +1932,83 @@ bool DisplayMode::hdcpTxInit(bool *pHdcp22, bool *pHdcp14) {
     return true;
 }
 
+typedef struct hdcp_poll {
+    DisplayMode *thiz;
+    bool hdcp22;
+    bool svcRunning;
+} hdcp_poll_t;
+
+//for the kernels without the hdcp uevent, and the hdcp_tx22 service quit as a failure
+int DisplayMode::hdcpTxPollAuth(void* data) {
+    hdcp_poll_t *poll = (hdcp_poll_t *)data;
+    char auth[MODE_LEN] = {0};
+
+    poll->thiz->pSysWrite->readSysfs(DISPLAY_HDMI_HDCP_AUTH, auth);
+    if (_strstr(auth, (char *)"1"))
+        return HDCP_AUTH_OK;
+
+    if (poll->hdcp22) {
+        char svc[PROPERTY_VALUE_MAX] = {0};
+        poll->thiz->pSysWrite->getPropertyString(PROP_HDCP_TX22_SVC, svc, "");
+        if (!strcmp(svc, "running")) {
+            poll->svcRunning = true;
+        } else if (poll->svcRunning && !strcmp(svc, "stopped")) {
+            return HDCP_AUTH_FAIL;
+        }
+    }
+    return HDCP_AUTH_NONE;
+}
+
 void DisplayMode::hdcpTxAuthenticate(bool useHdcp22, bool useHdcp14) {
 #ifdef HDCP_AUTHENTICATION
     SYS_LOGI("hdcp_tx begin to authenticate\n");
-    int count = 0;
+    int timeout22 = pSysWrite->getPropertyInt(PROP_HDCP_TX22_TIMEOUT, HDCP_TX_TIMEOUT_MS);
+    int timeout14 = pSysWrite->getPropertyInt(PROP_HDCP_TX14_TIMEOUT, HDCP_TX_TIMEOUT_MS);
+    int pollMs = pSysWrite->getPropertyInt(PROP_HDCP_TX_POLL, HDCP_TX_POLL_MS);
+    int metric = metrics_id("hdcp.wait");
+
     while (!mExitHdcpTxThread) {
-        usleep(200*1000);//sleep 200ms
+        hdcp_poll_t poll;
+        int64_t elapsedUs = 0;
+
+        poll.thiz = this;
+        poll.hdcp22 = useHdcp22;
+        poll.svcRunning = false;
+        metrics_trace_begin(metric);
+        int result = mHdcpAuth.wait((useHdcp22?timeout22:timeout14)*1000, pollMs*1000,
+            hdcpTxPollAuth, &poll, &elapsedUs);
+        metrics_trace_end(metric);
+        metrics_record(metric, elapsedUs);
+        if (HDCP_AUTH_EXIT == result)
+            break;
 
-        char auth[MODE_LEN] = {0};
-        pSysWrite->readSysfs(DISPLAY_HDMI_HDCP_AUTH, auth);
-        if (_strstr(auth, (char *)"1")) {//Authenticate is OK
-            SYS_LOGI("hdcp_tx authenticate succeed\n");
+        if (HDCP_AUTH_OK == result) {
+            mHdcpAuth.record(useHdcp22?HDCP_AUTH_22_OK:HDCP_AUTH_14_OK, elapsedUs);
+            SYS_LOGI("hdcp_tx %s authenticate succeed in %lldms\n",
+                useHdcp22?"2.2":"1.4", (long long)elapsedUs/1000);
             pSysWrite->writeSysfs(DISPLAY_HDMI_AVMUTE, "-1");
             break;
         }
 
-        count++;
-        if (count > 40) { //max 200msx40 = 8s it will authenticate completely
-            if (useHdcp22) {
-                SYS_LOGE("hdcp_tx 2.2 authenticate fail for 8s timeout, change to hdcp_tx 1.4 authenticate\n");
-
-                count = 0;
-                useHdcp22 = false;
-                useHdcp14 = true;
-                //if support hdcp22, must support hdcp14
-                hdcpTxStart14();
-                continue;
-            }
-            else if (useHdcp14) {
-                SYS_LOGE("hdcp_tx 1.4 authenticate fail, 8s timeout\n");
-                hdcpTxStop();
-            }
-            pSysWrite->writeSysfs(DISPLAY_HDMI_AVMUTE, "-1");
-            break;
+        mHdcpAuth.record(useHdcp22?HDCP_AUTH_22_FAIL:HDCP_AUTH_14_FAIL, elapsedUs);
+        if (useHdcp22) {
+            SYS_LOGE("hdcp_tx 2.2 authenticate %s after %lldms, change to hdcp_tx 1.4 authenticate\n",
+                (HDCP_AUTH_FAIL == result)?"fail":"timeout", (long long)elapsedUs/1000);
+
+            useHdcp22 = false;
+            useHdcp14 = true;
+            //if support hdcp22, must support hdcp14
+            mHdcpAuth.clear();
+            hdcpTxStart14();
+            continue;
         }
+        else if (useHdcp14) {
+            SYS_LOGE("hdcp_tx 1.4 authenticate %s after %lldms\n",
+                (HDCP_AUTH_FAIL == result)?"fail":"timeout", (long long)elapsedUs/1000);
+            hdcpTxStop();
+        }
+        pSysWrite->writeSysfs(DISPLAY_HDMI_AVMUTE, "-1");
+        break;
     }
     SYS_LOGI("hdcp_tx authenticate finish\n");
 #else
@@ -1912,6 +2060,7 @@ int DisplayMode::hdcpTxThreadStart() {
     }
 
     mExitHdcpTxThread = false;
+    mHdcpAuth.reset();
     ret = pthread_create(&thread_id, NULL, hdcpTxThreadLoop, this);
     if (ret != 0) SYS_LOGE("hdcp_tx display mode, thread create failed\n");
 
@@ -1934,6 +2083,7 @@ int DisplayMode::hdcpTxThreadExit() {
     }
 
     mExitHdcpTxThread = true;
+    mHdcpAuth.cancel();
     if (0 != pthreadIdHdcpTx) {
         if (pthread_mutex_trylock(&pthreadTxMutex) == EDEADLK) {
             SYS_LOGE("hdcp_tx exit hdcp thread, Mutex is deadlock\n");
@@ -1953,6 +2103,22 @@ int DisplayMode::hdcpTxThreadExit() {
     return ret;
 }
 
+//a uevent from the simulator, as if it was read from the netlink socket
+int DisplayMode::injectUevent(const char *buf, int len, bool wait) {
+    int ret = mUevent.dispatch(buf, len);
+    if (wait)
+        mUevent.waitIdle();
+    return ret;
+}
+
+//called in the video uevent queue, the listener is never called with the data of another one
+void DisplayMode::setVideoLayerListener(video_layer_listener_t listener, void *data) {
+    pthread_mutex_lock(&mVideoLayerMutex);
+    mVideoLayerListener = listener;
+    mVideoLayerData = data;
+    pthread_mutex_unlock(&mVideoLayerMutex);
+}
+
 //for debug
 void DisplayMode::hdcpSwitch() {
     SYS_LOGI("hdcpSwitch for debug hdcp authenticate\n");
@@ -1995,7 +2161,20 @@ int DisplayMode::dump(char *result) {
     if (DISPLAY_TYPE_MBOX == mDisplayType) {
         sprintf(buf, "default ui:%s\n", mDefaultUI);
         strcat(result, buf);
+
+        pthread_mutex_lock(&mEdidMutex);
+        edidDumpCaps(&mEdidCaps, result);
+        pthread_mutex_unlock(&mEdidMutex);
+        mEdidCache.dump(result);
+
+        mHdcpAuth.dump(result);
+
+        sprintf(buf, "\nlast output mode switch: %lldus\n", (long long)mLastPlanUs);
+        strcat(result, buf);
+        modePlanDump(&mLastPlan, result);
     }
+
+    mUevent.dump(result);
     return 0;
 }
 
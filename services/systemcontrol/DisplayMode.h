@@ -23,6 +23,11 @@
 #define ANDROID_DISPLAY_MODE_H
 
 #include "SysWrite.h"
+#include "EdidCaps.h"
+#include "ModePlan.h"
+#include "HdcpAuth.h"
+#include "UeventDispatcher.h"
+#include "DisplayConfig.h"
 #include "common.h"
 
 #include <map>
@@ -41,10 +46,6 @@ using namespace android;
 //#define USE_BEST_MODE
 #define TEST_UBOOT_MODE
 
-#define DEVICE_STR_MID                  "MID"
-#define DEVICE_STR_MBOX                 "MBOX"
-#define DEVICE_STR_TV                   "TV"
-
 #define DESITY_720P                     "160"
 #define DESITY_1080P                    "240"
 #define DESITY_2160P                    "480"
@@ -93,6 +94,7 @@ using namespace android;
 #define DISPLAY_HPD_STATE               "/sys/class/amhdmitx/amhdmitx0/hpd_state"
 #define DISPLAY_HDMI_EDID               "/sys/class/amhdmitx/amhdmitx0/disp_cap"//RX support display mode
 #define DISPLAY_HDMI_DEEP_COLOR         "/sys/class/amhdmitx/amhdmitx0/dc_cap"//RX supoort deep color
+#define DISPLAY_HDMI_HDR                "/sys/class/amhdmitx/amhdmitx0/hdr_cap"//RX support hdr eotf
 #define DISPLAY_HDMI_VIC                "/sys/class/amhdmitx/amhdmitx0/vic"//if switch between 8bit and 10bit, clear mic first
 
 #define DISPLAY_HDMI_AVMUTE             "/sys/devices/virtual/amhdmitx/amhdmitx0/avmute"
@@ -106,11 +108,17 @@ using namespace android;
 #define HDMI_TX_PLUG_UEVENT    "DEVPATH=/devices/virtual/switch/hdmi"
 #define HDMI_TX_POWER_UEVENT    "DEVPATH=/devices/virtual/switch/hdmi_power"
 #define HDMI_TX_PLUG_STATE    "/sys/devices/virtual/switch/hdmi/state"
+#define HDMI_TX_HDCP_UEVENT    "DEVPATH=/devices/virtual/switch/hdcp"    //1:hdcp tx authenticated
 
 #define HDMI_TX_PLUG_OUT    "0"
 #define HDMI_TX_PLUG_IN    "1"
 #define HDMI_TX_SUSPEND    "0"
 #define HDMI_TX_RESUME    "1"
+#define HDMI_TX_HDCP_AUTH_OK    "1"
+
+//the most an hdcp tx attempt wait before the fallback, and the driver read interval
+#define HDCP_TX_TIMEOUT_MS      8000
+#define HDCP_TX_POLL_MS         50
 
 //HDCP RX
 #define HDMI_RX_PLUG_UEVENT    "DEVPATH=/devices/virtual/switch/hdmirx_hpd"    //1:plugin 0:plug out
@@ -141,6 +149,11 @@ using namespace android;
 #define PROP_BOOTANIM_DELAY             "const.bootanim.delay"
 #define PROP_BOOTVIDEO_SERVICE          "service.bootvideo"
 #define PROP_DEEPCOLOR                  "sys.open.deepcolor" //default close this function, when reboot
+#define PROP_HDCP_TX22_TIMEOUT          "persist.sys.hdcp.tx22_timeout" //ms
+#define PROP_HDCP_TX14_TIMEOUT          "persist.sys.hdcp.tx14_timeout" //ms
+#define PROP_HDCP_TX_POLL               "persist.sys.hdcp.tx_poll" //ms, driver read interval
+#define PROP_HDCP_TX22_SVC              "init.svc.hdcp_tx22"
+#define PROP_UEVENT_RECORD              "sys.systemcontrol.uevent_record" //file the uevents are appended to
 
 #define ENV_480I_X                      "ubootenv.var.480i_x"
 #define ENV_480I_Y                      "ubootenv.var.480i_y"
@@ -226,13 +239,6 @@ enum {
     EVENT_DIGITAL_MODE_CHANGE           = 1,
 };
 
-enum {
-    DISPLAY_TYPE_NONE                   = 0,
-    DISPLAY_TYPE_TABLET                 = 1,
-    DISPLAY_TYPE_MBOX                   = 2,
-    DISPLAY_TYPE_TV                     = 3
-};
-
 #define MODE_480I                       "480i60hz"
 #define MODE_480P                       "480p60hz"
 #define MODE_480CVBS                    "480cvbs"
@@ -294,15 +300,8 @@ enum {
     DISPLAY_MODE_TOTAL                  = 28
 };
 
-typedef enum {
-    OUPUT_MODE_STATE_INIT               = 0,
-    OUPUT_MODE_STATE_POWER              = 1,
-    OUPUT_MODE_STATE_SWITCH             = 2,
-    OUPUT_MODE_STATE_RESERVE            = 3
-}output_mode_state;
-
 typedef struct hdmi_data {
-    char edid[MAX_STR_LEN];
+    edid_caps_t edid;//parsed disp_cap, dc_cap, support_3d and hdr_cap
     char hpd_state[10];//"0" or "1", hdmi pluged or not
     char current_mode[MODE_LEN];
     char ubootenv_hdmimode[MODE_LEN];
@@ -322,6 +321,9 @@ typedef struct uevent_data {
     char state[128];
 } uevent_data_t;
 
+//the video layer uevent for the other modules, state "1" if the video data is aviliable
+typedef void (*video_layer_listener_t)(const char *state, void *data);
+
 // ----------------------------------------------------------------------------
 
 class DisplayMode
@@ -331,6 +333,10 @@ public:
     ~DisplayMode();
 
     void init();
+    //init() in stages for the boot init: initConfig, then prefetchEdid, then initDisplay
+    void initConfig();
+    void prefetchEdid();
+    void initDisplay();
     void reInit();
 
     void getDisplayInfo(int &type, char* socType, char* defaultUI);
@@ -340,6 +346,8 @@ public:
     void setLogLevel(int level);
     int dump(char *result);
     void setMboxOutputMode(const char* outputmode);
+    //dry run, print the plan of the switch to outputmode
+    int planMboxOutputMode(const char* outputmode, char *result);
     void setDigitalMode(const char* mode);
     void setOsdMouse(const char* curMode);
     void setOsdMouse(int x, int y, int w, int h);
@@ -365,6 +373,9 @@ public:
 
     int hdcpTxThreadStart();
     int hdcpTxThreadExit();
+    void setVideoLayerListener(video_layer_listener_t listener, void *data);
+    //for the host simulator, wait return when the handlers are done
+    int injectUevent(const char *buf, int len, bool wait);
 #ifndef RECOVERY_MODE
     void notifyEvent(int event);
     void setListener(const sp<ISystemControlNotify>& listener);
@@ -383,18 +394,35 @@ private:
     void getHighestHdmiMode(char* mode, hdmi_data_t* data);
     void filterHdmiMode(char * mode, hdmi_data_t* data);
     void standardMode(char* mode);
-    void addSuffixForMode(char* mode, output_mode_state state);
+    bool addSuffixForMode(char* mode, output_mode_state state);
     void getHdmiOutputMode(char *mode, hdmi_data_t* data);
+    bool getEdidCrc(char* crc);
     bool isEdidChange();
+    void readEdidCaps(edid_caps_t* caps);
+    void loadEdidCaps(edid_caps_t* caps);
     bool isBestOutputmode();
     bool isDeepColor();
     void initHdmiData(hdmi_data_t* data, char* hpdstate);
     void setMboxOutputMode(const char* outputmode, output_mode_state state);
+    void buildModePlan(const char* outputmode, output_mode_state state, mode_plan_t* plan,
+        display_state_t* want);
+    void readDisplayState(display_state_t* cur, const display_state_t* want);
+    void waitSysfs(const char* path, const char* value, int timeoutUs);
+    void runModePlan(const mode_plan_t* plan, const char* finalMode);
     void setTVOutputMode(const char* outputmode, bool initState);
     int modeToIndex(const char *mode);
     void startHdmiPlugDetectThread();
     void startBootanimDetectThread();
     static void* HdmiUenventThreadLoop(void* data);
+    void initUeventHandlers();
+    static void onHdmiTxPower(const uevent_msg_t* msg, void* data);
+    static void onHdmiTxPlug(const uevent_msg_t* msg, void* data);
+    static void onHdmiTxHdcp(const uevent_msg_t* msg, void* data);
+    static void onHdmiRxPlug(const uevent_msg_t* msg, void* data);
+    static void onHdmiRxAuth(const uevent_msg_t* msg, void* data);
+#ifndef RECOVERY_MODE
+    static void onVideoLayer(const uevent_msg_t* msg, void* data);
+#endif
     void setTVDisplay(bool initState);
     void setFbParameter(const char* fbdev, struct fb_var_screeninfo var_set);
     int getBootenvInt(const char* key, int defaultVal);
@@ -403,6 +431,7 @@ private:
     void hdcpRxInit();
     void hdcpTxAuthenticate(bool useHdcp22, bool useHdcp14);
     static void* hdcpTxThreadLoop(void* data);
+    static int hdcpTxPollAuth(void* data);
     static void* hdcpRxThreadLoop(void* data);
     void hdcpRxAuthenticate(bool plugIn);
 
@@ -436,10 +465,26 @@ private:
     sem_t pthreadTxSem/*, pthreadRxSem*/;
     pthread_t pthreadIdHdcpTx/*, pthreadIdHdcpRx*/;
     bool mExitHdcpTxThread/*, mExitHdcpRxThread*/;
+    //result of the hdcp tx authenticate, posted by the uevent thread
+    HdcpAuthWaiter mHdcpAuth;
+    UeventDispatcher mUevent;
+    //the video queue thread read the pair while it is set
+    pthread_mutex_t mVideoLayerMutex;
+    video_layer_listener_t mVideoLayerListener;
+    void *mVideoLayerData;
 
     sem_t pthreadBootDetectSem;
     bool mBootAnimDetectFinished;
 
+    //tables of the TVs by edid crc, and the one of the TV plugged now
+    EdidCapsCache mEdidCache;
+    pthread_mutex_t mEdidMutex;
+    edid_caps_t mEdidCaps;
+
+    //the last mode switch, for dump
+    mode_plan_t mLastPlan;
+    int64_t mLastPlanUs;
+
 #ifndef RECOVERY_MODE
     sp<ISystemControlNotify> mNotifyListener;
 #endif
@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/24
+ *  @par function description:
+ *  - 1 parse the hdmi tx capability nodes into a mode table
+ *  - 2 keep the tables of the last TVs, keyed by the edid crc
+ */
+
+#define LOG_TAG "SystemControl"
+//#define LOG_NDEBUG 0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "EdidCaps.h"
+
+//"1080p60hz", "576i50hz", "2160p60hz420", "smpte24hz", return false if it is not a mode
+static bool parseMode(edid_mode_t *mode, const char *line, int len) {
+    memset(mode, 0, sizeof(edid_mode_t));
+    while (len > 0 && (isspace((unsigned char)line[len - 1]) || line[len - 1] == '*')) {
+        if (line[len - 1] == '*')
+            mode->preferred = true;
+        len--;
+    }
+    if (len <= 0 || len >= MODE_LEN)
+        return false;
+
+    memcpy(mode->name, line, len);
+    mode->name[len] = 0;
+
+    const char *pos = mode->name;
+    if (!strncmp(pos, "smpte", 5)) {
+        mode->smpte = true;
+        mode->width = 4096;
+        mode->height = 2160;
+        pos += 5;
+    } else {
+        char *end;
+        mode->height = strtol(pos, &end, 10);
+        if (end == pos || (*end != 'p' && *end != 'i'))
+            return false;
+        mode->interlaced = (*end == 'i');
+        mode->width = (mode->height <= 576)?720:(mode->height*16/9);
+        pos = end + 1;
+    }
+
+    char *end;
+    mode->refresh = strtol(pos, &end, 10);
+    if (end == pos || strncmp(end, "hz", 2))
+        return false;
+
+    const char *suffix = end + 2;
+    if (strstr(suffix, "420") != NULL)
+        mode->colorSpace = EDID_CS_YUV420;
+    else if (strstr(suffix, "422") != NULL)
+        mode->colorSpace = EDID_CS_YUV422;
+    else
+        mode->colorSpace = EDID_CS_RGB444;
+
+    //the highest mode was the number of "1080p60" with p as 1 and i as 0, smpte is never the highest
+    if (!mode->smpte) {
+        char value[MODE_LEN];
+        sprintf(value, "%d%d%d", mode->height, mode->interlaced?0:1, mode->refresh);
+        mode->rank = atoi(value);
+    }
+    return true;
+}
+
+static void parseModes(edid_caps_t *caps, const char *dispCap) {
+    const char *line = dispCap;
+    while (*line != 0 && caps->modeCount < EDID_MAX_MODES) {
+        const char *end = strchr(line, '\n');
+        int len = (end != NULL)?(end - line):strlen(line);
+
+        edid_mode_t *mode = &caps->modes[caps->modeCount];
+        if (parseMode(mode, line, len)) {
+            if (mode->preferred && caps->preferred < 0)
+                caps->preferred = caps->modeCount;
+
+            //same rank, the longer name is taken, as "2160p60hz420" to "2160p60hz"
+            if (mode->rank > 0) {
+                if (caps->highest < 0) {
+                    caps->highest = caps->modeCount;
+                } else {
+                    const edid_mode_t *high = &caps->modes[caps->highest];
+                    int modeLen = strlen(mode->name) + (mode->preferred?1:0);
+                    int highLen = strlen(high->name) + (high->preferred?1:0);
+                    if (mode->rank > high->rank || (mode->rank == high->rank && modeLen > highLen))
+                        caps->highest = caps->modeCount;
+                }
+            }
+            caps->modeCount++;
+        }
+
+        if (end == NULL)
+            break;
+        line = end + 1;
+    }
+}
+
+//"420,10bit", "444,12bit", "rgb,10bit" one per line
+static void parseDeepColor(edid_caps_t *caps, const char *dcCap) {
+    const char *line = dcCap;
+    while (*line != 0) {
+        const char *end = strchr(line, '\n');
+        char value[MODE_LEN] = {0};
+        int len = (end != NULL)?(end - line):strlen(line);
+        if (len >= MODE_LEN)
+            len = MODE_LEN - 1;
+        memcpy(value, line, len);
+
+        int depth = 0;
+        if (strstr(value, "10bit") != NULL)
+            depth = EDID_DEPTH_10BIT;
+        else if (strstr(value, "12bit") != NULL)
+            depth = EDID_DEPTH_12BIT;
+        else if (strstr(value, "16bit") != NULL)
+            depth = EDID_DEPTH_16BIT;
+
+        if (!strncmp(value, "420", 3))
+            caps->deepColor[EDID_CS_YUV420] |= depth;
+        else if (!strncmp(value, "422", 3))
+            caps->deepColor[EDID_CS_YUV422] |= depth;
+        else if (!strncmp(value, "444", 3) || !strncasecmp(value, "rgb", 3))
+            caps->deepColor[EDID_CS_RGB444] |= depth;
+
+        if (end == NULL)
+            break;
+        line = end + 1;
+    }
+}
+
+//"SMPTE ST 2084: 1" and "Hybrid Log-Gamma: 1" of the supported eotf
+static bool hdrFlag(const char *hdrCap, const char *name) {
+    const char *pos = strstr(hdrCap, name);
+    if (pos == NULL)
+        return false;
+    pos += strlen(name);
+    while (*pos == ':' || *pos == ' ')
+        pos++;
+    return *pos == '1';
+}
+
+void edidParseCaps(edid_caps_t *caps, const char *dispCap, const char *dcCap,
+    const char *support3d, const char *hdrCap) {
+    char crc[EDID_CRC_LEN];
+    strcpy(crc, caps->crc);
+    memset(caps, 0, sizeof(edid_caps_t));
+    strcpy(caps->crc, crc);
+    caps->preferred = -1;
+    caps->highest = -1;
+
+    if (dispCap == NULL || strlen(dispCap) == 0 || strstr(dispCap, "null") != NULL)
+        return;
+
+    caps->valid = true;
+    parseModes(caps, dispCap);
+    if (dcCap != NULL && strlen(dcCap) > 0) {
+        caps->deepColorKnown = true;
+        parseDeepColor(caps, dcCap);
+    }
+    if (support3d != NULL)
+        caps->support3d = (support3d[0] == '1');
+    if (hdrCap != NULL) {
+        caps->hdr10 = hdrFlag(hdrCap, "SMPTE ST 2084");
+        caps->hlg = hdrFlag(hdrCap, "Hybrid Log-Gamma");
+    }
+}
+
+const edid_mode_t *edidFindMode(const edid_caps_t *caps, const char *name) {
+    for (int i = 0; i < caps->modeCount; i++) {
+        if (!strcmp(caps->modes[i].name, name))
+            return &caps->modes[i];
+    }
+    return NULL;
+}
+
+bool edidSupportDepth(const edid_caps_t *caps, const char *mode, int depth) {
+    int colorSpace = EDID_CS_RGB444;
+    if (strstr(mode, "420") != NULL)
+        colorSpace = EDID_CS_YUV420;
+    else if (strstr(mode, "422") != NULL)
+        colorSpace = EDID_CS_YUV422;
+    return (caps->deepColor[colorSpace] & depth) != 0;
+}
+
+void edidDumpCaps(const edid_caps_t *caps, char *result) {
+    char buf[512];
+
+    if (!caps->valid) {
+        strcat(result, "edid caps: not read\n");
+        return;
+    }
+
+    sprintf(buf, "edid caps crc:%s, %d modes, preferred:%s, highest:%s\n"
+        "deep color rgb/444:0x%x 422:0x%x 420:0x%x%s, 3d:%d, hdr10:%d, hlg:%d\n",
+        (caps->crc[0] != 0)?caps->crc:"-", caps->modeCount,
+        (caps->preferred >= 0)?caps->modes[caps->preferred].name:"-",
+        (caps->highest >= 0)?caps->modes[caps->highest].name:"-",
+        caps->deepColor[EDID_CS_RGB444], caps->deepColor[EDID_CS_YUV422],
+        caps->deepColor[EDID_CS_YUV420], caps->deepColorKnown?"":" (unknown)",
+        caps->support3d, caps->hdr10, caps->hlg);
+    strcat(result, buf);
+
+    for (int i = 0; i < caps->modeCount; i++) {
+        const edid_mode_t *mode = &caps->modes[i];
+        sprintf(buf, "  %-14s %4dx%-4d %s%dhz%s\n", mode->name, mode->width, mode->height,
+            mode->interlaced?"i":"p", mode->refresh, mode->preferred?" *":"");
+        strcat(result, buf);
+    }
+}
+
+EdidCapsCache::EdidCapsCache()
+    :mClock(0) {
+    pthread_mutex_init(&mLock, NULL);
+    memset(mEntries, 0, sizeof(mEntries));
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+EdidCapsCache::~EdidCapsCache() {
+    pthread_mutex_destroy(&mLock);
+}
+
+bool EdidCapsCache::get(const char *crc, edid_caps_t *caps) {
+    bool found = false;
+
+    pthread_mutex_lock(&mLock);
+    for (int i = 0; i < EDID_CACHE_SIZE && crc[0] != 0; i++) {
+        if (mEntries[i].caps.valid && !strcmp(mEntries[i].caps.crc, crc)) {
+            memcpy(caps, &mEntries[i].caps, sizeof(edid_caps_t));
+            mEntries[i].lastUse = ++mClock;
+            found = true;
+            break;
+        }
+    }
+
+    if (found)
+        mStats.hits++;
+    else
+        mStats.misses++;
+    pthread_mutex_unlock(&mLock);
+    return found;
+}
+
+void EdidCapsCache::put(const edid_caps_t *caps) {
+    //without crc the TV can not be told, and a table of no edid is never kept
+    if (!caps->valid || caps->crc[0] == 0)
+        return;
+
+    pthread_mutex_lock(&mLock);
+    Entry *entry = NULL;
+    for (int i = 0; i < EDID_CACHE_SIZE; i++) {
+        if (mEntries[i].caps.valid && !strcmp(mEntries[i].caps.crc, caps->crc)) {
+            entry = &mEntries[i];
+            break;
+        }
+        if (entry == NULL || mEntries[i].lastUse < entry->lastUse)
+            entry = &mEntries[i];
+    }
+
+    memcpy(&entry->caps, caps, sizeof(edid_caps_t));
+    entry->lastUse = ++mClock;
+    pthread_mutex_unlock(&mLock);
+}
+
+void EdidCapsCache::countParse(int64_t us) {
+    pthread_mutex_lock(&mLock);
+    mStats.parses++;
+    mStats.parseUs += us;
+    if (us > mStats.maxParseUs)
+        mStats.maxParseUs = us;
+    pthread_mutex_unlock(&mLock);
+}
+
+void EdidCapsCache::clear() {
+    pthread_mutex_lock(&mLock);
+    memset(mEntries, 0, sizeof(mEntries));
+    pthread_mutex_unlock(&mLock);
+}
+
+void EdidCapsCache::getStats(edid_cache_stats_t *stats) {
+    pthread_mutex_lock(&mLock);
+    *stats = mStats;
+    pthread_mutex_unlock(&mLock);
+}
+
+void EdidCapsCache::dump(char *result) {
+    char buf[256];
+
+    pthread_mutex_lock(&mLock);
+    sprintf(buf, "edid cache hits:%lld misses:%lld, parses:%lld avg:%lldus max:%lldus\n",
+        (long long)mStats.hits, (long long)mStats.misses, (long long)mStats.parses,
+        (long long)((mStats.parses > 0)?mStats.parseUs/mStats.parses:0),
+        (long long)mStats.maxParseUs);
+    strcat(result, buf);
+
+    for (int i = 0; i < EDID_CACHE_SIZE; i++) {
+        if (!mEntries[i].caps.valid)
+            continue;
+        const edid_caps_t *caps = &mEntries[i].caps;
+        sprintf(buf, "  crc:%s %d modes, highest:%s\n", caps->crc, caps->modeCount,
+            (caps->highest >= 0)?caps->modes[caps->highest].name:"-");
+        strcat(result, buf);
+    }
+    pthread_mutex_unlock(&mLock);
+}
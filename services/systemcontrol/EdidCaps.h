@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/24
+ *  @par function description:
+ *  - 1 parse the hdmi tx capability nodes into a mode table
+ *  - 2 keep the tables of the last TVs, keyed by the edid crc
+ */
+
+#ifndef EDID_CAPS_H
+#define EDID_CAPS_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "common.h"
+
+#define EDID_MAX_MODES          64
+#define EDID_CRC_LEN            32
+//tables kept, a box is usually moved between a few TVs
+#define EDID_CACHE_SIZE         4
+
+//color space of the mode, from the suffix of the mode name
+enum {
+    EDID_CS_RGB444              = 0,
+    EDID_CS_YUV422              = 1,
+    EDID_CS_YUV420              = 2,
+    EDID_CS_TOTAL               = 3
+};
+
+//bits of the deep color mask
+#define EDID_DEPTH_10BIT        (1 << 0)
+#define EDID_DEPTH_12BIT        (1 << 1)
+#define EDID_DEPTH_16BIT        (1 << 2)
+
+typedef struct edid_mode {
+    char name[MODE_LEN];        //without the '*', like "2160p60hz420"
+    int width;
+    int height;
+    int refresh;                //hz
+    int colorSpace;
+    bool interlaced;
+    bool smpte;
+    bool preferred;             //marked with '*' in disp_cap
+    //old order of the highest mode, 0 if it can not be the highest
+    int rank;
+} edid_mode_t;
+
+typedef struct edid_caps {
+    bool valid;                 //disp_cap is read
+    char crc[EDID_CRC_LEN];
+    int modeCount;
+    edid_mode_t modes[EDID_MAX_MODES];
+    int preferred;              //index of the preferred mode, -1 if none
+    int highest;                //index of the highest mode, -1 if none
+    int deepColor[EDID_CS_TOTAL];
+    bool deepColorKnown;        //dc_cap is read
+    bool support3d;
+    bool hdr10;
+    bool hlg;
+} edid_caps_t;
+
+typedef struct edid_cache_stats {
+    int64_t hits;
+    int64_t misses;
+    int64_t parses;
+    int64_t parseUs;
+    int64_t maxParseUs;
+} edid_cache_stats_t;
+
+//the nodes are the text of the driver, NULL if not read
+void edidParseCaps(edid_caps_t *caps, const char *dispCap, const char *dcCap,
+    const char *support3d, const char *hdrCap);
+const edid_mode_t *edidFindMode(const edid_caps_t *caps, const char *name);
+//the color space of the mode support the depth
+bool edidSupportDepth(const edid_caps_t *caps, const char *mode, int depth);
+void edidDumpCaps(const edid_caps_t *caps, char *result);
+
+class EdidCapsCache
+{
+public:
+    EdidCapsCache();
+    ~EdidCapsCache();
+
+    //return true and the table of the crc if it is kept
+    bool get(const char *crc, edid_caps_t *caps);
+    //keep the table under caps->crc, the least recently used one is dropped
+    void put(const edid_caps_t *caps);
+    void countParse(int64_t us);
+    void clear();
+
+    void getStats(edid_cache_stats_t *stats);
+    void dump(char *result);
+
+private:
+    struct Entry {
+        edid_caps_t caps;
+        int64_t lastUse;
+    };
+
+    pthread_mutex_t mLock;
+    Entry mEntries[EDID_CACHE_SIZE];
+    int64_t mClock;
+    edid_cache_stats_t mStats;
+};
+
+#endif // EDID_CAPS_H
@@ -22,6 +22,10 @@
 
 /* #include "polarssl/config.h" */
 #define POLARSSL_AES_C
+/* the tables are in rodata, not generated in the first setkey */
+#define POLARSSL_AES_ROM_TABLES
+/* AES-NI or ARMv8 Crypto Extensions when the cpu has them */
+#define POLARSSL_AES_BACKEND
 
 #if defined(POLARSSL_AES_C)
 
@@ -30,6 +34,9 @@
 /* #include "polarssl/padlock.h" */
 /* #endif */
 #include "aes.h"
+#if defined(POLARSSL_AES_BACKEND)
+#include "aes_backend.h"
+#endif
 
 /*
  * 32-bit integer manipulation macros (little endian)
@@ -102,7 +109,6 @@ static const unsigned char FSb[256] = {
  * Forward tables
  */
 #define FT \
-( \
 	V(A5, 63, 63, C6), V(84, 7C, 7C, F8), \
 	V(99, 77, 77, EE), V(8D, 7B, 7B, F6), \
 	V(0D, F2, F2, FF), V(BD, 6B, 6B, D6), \
@@ -230,7 +236,7 @@ static const unsigned char FSb[256] = {
 	V(C3, 41, 41, 82), V(B0, 99, 99, 29), \
 	V(77, 2D, 2D, 5A), V(11, 0F, 0F, 1E), \
 	V(CB, B0, B0, 7B), V(FC, 54, 54, A8), \
-	V(D6, BB, BB, 6D), V(3A, 16, 16, 2C))
+	V(D6, BB, BB, 6D), V(3A, 16, 16, 2C)
 
 #define V(a, b, c, d) (0x##a##b##c##d)
 static const uint32_t FT0[256] = { FT };
@@ -296,7 +302,6 @@ static const unsigned char RSb[256] = {
  * Reverse tables
  */
 #define RT \
-	( \
 	V(50, A7, F4, 51), V(53, 65, 41, 7E), \
 	V(C3, A4, 17, 1A), V(96, 5E, 27, 3A), \
 	V(CB, 6B, AB, 3B), V(F1, 45, 9D, 1F), \
@@ -424,7 +429,7 @@ static const unsigned char RSb[256] = {
 	V(71, 01, A8, 39), V(DE, B3, 0C, 08), \
 	V(9C, E4, B4, D8), V(90, C1, 56, 64), \
 	V(61, 84, CB, 7B), V(70, B6, 32, D5), \
-	V(74, 5C, 6C, 48), V(42, 57, B8, D0))
+	V(74, 5C, 6C, 48), V(42, 57, B8, D0)
 
 #define V(a, b, c, d) (0x##a##b##c##d)
 static const uint32_t RT0[256] = { RT };
@@ -811,6 +816,12 @@ int aes_crypt_ecb(struct aes_context *ctx,
 	}
 #endif
 
+#if defined(POLARSSL_AES_BACKEND)
+	const struct aes_backend *backend = aes_backend_active();
+	if (backend->crypt_ecb != NULL)
+		return backend->crypt_ecb(ctx, mode, input, output);
+#endif
+
 	RK = ctx->rk;
 
 	GET_UINT32_LE(X0, input, 0);
@@ -922,6 +933,13 @@ int aes_crypt_cbc(struct aes_context *ctx,
 	}
 #endif
 
+#if defined(POLARSSL_AES_BACKEND)
+	/* the whole buffer, not a call per block */
+	const struct aes_backend *backend = aes_backend_active();
+	if (backend->crypt_cbc != NULL)
+		return backend->crypt_cbc(ctx, mode, length, iv, input, output);
+#endif
+
 	if (mode == AES_DECRYPT) {
 		while (length > 0) {
 			memcpy(temp, input, 16);
@@ -1075,6 +1093,59 @@ static const unsigned char aes_test_cbc_enc[3][16] = {
 	 0x6F, 0xCD, 0x88, 0xB2, 0xCC, 0x89, 0x8F, 0xF0}
 };
 
+/*
+ * AES known answers from FIPS-197 appendix C, the key is 00 01 02 ..
+ */
+static const unsigned char aes_test_fips_pt[16] = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+};
+
+static const unsigned char aes_test_fips_ct[3][16] = {
+	{0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30,
+	 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A},
+	{0xDD, 0xA9, 0x7C, 0xA4, 0x86, 0x4C, 0xDF, 0xE0,
+	 0x6E, 0xAF, 0x70, 0xA0, 0xEC, 0x0D, 0x71, 0x91},
+	{0x8E, 0xA2, 0xB7, 0xCA, 0x51, 0x67, 0x45, 0xBF,
+	 0xEA, 0xFC, 0x49, 0x90, 0x4B, 0x49, 0x60, 0x89}
+};
+
+/*
+ * AES-CBC-128 of several blocks from NIST SP 800-38A F.2.1,
+ * the blocks are chained as in do_aes
+ */
+static const unsigned char aes_test_sp_key[16] = {
+	0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+	0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+
+static const unsigned char aes_test_sp_iv[16] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+};
+
+static const unsigned char aes_test_sp_pt[64] = {
+	0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96,
+	0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+	0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C,
+	0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51,
+	0x30, 0xC8, 0x1C, 0x46, 0xA3, 0x5C, 0xE4, 0x11,
+	0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+	0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17,
+	0xAD, 0x2B, 0x41, 0x7B, 0xE6, 0x6C, 0x37, 0x10
+};
+
+static const unsigned char aes_test_sp_ct[64] = {
+	0x76, 0x49, 0xAB, 0xAC, 0x81, 0x19, 0xB2, 0x46,
+	0xCE, 0xE9, 0x8E, 0x9B, 0x12, 0xE9, 0x19, 0x7D,
+	0x50, 0x86, 0xCB, 0x9B, 0x50, 0x72, 0x19, 0xEE,
+	0x95, 0xDB, 0x11, 0x3A, 0x91, 0x76, 0x78, 0xB2,
+	0x73, 0xBE, 0xD6, 0xB8, 0xE3, 0xC1, 0x74, 0x3B,
+	0x71, 0x16, 0xE6, 0x9E, 0x22, 0x22, 0x95, 0x16,
+	0x3F, 0xF1, 0xCA, 0xA1, 0x68, 0x1F, 0xAC, 0x09,
+	0x12, 0x0E, 0xCA, 0x30, 0x75, 0x86, 0xE1, 0xA7
+};
+
 #if defined(POLARSSL_CIPHER_MODE_CFB)
 /*
  * AES-CFB128 test vectors from:
@@ -1196,9 +1267,104 @@ static const int aes_test_ctr_len[3] = { 16, 32, 36 };
 #endif				/* POLARSSL_CIPHER_MODE_CTR */
 
 /*
- * Checkup routine
+ * Known answers of FIPS-197 and SP 800-38A, the CBC is run out of place
+ * and in place as hdcpKeyUnpack may do
  */
-int aes_self_test(int verbose)
+static int aes_self_test_kat(int verbose)
+{
+	int i, u, v;
+	unsigned char key[32];
+	unsigned char buf[64];
+	unsigned char iv[16];
+	struct aes_context ctx;
+
+	for (i = 0; i < 32; i++)
+		key[i] = (unsigned char)i;
+
+	for (i = 0; i < 6; i++) {
+		u = i >> 1;
+		v = i & 1;
+
+		if (verbose != 0)
+			printf("  AES-FIPS-%3d (%s): ", 128 + u * 64,
+			       (v == AES_DECRYPT) ? "dec" : "enc");
+
+		if (v == AES_DECRYPT) {
+			aes_setkey_dec(&ctx, key, 128 + u * 64);
+			aes_crypt_ecb(&ctx, v, aes_test_fips_ct[u], buf);
+			if (memcmp(buf, aes_test_fips_pt, 16) != 0) {
+				if (verbose != 0)
+					printf("failed\n");
+				return 1;
+			}
+		} else {
+			aes_setkey_enc(&ctx, key, 128 + u * 64);
+			aes_crypt_ecb(&ctx, v, aes_test_fips_pt, buf);
+			if (memcmp(buf, aes_test_fips_ct[u], 16) != 0) {
+				if (verbose != 0)
+					printf("failed\n");
+				return 1;
+			}
+		}
+
+		if (verbose != 0)
+			printf("passed\n");
+	}
+
+	for (i = 0; i < 4; i++) {
+		v = i & 1;
+
+		if (verbose != 0)
+			printf("  AES-CBC-128 4 blocks %s(%s): ",
+			       (i >> 1) ? "in place " : "",
+			       (v == AES_DECRYPT) ? "dec" : "enc");
+
+		memcpy(iv, aes_test_sp_iv, 16);
+		if (v == AES_DECRYPT) {
+			aes_setkey_dec(&ctx, aes_test_sp_key, 128);
+			memcpy(buf, aes_test_sp_ct, 64);
+			aes_crypt_cbc(&ctx, v, 64, iv,
+				      (i >> 1) ? buf : aes_test_sp_ct, buf);
+			if (memcmp(buf, aes_test_sp_pt, 64) != 0 ||
+			    memcmp(iv, aes_test_sp_ct + 48, 16) != 0) {
+				if (verbose != 0)
+					printf("failed\n");
+				return 1;
+			}
+		} else {
+			aes_setkey_enc(&ctx, aes_test_sp_key, 128);
+			memcpy(buf, aes_test_sp_pt, 64);
+			aes_crypt_cbc(&ctx, v, 64, iv,
+				      (i >> 1) ? buf : aes_test_sp_pt, buf);
+			if (memcmp(buf, aes_test_sp_ct, 64) != 0 ||
+			    memcmp(iv, aes_test_sp_ct + 48, 16) != 0) {
+				if (verbose != 0)
+					printf("failed\n");
+				return 1;
+			}
+		}
+
+		if (verbose != 0)
+			printf("passed\n");
+	}
+
+	if (aes_crypt_cbc(&ctx, AES_ENCRYPT, 15, iv, buf, buf) !=
+	    POLARSSL_ERR_AES_INVALID_INPUT_LENGTH) {
+		if (verbose != 0)
+			printf("  AES-CBC partial block: failed\n");
+		return 1;
+	}
+
+	if (verbose != 0)
+		printf("\n");
+
+	return 0;
+}
+
+/*
+ * Checkup routine of the backend in use
+ */
+static int aes_self_test_run(int verbose)
 {
 	int i, j, u, v;
 	unsigned char key[32];
@@ -1420,7 +1586,33 @@ int aes_self_test(int verbose)
 		printf("\n");
 #endif				/* POLARSSL_CIPHER_MODE_CTR */
 
-	return 0;
+	return aes_self_test_kat(verbose);
+}
+
+/*
+ * Checkup routine, every backend the cpu support
+ */
+int aes_self_test(int verbose)
+{
+#if defined(POLARSSL_AES_BACKEND)
+	int id;
+	int active = aes_backend_active_id();
+	int ret = 0;
+
+	for (id = 0; id < AES_BACKENDS && ret == 0; id++) {
+		if (aes_backend_select(id) != 0)
+			continue;
+
+		if (verbose != 0)
+			printf("  AES backend %s:\n", aes_backend_get(id)->name);
+		ret = aes_self_test_run(verbose);
+	}
+
+	aes_backend_select(active);
+	return ret;
+#else
+	return aes_self_test_run(verbose);
+#endif
 }
 
 #endif
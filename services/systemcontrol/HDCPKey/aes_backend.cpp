@@ -0,0 +1,324 @@
+/*
+ *  AES backends: portable tables, x86 AES-NI and ARMv8 Crypto Extensions
+ *
+ *  The round keys are the ones of aes.cpp, in little endian words, so the
+ *  bytes of ctx->rk are the round keys of FIPS-197 in order. The decryption
+ *  keys of aes_setkey_dec() are already InvMixColumns of the encryption
+ *  keys in reverse order, that is what AESDEC and AESD/AESIMC expect.
+ */
+
+#include <string.h>
+#include <pthread.h>
+
+#include "aes_backend.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AES_HAVE_AESNI
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+/*
+ * the crypto intrinsics are only there when the compiler may use them,
+ * Android.mk add the flags to this file only, libsystemcontrol_aes, on arm64
+ * and on the armv8-a builds of arm
+ */
+#if (defined(__aarch64__) || defined(__arm__)) && defined(__ARM_FEATURE_CRYPTO)
+#define AES_HAVE_ARMV8_CE
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#ifndef AT_HWCAP2
+#define AT_HWCAP2               26
+#endif
+#if defined(__aarch64__)
+#define AES_HWCAP               AT_HWCAP
+#define AES_HWCAP_AES           (1 << 3)
+#else
+#define AES_HWCAP               AT_HWCAP2
+#define AES_HWCAP_AES           (1 << 0)
+#endif
+#endif
+
+#if defined(AES_HAVE_AESNI)
+
+static int aesni_supported(void)
+{
+	unsigned int a, b, c, d;
+
+	if (!__get_cpuid(1, &a, &b, &c, &d))
+		return 0;
+	return (c & bit_AES) && (d & bit_SSE2);
+}
+
+__attribute__((target("aes,sse2")))
+static inline __m128i aesni_block(const struct aes_context *ctx, int mode,
+				  __m128i block)
+{
+	const __m128i *rk = (const __m128i *)ctx->rk;
+	int i;
+
+	block = _mm_xor_si128(block, _mm_loadu_si128(rk));
+	if (mode == AES_DECRYPT) {
+		for (i = 1; i < ctx->nr; i++)
+			block = _mm_aesdec_si128(block, _mm_loadu_si128(rk + i));
+		return _mm_aesdeclast_si128(block, _mm_loadu_si128(rk + ctx->nr));
+	}
+
+	for (i = 1; i < ctx->nr; i++)
+		block = _mm_aesenc_si128(block, _mm_loadu_si128(rk + i));
+	return _mm_aesenclast_si128(block, _mm_loadu_si128(rk + ctx->nr));
+}
+
+__attribute__((target("aes,sse2")))
+static int aesni_crypt_ecb(struct aes_context *ctx, int mode,
+			   const unsigned char input[16],
+			   unsigned char output[16])
+{
+	__m128i block = _mm_loadu_si128((const __m128i *)input);
+
+	_mm_storeu_si128((__m128i *)output, aesni_block(ctx, mode, block));
+	return 0;
+}
+
+__attribute__((target("aes,sse2")))
+static int aesni_crypt_cbc(struct aes_context *ctx, int mode, size_t length,
+			   unsigned char iv[16], const unsigned char *input,
+			   unsigned char *output)
+{
+	__m128i chain = _mm_loadu_si128((const __m128i *)iv);
+	__m128i block;
+
+	if (length % 16)
+		return POLARSSL_ERR_AES_INVALID_INPUT_LENGTH;
+
+	for (; length > 0; length -= 16, input += 16, output += 16) {
+		block = _mm_loadu_si128((const __m128i *)input);
+		if (mode == AES_DECRYPT) {
+			/* input and output may be the same buffer */
+			__m128i next = block;
+
+			block = _mm_xor_si128(aesni_block(ctx, mode, block), chain);
+			chain = next;
+		} else {
+			block = aesni_block(ctx, mode, _mm_xor_si128(block, chain));
+			chain = block;
+		}
+		_mm_storeu_si128((__m128i *)output, block);
+	}
+
+	_mm_storeu_si128((__m128i *)iv, chain);
+	return 0;
+}
+
+#endif /* AES_HAVE_AESNI */
+
+#if defined(AES_HAVE_ARMV8_CE)
+
+static int armv8_ce_supported(void)
+{
+	return (getauxval(AES_HWCAP) & AES_HWCAP_AES) != 0;
+}
+
+/*
+ * AESE and AESD add the round key before the (inverse) SubBytes and
+ * ShiftRows, the last round key is added alone
+ */
+static inline uint8x16_t armv8_ce_block(const struct aes_context *ctx,
+					int mode, uint8x16_t block)
+{
+	const uint8_t *rk = (const uint8_t *)ctx->rk;
+	int i;
+
+	if (mode == AES_DECRYPT) {
+		for (i = 0; i < ctx->nr - 1; i++)
+			block = vaesimcq_u8(vaesdq_u8(block, vld1q_u8(rk + i * 16)));
+		block = vaesdq_u8(block, vld1q_u8(rk + i * 16));
+	} else {
+		for (i = 0; i < ctx->nr - 1; i++)
+			block = vaesmcq_u8(vaeseq_u8(block, vld1q_u8(rk + i * 16)));
+		block = vaeseq_u8(block, vld1q_u8(rk + i * 16));
+	}
+	return veorq_u8(block, vld1q_u8(rk + ctx->nr * 16));
+}
+
+static int armv8_ce_crypt_ecb(struct aes_context *ctx, int mode,
+			      const unsigned char input[16],
+			      unsigned char output[16])
+{
+	vst1q_u8(output, armv8_ce_block(ctx, mode, vld1q_u8(input)));
+	return 0;
+}
+
+static int armv8_ce_crypt_cbc(struct aes_context *ctx, int mode,
+			      size_t length, unsigned char iv[16],
+			      const unsigned char *input,
+			      unsigned char *output)
+{
+	uint8x16_t chain = vld1q_u8(iv);
+	uint8x16_t block;
+
+	if (length % 16)
+		return POLARSSL_ERR_AES_INVALID_INPUT_LENGTH;
+
+	for (; length > 0; length -= 16, input += 16, output += 16) {
+		block = vld1q_u8(input);
+		if (mode == AES_DECRYPT) {
+			/* input and output may be the same buffer */
+			uint8x16_t next = block;
+
+			block = veorq_u8(armv8_ce_block(ctx, mode, block), chain);
+			chain = next;
+		} else {
+			block = armv8_ce_block(ctx, mode, veorq_u8(block, chain));
+			chain = block;
+		}
+		vst1q_u8(output, block);
+	}
+
+	vst1q_u8(iv, chain);
+	return 0;
+}
+
+#endif /* AES_HAVE_ARMV8_CE */
+
+static int table_supported(void)
+{
+	return 1;
+}
+
+static const struct aes_backend aes_backends[AES_BACKENDS] = {
+	{"table", table_supported, NULL, NULL},
+#if defined(AES_HAVE_AESNI)
+	{"aes-ni", aesni_supported, aesni_crypt_ecb, aesni_crypt_cbc},
+#else
+	{"aes-ni", NULL, NULL, NULL},
+#endif
+#if defined(AES_HAVE_ARMV8_CE)
+	{"armv8-ce", armv8_ce_supported, armv8_ce_crypt_ecb, armv8_ce_crypt_cbc},
+#else
+	{"armv8-ce", NULL, NULL, NULL},
+#endif
+};
+
+static pthread_once_t aes_backend_once = PTHREAD_ONCE_INIT;
+static volatile int aes_backend_id = AES_BACKEND_TABLE;
+/* the backends which gave the known answers */
+static int aes_backend_verified[AES_BACKENDS];
+
+/*
+ * FIPS-197 appendix C, the key is 00 01 02 ... 1f cut to the key size
+ */
+static const unsigned char aes_kat_pt[16] = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+};
+
+static const unsigned char aes_kat_ct[3][16] = {
+	{0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30,
+	 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A},
+	{0xDD, 0xA9, 0x7C, 0xA4, 0x86, 0x4C, 0xDF, 0xE0,
+	 0x6E, 0xAF, 0x70, 0xA0, 0xEC, 0x0D, 0x71, 0x91},
+	{0x8E, 0xA2, 0xB7, 0xCA, 0x51, 0x67, 0x45, 0xBF,
+	 0xEA, 0xFC, 0x49, 0x90, 0x4B, 0x49, 0x60, 0x89}
+};
+
+/*
+ * the known answers of the three key sizes on the backend, ecb both ways
+ * and a cbc of two blocks encrypted and decrypted again in place
+ */
+static int aes_backend_verify(const struct aes_backend *backend)
+{
+	struct aes_context ctx;
+	unsigned char key[32], iv[16], buf[32], pt2[32];
+	int i, u;
+
+	if (backend->crypt_ecb == NULL)
+		return 0;
+
+	for (i = 0; i < 32; i++)
+		key[i] = (unsigned char)i;
+	memcpy(pt2, aes_kat_pt, 16);
+	memcpy(pt2 + 16, aes_kat_pt, 16);
+
+	for (u = 0; u < 3; u++) {
+		aes_setkey_enc(&ctx, key, 128 + u * 64);
+		backend->crypt_ecb(&ctx, AES_ENCRYPT, aes_kat_pt, buf);
+		if (memcmp(buf, aes_kat_ct[u], 16) != 0)
+			return -1;
+
+		/* with a zero iv the first block is the ecb one */
+		memset(iv, 0, sizeof(iv));
+		memcpy(buf, pt2, sizeof(buf));
+		backend->crypt_cbc(&ctx, AES_ENCRYPT, sizeof(buf), iv, buf, buf);
+		if (memcmp(buf, aes_kat_ct[u], 16) != 0
+		    || memcmp(iv, buf + 16, 16) != 0)
+			return -1;
+
+		aes_setkey_dec(&ctx, key, 128 + u * 64);
+		memset(iv, 0, sizeof(iv));
+		backend->crypt_cbc(&ctx, AES_DECRYPT, sizeof(buf), iv, buf, buf);
+		if (memcmp(buf, pt2, sizeof(buf)) != 0)
+			return -1;
+
+		backend->crypt_ecb(&ctx, AES_DECRYPT, aes_kat_ct[u], buf);
+		if (memcmp(buf, aes_kat_pt, 16) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ * the instructions of a cpu are not changed, detect them once. a backend
+ * is only used after it gave the known answers, else the tables are
+ */
+static void aes_backend_detect(void)
+{
+	int id;
+
+	for (id = 0; id < AES_BACKENDS; id++) {
+		aes_backend_verified[id] = aes_backend_supported(id)
+			&& aes_backend_verify(&aes_backends[id]) == 0;
+	}
+
+	for (id = AES_BACKENDS - 1; id > AES_BACKEND_TABLE; id--) {
+		if (aes_backend_verified[id])
+			break;
+	}
+	aes_backend_id = id;
+}
+
+const struct aes_backend *aes_backend_get(int id)
+{
+	if (id < 0 || id >= AES_BACKENDS || aes_backends[id].supported == NULL)
+		return NULL;
+	return &aes_backends[id];
+}
+
+int aes_backend_supported(int id)
+{
+	const struct aes_backend *backend = aes_backend_get(id);
+
+	return backend != NULL && backend->supported();
+}
+
+const struct aes_backend *aes_backend_active(void)
+{
+	pthread_once(&aes_backend_once, aes_backend_detect);
+	return &aes_backends[aes_backend_id];
+}
+
+int aes_backend_active_id(void)
+{
+	pthread_once(&aes_backend_once, aes_backend_detect);
+	return aes_backend_id;
+}
+
+int aes_backend_select(int id)
+{
+	pthread_once(&aes_backend_once, aes_backend_detect);
+	if (id < 0 || id >= AES_BACKENDS || !aes_backend_verified[id])
+		return -1;
+	aes_backend_id = id;
+	return 0;
+}
@@ -0,0 +1,76 @@
+/**
+ * \file aes_backend.h
+ *
+ * \brief AES backends: the portable tables of aes.cpp, x86 AES-NI and
+ *        the ARMv8 Crypto Extensions, chosen at runtime by the cpu
+ *
+ * The accelerated backends use the round keys of aes_setkey_enc() and
+ * aes_setkey_dec() as they are, the decryption keys are already in the
+ * form of the equivalent inverse cipher.
+ */
+#ifndef AES_BACKEND_H
+#define AES_BACKEND_H
+
+#include <stddef.h>
+
+#include "aes.h"
+
+#define AES_BACKEND_TABLE       0
+#define AES_BACKEND_AESNI       1
+#define AES_BACKEND_ARMV8_CE    2
+#define AES_BACKENDS            3
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief          AES backend, crypt_ecb and crypt_cbc are NULL for the
+ *                 tables, aes_crypt_ecb() and aes_crypt_cbc() run them
+ */
+struct aes_backend {
+	const char *name;
+	int (*supported)(void);
+	int (*crypt_ecb)(struct aes_context *ctx,
+			 int mode,
+			 const unsigned char input[16],
+			 unsigned char output[16]);
+	int (*crypt_cbc)(struct aes_context *ctx,
+			 int mode,
+			 size_t length,
+			 unsigned char iv[16],
+			 const unsigned char *input,
+			 unsigned char *output);
+};
+
+/**
+ * \brief          Backend of the id, NULL if it is not built for this cpu
+ */
+const struct aes_backend *aes_backend_get(int id);
+
+/**
+ * \brief          1 if the backend is built and the cpu has the instructions
+ */
+int aes_backend_supported(int id);
+
+/**
+ * \brief          Backend in use, the fastest one supported which gives the
+ *                 known answers of FIPS-197 is chosen on the first call
+ */
+const struct aes_backend *aes_backend_active(void);
+int aes_backend_active_id(void);
+
+/**
+ * \brief          Use the backend of the id for all the contexts, for the
+ *                 tests and the benchmark
+ *
+ * \return         0 if successful, or -1 if it is not supported or it did
+ *                 not give the known answers
+ */
+int aes_backend_select(int id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* aes_backend.h */
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/06/02
+ *  @par function description:
+ *  - 1 wait the hdcp tx authentication result posted by the uevent thread
+ *  - 2 poll the driver slowly for the kernels without the hdcp uevent
+ *  - 3 latency histograms of the authentications
+ */
+
+#define LOG_TAG "SystemControl"
+//#define LOG_NDEBUG 0
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "HdcpAuth.h"
+#include "Metrics.h"
+
+static const int BUCKET_MS[HDCP_AUTH_BUCKETS - 1] = {
+    50, 100, 200, 500, 1000, 2000, 4000, 8000
+};
+
+static const char *KIND_NAMES[HDCP_AUTH_KINDS] = {
+    "2.2 ok", "1.4 ok", "2.2 fail", "1.4 fail"
+};
+
+static const char *KIND_METRICS[HDCP_AUTH_KINDS] = {
+    "hdcp.auth22.ok", "hdcp.auth14.ok", "hdcp.auth22.fail", "hdcp.auth14.fail"
+};
+
+static int64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+HdcpAuthWaiter::HdcpAuthWaiter()
+    :mResult(HDCP_AUTH_NONE),
+    mCancel(false) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&mLock, NULL);
+    memset(&mStats, 0, sizeof(mStats));
+    for (int i = 0; i < HDCP_AUTH_KINDS; i++)
+        mMetrics[i] = metrics_id(KIND_METRICS[i]);
+}
+
+HdcpAuthWaiter::~HdcpAuthWaiter() {
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mLock);
+}
+
+void HdcpAuthWaiter::post(int result) {
+    pthread_mutex_lock(&mLock);
+    mResult = result;
+    mStats.events++;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mLock);
+}
+
+void HdcpAuthWaiter::clear() {
+    pthread_mutex_lock(&mLock);
+    mResult = HDCP_AUTH_NONE;
+    pthread_mutex_unlock(&mLock);
+}
+
+void HdcpAuthWaiter::cancel() {
+    pthread_mutex_lock(&mLock);
+    mCancel = true;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mLock);
+}
+
+void HdcpAuthWaiter::reset() {
+    pthread_mutex_lock(&mLock);
+    mCancel = false;
+    mResult = HDCP_AUTH_NONE;
+    pthread_mutex_unlock(&mLock);
+}
+
+int HdcpAuthWaiter::wait(int timeoutUs, int pollUs, hdcp_auth_poll_t poll, void *data,
+    int64_t *elapsedUs) {
+    int64_t start = nowUs();
+    int64_t deadline = start + timeoutUs;
+    int result = HDCP_AUTH_NONE;
+
+    pthread_mutex_lock(&mLock);
+    while (true) {
+        if (mCancel) {
+            result = HDCP_AUTH_EXIT;
+            break;
+        }
+        if (mResult != HDCP_AUTH_NONE) {
+            result = mResult;
+            break;
+        }
+
+        //the driver is read without the lock, post is not blocked by a slow sysfs read
+        if (poll != NULL) {
+            pthread_mutex_unlock(&mLock);
+            int polled = poll(data);
+            pthread_mutex_lock(&mLock);
+            mStats.polls++;
+            if (polled != HDCP_AUTH_NONE && mResult == HDCP_AUTH_NONE && !mCancel) {
+                result = polled;
+                break;
+            }
+            if (mCancel || mResult != HDCP_AUTH_NONE)
+                continue;
+        }
+
+        int64_t now = nowUs();
+        if (now >= deadline) {
+            result = HDCP_AUTH_TIMEOUT;
+            break;
+        }
+
+        int64_t wake = now + pollUs;
+        if (poll == NULL || wake > deadline)
+            wake = deadline;
+        struct timespec ts;
+        ts.tv_sec = wake/1000000;
+        ts.tv_nsec = (wake%1000000)*1000;
+        pthread_cond_timedwait(&mCond, &mLock, &ts);
+    }
+    pthread_mutex_unlock(&mLock);
+
+    if (elapsedUs != NULL)
+        *elapsedUs = nowUs() - start;
+    return result;
+}
+
+void HdcpAuthWaiter::record(int kind, int64_t us) {
+    if (kind < 0 || kind >= HDCP_AUTH_KINDS)
+        return;
+
+    int bucket = 0;
+    while (bucket < HDCP_AUTH_BUCKETS - 1 && us > (int64_t)BUCKET_MS[bucket]*1000)
+        bucket++;
+
+    metrics_record(mMetrics[kind], us);
+
+    pthread_mutex_lock(&mLock);
+    mStats.count[kind][bucket]++;
+    mStats.totalUs[kind] += us;
+    if (us > mStats.maxUs[kind])
+        mStats.maxUs[kind] = us;
+    pthread_mutex_unlock(&mLock);
+}
+
+void HdcpAuthWaiter::getStats(hdcp_auth_stats_t *stats) {
+    pthread_mutex_lock(&mLock);
+    *stats = mStats;
+    pthread_mutex_unlock(&mLock);
+}
+
+void HdcpAuthWaiter::dump(char *result) {
+    hdcp_auth_stats_t stats;
+    char buf[512];
+
+    getStats(&stats);
+    sprintf(buf, "\nhdcp tx authenticate: %lld uevents, %lld polls\n"
+        "  ms:      <=50 <=100 <=200 <=500  <=1s  <=2s  <=4s  <=8s   >8s   avg   max\n",
+        (long long)stats.events, (long long)stats.polls);
+    strcat(result, buf);
+
+    for (int i = 0; i < HDCP_AUTH_KINDS; i++) {
+        int64_t total = 0;
+        int len = sprintf(buf, "  %-8s", KIND_NAMES[i]);
+        for (int j = 0; j < HDCP_AUTH_BUCKETS; j++) {
+            len += sprintf(buf + len, " %5lld", (long long)stats.count[i][j]);
+            total += stats.count[i][j];
+        }
+        sprintf(buf + len, " %5lld %5lld\n",
+            (long long)((total > 0)?stats.totalUs[i]/total/1000:0),
+            (long long)(stats.maxUs[i]/1000));
+        strcat(result, buf);
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/06/02
+ *  @par function description:
+ *  - 1 wait the hdcp tx authentication result posted by the uevent thread
+ *  - 2 poll the driver slowly for the kernels without the hdcp uevent
+ *  - 3 latency histograms of the authentications
+ */
+
+#ifndef HDCP_AUTH_H
+#define HDCP_AUTH_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+enum {
+    HDCP_AUTH_NONE              = 0,    //no result yet
+    HDCP_AUTH_OK                = 1,
+    HDCP_AUTH_FAIL              = 2,    //the driver or hdcp_tx22 tell it failed
+    HDCP_AUTH_TIMEOUT           = 3,
+    HDCP_AUTH_EXIT              = 4     //the hdcp tx thread exit
+};
+
+//histograms of the attempts, by version and result
+enum {
+    HDCP_AUTH_22_OK             = 0,
+    HDCP_AUTH_14_OK             = 1,
+    HDCP_AUTH_22_FAIL           = 2,
+    HDCP_AUTH_14_FAIL           = 3,
+    HDCP_AUTH_KINDS             = 4
+};
+
+//upper bound of the buckets in ms, the last one is the rest
+#define HDCP_AUTH_BUCKETS       9
+
+typedef struct hdcp_auth_stats {
+    int64_t count[HDCP_AUTH_KINDS][HDCP_AUTH_BUCKETS];
+    int64_t totalUs[HDCP_AUTH_KINDS];
+    int64_t maxUs[HDCP_AUTH_KINDS];
+    int64_t events;             //results posted by the uevent
+    int64_t polls;              //reads of the driver while waiting
+} hdcp_auth_stats_t;
+
+//read the driver, return HDCP_AUTH_NONE, HDCP_AUTH_OK or HDCP_AUTH_FAIL
+typedef int (*hdcp_auth_poll_t)(void *data);
+
+class HdcpAuthWaiter
+{
+public:
+    HdcpAuthWaiter();
+    ~HdcpAuthWaiter();
+
+    //from the uevent thread, the wait return at once
+    void post(int result);
+    //drop the result of the last attempt, before hdcp is started again
+    void clear();
+    //the wait return HDCP_AUTH_EXIT until reset
+    void cancel();
+    void reset();
+
+    //wait a posted result at most timeoutUs, poll is called every pollUs
+    int wait(int timeoutUs, int pollUs, hdcp_auth_poll_t poll, void *data, int64_t *elapsedUs);
+
+    void record(int kind, int64_t us);
+    void getStats(hdcp_auth_stats_t *stats);
+    void dump(char *result);
+
+private:
+    pthread_mutex_t mLock;
+    pthread_cond_t mCond;
+    int mResult;
+    bool mCancel;
+    hdcp_auth_stats_t mStats;
+    int mMetrics[HDCP_AUTH_KINDS];
+};
+
+#endif // HDCP_AUTH_H
@@ -451,6 +451,55 @@ public:
         }
     }
 
+    virtual int32_t getProperties(const Vector<String16>& keys,
+        Vector<String16>& values, Vector<int32_t>& status)
+    {
+        Parcel data, reply;
+        data.writeInterfaceToken(ISystemControlService::getInterfaceDescriptor());
+        writeStrings(data, keys);
+        ALOGV("getProperties count:%d\n", (int)keys.size());
+
+        if (remote()->transact(GET_PROPERTIES, data, &reply) != NO_ERROR) {
+            ALOGE("getProperties could not contact remote\n");
+            return failBatch(keys.size(), &values, status);
+        }
+
+        return readBatchReply(reply, keys.size(), &values, status);
+    }
+
+    virtual int32_t readSysfsBatch(const Vector<String16>& paths,
+        Vector<String16>& values, Vector<int32_t>& status)
+    {
+        Parcel data, reply;
+        data.writeInterfaceToken(ISystemControlService::getInterfaceDescriptor());
+        writeStrings(data, paths);
+        ALOGV("readSysfsBatch count:%d\n", (int)paths.size());
+
+        if (remote()->transact(READ_SYSFS_BATCH, data, &reply) != NO_ERROR) {
+            ALOGE("readSysfsBatch could not contact remote\n");
+            return failBatch(paths.size(), &values, status);
+        }
+
+        return readBatchReply(reply, paths.size(), &values, status);
+    }
+
+    virtual int32_t writeSysfsBatch(const Vector<String16>& paths,
+        const Vector<String16>& values, Vector<int32_t>& status)
+    {
+        Parcel data, reply;
+        data.writeInterfaceToken(ISystemControlService::getInterfaceDescriptor());
+        writeStrings(data, paths);
+        writeStrings(data, values);
+        ALOGV("writeSysfsBatch count:%d\n", (int)paths.size());
+
+        if (remote()->transact(WRITE_SYSFS_BATCH, data, &reply) != NO_ERROR) {
+            ALOGE("writeSysfsBatch could not contact remote\n");
+            return failBatch(paths.size(), NULL, status);
+        }
+
+        return readBatchReply(reply, paths.size(), NULL, status);
+    }
+
     virtual void setDigitalMode(const String16& mode)
     {
         Parcel data, reply;
@@ -586,12 +635,64 @@ public:
             return;
         }
     }
+
+private:
+    static void writeStrings(Parcel& data, const Vector<String16>& strings)
+    {
+        data.writeInt32(strings.size());
+        for (size_t i = 0; i < strings.size(); i++)
+            data.writeString16(strings[i]);
+    }
+
+    static int32_t failBatch(size_t count, Vector<String16> *values, Vector<int32_t>& status)
+    {
+        status.clear();
+        status.insertAt(0, 0, count);
+        if (values != NULL) {
+            values->clear();
+            values->insertAt(String16(), 0, count);
+        }
+        return -1;
+    }
+
+    //result, then status and value of every item
+    static int32_t readBatchReply(const Parcel& reply, size_t count,
+        Vector<String16> *values, Vector<int32_t>& status)
+    {
+        int32_t result = reply.readInt32();
+        if (result < 0) {
+            ALOGE("batch call failed %d\n", result);
+            return failBatch(count, values, status);
+        }
+
+        status.clear();
+        if (values != NULL)
+            values->clear();
+        for (size_t i = 0; i < count; i++) {
+            status.push_back(reply.readInt32());
+            if (values != NULL)
+                values->push_back(reply.readString16());
+        }
+        return result;
+    }
 };
 
 IMPLEMENT_META_INTERFACE(SystemControlService, "droidlogic.ISystemControlService");
 
 // ----------------------------------------------------------------------------
 
+static status_t readStrings(const Parcel& data, Vector<String16>& strings)
+{
+    int32_t count = data.readInt32();
+    if (count < 0 || count > MAX_BATCH_ITEMS)
+        return BAD_VALUE;
+
+    strings.setCapacity(count);
+    for (int32_t i = 0; i < count; i++)
+        strings.push_back(data.readString16());
+    return NO_ERROR;
+}
+
 status_t BnISystemControlService::onTransact(
     uint32_t code, const Parcel& data, Parcel* reply, uint32_t flags)
 {
@@ -854,6 +955,37 @@ status_t BnISystemControlService::onTransact(
             autoDetect3DForMbox();
             return NO_ERROR;
         }
+        case GET_PROPERTIES:
+        case READ_SYSFS_BATCH:
+        case WRITE_SYSFS_BATCH: {
+            CHECK_INTERFACE(ISystemControlService, data, reply);
+            Vector<String16> keys, values;
+            Vector<int32_t> status;
+            if (readStrings(data, keys) != NO_ERROR
+                || (code == WRITE_SYSFS_BATCH && (readStrings(data, values) != NO_ERROR
+                    || values.size() != keys.size()))) {
+                ALOGE("batch transaction %d bad items\n", code);
+                return BAD_VALUE;
+            }
+
+            int32_t result;
+            if (code == GET_PROPERTIES)
+                result = getProperties(keys, values, status);
+            else if (code == READ_SYSFS_BATCH)
+                result = readSysfsBatch(keys, values, status);
+            else
+                result = writeSysfsBatch(keys, values, status);
+
+            reply->writeInt32(result);
+            if (result < 0)
+                return NO_ERROR;
+            for (size_t i = 0; i < keys.size(); i++) {
+                reply->writeInt32((i < status.size())?status[i]:0);
+                if (code != WRITE_SYSFS_BATCH)
+                    reply->writeString16((i < values.size())?values[i]:String16());
+            }
+            return NO_ERROR;
+        }
 
         default: {
             return BBinder::onTransact(code, data, reply, flags);
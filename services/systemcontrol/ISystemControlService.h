@@ -26,6 +26,7 @@
 #include <binder/IInterface.h>
 #include <utils/String8.h>
 #include <utils/String16.h>
+#include <utils/Vector.h>
 #include "ISystemControlNotify.h"
 
 namespace android {
@@ -77,8 +78,16 @@ enum {
     SWITCH_3DTO2D                  = IBinder::FIRST_CALL_TRANSACTION + 33,
     SWITCH_2DTO3D                  = IBinder::FIRST_CALL_TRANSACTION + 34,
     AUTO_DETECT_3D                 = IBinder::FIRST_CALL_TRANSACTION + 35,
+
+    //several keys or nodes in one transaction
+    GET_PROPERTIES                 = IBinder::FIRST_CALL_TRANSACTION + 36,
+    READ_SYSFS_BATCH               = IBinder::FIRST_CALL_TRANSACTION + 37,
+    WRITE_SYSFS_BATCH              = IBinder::FIRST_CALL_TRANSACTION + 38,
 };
 
+//items of one batch transaction
+#define MAX_BATCH_ITEMS     256
+
 // ----------------------------------------------------------------------------
 
 // must be kept in sync with interface defined in ISystemControlService.aidl
@@ -132,6 +141,17 @@ public:
     virtual bool switch3DTo2D(int format) = 0;
     virtual bool switch2DTo3D(int format) = 0;
     virtual void autoDetect3DForMbox(void) = 0;
+
+    /*
+     * batch get or set, status[i] is 1 if the item i succeed.
+     * return the count of the succeed items, -1 if the call failed
+     */
+    virtual int32_t getProperties(const Vector<String16>& keys,
+        Vector<String16>& values, Vector<int32_t>& status) = 0;
+    virtual int32_t readSysfsBatch(const Vector<String16>& paths,
+        Vector<String16>& values, Vector<int32_t>& status) = 0;
+    virtual int32_t writeSysfsBatch(const Vector<String16>& paths,
+        const Vector<String16>& values, Vector<int32_t>& status) = 0;
 };
 
 // ----------------------------------------------------------------------------
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/07/11
+ *  @par function description:
+ *  - 1 the entries are in a fixed array, found by the hash of the name
+ *  - 2 the values are updated with one lock, an entry is never removed
+ */
+
+#define LOG_TAG "SystemControl"
+//#define LOG_NDEBUG 0
+
+//no atrace in recovery and in the host tests
+#if defined(__ANDROID__) && !defined(RECOVERY_MODE)
+#define METRICS_ATRACE
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+#include <cutils/trace.h>
+#endif
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "Metrics.h"
+#include "common.h"
+
+//hash slots of the names, power of 2
+#define METRICS_TABLE_SIZE      512
+
+typedef struct metrics_entry {
+    char name[METRICS_NAME_LEN];
+    uint32_t hash;
+    int next;                   //next entry of the same hash slot, -1 if none
+    metrics_stats_t stats;
+} metrics_entry_t;
+
+static pthread_mutex_t sLock = PTHREAD_MUTEX_INITIALIZER;
+static metrics_entry_t sEntries[METRICS_MAX];
+static int sCount = 0;
+static int sTable[METRICS_TABLE_SIZE];
+static bool sTableInit = false;
+//names not added as the registry is full
+static int64_t sDropped = 0;
+static volatile int sTrace = 0;
+
+//FNV-1a
+static uint32_t nameHash(const char *name) {
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+int64_t metrics_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+//with sLock
+static int findEntry(const char *name, uint32_t hash) {
+    if (!sTableInit) {
+        for (int i = 0; i < METRICS_TABLE_SIZE; i++)
+            sTable[i] = -1;
+        sTableInit = true;
+    }
+
+    for (int id = sTable[hash & (METRICS_TABLE_SIZE - 1)]; id >= 0; id = sEntries[id].next) {
+        if (sEntries[id].hash == hash && !strcmp(sEntries[id].name, name))
+            return id;
+    }
+    return -1;
+}
+
+static int addEntry(const char *name, int max) {
+    uint32_t hash = nameHash(name);
+
+    pthread_mutex_lock(&sLock);
+    int id = findEntry(name, hash);
+    if (id < 0) {
+        if (sCount >= max) {
+            sDropped++;
+            pthread_mutex_unlock(&sLock);
+            return -1;
+        }
+
+        id = sCount++;
+        metrics_entry_t *entry = &sEntries[id];
+        strncpy(entry->name, name, METRICS_NAME_LEN - 1);
+        entry->name[METRICS_NAME_LEN - 1] = 0;
+        entry->hash = hash;
+        memset(&entry->stats, 0, sizeof(metrics_stats_t));
+        entry->next = sTable[hash & (METRICS_TABLE_SIZE - 1)];
+        sTable[hash & (METRICS_TABLE_SIZE - 1)] = id;
+    }
+    pthread_mutex_unlock(&sLock);
+    return id;
+}
+
+int metrics_id(const char *name) {
+    return addEntry(name, METRICS_MAX);
+}
+
+int metrics_id_limited(const char *name) {
+    return addEntry(name, METRICS_MAX - METRICS_RESERVED);
+}
+
+void metrics_count(int id, int64_t n) {
+    if (id < 0 || id >= METRICS_MAX)
+        return;
+
+    pthread_mutex_lock(&sLock);
+    sEntries[id].stats.count += n;
+    pthread_mutex_unlock(&sLock);
+}
+
+static int bucketOf(int64_t us) {
+    int bucket = 0;
+    while (us > 0 && bucket < METRICS_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void metrics_record(int id, int64_t us) {
+    if (id < 0 || id >= METRICS_MAX)
+        return;
+    if (us < 0)
+        us = 0;
+
+    int bucket = bucketOf(us);
+    pthread_mutex_lock(&sLock);
+    metrics_stats_t *stats = &sEntries[id].stats;
+    stats->count++;
+    stats->timed = 1;
+    stats->totalUs += us;
+    if (us > stats->maxUs)
+        stats->maxUs = us;
+    stats->buckets[bucket]++;
+    pthread_mutex_unlock(&sLock);
+}
+
+void metrics_set_trace(int enable) {
+    sTrace = enable;
+}
+
+int metrics_get_trace(void) {
+    return sTrace;
+}
+
+//the name of an entry is not changed once added, it is read without the lock
+void metrics_trace_begin(int id) {
+#ifdef METRICS_ATRACE
+    if (sTrace && id >= 0 && id < METRICS_MAX)
+        atrace_begin(ATRACE_TAG, sEntries[id].name);
+#else
+    (void)id;
+#endif
+}
+
+void metrics_trace_end(int id) {
+#ifdef METRICS_ATRACE
+    if (sTrace && id >= 0 && id < METRICS_MAX)
+        atrace_end(ATRACE_TAG);
+#else
+    (void)id;
+#endif
+}
+
+void metrics_reset(void) {
+    pthread_mutex_lock(&sLock);
+    for (int i = 0; i < sCount; i++)
+        memset(&sEntries[i].stats, 0, sizeof(metrics_stats_t));
+    sDropped = 0;
+    pthread_mutex_unlock(&sLock);
+}
+
+int metrics_get(const char *name, metrics_stats_t *stats) {
+    uint32_t hash = nameHash(name);
+
+    pthread_mutex_lock(&sLock);
+    int id = findEntry(name, hash);
+    if (id >= 0)
+        *stats = sEntries[id].stats;
+    pthread_mutex_unlock(&sLock);
+    return (id >= 0)?0:-1;
+}
+
+//the upper bound of the bucket the percent of the events are in, not more than the max
+static int64_t percentile(const metrics_stats_t *stats, int percent) {
+    int64_t target = (stats->count*percent + 99)/100;
+    int64_t sum = 0;
+    for (int i = 0; i < METRICS_BUCKETS; i++) {
+        sum += stats->buckets[i];
+        if (sum >= target && sum > 0) {
+            int64_t upper = (i == 0)?0:((int64_t)1 << i) - 1;
+            return (upper < stats->maxUs)?upper:stats->maxUs;
+        }
+    }
+    return stats->maxUs;
+}
+
+static void append(char *result, int size, int *len, const char *fmt, ...) {
+    if (*len >= size - 1)
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(result + *len, size - *len, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        *len += (n < size - *len)?n:(size - *len - 1);
+}
+
+static void dumpText(const metrics_entry_t *entry, char *result, int size, int *len) {
+    const metrics_stats_t *stats = &entry->stats;
+    if (!stats->timed) {
+        append(result, size, len, "%s count:%lld\n", entry->name, (long long)stats->count);
+        return;
+    }
+    append(result, size, len, "%s count:%lld avg:%lldus max:%lldus p50:%lldus p99:%lldus\n",
+        entry->name, (long long)stats->count,
+        (long long)((stats->count > 0)?stats->totalUs/stats->count:0), (long long)stats->maxUs,
+        (long long)percentile(stats, 50), (long long)percentile(stats, 99));
+}
+
+static void dumpKv(const metrics_entry_t *entry, char *result, int size, int *len) {
+    const metrics_stats_t *stats = &entry->stats;
+    append(result, size, len, "%s.count=%lld\n", entry->name, (long long)stats->count);
+    if (!stats->timed)
+        return;
+
+    append(result, size, len, "%s.total_us=%lld\n%s.max_us=%lld\n%s.p50_us=%lld\n%s.p99_us=%lld\n",
+        entry->name, (long long)stats->totalUs, entry->name, (long long)stats->maxUs,
+        entry->name, (long long)percentile(stats, 50), entry->name, (long long)percentile(stats, 99));
+    //the buckets to the last used one
+    int last = METRICS_BUCKETS - 1;
+    while (last > 0 && stats->buckets[last] == 0)
+        last--;
+    append(result, size, len, "%s.buckets=", entry->name);
+    for (int i = 0; i <= last; i++)
+        append(result, size, len, (i == 0)?"%lld":",%lld", (long long)stats->buckets[i]);
+    append(result, size, len, "\n");
+}
+
+static void dumpJson(const metrics_entry_t *entry, bool first, char *result, int size, int *len) {
+    const metrics_stats_t *stats = &entry->stats;
+    //the names are node paths and method names, no quote or backslash in them
+    append(result, size, len, "%s\n  \"%s\": {\"count\": %lld", first?"":",",
+        entry->name, (long long)stats->count);
+    if (stats->timed) {
+        append(result, size, len, ", \"total_us\": %lld, \"max_us\": %lld, \"p50_us\": %lld, \"p99_us\": %lld, \"buckets\": [",
+            (long long)stats->totalUs, (long long)stats->maxUs,
+            (long long)percentile(stats, 50), (long long)percentile(stats, 99));
+        for (int i = 0; i < METRICS_BUCKETS; i++)
+            append(result, size, len, (i == 0)?"%lld":", %lld", (long long)stats->buckets[i]);
+        append(result, size, len, "]");
+    }
+    append(result, size, len, "}");
+}
+
+int metrics_dump(char *result, int size, int format) {
+    int len = strlen(result);
+
+    pthread_mutex_lock(&sLock);
+    if (METRICS_DUMP_JSON == format)
+        append(result, size, &len, "{\"dropped\": %lld, \"metrics\": {", (long long)sDropped);
+    else if (METRICS_DUMP_KV == format)
+        append(result, size, &len, "metrics.dropped=%lld\n", (long long)sDropped);
+    else
+        append(result, size, &len, "metrics entries:%d, dropped:%lld, trace:%s\n",
+            sCount, (long long)sDropped, sTrace?"on":"off");
+
+    for (int i = 0; i < sCount; i++) {
+        //the table is for a human, skip the methods and nodes never used
+        if (METRICS_DUMP_TEXT == format && sEntries[i].stats.count == 0)
+            continue;
+        if (METRICS_DUMP_JSON == format)
+            dumpJson(&sEntries[i], i == 0, result, size, &len);
+        else if (METRICS_DUMP_KV == format)
+            dumpKv(&sEntries[i], result, size, &len);
+        else
+            dumpText(&sEntries[i], result, size, &len);
+    }
+
+    if (METRICS_DUMP_JSON == format)
+        append(result, size, &len, "\n}}\n");
+    pthread_mutex_unlock(&sLock);
+    return len;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/07/11
+ *  @par function description:
+ *  - 1 one registry of the counters and latency histograms of the service, by name
+ *  - 2 binder methods, sysfs nodes, bootenv flush, hdcp auth and uevent handlers record here
+ *  - 3 dump as a table, key=value lines or json
+ *  - 4 atrace begin and end of the hot paths, switched at runtime
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define METRICS_MAX             256
+//entries only the fixed names of the service can take
+#define METRICS_RESERVED        96
+//"sysfs.write." and a sysfs path
+#define METRICS_NAME_LEN        144
+//bucket 0 is 0us, bucket i is [2^(i-1), 2^i)us, the last one is the rest
+#define METRICS_BUCKETS         24
+
+enum {
+    METRICS_DUMP_TEXT           = 0,
+    METRICS_DUMP_KV             = 1,    //name.field=value lines
+    METRICS_DUMP_JSON           = 2
+};
+
+typedef struct metrics_stats {
+    int64_t count;
+    //only the entries recorded with a latency have them
+    int timed;
+    int64_t totalUs;
+    int64_t maxUs;
+    int64_t buckets[METRICS_BUCKETS];
+} metrics_stats_t;
+
+//find or add the entry of name, return its id or -1 if the registry is full.
+//the id is kept by reset, the callers may keep it
+int metrics_id(const char *name);
+//as metrics_id, but a new name do not take the reserved entries.
+//for the names made of sysfs paths, which the binder callers choose
+int metrics_id_limited(const char *name);
+//add n to the counter
+void metrics_count(int id, int64_t n);
+//one event which took us
+void metrics_record(int id, int64_t us);
+int64_t metrics_now_us(void);
+
+//the atrace markers, nothing is traced until it is enabled
+void metrics_set_trace(int enable);
+int metrics_get_trace(void);
+void metrics_trace_begin(int id);
+void metrics_trace_end(int id);
+
+//clear the values of all the entries
+void metrics_reset(void);
+//return -1 if there is no entry of name
+int metrics_get(const char *name, metrics_stats_t *stats);
+//append to result at most size bytes, return the length of result
+int metrics_dump(char *result, int size, int format);
+
+#ifdef __cplusplus
+}
+
+//the time and the trace of a scope
+class MetricsScope
+{
+public:
+    MetricsScope(int id) : mId(id), mStartUs(metrics_now_us()) {
+        metrics_trace_begin(mId);
+    }
+    ~MetricsScope() {
+        metrics_trace_end(mId);
+        metrics_record(mId, metrics_now_us() - mStartUs);
+    }
+
+private:
+    int mId;
+    int64_t mStartUs;
+};
+#endif
+
+#endif // METRICS_H
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/30
+ *  @par function description:
+ *  - 1 diff the display state of the driver with the wanted one
+ *  - 2 plan only the sysfs writes, waits and actions the mode switch need
+ *  - 3 estimate the cost of the plan for the dry run
+ */
+
+#define LOG_TAG "SystemControl"
+//#define LOG_NDEBUG 0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "ModePlan.h"
+
+//measured on gxbb, the mode write set the vic and wait the pll lock in the driver
+#define COST_WRITE_US           100
+#define COST_WRITE_MODE_US      30000
+#define COST_HDCP_START_US      2000
+#define COST_HDCP_STOP_US       3000
+#define COST_VIDEO_AXIS_US      300
+#define COST_OSD_MOUSE_US       400
+#define COST_NOTIFY_US          500
+#define COST_AUDIO_US           200
+#define COST_ENV_US             50
+
+//the sleeps the switch did before, now the most a wait can take, avmute is still a sleep
+#define WAIT_AVMUTE_US          50000
+#define WAIT_HDCP_OFF_US        100000
+#define WAIT_PHY_OFF_US         50000
+
+static const char *STEP_NAMES[PLAN_STEP_TOTAL] = {
+    "write",
+    "wait",
+    "hdcp start",
+    "hdcp stop",
+    "video axis",
+    "osd mouse",
+    "bootanim",
+    "notify",
+    "audio",
+    "env",
+};
+
+//the numbers of a node text, hex as 0x10001, at most max of them
+static int parseNumbers(const char *str, long *numbers, int max) {
+    int count = 0;
+    const char *pos = str;
+    while (*pos != 0 && count < max) {
+        if (isdigit((unsigned char)*pos) ||
+                (*pos == '-' && isdigit((unsigned char)pos[1]))) {
+            char *end;
+            numbers[count++] = strtol(pos, &end, 0);
+            pos = end;
+        } else {
+            pos++;
+        }
+    }
+    return count;
+}
+
+bool modePlanSameValue(const char *current, const char *value) {
+    if (!strcmp(current, value))
+        return true;
+
+    long curNumbers[8];
+    long numbers[8];
+    int curCount = parseNumbers(current, curNumbers, 8);
+    int count = parseNumbers(value, numbers, 8);
+    if (count == 0 || count != curCount)
+        return false;
+
+    return !memcmp(curNumbers, numbers, count*sizeof(long));
+}
+
+static mode_plan_step_t *addStep(mode_plan_t *plan, int type, const char *path,
+    const char *value, int costUs) {
+    if (plan->count >= MODE_PLAN_MAX_STEPS)
+        return NULL;
+
+    mode_plan_step_t *step = &plan->steps[plan->count++];
+    memset(step, 0, sizeof(mode_plan_step_t));
+    step->type = type;
+    if (path != NULL)
+        strncpy(step->path, path, MODE_PLAN_PATH_LEN - 1);
+    if (value != NULL)
+        strncpy(step->value, value, MODE_LEN - 1);
+    step->costUs = costUs;
+    plan->costUs += costUs;
+    return step;
+}
+
+//the node already has the value, skip the write
+static void addWrite(mode_plan_t *plan, const char *path, const char *current, const char *value) {
+    if (current != NULL && modePlanSameValue(current, value)) {
+        plan->skipped++;
+        return;
+    }
+    addStep(plan, PLAN_STEP_WRITE, path, value, COST_WRITE_US);
+}
+
+static void addWait(mode_plan_t *plan, const char *path, const char *value, int timeoutUs) {
+    mode_plan_step_t *step = addStep(plan, PLAN_STEP_WAIT, path, value, timeoutUs);
+    if (step != NULL)
+        step->timeoutUs = timeoutUs;
+}
+
+static void addEnv(mode_plan_t *plan, const char *key, const char *current, const char *value) {
+    if (!strcmp(current, value)) {
+        plan->skipped++;
+        return;
+    }
+    addStep(plan, PLAN_STEP_ENV, key, value, COST_ENV_US);
+}
+
+void modePlanBuild(mode_plan_t *plan, const mode_plan_nodes_t *nodes,
+    const display_state_t *cur, const display_state_t *want, output_mode_state state) {
+    memset(plan, 0, sizeof(mode_plan_t));
+
+    //the driver enable the tmds output again by the mode write after plug in or resume
+    plan->writeMode = strcmp(cur->mode, want->mode) || (OUPUT_MODE_STATE_POWER == state);
+    //uboot may already set the mode, hdcp and audio still need be started at boot
+    bool outputChange = plan->writeMode || (OUPUT_MODE_STATE_INIT == state);
+    bool axisChange = !modePlanSameValue(cur->windowAxis, want->windowAxis);
+
+    if (plan->writeMode && OUPUT_MODE_STATE_INIT != state) {
+        addStep(plan, PLAN_STEP_WRITE, nodes->avmute, "1", COST_WRITE_US);
+        if (OUPUT_MODE_STATE_POWER != state) {
+            //the sink is muted in the next frames, the driver do not tell when
+            addWait(plan, NULL, NULL, WAIT_AVMUTE_US);
+            addStep(plan, PLAN_STEP_WRITE, nodes->hdcpMode, "-1", COST_WRITE_US);
+            addWait(plan, nodes->hdcpAuth, "0", WAIT_HDCP_OFF_US);
+            //turn off tmds phy
+            addStep(plan, PLAN_STEP_WRITE, nodes->phy, "0", COST_WRITE_US);
+            addWait(plan, nodes->phy, "0", WAIT_PHY_OFF_US);
+        }
+        if (want->clearVic)
+            addStep(plan, PLAN_STEP_WRITE, nodes->vic, "0", COST_WRITE_US);
+    }
+
+    if (plan->writeMode) {
+        addStep(plan, PLAN_STEP_WRITE, nodes->mode, want->mode, COST_WRITE_MODE_US);
+        if (strlen(want->mode2) > 0)
+            addWrite(plan, nodes->mode2, cur->mode2, want->mode2);
+    }
+
+    addWrite(plan, nodes->freeScaleAxis, cur->freeScaleAxis, want->freeScaleAxis);
+    addWrite(plan, nodes->windowAxis, cur->windowAxis, want->windowAxis);
+    if (plan->writeMode || axisChange)
+        addStep(plan, PLAN_STEP_VIDEO_AXIS, NULL, NULL, COST_VIDEO_AXIS_US);
+
+    //only HDMI mode need HDCP authenticate
+    if (outputChange) {
+        if (want->cvbs)
+            addStep(plan, PLAN_STEP_HDCP_STOP, NULL, NULL, COST_HDCP_STOP_US);
+        else
+            addStep(plan, PLAN_STEP_HDCP_START, NULL, NULL, COST_HDCP_START_US);
+    }
+
+    if (OUPUT_MODE_STATE_INIT == state) {
+        addStep(plan, PLAN_STEP_BOOTANIM, NULL, NULL, 0);
+    } else {
+        if (plan->writeMode) {
+            addWrite(plan, nodes->fb0Blank, cur->fb0Blank, want->fb0Blank);
+            addWrite(plan, nodes->fb0FreeScale, cur->fb0FreeScale, want->fb0FreeScale);
+        }
+        if (plan->writeMode || axisChange)
+            addStep(plan, PLAN_STEP_OSD_MOUSE, NULL, want->envOutputMode, COST_OSD_MOUSE_US);
+    }
+
+    if (outputChange) {
+        addStep(plan, PLAN_STEP_NOTIFY, NULL, NULL, COST_NOTIFY_US);
+        addStep(plan, PLAN_STEP_AUDIO, NULL, NULL, COST_AUDIO_US);
+    }
+    if (plan->writeMode && OUPUT_MODE_STATE_INIT != state)
+        addStep(plan, PLAN_STEP_WRITE, nodes->avmute, "-1", COST_WRITE_US);
+
+    addEnv(plan, nodes->envOutputMode, cur->envOutputMode, want->envOutputMode);
+    if (strlen(want->envCvbsMode) > 0)
+        addEnv(plan, nodes->envCvbsMode, cur->envCvbsMode, want->envCvbsMode);
+    else
+        addEnv(plan, nodes->envHdmiMode, cur->envHdmiMode, want->envHdmiMode);
+}
+
+const char *modePlanStepName(int type) {
+    if (type < 0 || type >= PLAN_STEP_TOTAL)
+        return "unknown";
+    return STEP_NAMES[type];
+}
+
+void modePlanDump(const mode_plan_t *plan, char *result) {
+    char buf[256];
+    sprintf(buf, "mode plan: %d steps, %d writes skipped, display mode %s, estimated cost <= %d.%03dms\n",
+        plan->count, plan->skipped, plan->writeMode?"written":"kept",
+        plan->costUs/1000, plan->costUs%1000);
+    strcat(result, buf);
+
+    for (int i = 0; i < plan->count; i++) {
+        const mode_plan_step_t *step = &plan->steps[i];
+        if (PLAN_STEP_WAIT == step->type && strlen(step->path) == 0) {
+            snprintf(buf, sizeof(buf), "  %2d %-11s sleep %dms\n",
+                i, modePlanStepName(step->type), step->timeoutUs/1000);
+        } else if (PLAN_STEP_WAIT == step->type) {
+            snprintf(buf, sizeof(buf), "  %2d %-11s %s == %s, timeout %dms\n",
+                i, modePlanStepName(step->type), step->path, step->value, step->timeoutUs/1000);
+        } else if (strlen(step->path) > 0) {
+            snprintf(buf, sizeof(buf), "  %2d %-11s %s = %s, ~%dus\n",
+                i, modePlanStepName(step->type), step->path, step->value, step->costUs);
+        } else {
+            snprintf(buf, sizeof(buf), "  %2d %-11s %s ~%dus\n",
+                i, modePlanStepName(step->type), step->value, step->costUs);
+        }
+        strcat(result, buf);
+    }
+}
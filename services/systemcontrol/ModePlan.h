@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/30
+ *  @par function description:
+ *  - 1 diff the display state of the driver with the wanted one
+ *  - 2 plan only the sysfs writes, waits and actions the mode switch need
+ *  - 3 estimate the cost of the plan for the dry run
+ */
+
+#ifndef MODE_PLAN_H
+#define MODE_PLAN_H
+
+#include <stdint.h>
+
+#include "common.h"
+
+#define MODE_PLAN_MAX_STEPS     32
+#define MODE_PLAN_PATH_LEN      128
+//poll interval of the wait steps
+#define MODE_PLAN_POLL_US       2000
+
+typedef enum {
+    OUPUT_MODE_STATE_INIT               = 0,
+    OUPUT_MODE_STATE_POWER              = 1,
+    OUPUT_MODE_STATE_SWITCH             = 2,
+    OUPUT_MODE_STATE_RESERVE            = 3
+}output_mode_state;
+
+enum {
+    PLAN_STEP_WRITE             = 0,    //write value to path
+    PLAN_STEP_WAIT              = 1,    //poll path until it reads value, at most timeoutUs, no path sleep
+    PLAN_STEP_HDCP_START        = 2,    //exit the hdcp tx thread and start it again
+    PLAN_STEP_HDCP_STOP         = 3,    //exit the hdcp tx thread and stop hdcp, cvbs
+    PLAN_STEP_VIDEO_AXIS        = 4,    //scale the native window of the playing video
+    PLAN_STEP_OSD_MOUSE         = 5,
+    PLAN_STEP_BOOTANIM          = 6,    //close the uboot logo after the boot animation
+    PLAN_STEP_NOTIFY            = 7,    //EVENT_OUTPUT_MODE_CHANGE to the listener
+    PLAN_STEP_AUDIO             = 8,    //digital audio mode of the env
+    PLAN_STEP_ENV               = 9,    //path is the env key
+    PLAN_STEP_TOTAL             = 10
+};
+
+typedef struct mode_plan_step {
+    int type;
+    char path[MODE_PLAN_PATH_LEN];
+    char value[MODE_LEN];
+    int timeoutUs;
+    int costUs;                 //estimated, the timeout for a wait
+} mode_plan_step_t;
+
+typedef struct mode_plan {
+    int count;
+    mode_plan_step_t steps[MODE_PLAN_MAX_STEPS];
+    bool writeMode;             //display mode is written
+    int skipped;                //writes of the values the nodes already have
+    int costUs;
+} mode_plan_t;
+
+//the mbox output nodes and env, read from the driver or the wanted ones
+typedef struct display_state {
+    char mode[MODE_LEN];        //display/mode, 480cvbs for 480i of a cvbs board
+    char mode2[MODE_LEN];       //display2/mode, empty if it is not touched
+    char freeScaleAxis[MODE_LEN];
+    char windowAxis[MODE_LEN];
+    char fb0Blank[MODE_LEN];
+    char fb0FreeScale[MODE_LEN];
+    char envOutputMode[MODE_LEN];
+    char envHdmiMode[MODE_LEN];
+    char envCvbsMode[MODE_LEN]; //only one of the wanted hdmi and cvbs env is set
+    bool cvbs;
+    bool clearVic;              //switch between 8bit and 10bit, clear vic first
+} display_state_t;
+
+//paths of the nodes the plan write and wait on
+typedef struct mode_plan_nodes {
+    const char *mode;
+    const char *mode2;
+    const char *freeScaleAxis;
+    const char *windowAxis;
+    const char *fb0Blank;
+    const char *fb0FreeScale;
+    const char *avmute;
+    const char *hdcpMode;
+    const char *hdcpAuth;
+    const char *phy;
+    const char *vic;
+    const char *envOutputMode;
+    const char *envHdmiMode;
+    const char *envCvbsMode;
+} mode_plan_nodes_t;
+
+//the text of a node and the written value are the same, "window axis is [0 0 1919 1079]"
+//equal to "0 0 1919 1079" by the numbers in them
+bool modePlanSameValue(const char *current, const char *value);
+void modePlanBuild(mode_plan_t *plan, const mode_plan_nodes_t *nodes,
+    const display_state_t *cur, const display_state_t *want, output_mode_state state);
+const char *modePlanStepName(int type);
+void modePlanDump(const mode_plan_t *plan, char *result);
+
+#endif // MODE_PLAN_H
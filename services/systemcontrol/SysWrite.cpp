@@ -31,6 +31,7 @@
 #include <stdint.h>
 #include <sys/types.h>
 #include <SysWrite.h>
+#include <SysfsCache.h>
 #include <common.h>
 
 SysWrite::SysWrite()
@@ -124,64 +125,46 @@ void SysWrite::setProperty(const char *key, const char *value){
 
 bool SysWrite::readSysfs(const char *path, char *value){
     char buf[MAX_STR_LEN+1] = {0};
-    readSys(path, (char*)buf, MAX_STR_LEN, false);
+    int ret = readSys(path, (char*)buf, MAX_STR_LEN, false);
     strcpy(value, buf);
-    return true;
+    return ret >= 0;
 }
 
 // get the original data from sysfs without any change.
 bool SysWrite::readSysfsOriginal(const char *path, char *value){
     char buf[MAX_STR_LEN+1] = {0};
-    readSys(path, (char*)buf, MAX_STR_LEN, true);
+    int ret = readSys(path, (char*)buf, MAX_STR_LEN, true);
     strcpy(value, buf);
-    return true;
+    return ret >= 0;
 }
 
 bool SysWrite::writeSysfs(const char *path, const char *value){
-    writeSys(path, value);
-    return true;
+    return writeSys(path, value) >= 0;
 }
 
 void SysWrite::setLogLevel(int level){
     mLogLevel = level;
 }
 
-void SysWrite::writeSys(const char *path, const char *val){
-    int fd;
-
-    if((fd = open(path, O_RDWR)) < 0) {
-        SYS_LOGE("writeSysFs, open %s fail.", path);
-        goto exit;
-    }
-
+//SysfsCache keep the fd of the sysfs node, the next write is only a pwrite
+int SysWrite::writeSys(const char *path, const char *val){
     if(mLogLevel > LOG_LEVEL_1)
         SYS_LOGI("write %s, val:%s\n", path, val);
 
-    write(fd, val, strlen(val));
-
-exit:
-    close(fd);
+    return SysfsCache::getInstance()->write(path, val, strlen(val));
 }
 
-void SysWrite::readSys(const char *path, char *buf, int count, bool needOriginalData){
-    int fd, len;
-    char *pos;
+int SysWrite::readSys(const char *path, char *buf, int count, bool needOriginalData){
+    int len;
 
     if ( NULL == buf ) {
         SYS_LOGE("buf is NULL");
-        return;
+        return -1;
     }
 
-    if ((fd = open(path, O_RDONLY)) < 0) {
-        SYS_LOGE("readSysFs, open %s fail.", path);
-        goto exit;
-    }
-
-    len = read(fd, buf, count);
-    if (len < 0) {
-        SYS_LOGE("read error: %s, %s\n", path, strerror(errno));
-        goto exit;
-    }
+    len = SysfsCache::getInstance()->read(path, buf, count);
+    if (len < 0)
+        return -1;
 
     if (!needOriginalData) {
         int i , j;
@@ -208,8 +191,7 @@ void SysWrite::readSys(const char *path, char *buf, int count, bool needOriginal
     if (mLogLevel > LOG_LEVEL_1)
         SYS_LOGI("read %s, result length:%d, val:%s\n", path, len, buf);
 
-exit:
-    close(fd);
+    return len;
 }
 
 #if 0
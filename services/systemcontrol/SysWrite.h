@@ -42,8 +42,9 @@ public:
 
     void setLogLevel(int level);
 private:
-    void writeSys(const char *path, const char *val);
-    void readSys(const char *path, char *buf, int count, bool needOriginalData);
+    //return the bytes written or read, -1 if failed
+    int writeSys(const char *path, const char *val);
+    int readSys(const char *path, char *buf, int count, bool needOriginalData);
 
     int mLogLevel;
 };
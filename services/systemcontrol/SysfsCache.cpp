@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/16
+ *  @par function description:
+ *  - 1 keep the fds of the sysfs nodes, read again with pread at offset 0
+ *  - 2 hit, miss and latency counters of the sysfs access
+ *  - 3 the count and latency of every node in the metrics
+ */
+
+#define LOG_TAG "SystemControl"
+//#define LOG_NDEBUG 0
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+
+#include "SysfsCache.h"
+#include "Metrics.h"
+#include "common.h"
+
+//the metric of the node is not resolved yet
+#define METRIC_UNRESOLVED       -2
+
+static int64_t nowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+//FNV-1a
+static uint32_t pathHash(const char *path) {
+    uint32_t hash = 2166136261u;
+    while (*path) {
+        hash ^= (uint8_t)*path++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+//the cached fd is gone with the node, any other error is the answer of the driver
+static bool isFdGone(int err) {
+    return err == ENODEV || err == ENOENT || err == ESTALE || err == EBADF;
+}
+
+static int sysOpen(const char *path, int flags) {
+    return open(path, flags);
+}
+
+static const sysfs_ops_t SYS_OPS = { sysOpen, pread, pwrite };
+
+SysfsCache *SysfsCache::getInstance() {
+    static SysfsCache instance;
+    return &instance;
+}
+
+SysfsCache::SysfsCache()
+    :mEnable(true),
+    mOps(&SYS_OPS),
+    mClock(0) {
+    pthread_mutex_init(&mLock, NULL);
+    strcpy(mPrefix, "/sys/");
+    memset(&mStats, 0, sizeof(mStats));
+    for (int i = 0; i < SYSFS_CACHE_NODES; i++) {
+        mNodes[i].path[0] = 0;
+        mNodes[i].hash = 0;
+        mNodes[i].readFd = -1;
+        mNodes[i].writeFd = -1;
+        mNodes[i].metrics[0] = METRIC_UNRESOLVED;
+        mNodes[i].metrics[1] = METRIC_UNRESOLVED;
+        mNodes[i].refs = 0;
+        mNodes[i].lastUse = 0;
+        pthread_mutex_init(&mNodes[i].lock, NULL);
+    }
+    mOtherMetrics[0] = metrics_id("sysfs.read.other");
+    mOtherMetrics[1] = metrics_id("sysfs.write.other");
+}
+
+SysfsCache::~SysfsCache() {
+    for (int i = 0; i < SYSFS_CACHE_NODES; i++) {
+        closeNode(&mNodes[i]);
+        pthread_mutex_destroy(&mNodes[i].lock);
+    }
+    pthread_mutex_destroy(&mLock);
+}
+
+//with mLock, or when the node is not pinned
+void SysfsCache::closeNode(Node *node) {
+    if (node->readFd >= 0) {
+        close(node->readFd);
+        node->readFd = -1;
+        mStats.opened--;
+    }
+    if (node->writeFd >= 0) {
+        close(node->writeFd);
+        node->writeFd = -1;
+        mStats.opened--;
+    }
+    node->path[0] = 0;
+}
+
+//find the node of the path or take the least recently used one, NULL if all are busy
+SysfsCache::Node *SysfsCache::pin(const char *path, const sysfs_ops_t **ops) {
+    uint32_t hash = pathHash(path);
+    Node *node = NULL;
+
+    pthread_mutex_lock(&mLock);
+    *ops = mOps;
+    if (!mEnable || strncmp(path, mPrefix, strlen(mPrefix))
+        || strlen(path) >= SYSFS_CACHE_PATH_LEN) {
+        pthread_mutex_unlock(&mLock);
+        return NULL;
+    }
+
+    for (int i = 0; i < SYSFS_CACHE_NODES; i++) {
+        if (mNodes[i].hash == hash && !strcmp(mNodes[i].path, path)) {
+            node = &mNodes[i];
+            break;
+        }
+    }
+
+    if (node == NULL) {
+        for (int i = 0; i < SYSFS_CACHE_NODES; i++) {
+            if (mNodes[i].refs == 0 && (node == NULL || mNodes[i].lastUse < node->lastUse))
+                node = &mNodes[i];
+        }
+        if (node != NULL) {
+            closeNode(node);
+            strcpy(node->path, path);
+            node->hash = hash;
+            node->metrics[0] = METRIC_UNRESOLVED;
+            node->metrics[1] = METRIC_UNRESOLVED;
+        }
+    }
+
+    if (node != NULL) {
+        node->refs++;
+        node->lastUse = ++mClock;
+    }
+    pthread_mutex_unlock(&mLock);
+    return node;
+}
+
+void SysfsCache::unpin(Node *node) {
+    pthread_mutex_lock(&mLock);
+    node->refs--;
+    if (!mEnable && node->refs == 0)
+        closeNode(node);
+    pthread_mutex_unlock(&mLock);
+}
+
+//with the lock of the node, a path has its own metric while the registry has room
+int SysfsCache::nodeMetric(Node *node, bool isWrite) {
+    int *metric = &node->metrics[isWrite?1:0];
+    if (*metric == METRIC_UNRESOLVED) {
+        char name[METRICS_NAME_LEN];
+        snprintf(name, sizeof(name), "sysfs.%s.%s", isWrite?"write":"read", node->path);
+        *metric = metrics_id_limited(name);
+        if (*metric < 0)
+            *metric = mOtherMetrics[isWrite?1:0];
+    }
+    return *metric;
+}
+
+void SysfsCache::count(int metric, bool isWrite, int64_t startUs, int syscalls, bool hit, bool failed) {
+    int64_t us = nowUs() - startUs;
+    metrics_trace_end(metric);
+    metrics_record(metric, us);
+
+    pthread_mutex_lock(&mLock);
+    if (isWrite) {
+        mStats.writes++;
+        mStats.writeUs += us;
+        if (us > mStats.maxWriteUs)
+            mStats.maxWriteUs = us;
+    } else {
+        mStats.reads++;
+        mStats.readUs += us;
+        if (us > mStats.maxReadUs)
+            mStats.maxReadUs = us;
+    }
+
+    if (hit)
+        mStats.hits++;
+    else
+        mStats.misses++;
+    if (failed)
+        mStats.errors++;
+    mStats.syscalls += syscalls;
+    pthread_mutex_unlock(&mLock);
+}
+
+//the node is not kept, open, read or write, close
+int SysfsCache::transferOnce(const sysfs_ops_t *ops, const char *path, bool isWrite,
+        char *buf, int len, int *syscalls) {
+    int fd = ops->open(path, isWrite?O_WRONLY:O_RDONLY);
+    (*syscalls)++;
+    if (fd < 0) {
+        SYS_LOGE("%s sysfs, open %s fail: %s\n", isWrite?"write":"read", path, strerror(errno));
+        return -1;
+    }
+
+    int ret = isWrite ? ops->pwrite(fd, buf, len, 0) : ops->pread(fd, buf, len, 0);
+    if (ret < 0)
+        SYS_LOGE("%s error: %s, %s\n", isWrite?"write":"read", path, strerror(errno));
+
+    close(fd);
+    *syscalls += 2;
+    return ret;
+}
+
+int SysfsCache::transfer(const char *path, bool isWrite, char *buf, int len) {
+    int64_t start = nowUs();
+    int syscalls = 0;
+    int ret = -1;
+    const sysfs_ops_t *ops;
+
+    Node *node = pin(path, &ops);
+    if (node == NULL) {
+        int metric = mOtherMetrics[isWrite?1:0];
+        metrics_trace_begin(metric);
+        ret = transferOnce(ops, path, isWrite, buf, len, &syscalls);
+        count(metric, isWrite, start, syscalls, false, ret < 0);
+        return ret;
+    }
+
+    pthread_mutex_lock(&node->lock);
+    int metric = nodeMetric(node, isWrite);
+    metrics_trace_begin(metric);
+    int *fd = isWrite?&node->writeFd:&node->readFd;
+    bool hit = (*fd >= 0);
+    //a cached fd fail if the node is removed and added again, open it once more.
+    //a value the driver refuse is not written twice
+    for (int retry = 0; retry < (hit?2:1) && ret < 0; retry++) {
+        if (*fd < 0) {
+            *fd = ops->open(path, isWrite?O_WRONLY:O_RDONLY);
+            syscalls++;
+            if (*fd < 0) {
+                SYS_LOGE("%s sysfs, open %s fail: %s\n", isWrite?"write":"read", path, strerror(errno));
+                break;
+            }
+            pthread_mutex_lock(&mLock);
+            mStats.opened++;
+            pthread_mutex_unlock(&mLock);
+        }
+
+        ret = isWrite ? ops->pwrite(*fd, buf, len, 0) : ops->pread(*fd, buf, len, 0);
+        syscalls++;
+        if (ret < 0) {
+            int err = errno;
+            SYS_LOGE("%s error: %s, %s\n", isWrite?"write":"read", path, strerror(err));
+            if (!isFdGone(err))
+                break;
+            close(*fd);
+            *fd = -1;
+            syscalls++;
+            pthread_mutex_lock(&mLock);
+            mStats.opened--;
+            pthread_mutex_unlock(&mLock);
+        }
+    }
+    pthread_mutex_unlock(&node->lock);
+
+    unpin(node);
+    count(metric, isWrite, start, syscalls, hit, ret < 0);
+    return ret;
+}
+
+int SysfsCache::read(const char *path, char *buf, int count) {
+    return transfer(path, false, buf, count);
+}
+
+int SysfsCache::write(const char *path, const char *val, int len) {
+    return transfer(path, true, (char *)val, len);
+}
+
+void SysfsCache::setEnable(bool enable) {
+    pthread_mutex_lock(&mLock);
+    mEnable = enable;
+    if (!enable) {
+        for (int i = 0; i < SYSFS_CACHE_NODES; i++) {
+            if (mNodes[i].refs == 0)
+                closeNode(&mNodes[i]);
+        }
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+void SysfsCache::setPrefix(const char *prefix) {
+    pthread_mutex_lock(&mLock);
+    strncpy(mPrefix, prefix, SYSFS_CACHE_PATH_LEN - 1);
+    mPrefix[SYSFS_CACHE_PATH_LEN - 1] = 0;
+    for (int i = 0; i < SYSFS_CACHE_NODES; i++) {
+        if (mNodes[i].refs == 0)
+            closeNode(&mNodes[i]);
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+void SysfsCache::setOps(const sysfs_ops_t *ops) {
+    pthread_mutex_lock(&mLock);
+    mOps = (ops != NULL)?ops:&SYS_OPS;
+    for (int i = 0; i < SYSFS_CACHE_NODES; i++) {
+        if (mNodes[i].refs == 0)
+            closeNode(&mNodes[i]);
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+void SysfsCache::reset() {
+    pthread_mutex_lock(&mLock);
+    for (int i = 0; i < SYSFS_CACHE_NODES; i++) {
+        if (mNodes[i].refs == 0)
+            closeNode(&mNodes[i]);
+    }
+    int opened = mStats.opened;
+    memset(&mStats, 0, sizeof(mStats));
+    mStats.opened = opened;
+    pthread_mutex_unlock(&mLock);
+}
+
+void SysfsCache::getStats(sysfs_stats_t *stats) {
+    pthread_mutex_lock(&mLock);
+    *stats = mStats;
+    pthread_mutex_unlock(&mLock);
+}
+
+void SysfsCache::dump(char *result) {
+    sysfs_stats_t stats;
+    char buf[512] = {0};
+
+    getStats(&stats);
+    int64_t total = stats.reads + stats.writes;
+    sprintf(buf, "sysfs cache %s, prefix:%s, open nodes:%d\n"
+        "reads:%lld, writes:%lld, hits:%lld, misses:%lld, errors:%lld\n"
+        "syscalls per access:%.2f, read avg:%lldus max:%lldus, write avg:%lldus max:%lldus\n",
+        mEnable?"on":"off", mPrefix, stats.opened,
+        (long long)stats.reads, (long long)stats.writes, (long long)stats.hits,
+        (long long)stats.misses, (long long)stats.errors,
+        (total > 0)?(double)stats.syscalls/total:0.0,
+        (long long)((stats.reads > 0)?stats.readUs/stats.reads:0), (long long)stats.maxReadUs,
+        (long long)((stats.writes > 0)?stats.writeUs/stats.writes:0), (long long)stats.maxWriteUs);
+    strcat(result, buf);
+}
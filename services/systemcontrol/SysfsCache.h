@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/16
+ *  @par function description:
+ *  - 1 keep the fds of the sysfs nodes, read again with pread at offset 0
+ *  - 2 hit, miss and latency counters of the sysfs access
+ *  - 3 the syscalls of the access can be replaced, the host simulator has its own
+ */
+
+#ifndef SYSFS_CACHE_H
+#define SYSFS_CACHE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+//the nodes kept open, the least recently used one is closed
+#define SYSFS_CACHE_NODES       64
+#define SYSFS_CACHE_PATH_LEN    128
+
+typedef struct sysfs_stats {
+    int64_t reads;
+    int64_t writes;
+    int64_t hits;
+    int64_t misses;
+    int64_t errors;
+    //open, pread, pwrite and close done for the reads and writes
+    int64_t syscalls;
+    int64_t readUs;
+    int64_t writeUs;
+    int64_t maxReadUs;
+    int64_t maxWriteUs;
+    int opened;
+} sysfs_stats_t;
+
+//the syscalls of the node access, the display simulator on the host has its own
+typedef struct sysfs_ops {
+    int (*open)(const char *path, int flags);
+    ssize_t (*pread)(int fd, void *buf, size_t count, off_t offset);
+    ssize_t (*pwrite)(int fd, const void *buf, size_t count, off_t offset);
+} sysfs_ops_t;
+
+class SysfsCache
+{
+public:
+    static SysfsCache *getInstance();
+
+    //return the bytes read, or -1 if the node can not be read
+    int read(const char *path, char *buf, int count);
+    //return the bytes written, or -1 if the node can not be written
+    int write(const char *path, const char *val, int len);
+
+    //false close all the fds and open the node in every access
+    void setEnable(bool enable);
+    //only the nodes under prefix are kept open, default /sys/
+    void setPrefix(const char *prefix);
+    //NULL is the syscalls. set it before any access, the idle nodes are closed
+    void setOps(const sysfs_ops_t *ops);
+    //close all the fds and reset the counters
+    void reset();
+
+    void getStats(sysfs_stats_t *stats);
+    void dump(char *result);
+
+private:
+    struct Node {
+        char path[SYSFS_CACHE_PATH_LEN];
+        uint32_t hash;
+        int readFd;
+        int writeFd;
+        //the metric ids of the read and the write, resolved in the first access
+        int metrics[2];
+        //accesses in flight, the node is not closed or reused
+        int refs;
+        int64_t lastUse;
+        //one access of the node at a time, sysfs do the same
+        pthread_mutex_t lock;
+    };
+
+    SysfsCache();
+    ~SysfsCache();
+
+    int transfer(const char *path, bool isWrite, char *buf, int len);
+    int transferOnce(const sysfs_ops_t *ops, const char *path, bool isWrite,
+        char *buf, int len, int *syscalls);
+    Node *pin(const char *path, const sysfs_ops_t **ops);
+    void unpin(Node *node);
+    void closeNode(Node *node);
+    int nodeMetric(Node *node, bool isWrite);
+    void count(int metric, bool isWrite, int64_t startUs, int syscalls, bool hit, bool failed);
+
+    pthread_mutex_t mLock;
+    bool mEnable;
+    char mPrefix[SYSFS_CACHE_PATH_LEN];
+    const sysfs_ops_t *mOps;
+    Node mNodes[SYSFS_CACHE_NODES];
+    //the read and the write of the paths not kept, one metric each
+    int mOtherMetrics[2];
+    int64_t mClock;
+    sysfs_stats_t mStats;
+};
+
+#endif // SYSFS_CACHE_H
@@ -36,6 +36,7 @@
 
 #include "SystemControl.h"
 #include "ubootenv.h"
+#include "SysfsCache.h"
 
 namespace android {
 
@@ -49,17 +50,53 @@ void SystemControl::instantiate(const char *cfgpath) {
     ALOGI("instantiate add system_control service result:%d", ret);
 }
 
+//by the transaction code, from IBinder::FIRST_CALL_TRANSACTION
+static const char *BINDER_METHOD_NAMES[BINDER_METHODS] = {
+    "getProperty", "getPropertyString", "getPropertyInt", "getPropertyLong",
+    "getPropertyBoolean", "setProperty", "readSysfs", "writeSysfs",
+    "getBootEnv", "setBootEnv", "getDroidDisplayInfo", "loopMountUnmount",
+    "setMboxOutputMode", "setOsdMouseMode", "setOsdMousePara", "setPosition",
+    "getPosition", "reInit", "setNativeWindowRect", "setVideoPlayingAxis",
+    "setPowerMode", "instabootResetDisplay", "setDigitalMode", "set3DMode",
+    "setListener", "init3DSetting", "getVideo3DFormat", "getDisplay3DTo2DFormat",
+    "setDisplay3DTo2DFormat", "setDisplay3DFormat", "getDisplay3DFormat", "setOsd3DFormatHolder",
+    "setOsd3DFormat", "switch3DTo2D", "switch2DTo3D", "autoDetect3DForMbox",
+    "getProperties", "readSysfsBatch", "writeSysfsBatch"
+};
+
+//the bootenv partition read and the edid read run together, the display wait both
 SystemControl::SystemControl(const char *path)
-    : mLogLevel(LOG_LEVEL_DEFAULT) {
-
-    bootenv_init();
+    : mLogLevel(LOG_LEVEL_DEFAULT),
+    mBootInit(PROP_BOOT_INIT_PREFIX),
+    pConfigPath(path),
+    pDisplayMode(NULL),
+    pDimension(NULL) {
 
     pSysWrite = new SysWrite();
 
-    pDisplayMode = new DisplayMode(path);
-    pDisplayMode->init();
+    char name[METRICS_NAME_LEN];
+    for (int i = 0; i < BINDER_METHODS; i++) {
+        snprintf(name, sizeof(name), "binder.%s", BINDER_METHOD_NAMES[i]);
+        mBinderMetrics[i] = metrics_id(name);
+    }
+    mBinderOtherMetric = metrics_id("binder.other");
+    metrics_set_trace(pSysWrite->getPropertyBoolean(PROP_METRICS_TRACE, false));
+    bootenv_set_flush_listener(onBootenvFlush);
+
+    mBootInit.addStage("bootenv", bootenvStage, this, 0);
+    mBootInit.addStage("config", configStage, this, 0);
+    mBootInit.addStage("edid", edidStage, this, 1 << BOOT_STAGE_CONFIG);
+    mBootInit.addStage("display", displayStage, this,
+        (1 << BOOT_STAGE_BOOTENV) | (1 << BOOT_STAGE_CONFIG) | (1 << BOOT_STAGE_EDID));
+    mBootInit.addStage("dimension", dimensionStage, this, 1 << BOOT_STAGE_DISPLAY);
+    mBootInit.start();
+}
 
-    pDimension = new Dimension(pDisplayMode, pSysWrite);
+int SystemControl::bootenvStage(void *data) {
+    (void)data;
+    int ret = bootenv_init();
+    //mode switch write the env several times, write them together
+    bootenv_set_flush_delay(BOOTENV_FLUSH_DELAY_MS);
 
     //if ro.firstboot is true, we should clear first boot flag
     const char* firstBoot = bootenv_get("ubootenv.var.firstboot");
@@ -69,9 +106,62 @@ SystemControl::SystemControl(const char *path)
             ALOGE("set firstboot to 0 fail");
         }
     }
+    return ret;
+}
+
+int SystemControl::configStage(void *data) {
+    SystemControl *pThiz = (SystemControl *)data;
+    pThiz->pDisplayMode = new DisplayMode(pThiz->pConfigPath);
+    pThiz->pDisplayMode->initConfig();
+    return 0;
+}
+
+int SystemControl::edidStage(void *data) {
+    SystemControl *pThiz = (SystemControl *)data;
+    pThiz->pDisplayMode->prefetchEdid();
+    return 0;
+}
+
+int SystemControl::displayStage(void *data) {
+    SystemControl *pThiz = (SystemControl *)data;
+    pThiz->pDisplayMode->initDisplay();
+    return 0;
+}
+
+int SystemControl::dimensionStage(void *data) {
+    SystemControl *pThiz = (SystemControl *)data;
+    pThiz->pDimension = new Dimension(pThiz->pDisplayMode, pThiz->pSysWrite);
+    return 0;
+}
+
+void SystemControl::onBootenvFlush(int result, int64_t us) {
+    static int written = metrics_id("bootenv.flush");
+    static int same = metrics_id("bootenv.flush_same");
+    static int failed = metrics_id("bootenv.flush_fail");
+
+    if (result < 0)
+        metrics_record(failed, us);
+    else
+        metrics_record((0 == result)?written:same, us);
+}
+
+status_t SystemControl::onTransact(uint32_t code, const Parcel& data, Parcel* reply, uint32_t flags) {
+    int method = code - IBinder::FIRST_CALL_TRANSACTION;
+    MetricsScope scope((method >= 0 && method < BINDER_METHODS)?mBinderMetrics[method]:mBinderOtherMetric);
+    return BnISystemControlService::onTransact(code, data, reply, flags);
+}
+
+//the service is published before the boot init is done, a call wait the stage it need
+bool SystemControl::waitBoot(int stage) {
+    if (mBootInit.wait(stage, BOOT_INIT_WAIT_MS))
+        return true;
+
+    ALOGE("boot init stage %d is not done in %dms", stage, BOOT_INIT_WAIT_MS);
+    return false;
 }
 
 SystemControl::~SystemControl() {
+    mBootInit.wait(-1, -1);
     delete pSysWrite;
     delete pDisplayMode;
     delete pDimension;
@@ -83,8 +173,14 @@ int SystemControl::permissionCheck() {
     const int pid = ipc->getCallingPid();
     const int uid = ipc->getCallingUid();
 
-    if ((uid != AID_GRAPHICS) && (uid != AID_MEDIA) &&
-            !PermissionCache::checkPermission(String16("droidlogic.permission.SYSTEM_CONTROL"), pid, uid)) {
+    int granted = mCallerCache.getPermission(pid, uid);
+    if (granted < 0) {
+        granted = ((uid == AID_GRAPHICS) || (uid == AID_MEDIA) ||
+            PermissionCache::checkPermission(String16("droidlogic.permission.SYSTEM_CONTROL"), pid, uid))?1:0;
+        mCallerCache.setPermission(pid, uid, granted);
+    }
+
+    if (!granted) {
         ALOGE("Permission Denial: "
                 "can't use system control service pid=%d, uid=%d", pid, uid);
         return PERMISSION_DENIED;
@@ -155,8 +251,72 @@ bool SystemControl::writeSysfs(const String16& path, const String16& value) {
     return false;
 }
 
+//one permission check and trace for the whole batch
+int32_t SystemControl::getProperties(const Vector<String16>& keys,
+        Vector<String16>& values, Vector<int32_t>& status) {
+    int32_t count = 0;
+
+    values.clear();
+    status.clear();
+    for (size_t i = 0; i < keys.size(); i++) {
+        char buf[PROPERTY_VALUE_MAX] = {0};
+        pSysWrite->getProperty(String8(keys[i]).string(), buf);
+        values.push_back(String16(buf));
+        status.push_back((buf[0] != 0)?1:0);
+        if (buf[0] != 0)
+            count++;
+    }
+    return count;
+}
+
+int32_t SystemControl::readSysfsBatch(const Vector<String16>& paths,
+        Vector<String16>& values, Vector<int32_t>& status) {
+    if (NO_ERROR != permissionCheck())
+        return -1;
+
+    if (paths.size() > 0)
+        traceValue(String16("readSysfsBatch"), paths[0],
+            String16(String8::format("%d nodes", (int)paths.size())));
+
+    int32_t count = 0;
+    values.clear();
+    status.clear();
+    for (size_t i = 0; i < paths.size(); i++) {
+        char buf[MAX_STR_LEN + 1] = {0};
+        bool ret = pSysWrite->readSysfs(String8(paths[i]).string(), buf);
+        values.push_back(String16(buf));
+        status.push_back(ret?1:0);
+        if (ret)
+            count++;
+    }
+    return count;
+}
+
+int32_t SystemControl::writeSysfsBatch(const Vector<String16>& paths,
+        const Vector<String16>& values, Vector<int32_t>& status) {
+    if (NO_ERROR != permissionCheck())
+        return -1;
+
+    if (paths.size() > 0)
+        traceValue(String16("writeSysfsBatch"), paths[0],
+            String16(String8::format("%d nodes", (int)paths.size())));
+
+    int32_t count = 0;
+    status.clear();
+    for (size_t i = 0; i < paths.size() && i < values.size(); i++) {
+        bool ret = pSysWrite->writeSysfs(String8(paths[i]).string(), String8(values[i]).string());
+        status.push_back(ret?1:0);
+        if (ret)
+            count++;
+    }
+    return count;
+}
+
 //set or get uboot env
 bool SystemControl::getBootEnv(const String16& key, String16& value) {
+    if (!waitBoot(BOOT_STAGE_BOOTENV))
+        return false;
+
     const char* p_value = bootenv_get(String8(key).string());
 	if (p_value) {
         value.setTo(String16(p_value));
@@ -166,8 +326,10 @@ bool SystemControl::getBootEnv(const String16& key, String16& value) {
 }
 
 void SystemControl::setBootEnv(const String16& key, const String16& value) {
-    if (NO_ERROR == permissionCheck()) {
+    if (NO_ERROR == permissionCheck() && waitBoot(BOOT_STAGE_BOOTENV)) {
+        //the caller may reboot right after, write it before return
         bootenv_update(String8(key).string(), String8(value).string());
+        bootenv_commit();
         traceValue(String16("setBootEnv"), key, value);
     }
 }
@@ -175,7 +337,7 @@ void SystemControl::setBootEnv(const String16& key, const String16& value) {
 void SystemControl::getDroidDisplayInfo(int &type, String16& socType, String16& defaultUI,
         int &fb0w, int &fb0h, int &fb0bits, int &fb0trip,
         int &fb1w, int &fb1h, int &fb1bits, int &fb1trip) {
-    if (NO_ERROR == permissionCheck()) {
+    if (NO_ERROR == permissionCheck() && waitBoot(BOOT_STAGE_CONFIG)) {
         char bufType[MAX_STR_LEN] = {0};
         char bufUI[MAX_STR_LEN] = {0};
         pDisplayMode->getDisplayInfo(type, bufType, bufUI);
@@ -209,6 +371,9 @@ void SystemControl::setMboxOutputMode(const String16& mode) {
         ALOGI("set output mode :%s", String8(mode).string());
     }
 
+    if (!waitBoot(BOOT_STAGE_DISPLAY))
+        return;
+
     pDisplayMode->setMboxOutputMode(String8(mode).string());
 }
 
@@ -217,6 +382,9 @@ int32_t SystemControl::set3DMode(const String16& mode3d) {
         ALOGI("set 3d mode :%s", String8(mode3d).string());
     }
 
+    if (!waitBoot(BOOT_STAGE_DIMENSION))
+        return -1;
+
     return pDimension->set3DMode(String8(mode3d).string());
 }
 
@@ -225,6 +393,9 @@ void SystemControl::init3DSetting(void) {
         ALOGI("init3DSetting\n");
     }
 
+    if (!waitBoot(BOOT_STAGE_DIMENSION))
+        return;
+
     pDimension->init3DSetting();
 }
 
@@ -233,6 +404,9 @@ int32_t SystemControl::getVideo3DFormat(void) {
         ALOGI("getVideo3DFormat\n");
     }
 
+    if (!waitBoot(BOOT_STAGE_DIMENSION))
+        return -1;
+
     return pDimension->getVideo3DFormat();
 }
 
@@ -241,6 +415,9 @@ int32_t SystemControl::getDisplay3DTo2DFormat(void) {
         ALOGI("getDisplay3DTo2DFormat\n");
     }
 
+    if (!waitBoot(BOOT_STAGE_DIMENSION))
+        return -1;
+
     return pDimension->getDisplay3DTo2DFormat();
 }
 
@@ -250,6 +427,9 @@ bool SystemControl::setDisplay3DTo2DFormat(int format) {
         ALOGI("setDisplay3DTo2DFormat format:%d\n", format);
     }
 
+    if (!waitBoot(BOOT_STAGE_DIMENSION))
+        return false;
+
     return pDimension->setDisplay3DTo2DFormat(format);
 }
 
@@ -259,10 +439,16 @@ bool SystemControl::setDisplay3DFormat(int format) {
         ALOGI("setDisplay3DFormat format:%d\n", format);
     }
 
+    if (!waitBoot(BOOT_STAGE_DIMENSION))
+        return false;
+
     return pDimension->setDisplay3DFormat(format);
 }
 
 int32_t SystemControl::getDisplay3DFormat(void) {
+    if (!waitBoot(BOOT_STAGE_DIMENSION))
+        return -1;
+
     return pDimension->getDisplay3DFormat();
 }
 
@@ -271,6 +457,9 @@ bool SystemControl::setOsd3DFormat(int format) {
         ALOGI("setOsd3DFormat format:%d\n", format);
     }
 
+    if (!waitBoot(BOOT_STAGE_DIMENSION))
+        return false;
+
     return pDimension->setOsd3DFormat(format);
 }
 
@@ -279,6 +468,9 @@ bool SystemControl::switch3DTo2D(int format) {
         ALOGI("switch3DTo2D format:%d\n", format);
     }
 
+    if (!waitBoot(BOOT_STAGE_DIMENSION))
+        return false;
+
     return pDimension->switch3DTo2D(format);
 }
 
@@ -287,6 +479,9 @@ bool SystemControl::switch2DTo3D(int format) {
         ALOGI("switch2DTo3D format:%d\n", format);
     }
 
+    if (!waitBoot(BOOT_STAGE_DIMENSION))
+        return false;
+
     return pDimension->switch2DTo3D(format);
 }
 
@@ -295,6 +490,9 @@ void SystemControl::autoDetect3DForMbox() {
         ALOGI("autoDetect3DForMbox\n");
     }
 
+    if (!waitBoot(BOOT_STAGE_DIMENSION))
+        return;
+
     pDimension->autoDetect3DForMbox();
 }
 
@@ -303,10 +501,16 @@ void SystemControl::setDigitalMode(const String16& mode) {
         ALOGI("set Digital mode :%s", String8(mode).string());
     }
 
+    if (!waitBoot(BOOT_STAGE_DISPLAY))
+        return;
+
     pDisplayMode->setDigitalMode(String8(mode).string());
 }
 
 void SystemControl::setListener(const sp<ISystemControlNotify>& listener) {
+    if (!waitBoot(BOOT_STAGE_DISPLAY))
+        return;
+
     pDisplayMode->setListener(listener);
 }
 
@@ -315,6 +519,9 @@ void SystemControl::setOsdMouseMode(const String16& mode) {
         ALOGI("set osd mouse mode :%s", String8(mode).string());
     }
 
+    if (!waitBoot(BOOT_STAGE_DISPLAY))
+        return;
+
     pDisplayMode->setOsdMouse(String8(mode).string());
 }
 
@@ -322,6 +529,9 @@ void SystemControl::setOsdMousePara(int x, int y, int w, int h) {
     if (mLogLevel > LOG_LEVEL_1) {
         ALOGI("set osd mouse parameter x:%d y:%d w:%d h:%d", x, y, w, h);
     }
+    if (!waitBoot(BOOT_STAGE_DISPLAY))
+        return;
+
     pDisplayMode->setOsdMouse(x, y, w, h);
 }
 
@@ -329,12 +539,16 @@ void SystemControl::setPosition(int left, int top, int width, int height) {
     if (mLogLevel > LOG_LEVEL_1) {
         ALOGI("set position x:%d y:%d w:%d h:%d", left, top, width, height);
     }
+    if (!waitBoot(BOOT_STAGE_DISPLAY))
+        return;
+
     pDisplayMode->setPosition(left, top, width, height);
 }
 
 void SystemControl::getPosition(const String16& mode, int &x, int &y, int &w, int &h) {
     int position[4] = { 0, 0, 0, 0 };
-    pDisplayMode->getPosition(String8(mode).string(), position);
+    if (waitBoot(BOOT_STAGE_DISPLAY))
+        pDisplayMode->getPosition(String8(mode).string(), position);
     x = position[0];
     y = position[1];
     w = position[2];
@@ -345,10 +559,14 @@ void SystemControl::getPosition(const String16& mode, int &x, int &y, int &w, in
 }
 
 void SystemControl::reInit() {
-    bootenv_reinit();
+    if (waitBoot(BOOT_STAGE_BOOTENV))
+        bootenv_reinit();
 }
 
 void SystemControl::instabootResetDisplay() {
+    if (!waitBoot(BOOT_STAGE_DISPLAY))
+        return;
+
     pDisplayMode->reInit();
 }
 
@@ -357,6 +575,9 @@ void SystemControl::setNativeWindowRect(int x, int y, int w, int h) {
     if (mLogLevel > LOG_LEVEL_1) {
         ALOGI("set native window rect x:%d y:%d w:%d h:%d", x, y, w, h);
     }
+    if (!waitBoot(BOOT_STAGE_DISPLAY))
+        return;
+
     pDisplayMode->setNativeWindowRect(x, y, w, h);
 }
 
@@ -364,6 +585,9 @@ void SystemControl::setVideoPlayingAxis() {
     if (mLogLevel > LOG_LEVEL_1) {
         ALOGI("set video playing axis");
     }
+    if (!waitBoot(BOOT_STAGE_DISPLAY))
+        return;
+
     pDisplayMode->setVideoPlayingAxis();
 }
 
@@ -373,7 +597,7 @@ void SystemControl::traceValue(const String16& type, const String16& key, const
         int pid = IPCThreadState::self()->getCallingPid();
         int uid = IPCThreadState::self()->getCallingUid();
 
-        getProcName(pid, procName);
+        getProcName(pid, uid, procName);
 
         ALOGI("%s [ %s ] [ %s ] from pid=%d, uid=%d, process name=%s",
             String8(type).string(), String8(key).string(), String8(value).string(),
@@ -390,6 +614,9 @@ void SystemControl::setLogLevel(int level) {
 
     mLogLevel = level;
     pSysWrite->setLogLevel(level);
+    if (!waitBoot(BOOT_STAGE_DIMENSION))
+        return;
+
     pDisplayMode->setLogLevel(level);
     pDimension->setLogLevel(level);
 }
@@ -398,25 +625,13 @@ int SystemControl::getLogLevel() {
     return mLogLevel;
 }
 
-int SystemControl::getProcName(pid_t pid, String16& procName) {
-    char proc_path[MAX_STR_LEN];
-    char cmdline[64];
-    int fd;
-
-    strcpy(cmdline, "unknown");
+//cmdline is read once for a process, not in every traced call
+int SystemControl::getProcName(pid_t pid, uid_t uid, String16& procName) {
+    char cmdline[CALLER_NAME_LEN];
 
-    sprintf(proc_path, "/proc/%d/cmdline", pid);
-    fd = open(proc_path, O_RDONLY);
-    if (fd >= 0) {
-        int rc = read(fd, cmdline, sizeof(cmdline)-1);
-        cmdline[rc] = 0;
-        close(fd);
-
-        procName.setTo(String16(cmdline));
-        return 0;
-    }
-
-    return -1;
+    int ret = mCallerCache.getProcName(pid, uid, cmdline, sizeof(cmdline));
+    procName.setTo(String16(cmdline));
+    return ret;
 }
 
 status_t SystemControl::dump(int fd, const Vector<String16>& args) {
@@ -439,6 +654,11 @@ status_t SystemControl::dump(int fd, const Vector<String16>& args) {
             String16 display("-d");
             String16 dimension("-dms");
             String16 hdcp("-hdcp");
+            String16 sysfs("-s");
+            String16 caller("-c");
+            String16 plan("-p");
+            String16 boot("-boot");
+            String16 metrics("-m");
             String16 help("-h");
             if (args[i] == debugLevel) {
                 if (i + 1 < len) {
@@ -460,7 +680,21 @@ status_t SystemControl::dump(int fd, const Vector<String16>& args) {
                 }
                 else if (((i + 2) <= len) && (args[i + 1] == String16("get"))) {
                     if ((i + 2) == len) {
+                        if (!waitBoot(BOOT_STAGE_BOOTENV)) {
+                            result.appendFormat("bootenv is not loaded\n");
+                            break;
+                        }
+                        int updates, writes, pending;
+                        bootenv_get_stats(&updates, &writes, &pending);
                         result.appendFormat("get all bootenv\n");
+                        result.appendFormat("bootenv updates:%d, writes:%d, pending:%d\n",
+                            updates, writes, pending);
+                        int64_t bytes;
+                        int skipped, redundant;
+                        uint32_t seq;
+                        bootenv_get_write_stats(&bytes, &skipped, &seq, &redundant);
+                        result.appendFormat("bootenv written bytes:%lld, skipped:%d, %s seq:%u\n",
+                            (long long)bytes, skipped, redundant?"A/B":"single", seq);
                         bootenv_print();
                     }
                     else {
@@ -472,10 +706,18 @@ status_t SystemControl::dump(int fd, const Vector<String16>& args) {
                     }
                     break;
                 }
+                else if (((i + 2) == len) && (args[i + 1] == String16("commit"))) {
+                    if (waitBoot(BOOT_STAGE_BOOTENV))
+                        result.appendFormat("commit bootenv result:%d\n", bootenv_commit());
+                    else
+                        result.appendFormat("bootenv is not loaded\n");
+                    break;
+                }
                 else {
                     result.appendFormat(
                         "dump bootenv format error!! should use:\n"
-                        "dumpsys system_control -b [set |get] key value \n");
+                        "dumpsys system_control -b [set |get] key value \n"
+                        "dumpsys system_control -b commit \n");
                 }
             }
             else if (args[i] == display) {
@@ -484,19 +726,87 @@ status_t SystemControl::dump(int fd, const Vector<String16>& args) {
                 pDisplayMode->dump(displayInfo);
                 result.append(displayInfo);*/
 
-                char buf[4096] = {0};
-                pDisplayMode->dump(buf);
+                char buf[8192] = {0};
+                if (waitBoot(BOOT_STAGE_DISPLAY))
+                    pDisplayMode->dump(buf);
                 result.append(String8(buf));
                 break;
             }
             else if (args[i] == dimension) {
                 char buf[4096] = {0};
-                pDimension->dump(buf);
+                if (waitBoot(BOOT_STAGE_DIMENSION))
+                    pDimension->dump(buf);
+                result.append(String8(buf));
+                break;
+            }
+            else if (args[i] == sysfs) {
+                if (((i + 2) == len) && (args[i + 1] == String16("reset"))) {
+                    SysfsCache::getInstance()->reset();
+                    result.appendFormat("reset sysfs cache\n");
+                }
+                else if (((i + 2) == len) && (args[i + 1] == String16("off"))) {
+                    SysfsCache::getInstance()->setEnable(false);
+                }
+                else if (((i + 2) == len) && (args[i + 1] == String16("on"))) {
+                    SysfsCache::getInstance()->setEnable(true);
+                }
+
+                char buf[1024] = {0};
+                SysfsCache::getInstance()->dump(buf);
+                result.append(String8(buf));
+                break;
+            }
+            else if (args[i] == caller) {
+                char buf[8192] = {0};
+                mCallerCache.dump(buf);
                 result.append(String8(buf));
                 break;
             }
+            else if (args[i] == plan) {
+                if (i + 1 < len && waitBoot(BOOT_STAGE_DISPLAY)) {
+                    char buf[4096] = {0};
+                    pDisplayMode->planMboxOutputMode(String8(args[i+1]).string(), buf);
+                    result.append(String8(buf));
+                } else {
+                    result.appendFormat("dumpsys system_control -p outputmode \n");
+                }
+                break;
+            }
             else if (args[i] == hdcp) {
-                pDisplayMode->hdcpSwitch();
+                if (waitBoot(BOOT_STAGE_DISPLAY))
+                    pDisplayMode->hdcpSwitch();
+                break;
+            }
+            else if (args[i] == boot) {
+                char buf[2048] = {0};
+                mBootInit.dump(buf);
+                result.append(String8(buf));
+                break;
+            }
+            else if (args[i] == metrics) {
+                int format = METRICS_DUMP_TEXT;
+                if (((i + 2) == len) && (args[i + 1] == String16("reset"))) {
+                    metrics_reset();
+                    result.appendFormat("reset metrics\n");
+                    break;
+                }
+                else if (((i + 3) == len) && (args[i + 1] == String16("trace"))) {
+                    metrics_set_trace(args[i + 2] == String16("on"));
+                    result.appendFormat("metrics trace %s\n", metrics_get_trace()?"on":"off");
+                    break;
+                }
+                else if (((i + 2) == len) && (args[i + 1] == String16("kv"))) {
+                    format = METRICS_DUMP_KV;
+                }
+                else if (((i + 2) == len) && (args[i + 1] == String16("json"))) {
+                    format = METRICS_DUMP_JSON;
+                }
+
+                char *buf = new char[METRICS_DUMP_SIZE];
+                buf[0] = 0;
+                metrics_dump(buf, METRICS_DUMP_SIZE, format);
+                result.append(String8(buf));
+                delete[] buf;
                 break;
             }
             else if (args[i] == help) {
@@ -507,8 +817,14 @@ status_t SystemControl::dump(int fd, const Vector<String16>& args) {
                     "dumpsys system_control -l value \n"
                     "dumpsys system_control -b [set |get] key value \n"
                     "-l: debug level \n"
-                    "-b: set or get bootenv \n"
+                    "-b: set or get bootenv, commit write the pending bootenv \n"
                     "-d: dump display mode info \n"
+                    "-s [reset |on |off]: dump sysfs access counters, reset them or switch the fd cache \n"
+                    "-c: dump permission and process name cache of the callers \n"
+                    "-p outputmode: dry run, print the steps and cost of the switch to outputmode \n"
+                    "-boot: dump the time of the boot init stages \n"
+                    "-m [kv |json |reset |trace on|off]: dump the counters and latency of the binder methods, \n"
+                    "    sysfs nodes, bootenv flush, hdcp and uevent handlers, reset them or switch the atrace \n"
                     "-hdcp: stop hdcp and start hdcp tx \n"
                     "-h: help \n");
             }
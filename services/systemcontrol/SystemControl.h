@@ -29,12 +29,34 @@
 #include <ISystemControlService.h>
 
 #include "SysWrite.h"
+#include "CallerCache.h"
+#include "BootInit.h"
+#include "Metrics.h"
 #include "common.h"
 #include "DisplayMode.h"
 #include "Dimension.h"
 
 extern "C" int vdc_loop(int argc, char **argv);
 
+//the time of the boot init stages in ms, sys.scboot.display
+#define PROP_BOOT_INIT_PREFIX   "sys.scboot."
+//a call wait the boot init stage it need at most this time
+#define BOOT_INIT_WAIT_MS       10000
+//1 emit the atrace markers of the metrics, it can be switched with dumpsys -m trace
+#define PROP_METRICS_TRACE      "persist.sys.sc.trace"
+//the binder methods timed by their transaction code
+#define BINDER_METHODS          (WRITE_SYSFS_BATCH - IBinder::FIRST_CALL_TRANSACTION + 1)
+#define METRICS_DUMP_SIZE       (64*1024)
+
+//the boot init stages, in the order they are added
+enum {
+    BOOT_STAGE_BOOTENV          = 0,
+    BOOT_STAGE_CONFIG           = 1,
+    BOOT_STAGE_EDID             = 2,
+    BOOT_STAGE_DISPLAY          = 3,
+    BOOT_STAGE_DIMENSION        = 4
+};
+
 namespace android {
 // ----------------------------------------------------------------------------
 
@@ -87,9 +109,18 @@ public:
     virtual bool switch2DTo3D(int format);
     virtual void autoDetect3DForMbox();
 
+    virtual int32_t getProperties(const Vector<String16>& keys,
+        Vector<String16>& values, Vector<int32_t>& status);
+    virtual int32_t readSysfsBatch(const Vector<String16>& paths,
+        Vector<String16>& values, Vector<int32_t>& status);
+    virtual int32_t writeSysfsBatch(const Vector<String16>& paths,
+        const Vector<String16>& values, Vector<int32_t>& status);
+
     static void instantiate(const char *cfgpath);
 
     virtual status_t dump(int fd, const Vector<String16>& args);
+    //the count and latency of every method
+    virtual status_t onTransact(uint32_t code, const Parcel& data, Parcel* reply, uint32_t flags);
 
     int getLogLevel();
 
@@ -97,12 +128,25 @@ private:
     int permissionCheck();
     void setLogLevel(int level);
     void traceValue(const String16& type, const String16& key, const String16& value);
-    int getProcName(pid_t pid, String16& procName);
+    int getProcName(pid_t pid, uid_t uid, String16& procName);
+    bool waitBoot(int stage);
+
+    static int bootenvStage(void *data);
+    static int configStage(void *data);
+    static int edidStage(void *data);
+    static int displayStage(void *data);
+    static int dimensionStage(void *data);
+    static void onBootenvFlush(int result, int64_t us);
 
     mutable Mutex mLock;
 
     int mLogLevel;
+    CallerCache mCallerCache;
+    BootInit mBootInit;
+    int mBinderMetrics[BINDER_METHODS];
+    int mBinderOtherMetric;
 
+    const char *pConfigPath;
     SysWrite *pSysWrite;
     DisplayMode *pDisplayMode;
     Dimension *pDimension;
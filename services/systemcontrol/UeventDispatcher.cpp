@@ -0,0 +1,425 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/06/06
+ *  @par function description:
+ *  - 1 parse a kernel uevent once into the fields the handlers use
+ *  - 2 find the handlers of the DEVPATH in a hashed table
+ *  - 3 run the handlers in their own queue threads, the burst of a switch is coalesced
+ *  - 4 record the uevents as text lines for the replay tool
+ *  - 5 the wait and handle time of every handler in the metrics
+ */
+
+#define LOG_TAG "SystemControl"
+//#define LOG_NDEBUG 0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "UeventDispatcher.h"
+#include "Metrics.h"
+#include "common.h"
+
+static int64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static uint32_t pathHash(const char *path) {
+    uint32_t hash = 2166136261u;
+    while (*path != 0) {
+        hash ^= (uint8_t)*path++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void copyValue(char *dst, const char *src, int size) {
+    strncpy(dst, src, size - 1);
+    dst[size - 1] = 0;
+}
+
+void ueventParse(uevent_msg_t *msg, const char *buf, int len) {
+    memset(msg, 0, sizeof(uevent_msg_t));
+    if (len >= UEVENT_MSG_LEN)
+        len = UEVENT_MSG_LEN - 1;
+    if (len < 0)
+        len = 0;
+    memcpy(msg->buf, buf, len);
+    msg->buf[len] = 0;
+    msg->len = len;
+    msg->receivedUs = nowUs();
+
+    //change@/devices/virtual/switch/hdmi ACTION=change DEVPATH=/devices/virtual/switch/hdmi
+    //SUBSYSTEM=switch SWITCH_NAME=hdmi SWITCH_STATE=0 SEQNUM=2791
+    const char *field = msg->buf;
+    const char *end = msg->buf + len;
+    while (field < end) {
+        int fieldLen = strlen(field);
+        const char *value = strchr(field, '=');
+        if (value != NULL) {
+            int keyLen = value - field;
+            value++;
+            switch (field[0]) {
+                case 'A':
+                    if (keyLen == 6 && !strncmp(field, "ACTION", 6))
+                        copyValue(msg->action, value, sizeof(msg->action));
+                    break;
+                case 'D':
+                    if (keyLen == 7 && !strncmp(field, "DEVPATH", 7))
+                        copyValue(msg->devpath, value, sizeof(msg->devpath));
+                    break;
+                case 'S':
+                    if (keyLen == 9 && !strncmp(field, "SUBSYSTEM", 9))
+                        copyValue(msg->subsystem, value, sizeof(msg->subsystem));
+                    else if (keyLen == 11 && !strncmp(field, "SWITCH_NAME", 11))
+                        copyValue(msg->name, value, sizeof(msg->name));
+                    else if (keyLen == 12 && !strncmp(field, "SWITCH_STATE", 12))
+                        copyValue(msg->state, value, sizeof(msg->state));
+                    else if (keyLen == 6 && !strncmp(field, "SEQNUM", 6))
+                        msg->seqnum = strtoll(value, NULL, 10);
+                    break;
+            }
+        }
+        field += fieldLen + 1;
+    }
+}
+
+int ueventFromText(const char *line, char *buf, int size) {
+    int len = 0;
+    const char *pos = line;
+    while (*pos != 0 && *pos != '\n' && *pos != '\r' && len < size - 1) {
+        buf[len++] = (*pos == ' ')?0:*pos;
+        pos++;
+    }
+    buf[len] = 0;
+    return len;
+}
+
+UeventDispatcher::UeventDispatcher()
+    :mExit(false),
+    mHandlerCount(0),
+    mQueueCount(0),
+    mRecord(NULL) {
+    pthread_mutex_init(&mLock, NULL);
+    pthread_cond_init(&mIdleCond, NULL);
+    memset(mHandlers, 0, sizeof(mHandlers));
+    memset(&mStats, 0, sizeof(mStats));
+    for (int i = 0; i < UEVENT_TABLE_SIZE; i++)
+        mTable[i] = -1;
+}
+
+UeventDispatcher::~UeventDispatcher() {
+    stop();
+    if (mRecord != NULL)
+        fclose(mRecord);
+    pthread_cond_destroy(&mIdleCond);
+    pthread_mutex_destroy(&mLock);
+}
+
+int UeventDispatcher::addQueue(const char *name) {
+    pthread_mutex_lock(&mLock);
+    if (mQueueCount >= UEVENT_MAX_QUEUES) {
+        pthread_mutex_unlock(&mLock);
+        SYS_LOGE("uevent queue %s, too many queues\n", name);
+        return -1;
+    }
+
+    int id = mQueueCount;
+    Queue *queue = &mQueues[id];
+    memset(queue->name, 0, sizeof(queue->name));
+    copyValue(queue->name, name, UEVENT_NAME_LEN);
+    queue->owner = this;
+    queue->head = 0;
+    queue->count = 0;
+    queue->running = false;
+    pthread_cond_init(&queue->cond, NULL);
+    if (pthread_create(&queue->thread, NULL, queueLoop, queue) != 0) {
+        pthread_cond_destroy(&queue->cond);
+        pthread_mutex_unlock(&mLock);
+        SYS_LOGE("uevent queue %s, thread create failed\n", name);
+        return -1;
+    }
+    mQueueCount++;
+    pthread_mutex_unlock(&mLock);
+    return id;
+}
+
+int UeventDispatcher::add(const char *devpath, const char *subsystem, int queue, int flags,
+    uevent_handler_t handler, void *data, const char *name) {
+    pthread_mutex_lock(&mLock);
+    if (mHandlerCount >= UEVENT_MAX_HANDLERS || queue >= mQueueCount) {
+        pthread_mutex_unlock(&mLock);
+        SYS_LOGE("uevent handler %s can not be added\n", name);
+        return -1;
+    }
+
+    int id = mHandlerCount++;
+    Handler *h = &mHandlers[id];
+    memset(h, 0, sizeof(Handler));
+    copyValue(h->devpath, devpath, UEVENT_PATH_LEN);
+    if (subsystem != NULL)
+        copyValue(h->subsystem, subsystem, sizeof(h->subsystem));
+    copyValue(h->name, name, sizeof(h->name));
+    h->hash = pathHash(h->devpath);
+    h->queue = queue;
+    h->flags = flags;
+    h->handler = handler;
+    h->data = data;
+    char metric[METRICS_NAME_LEN];
+    snprintf(metric, sizeof(metric), "uevent.%s.wait", h->name);
+    h->waitMetric = metrics_id(metric);
+    snprintf(metric, sizeof(metric), "uevent.%s.handle", h->name);
+    h->handleMetric = metrics_id(metric);
+
+    //the handlers of a slot are kept in the order they are added
+    int slot = h->hash & (UEVENT_TABLE_SIZE - 1);
+    h->next = -1;
+    if (mTable[slot] < 0) {
+        mTable[slot] = id;
+    } else {
+        int last = mTable[slot];
+        while (mHandlers[last].next >= 0)
+            last = mHandlers[last].next;
+        mHandlers[last].next = id;
+    }
+    pthread_mutex_unlock(&mLock);
+    return id;
+}
+
+//with mLock
+void UeventDispatcher::enqueue(Queue *queue, int handler, const uevent_msg_t *msg) {
+    Handler *h = &mHandlers[handler];
+
+    //plug out and in again before the handler run, only the last state is handled
+    if (h->flags & UEVENT_COALESCE) {
+        for (int i = 0; i < queue->count; i++) {
+            Item *item = &queue->items[(queue->head + i) % UEVENT_QUEUE_LEN];
+            if (item->handler != handler)
+                continue;
+
+            //keep the order of the other events, the replaced one is moved to the tail
+            for (int j = i; j < queue->count - 1; j++) {
+                memcpy(&queue->items[(queue->head + j) % UEVENT_QUEUE_LEN],
+                    &queue->items[(queue->head + j + 1) % UEVENT_QUEUE_LEN], sizeof(Item));
+            }
+            queue->count--;
+            h->stats.coalesced++;
+            break;
+        }
+    }
+
+    if (queue->count >= UEVENT_QUEUE_LEN) {
+        Item *oldest = &queue->items[queue->head];
+        mHandlers[oldest->handler].stats.dropped++;
+        SYS_LOGE("uevent queue %s full, drop %s\n", queue->name, oldest->msg.devpath);
+        queue->head = (queue->head + 1) % UEVENT_QUEUE_LEN;
+        queue->count--;
+    }
+
+    Item *item = &queue->items[(queue->head + queue->count) % UEVENT_QUEUE_LEN];
+    item->handler = handler;
+    memcpy(&item->msg, msg, sizeof(uevent_msg_t));
+    queue->count++;
+    pthread_cond_signal(&queue->cond);
+}
+
+void UeventDispatcher::runHandler(int id, const uevent_msg_t *msg) {
+    Handler *h = &mHandlers[id];
+    int64_t start = nowUs();
+    metrics_trace_begin(h->handleMetric);
+    h->handler(msg, h->data);
+    metrics_trace_end(h->handleMetric);
+    int64_t end = nowUs();
+    metrics_record(h->waitMetric, start - msg->receivedUs);
+    metrics_record(h->handleMetric, end - start);
+
+    pthread_mutex_lock(&mLock);
+    h->stats.handled++;
+    if (start - msg->receivedUs > h->stats.maxWaitUs)
+        h->stats.maxWaitUs = start - msg->receivedUs;
+    h->stats.handleUs += end - start;
+    if (end - start > h->stats.maxHandleUs)
+        h->stats.maxHandleUs = end - start;
+    pthread_mutex_unlock(&mLock);
+}
+
+void *UeventDispatcher::queueLoop(void *data) {
+    Queue *queue = (Queue *)data;
+    UeventDispatcher *thiz = queue->owner;
+    Item item;
+
+    pthread_mutex_lock(&thiz->mLock);
+    while (true) {
+        while (queue->count == 0 && !thiz->mExit)
+            pthread_cond_wait(&queue->cond, &thiz->mLock);
+        if (thiz->mExit)
+            break;
+
+        memcpy(&item, &queue->items[queue->head], sizeof(Item));
+        queue->head = (queue->head + 1) % UEVENT_QUEUE_LEN;
+        queue->count--;
+        queue->running = true;
+        pthread_mutex_unlock(&thiz->mLock);
+
+        thiz->runHandler(item.handler, &item.msg);
+
+        pthread_mutex_lock(&thiz->mLock);
+        queue->running = false;
+        pthread_cond_broadcast(&thiz->mIdleCond);
+    }
+    pthread_mutex_unlock(&thiz->mLock);
+    return NULL;
+}
+
+int UeventDispatcher::dispatch(const char *buf, int len) {
+    uevent_msg_t msg;
+    int inlineHandlers[UEVENT_MAX_HANDLERS];
+    int inlineCount = 0;
+    int matched = 0;
+
+    ueventParse(&msg, buf, len);
+    uint32_t hash = pathHash(msg.devpath);
+
+    pthread_mutex_lock(&mLock);
+    mStats.events++;
+    for (int id = mTable[hash & (UEVENT_TABLE_SIZE - 1)]; id >= 0; id = mHandlers[id].next) {
+        Handler *h = &mHandlers[id];
+        if (h->hash != hash || strcmp(h->devpath, msg.devpath))
+            continue;
+        if (h->subsystem[0] != 0 && strcmp(h->subsystem, msg.subsystem))
+            continue;
+
+        h->stats.matched++;
+        matched++;
+        if (UEVENT_QUEUE_INLINE == h->queue)
+            inlineHandlers[inlineCount++] = id;
+        else
+            enqueue(&mQueues[h->queue], id, &msg);
+    }
+    if (matched == 0)
+        mStats.unmatched++;
+    mStats.parseUs += nowUs() - msg.receivedUs;
+    if (mRecord != NULL)
+        record(&msg);
+    pthread_mutex_unlock(&mLock);
+
+    for (int i = 0; i < inlineCount; i++)
+        runHandler(inlineHandlers[i], &msg);
+    return matched;
+}
+
+void UeventDispatcher::waitIdle() {
+    pthread_mutex_lock(&mLock);
+    while (true) {
+        bool idle = true;
+        for (int i = 0; i < mQueueCount; i++) {
+            if (mQueues[i].count > 0 || mQueues[i].running)
+                idle = false;
+        }
+        if (idle || mExit)
+            break;
+        pthread_cond_wait(&mIdleCond, &mLock);
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+void UeventDispatcher::stop() {
+    pthread_mutex_lock(&mLock);
+    if (mExit) {
+        pthread_mutex_unlock(&mLock);
+        return;
+    }
+    mExit = true;
+    for (int i = 0; i < mQueueCount; i++)
+        pthread_cond_signal(&mQueues[i].cond);
+    pthread_cond_broadcast(&mIdleCond);
+    pthread_mutex_unlock(&mLock);
+
+    for (int i = 0; i < mQueueCount; i++) {
+        pthread_join(mQueues[i].thread, NULL);
+        pthread_cond_destroy(&mQueues[i].cond);
+    }
+    mQueueCount = 0;
+}
+
+//with mLock
+void UeventDispatcher::record(const uevent_msg_t *msg) {
+    char line[UEVENT_MSG_LEN + 1];
+    for (int i = 0; i < msg->len; i++)
+        line[i] = (msg->buf[i] == 0)?' ':msg->buf[i];
+    line[msg->len] = 0;
+    fprintf(mRecord, "%s\n", line);
+    fflush(mRecord);
+}
+
+int UeventDispatcher::setRecordFile(const char *path) {
+    pthread_mutex_lock(&mLock);
+    if (mRecord != NULL) {
+        fclose(mRecord);
+        mRecord = NULL;
+    }
+    if (path != NULL && strlen(path) > 0) {
+        mRecord = fopen(path, "a");
+        if (mRecord == NULL)
+            SYS_LOGE("uevent record file %s open failed\n", path);
+    }
+    pthread_mutex_unlock(&mLock);
+    return (path == NULL || mRecord != NULL)?0:-1;
+}
+
+void UeventDispatcher::getStats(uevent_stats_t *stats) {
+    pthread_mutex_lock(&mLock);
+    *stats = mStats;
+    pthread_mutex_unlock(&mLock);
+}
+
+void UeventDispatcher::getHandlerStats(int id, uevent_handler_stats_t *stats) {
+    pthread_mutex_lock(&mLock);
+    if (id >= 0 && id < mHandlerCount)
+        *stats = mHandlers[id].stats;
+    else
+        memset(stats, 0, sizeof(uevent_handler_stats_t));
+    pthread_mutex_unlock(&mLock);
+}
+
+void UeventDispatcher::dump(char *result) {
+    char buf[256];
+
+    pthread_mutex_lock(&mLock);
+    sprintf(buf, "\nuevent: %lld events, %lld unmatched, parse and match avg %lldus%s\n",
+        (long long)mStats.events, (long long)mStats.unmatched,
+        (long long)((mStats.events > 0)?mStats.parseUs/mStats.events:0),
+        (mRecord != NULL)?", recording":"");
+    strcat(result, buf);
+
+    for (int i = 0; i < mHandlerCount; i++) {
+        const Handler *h = &mHandlers[i];
+        const char *queue = (UEVENT_QUEUE_INLINE == h->queue)?"inline":mQueues[h->queue].name;
+        sprintf(buf, "  %-16s queue:%-6s matched:%lld handled:%lld coalesced:%lld dropped:%lld "
+            "max wait:%lldus handle avg:%lldus max:%lldus\n",
+            h->name, queue, (long long)h->stats.matched, (long long)h->stats.handled,
+            (long long)h->stats.coalesced, (long long)h->stats.dropped,
+            (long long)h->stats.maxWaitUs,
+            (long long)((h->stats.handled > 0)?h->stats.handleUs/h->stats.handled:0),
+            (long long)h->stats.maxHandleUs);
+        strcat(result, buf);
+    }
+    pthread_mutex_unlock(&mLock);
+}
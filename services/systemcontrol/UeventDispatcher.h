@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/06/06
+ *  @par function description:
+ *  - 1 parse a kernel uevent once into the fields the handlers use
+ *  - 2 find the handlers of the DEVPATH in a hashed table
+ *  - 3 run the handlers in their own queue threads, the burst of a switch is coalesced
+ *  - 4 record the uevents as text lines for the replay tool
+ */
+
+#ifndef UEVENT_DISPATCHER_H
+#define UEVENT_DISPATCHER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define UEVENT_MSG_LEN          1024
+#define UEVENT_PATH_LEN         128
+#define UEVENT_VALUE_LEN        128
+#define UEVENT_MAX_HANDLERS     16
+//hash slots of the handlers by DEVPATH, power of 2
+#define UEVENT_TABLE_SIZE       32
+#define UEVENT_MAX_QUEUES       4
+#define UEVENT_QUEUE_LEN        16
+#define UEVENT_NAME_LEN         16
+
+//run the handler in the thread of dispatch, it must not block
+#define UEVENT_QUEUE_INLINE     -1
+
+//flags of a handler
+#define UEVENT_COALESCE         (1 << 0)    //a pending event of the handler is replaced by the new one
+
+typedef struct uevent_msg {
+    int len;
+    char buf[UEVENT_MSG_LEN];   //the raw fields, '\0' separated
+    char action[UEVENT_NAME_LEN];
+    char devpath[UEVENT_PATH_LEN];
+    char subsystem[UEVENT_NAME_LEN*2];
+    char name[UEVENT_VALUE_LEN];        //SWITCH_NAME
+    char state[UEVENT_VALUE_LEN];       //SWITCH_STATE
+    int64_t seqnum;
+    int64_t receivedUs;
+} uevent_msg_t;
+
+typedef void (*uevent_handler_t)(const uevent_msg_t *msg, void *data);
+
+typedef struct uevent_handler_stats {
+    int64_t matched;
+    int64_t handled;
+    int64_t coalesced;
+    int64_t dropped;            //the queue was full, the oldest event is dropped
+    int64_t maxWaitUs;          //received to the handler start
+    int64_t handleUs;
+    int64_t maxHandleUs;
+} uevent_handler_stats_t;
+
+typedef struct uevent_stats {
+    int64_t events;
+    int64_t unmatched;
+    int64_t parseUs;            //parse and table lookup of all the events
+} uevent_stats_t;
+
+//parse the '\0' separated fields of buf, len is the received length
+void ueventParse(uevent_msg_t *msg, const char *buf, int len);
+//a recorded line, the fields separated by ' ', to the '\0' separated form, return the length
+int ueventFromText(const char *line, char *buf, int size);
+
+class UeventDispatcher
+{
+public:
+    UeventDispatcher();
+    ~UeventDispatcher();
+
+    //a thread running the handlers in order, return the queue id or -1
+    int addQueue(const char *name);
+    //subsystem NULL match any one, return the handler id or -1
+    int add(const char *devpath, const char *subsystem, int queue, int flags,
+        uevent_handler_t handler, void *data, const char *name);
+
+    //return the number of the handlers the event is passed to
+    int dispatch(const char *buf, int len);
+    //wait until all the queues are empty and no handler is running
+    void waitIdle();
+    //exit and join the queue threads
+    void stop();
+
+    //append the events as text lines, NULL to stop
+    int setRecordFile(const char *path);
+
+    void getStats(uevent_stats_t *stats);
+    void getHandlerStats(int id, uevent_handler_stats_t *stats);
+    void dump(char *result);
+
+private:
+    struct Handler {
+        char devpath[UEVENT_PATH_LEN];
+        char subsystem[UEVENT_NAME_LEN*2];
+        char name[UEVENT_NAME_LEN*2];
+        uint32_t hash;
+        int queue;
+        int flags;
+        uevent_handler_t handler;
+        void *data;
+        int next;               //next handler of the same hash slot, -1 if none
+        uevent_handler_stats_t stats;
+        int waitMetric;
+        int handleMetric;
+    };
+
+    struct Item {
+        int handler;
+        uevent_msg_t msg;
+    };
+
+    struct Queue {
+        char name[UEVENT_NAME_LEN];
+        UeventDispatcher *owner;
+        pthread_t thread;
+        pthread_cond_t cond;
+        Item items[UEVENT_QUEUE_LEN];
+        int head;
+        int count;
+        bool running;           //a handler of the queue is running
+    };
+
+    static void *queueLoop(void *data);
+    void enqueue(Queue *queue, int handler, const uevent_msg_t *msg);
+    void runHandler(int id, const uevent_msg_t *msg);
+    void record(const uevent_msg_t *msg);
+
+    pthread_mutex_t mLock;
+    pthread_cond_t mIdleCond;
+    bool mExit;
+
+    Handler mHandlers[UEVENT_MAX_HANDLERS];
+    int mHandlerCount;
+    int mTable[UEVENT_TABLE_SIZE];      //first handler of the slot, -1 if none
+
+    Queue mQueues[UEVENT_MAX_QUEUES];
+    int mQueueCount;
+
+    FILE *mRecord;
+    uevent_stats_t mStats;
+};
+
+#endif // UEVENT_DISPATCHER_H
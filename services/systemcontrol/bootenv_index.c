@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/03
+ *  @par function description:
+ *  - 1 hashed index of the uboot env, keys and values packed in string chunks
+ *  - 2 parse from and serialize to the env data in the partition order
+ */
+
+#define LOG_TAG "SystemControl"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "bootenv_index.h"
+#include "common.h"
+
+#define ERROR(x...)     SYS_LOGE(x)
+
+//FNV-1a
+static uint32_t env_hash(const char *key) {
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash ^= (uint8_t)*key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static char *env_alloc_string(env_index_t *index, uint32_t size) {
+    env_chunk_t *chunk = index->chunks;
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        uint32_t chunk_size = (size > ENV_CHUNK_SIZE)?size:ENV_CHUNK_SIZE;
+        chunk = (env_chunk_t *)malloc(sizeof(env_chunk_t) + chunk_size);
+        if (chunk == NULL)
+            return NULL;
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        chunk->next = index->chunks;
+        index->chunks = chunk;
+    }
+
+    char *str = chunk->data + chunk->used;
+    chunk->used += size;
+    return str;
+}
+
+static int32_t env_find(const env_index_t *index, const char *key, uint32_t hash) {
+    if (index->buckets == NULL)
+        return -1;
+
+    uint32_t slot = hash & index->bucket_mask;
+    while (index->buckets[slot] >= 0) {
+        const env_entry_t *entry = &index->entries[index->buckets[slot]];
+        if (entry->hash == hash && !strcmp(entry->key, key))
+            return index->buckets[slot];
+        slot = (slot + 1) & index->bucket_mask;
+    }
+    return -1;
+}
+
+//keep the load factor under 1/2
+static int env_rehash(env_index_t *index, uint32_t count) {
+    uint32_t size = 16;
+    while (size < count*2)
+        size <<= 1;
+    if (index->buckets != NULL && size <= index->bucket_mask + 1)
+        return 0;
+
+    int32_t *buckets = (int32_t *)malloc(size*sizeof(int32_t));
+    if (buckets == NULL)
+        return -1;
+    memset(buckets, 0xff, size*sizeof(int32_t));
+
+    for (uint32_t i = 0; i < index->count; i++) {
+        uint32_t slot = index->entries[i].hash & (size - 1);
+        while (buckets[slot] >= 0)
+            slot = (slot + 1) & (size - 1);
+        buckets[slot] = i;
+    }
+
+    free(index->buckets);
+    index->buckets = buckets;
+    index->bucket_mask = size - 1;
+    return 0;
+}
+
+static int env_add(env_index_t *index, const char *key, uint32_t key_len,
+        const char *value, uint32_t value_len, uint32_t hash) {
+    if (index->count >= index->capacity) {
+        uint32_t capacity = (index->capacity > 0)?index->capacity*2:64;
+        env_entry_t *entries = (env_entry_t *)realloc(index->entries, capacity*sizeof(env_entry_t));
+        if (entries == NULL)
+            return -1;
+        index->entries = entries;
+        index->capacity = capacity;
+    }
+    if (env_rehash(index, index->count + 1) < 0)
+        return -1;
+
+    char *str = env_alloc_string(index, key_len + value_len + 2);
+    if (str == NULL)
+        return -1;
+    memcpy(str, key, key_len);
+    str[key_len] = 0;
+    memcpy(str + key_len + 1, value, value_len);
+    str[key_len + 1 + value_len] = 0;
+
+    env_entry_t *entry = &index->entries[index->count];
+    entry->key = str;
+    entry->value = str + key_len + 1;
+    entry->hash = hash;
+    entry->value_size = value_len + 1;
+
+    uint32_t slot = hash & index->bucket_mask;
+    while (index->buckets[slot] >= 0)
+        slot = (slot + 1) & index->bucket_mask;
+    index->buckets[slot] = index->count;
+    index->count++;
+    return 0;
+}
+
+void env_index_init(env_index_t *index) {
+    memset(index, 0, sizeof(env_index_t));
+}
+
+void env_index_free(env_index_t *index) {
+    env_chunk_t *chunk = index->chunks;
+    while (chunk) {
+        env_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(index->entries);
+    free(index->buckets);
+    env_index_init(index);
+}
+
+int env_index_parse(env_index_t *index, const char *data, uint32_t size) {
+    const char *end = data + size;
+    const char *proc = data;
+
+    //the whole env in one chunk, count the entries first
+    uint32_t count = 0;
+    uint32_t bytes = 0;
+    while (proc < end && *proc) {
+        uint32_t len = strnlen(proc, end - proc);
+        count++;
+        bytes += len + 1;
+        proc += len + 1;
+    }
+
+    env_index_free(index);
+    if (count == 0)
+        return 0;
+
+    index->entries = (env_entry_t *)malloc(count*sizeof(env_entry_t));
+    index->chunks = (env_chunk_t *)malloc(sizeof(env_chunk_t) + bytes);
+    if (index->entries == NULL || index->chunks == NULL || env_rehash(index, count) < 0) {
+        ERROR("[ubootenv] index out of memory, %d entries\n", count);
+        env_index_free(index);
+        return -1;
+    }
+    index->capacity = count;
+    index->chunks->next = NULL;
+    index->chunks->size = bytes;
+    index->chunks->used = 0;
+
+    for (proc = data; proc < end && *proc; ) {
+        uint32_t len = strnlen(proc, end - proc);
+        const char *key = proc;
+        const char *value = memchr(proc, '=', len);
+        proc += len + 1;
+
+        if (value == NULL || value == key) {
+            ERROR("[ubootenv] error need '=' skip this value\n");
+            continue;
+        }
+
+        uint32_t key_len = value - key;
+        value++;
+        char name[key_len + 1];
+        memcpy(name, key, key_len);
+        name[key_len] = 0;
+
+        uint32_t hash = env_hash(name);
+        if (env_find(index, name, hash) >= 0) {
+            ERROR("[ubootenv] duplicate key [%s], keep the first one\n", name);
+            continue;
+        }
+        if (env_add(index, key, key_len, value, len - key_len - 1, hash) < 0) {
+            env_index_free(index);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int env_index_serialize(const env_index_t *index, char *data, uint32_t size) {
+    uint32_t pos = 0;
+
+    memset(data, 0, size);
+    for (uint32_t i = 0; i < index->count; i++) {
+        const env_entry_t *entry = &index->entries[i];
+        uint32_t key_len = strlen(entry->key);
+        uint32_t value_len = strlen(entry->value);
+        //the env end with an empty string
+        if (pos + key_len + value_len + 3 > size) {
+            ERROR("[ubootenv] env is larger than %d bytes\n", size);
+            return -1;
+        }
+
+        memcpy(data + pos, entry->key, key_len);
+        data[pos + key_len] = '=';
+        memcpy(data + pos + key_len + 1, entry->value, value_len);
+        pos += key_len + value_len + 2;
+    }
+    return pos;
+}
+
+const char *env_index_get(const env_index_t *index, const char *key) {
+    int32_t i = env_find(index, key, env_hash(key));
+    return (i >= 0)?index->entries[i].value:NULL;
+}
+
+int env_index_set(env_index_t *index, const char *key, const char *value, int create) {
+    uint32_t hash = env_hash(key);
+    uint32_t value_len = strlen(value);
+    int32_t i = env_find(index, key, hash);
+
+    if (i >= 0) {
+        env_entry_t *entry = &index->entries[i];
+        //longer value get new storage, the old one is freed with the index
+        if (value_len >= entry->value_size) {
+            char *str = env_alloc_string(index, value_len + 1);
+            if (str == NULL)
+                return -1;
+            entry->value = str;
+            entry->value_size = value_len + 1;
+        }
+        memcpy(entry->value, value, value_len + 1);
+        return 2;
+    }
+
+    if (!create)
+        return 0;
+
+    if (env_add(index, key, strlen(key), value, value_len, hash) < 0)
+        return -1;
+    return 1;
+}
+
+uint32_t env_index_bytes(const env_index_t *index) {
+    uint32_t bytes = index->capacity*sizeof(env_entry_t);
+    if (index->buckets != NULL)
+        bytes += (index->bucket_mask + 1)*sizeof(int32_t);
+
+    env_chunk_t *chunk = index->chunks;
+    while (chunk) {
+        bytes += sizeof(env_chunk_t) + chunk->size;
+        chunk = chunk->next;
+    }
+    return bytes;
+}
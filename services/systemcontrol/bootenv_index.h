@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/03
+ *  @par function description:
+ *  - 1 hashed index of the uboot env, keys and values packed in string chunks
+ *  - 2 parse from and serialize to the env data in the partition order
+ */
+
+#ifndef _BOOTENV_INDEX_H
+#define _BOOTENV_INDEX_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//string chunk size for the values added after parse
+#define ENV_CHUNK_SIZE          4096
+
+typedef struct env_entry {
+    const char *key;
+    char *value;
+    uint32_t hash;
+    //bytes can be used by the value in place, include '\0'
+    uint32_t value_size;
+} env_entry_t;
+
+//strings are never moved, so the values returned by get stay valid until free
+typedef struct env_chunk {
+    struct env_chunk *next;
+    uint32_t size;
+    uint32_t used;
+    char data[];
+} env_chunk_t;
+
+typedef struct env_index {
+    //in the partition order
+    env_entry_t *entries;
+    uint32_t count;
+    uint32_t capacity;
+    //open addressing, entry index or -1
+    int32_t *buckets;
+    uint32_t bucket_mask;
+    env_chunk_t *chunks;
+} env_index_t;
+
+void env_index_init(env_index_t *index);
+void env_index_free(env_index_t *index);
+
+//data is "key=value\0key=value\0\0"
+int env_index_parse(env_index_t *index, const char *data, uint32_t size);
+//return the used bytes, or -1 if the env is larger than size
+int env_index_serialize(const env_index_t *index, char *data, uint32_t size);
+
+const char *env_index_get(const env_index_t *index, const char *key);
+/*
+ * return 2 if the key is updated, 1 if it is created,
+ * 0 if it does not exist and create is 0, -1 if out of memory
+ */
+int env_index_set(env_index_t *index, const char *key, const char *value, int create);
+
+//heap bytes used by the index
+uint32_t env_index_bytes(const env_index_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // _BOOTENV_INDEX_H
@@ -9,7 +9,8 @@ endif
 
 LOCAL_SRC_FILES:= \
 	getbootenv.c \
-	../ubootenv.c
+	../ubootenv.c \
+	../bootenv_index.c
 
 LOCAL_MODULE:= getbootenv
 
@@ -40,7 +41,8 @@ endif
 
 LOCAL_SRC_FILES:= \
 	setbootenv.c \
-	../ubootenv.c
+	../ubootenv.c \
+	../bootenv_index.c
 
 LOCAL_MODULE:= setbootenv
 
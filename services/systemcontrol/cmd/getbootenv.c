@@ -3,13 +3,14 @@
 
 #include "../ubootenv.h"
 
+static void print_bootenv(const char *key, const char *value, void *cookie)
+{
+    printf("[%s]: [%s]\n", key, value);
+}
+
 static void list_bootenvs(void)
 {
-    env_attribute *attr = bootenv_get_attr();
-	while(attr != NULL) {
-        printf("[%s]: [%s]\n", attr->key, attr->value);
-		attr = attr->next;
-	}
+    bootenv_list(print_bootenv, NULL);
 }
 
 int main(int argc, char *argv[])
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/07/04
+ *  @par function description:
+ *  - 1 compile mesondisplay.cfg to mesondisplay.bin, the config is checked before
+ *  - 2 check the mesondisplay.cfg of all the products with -c
+ *  - 3 dump a binary, tell if it is stale against the text
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "DisplayConfig.h"
+
+static void usage() {
+    fprintf(stderr,
+        "usage: displaycfg [-o mesondisplay.bin] mesondisplay.cfg\n"
+        "       displaycfg -c mesondisplay.cfg ...\n"
+        "       displaycfg -d mesondisplay.bin [mesondisplay.cfg]\n"
+        "-o: compile the config, the default output is the config path with .bin\n"
+        "-c: check the configs, the exit code is the count of the bad ones\n"
+        "-d: dump the binary, and check it against the config\n");
+}
+
+//parse and check, print the first error
+static int checkConfig(const char *path, display_config_t *config) {
+    char error[MAX_STR_LEN];
+
+    int errors = displayCfgParse(path, config, error, sizeof(error));
+    if (errors == 0)
+        errors = displayCfgCheck(config, error, sizeof(error));
+    if (errors > 0)
+        fprintf(stderr, "%s: %d errors, %s\n", path, errors, error);
+    return errors;
+}
+
+static int compileConfig(const char *path, const char *binPath) {
+    display_config_t config;
+    char defaultPath[DISPLAY_CFG_PATH_LEN];
+
+    if (checkConfig(path, &config) > 0)
+        return 1;
+
+    if (binPath == NULL) {
+        displayCfgBinPath(path, defaultPath);
+        binPath = defaultPath;
+    }
+    if (displayCfgWriteBin(binPath, &config, path) < 0) {
+        fprintf(stderr, "%s: can not write %s\n", path, binPath);
+        return 1;
+    }
+    return 0;
+}
+
+static int dumpBin(const char *binPath, const char *path) {
+    display_config_t config;
+    char buf[1024] = {0};
+
+    int status = displayCfgReadBin(binPath, path, &config);
+    if (status == DISPLAY_CFG_BIN_STALE) {
+        printf("%s: stale, %s changed after it was compiled\n", binPath, path);
+        return 1;
+    }
+    if (status != DISPLAY_CFG_BIN_OK) {
+        printf("%s: bad binary %d\n", binPath, status);
+        return 1;
+    }
+
+    displayCfgDump(&config, buf);
+    printf("%s: version %d, %d bytes\n%s", binPath, DISPLAY_CFG_VERSION,
+        (int)(sizeof(display_cfg_header_t) + sizeof(display_config_t)), buf);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    if (!strcmp(argv[1], "-c")) {
+        display_config_t config;
+        int bad = 0;
+        for (int i = 2; i < argc; i++) {
+            if (checkConfig(argv[i], &config) > 0)
+                bad++;
+            else
+                printf("%s: ok\n", argv[i]);
+        }
+        return bad;
+    }
+
+    if (!strcmp(argv[1], "-d") && argc >= 3)
+        return dumpBin(argv[2], (argc >= 4)?argv[3]:NULL);
+
+    if (!strcmp(argv[1], "-o") && argc == 4)
+        return compileConfig(argv[3], argv[2]);
+
+    if (argc == 2 && argv[1][0] != '-')
+        return compileConfig(argv[1], NULL);
+
+    usage();
+    return 1;
+}
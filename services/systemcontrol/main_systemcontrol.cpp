@@ -23,6 +23,9 @@
 //#define LOG_NDEBUG 0
 
 #include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <sys/prctl.h>
 #include <sys/wait.h>
 #include <binder/IPCThreadState.h>
@@ -32,9 +35,21 @@
 #include <utils/Log.h>
 
 #include "SystemControl.h"
+#include "ubootenv.h"
 
 using namespace android;
 
+//bootenv updates are written later, write them before the service is killed
+static void *shutdownThread(void *arg) {
+    sigset_t *set = (sigset_t *)arg;
+    int sig = 0;
+    sigwait(set, &sig);
+    ALOGI("signal %d, commit bootenv before exit", sig);
+    bootenv_commit();
+    _exit(0);
+    return NULL;
+}
+
 int main(int argc, char** argv)
 {
     //char value[PROPERTY_VALUE_MAX];
@@ -43,6 +58,14 @@ int main(int argc, char** argv)
         path = argv[1];
     }
 
+    //all the threads created later block SIGTERM, only shutdownThread get it
+    static sigset_t set;
+    pthread_t thread;
+    sigemptyset(&set);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    pthread_create(&thread, NULL, shutdownThread, &set);
+
     sp<ProcessState> proc(ProcessState::self());
     sp<IServiceManager> sm = defaultServiceManager();
     ALOGI("ServiceManager: %p", sm.get());
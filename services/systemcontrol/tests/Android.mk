@@ -15,3 +15,335 @@ LOCAL_MODULE:= test-systemcontrol
 LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_EXECUTABLE)
+
+#================================
+#bootenv index benchmark for host
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	bootenv_benchmark.c \
+	../bootenv_index.c
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/..
+
+LOCAL_STATIC_LIBRARIES := \
+	liblog
+
+LOCAL_LDLIBS := -lrt
+
+LOCAL_MODULE:= bootenv_benchmark
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#================================
+#bootenv test on a tmpfs file
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	bootenv_test.c \
+	../ubootenv.c \
+	../bootenv_index.c
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/.. \
+	external/zlib
+
+LOCAL_STATIC_LIBRARIES := \
+	libcutils \
+	liblog \
+	libz \
+	libc
+
+LOCAL_FORCE_STATIC_EXECUTABLE := true
+
+LOCAL_MODULE:= bootenv_test
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+#================================
+#sysfs fd cache test on a fake sysfs tree for host
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	sysfs_cache_test.cpp \
+	../SysWrite.cpp \
+	../SysfsCache.cpp \
+	../Metrics.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/..
+
+LOCAL_STATIC_LIBRARIES := \
+	libcutils \
+	liblog
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= sysfs_cache_test
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#================================
+#caller permission and process name cache test for host
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	caller_cache_test.cpp \
+	../CallerCache.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/..
+
+LOCAL_STATIC_LIBRARIES := \
+	libutils \
+	liblog
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= caller_cache_test
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#================================
+#edid capability table test on the captured TVs in tests/edid for host
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	edid_caps_test.cpp \
+	../EdidCaps.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/..
+
+LOCAL_STATIC_LIBRARIES := \
+	libcutils \
+	liblog
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= edid_caps_test
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#================================
+#mode switch planner test for host
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	mode_plan_test.cpp \
+	../ModePlan.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/..
+
+LOCAL_MODULE:= mode_plan_test
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#================================
+#hdcp tx authenticate wait test for host
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	hdcp_auth_test.cpp \
+	../HdcpAuth.cpp \
+	../Metrics.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/..
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= hdcp_auth_test
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#================================
+#uevent dispatcher replay of the recorded streams for host
+#run it in the tests dir, or pass the stream files
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	uevent_replay.cpp \
+	../UeventDispatcher.cpp \
+	../Metrics.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/..
+
+LOCAL_SHARED_LIBRARIES := liblog
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= uevent_replay
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#================================
+#3d format detect on a fake video device for host
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	detect3d_test.cpp \
+	../Detect3D.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/..
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= detect3d_test
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#================================
+#the display stack on a fake sysfs tree for host, end to end timings
+#libsystemcontrol_static is for the target, its sources are built here.
+#RECOVERY_MODE drop the binder, display_sim has the klog and the properties of the host
+include $(CLEAR_VARS)
+
+LOCAL_CFLAGS += -DRECOVERY_MODE -DHDCP_AUTHENTICATION -DGXBABY_ENVSIZE
+
+LOCAL_SRC_FILES:= \
+	display_benchmark.cpp \
+	display_sim.cpp \
+	../ubootenv.c \
+	../bootenv_index.c \
+	../SysWrite.cpp \
+	../SysfsCache.cpp \
+	../Metrics.cpp \
+	../EdidCaps.cpp \
+	../ModePlan.cpp \
+	../HdcpAuth.cpp \
+	../UeventDispatcher.cpp \
+	../DisplayMode.cpp \
+	../DisplayConfig.cpp \
+	../Dimension.cpp \
+	../Detect3D.cpp \
+	../SysTokenizer.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/.. \
+	external/zlib
+
+LOCAL_STATIC_LIBRARIES := \
+	libz-host
+
+LOCAL_SHARED_LIBRARIES := liblog
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= display_benchmark
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#================================
+#boot init stages with fake stage times for host
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	boot_init_test.cpp \
+	../BootInit.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/..
+
+LOCAL_SHARED_LIBRARIES := liblog
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= boot_init_test
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#================================
+#mesondisplay.cfg text and binary, the checker and the load time for host
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	display_config_test.cpp \
+	../DisplayConfig.cpp \
+	../SysTokenizer.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/.. \
+	external/zlib
+
+LOCAL_STATIC_LIBRARIES := \
+	libz-host
+
+LOCAL_SHARED_LIBRARIES := liblog
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= display_config_test
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#================================
+#metrics registry, histograms and dumps for host
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	metrics_test.cpp \
+	../Metrics.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/..
+
+LOCAL_SHARED_LIBRARIES := liblog
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= metrics_test
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#================================
+#aes known answers of every backend and the decrypt speed for host
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	aes_benchmark.cpp \
+	../HDCPKey/aes.cpp \
+	../HDCPKey/aes_backend.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/../HDCPKey
+
+LOCAL_CFLAGS += -DPOLARSSL_SELF_TEST
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= aes_benchmark
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/07/11
+ *  @par function description:
+ *  - 1 the self test and known answers of aes on every backend the cpu support
+ *  - 2 the backends give the same bytes as the tables on random keys and data
+ *  - 3 the time of a key item decrypt as do_aes, and the MB/s of each backend
+ *  - usage: aes_benchmark [-r rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "aes.h"
+#include "aes_backend.h"
+
+//a hdcp 2.2 key item is about 1KB, the firmware one is bigger
+#define ITEM_SIZE       2048
+#define BULK_SIZE       (1024*1024)
+#define DEFAULT_ROUNDS  2000
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+static int64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static void randomFill(unsigned char *buf, int len) {
+    for (int i = 0; i < len; i++)
+        buf[i] = rand() & 0xff;
+}
+
+//the bytes of every backend are the ones of the tables
+static void crossCheck(int id) {
+    unsigned char key[32], iv[16], ivRef[16];
+    unsigned char in[256], out[256], ref[256];
+    struct aes_context ctx;
+
+    for (int n = 0; n < 200; n++) {
+        int keybits = 128 + (n % 3)*64;
+        int len = 16*(1 + rand() % 16);
+        int mode = (n & 1)?AES_ENCRYPT:AES_DECRYPT;
+        randomFill(key, sizeof(key));
+        randomFill(iv, sizeof(iv));
+        randomFill(in, len);
+        memcpy(ivRef, iv, sizeof(iv));
+
+        if (mode == AES_ENCRYPT)
+            aes_setkey_enc(&ctx, key, keybits);
+        else
+            aes_setkey_dec(&ctx, key, keybits);
+
+        aes_backend_select(AES_BACKEND_TABLE);
+        aes_crypt_cbc(&ctx, mode, len, ivRef, in, ref);
+        aes_backend_select(id);
+        aes_crypt_cbc(&ctx, mode, len, iv, in, out);
+        CHECK(!memcmp(out, ref, len));
+        CHECK(!memcmp(iv, ivRef, sizeof(iv)));
+
+        aes_backend_select(AES_BACKEND_TABLE);
+        aes_crypt_ecb(&ctx, mode, in, ref);
+        aes_backend_select(id);
+        aes_crypt_ecb(&ctx, mode, in, out);
+        CHECK(!memcmp(out, ref, 16));
+    }
+}
+
+int main(int argc, char **argv) {
+    int rounds = DEFAULT_ROUNDS;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        if (opt == 'r')
+            rounds = atoi(optarg);
+    }
+    if (rounds <= 0)
+        rounds = DEFAULT_ROUNDS;
+
+    int active = aes_backend_active_id();
+    printf("aes backend in use: %s\n", aes_backend_active()->name);
+
+    //self test of all the supported backends
+    CHECK(aes_self_test(0) == 0);
+    CHECK(aes_backend_active_id() == active);
+
+    //the tables are always there, an unknown id is refused
+    CHECK(aes_backend_supported(AES_BACKEND_TABLE));
+    CHECK(aes_backend_get(AES_BACKENDS) == NULL);
+    CHECK(aes_backend_select(-1) != 0);
+    CHECK(aes_backend_active_id() == active);
+
+    //a backend of the cpu which fail the known answers is not used, it is a bug here
+    srand(1);
+    for (int id = 0; id < AES_BACKENDS; id++) {
+        if (aes_backend_supported(id) && id != AES_BACKEND_TABLE) {
+            CHECK(aes_backend_select(id) == 0);
+            crossCheck(id);
+        }
+    }
+
+    unsigned char key[16], iv[16];
+    unsigned char *item = (unsigned char *)malloc(ITEM_SIZE);
+    unsigned char *bulk = (unsigned char *)malloc(BULK_SIZE);
+    randomFill(key, sizeof(key));
+    randomFill(item, ITEM_SIZE);
+    randomFill(bulk, BULK_SIZE);
+
+    for (int id = 0; id < AES_BACKENDS; id++) {
+        const struct aes_backend *backend = aes_backend_get(id);
+        if (backend == NULL) {
+            printf("backend %d not built for this cpu\n", id);
+            continue;
+        }
+        if (!aes_backend_supported(id)) {
+            printf("%-9s not supported by this cpu\n", backend->name);
+            continue;
+        }
+        if (aes_backend_select(id) != 0) {
+            printf("%-9s fail the known answers, not used\n", backend->name);
+            continue;
+        }
+
+        //a key item as do_aes, the key schedule and the decrypt in place
+        struct aes_context ctx;
+        int64_t start = nowUs();
+        for (int i = 0; i < rounds; i++) {
+            memset(iv, 0, sizeof(iv));
+            aes_setkey_dec(&ctx, key, 128);
+            aes_crypt_cbc(&ctx, AES_DECRYPT, ITEM_SIZE, iv, item, item);
+        }
+        int64_t itemUs = nowUs() - start;
+
+        start = nowUs();
+        memset(iv, 0, sizeof(iv));
+        aes_crypt_cbc(&ctx, AES_DECRYPT, BULK_SIZE, iv, bulk, bulk);
+        int64_t decUs = nowUs() - start;
+
+        aes_setkey_enc(&ctx, key, 128);
+        start = nowUs();
+        memset(iv, 0, sizeof(iv));
+        aes_crypt_cbc(&ctx, AES_ENCRYPT, BULK_SIZE, iv, bulk, bulk);
+        int64_t encUs = nowUs() - start;
+
+        printf("%-9s item %dB %.2fus, cbc dec %.1fMB/s, cbc enc %.1fMB/s\n",
+            backend->name, ITEM_SIZE, (double)itemUs/rounds,
+            (decUs > 0)?BULK_SIZE/(double)decUs:0.0,
+            (encUs > 0)?BULK_SIZE/(double)encUs:0.0);
+    }
+    aes_backend_select(active);
+
+    free(item);
+    free(bulk);
+    printf("%s, %d failed\n", (sFailed == 0)?"PASS":"FAIL", sFailed);
+    return (sFailed == 0)?0:1;
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/06/27
+ *  @par function description:
+ *  - 1 the boot init stages of the service with the time they took on a box
+ *  - 2 the independent stages run together, a stage start when its deps are done
+ *  - 3 a caller wait a stage while the others still run, the timings are in the properties
+ *  - usage: boot_init_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "BootInit.h"
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+//the stages of SystemControl, the time of the serial init on a box with a TV without edid
+enum {
+    STAGE_BOOTENV = 0,
+    STAGE_CONFIG,
+    STAGE_EDID,
+    STAGE_DISPLAY,
+    STAGE_DIMENSION
+};
+
+typedef struct fake_stage {
+    const char *name;
+    int us;
+    int ret;
+    unsigned int deps;
+} fake_stage_t;
+
+static fake_stage_t sStages[] = {
+    { "bootenv",   120000,  0, 0 },
+    { "config",    10000,   0, 0 },
+    { "edid",      250000, -1, 1 << STAGE_CONFIG },
+    { "display",   80000,   0, (1 << STAGE_BOOTENV) | (1 << STAGE_CONFIG) | (1 << STAGE_EDID) },
+    { "dimension", 5000,    0, 1 << STAGE_DISPLAY },
+};
+
+#define STAGE_COUNT     (int)(sizeof(sStages)/sizeof(sStages[0]))
+
+static int64_t nowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static int runFake(void *data) {
+    fake_stage_t *stage = (fake_stage_t *)data;
+    usleep(stage->us);
+    return stage->ret;
+}
+
+//the properties set by the boot init
+static pthread_mutex_t sPropLock = PTHREAD_MUTEX_INITIALIZER;
+static char sProps[16][2][96];
+static int sPropCount = 0;
+
+extern "C" int property_set(const char *key, const char *value) {
+    pthread_mutex_lock(&sPropLock);
+    if (sPropCount < 16) {
+        strncpy(sProps[sPropCount][0], key, 95);
+        strncpy(sProps[sPropCount][1], value, 95);
+        sPropCount++;
+    }
+    pthread_mutex_unlock(&sPropLock);
+    return 0;
+}
+
+static int getProp(const char *key) {
+    int value = -1;
+    pthread_mutex_lock(&sPropLock);
+    for (int i = 0; i < sPropCount; i++) {
+        if (!strcmp(sProps[i][0], key))
+            value = atoi(sProps[i][1]);
+    }
+    pthread_mutex_unlock(&sPropLock);
+    return value;
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    BootInit init("sys.scboot.");
+    int serialUs = 0;
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        CHECK(init.addStage(sStages[i].name, runFake, &sStages[i], sStages[i].deps) == i);
+        serialUs += sStages[i].us;
+    }
+    //a stage can only depend on the stages added before
+    CHECK(init.addStage("later", runFake, &sStages[0], 1 << STAGE_COUNT) < 0);
+
+    //nothing is waited before start
+    CHECK(!init.isDone(STAGE_BOOTENV));
+    CHECK(!init.wait(STAGE_DISPLAY, 10));
+
+    int64_t start = nowUs();
+    CHECK(init.start() == 0);
+    CHECK(init.start() < 0);
+    //published at once, the display calls wait
+    CHECK(nowUs() - start < 20000);
+    CHECK(!init.isDone(STAGE_DISPLAY));
+
+    CHECK(init.wait(STAGE_BOOTENV, 1000));
+    int64_t bootenvUs = nowUs() - start;
+    CHECK(!init.isDone(STAGE_DISPLAY));
+    CHECK(!init.wait(STAGE_DISPLAY, 50));
+
+    CHECK(init.wait(STAGE_DISPLAY, 2000));
+    int64_t displayUs = nowUs() - start;
+    CHECK(init.wait(-1, 2000));
+    int64_t allUs = nowUs() - start;
+
+    //the display start after all its deps, the failed edid does not stop it
+    boot_stage_stats_t stats[STAGE_COUNT];
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        CHECK(init.getStats(i, &stats[i]) == 0);
+        CHECK(stats[i].done);
+    }
+    CHECK(stats[STAGE_EDID].ret == -1);
+    CHECK(stats[STAGE_EDID].startUs >= stats[STAGE_CONFIG].endUs);
+    CHECK(stats[STAGE_DISPLAY].readyUs >= stats[STAGE_BOOTENV].endUs);
+    CHECK(stats[STAGE_DISPLAY].readyUs >= stats[STAGE_EDID].endUs);
+    CHECK(stats[STAGE_DIMENSION].startUs >= stats[STAGE_DISPLAY].endUs);
+    //bootenv and config run together
+    CHECK(stats[STAGE_BOOTENV].startUs < stats[STAGE_CONFIG].endUs);
+
+    //the critical path is config, edid, display, dimension
+    int criticalUs = sStages[STAGE_CONFIG].us + sStages[STAGE_EDID].us +
+        sStages[STAGE_DISPLAY].us + sStages[STAGE_DIMENSION].us;
+    CHECK(allUs < criticalUs + 60000);
+    CHECK(allUs < serialUs);
+    CHECK(init.totalUs() > 0 && init.totalUs() <= allUs);
+
+    //the timings are set when the last stage is done
+    usleep(10000);
+    CHECK(getProp("sys.scboot.edid") >= sStages[STAGE_EDID].us/1000);
+    CHECK(getProp("sys.scboot.display") >= sStages[STAGE_DISPLAY].us/1000);
+    CHECK(getProp("sys.scboot.total") == init.totalUs()/1000);
+
+    printf("boot init %d stages, serial %dms, staged %lldms, bootenv ready %lldms, display ready %lldms\n",
+        STAGE_COUNT, serialUs/1000, (long long)allUs/1000, (long long)bootenvUs/1000,
+        (long long)displayUs/1000);
+
+    char buf[2048] = {0};
+    init.dump(buf);
+    printf("%s", buf);
+
+    printf("%s, %d failed\n", (sFailed == 0)?"PASS":"FAIL", sFailed);
+    return (sFailed == 0)?0:1;
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/03
+ *  @par function description:
+ *  - 1 compare the bootenv hashed index with the old linked list
+ *  - 2 lookup time of the getPosition keys, heap bytes and RSS of the env
+ *  - usage: bootenv_benchmark [entries...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bootenv_index.h"
+
+#define ENV_DATA_SIZE           0x10000
+#define LOOKUP_ROUNDS           2000
+
+//the linked list used before the index
+typedef struct env_attribute {
+    struct env_attribute *next;
+    char key[256];
+    char value[1024];
+} env_attribute;
+
+static const char *modes[] = {
+    "480i", "480p", "576i", "576p", "720p", "1080i", "1080p",
+    "720p50hz", "1080i50hz", "1080p50hz", "4k2k24hz", "4k2k25hz",
+    "4k2k30hz", "4k2k50hz", "4k2k60hz", "4k2ksmpte", "2160p60hz420",
+};
+
+static const char *fixed[] = {
+    "bootcmd", "bootargs", "outputmode", "hdmimode", "cvbsmode", "firstboot",
+    "ethaddr", "display_width", "display_height", "display_bpp", "fb_width",
+    "fb_height", "upgrade_step", "jtag", "loadaddr", "hdmi_colordepth",
+};
+
+static int64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+static long rssKB(void) {
+    long pages = 0, resident = 0;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp == NULL)
+        return 0;
+    if (fscanf(fp, "%ld %ld", &pages, &resident) != 2)
+        resident = 0;
+    fclose(fp);
+    return resident*(sysconf(_SC_PAGESIZE)/1024);
+}
+
+//the fixed names, the position of every mode, then filler to the size
+static uint32_t buildEnvData(char *data, int entries) {
+    uint32_t pos = 0;
+    int count = 0;
+    int nfixed = sizeof(fixed)/sizeof(fixed[0]);
+    int nmodes = sizeof(modes)/sizeof(modes[0]);
+    const char *axis[] = {"x", "y", "w", "h"};
+
+    memset(data, 0, ENV_DATA_SIZE);
+    for (int i = 0; i < nfixed && count < entries; i++, count++)
+        pos += sprintf(data + pos, "%s=value_of_%s", fixed[i], fixed[i]) + 1;
+    for (int i = 0; i < nmodes*4 && count < entries; i++, count++)
+        pos += sprintf(data + pos, "%s_%s=%d", modes[i/4], axis[i%4], i*16) + 1;
+    for (; count < entries; count++)
+        pos += sprintf(data + pos, "var_%d=%08x", count, count*2654435761u) + 1;
+    return pos;
+}
+
+static env_attribute *listParse(char *data) {
+    env_attribute *head = (env_attribute *)malloc(sizeof(env_attribute));
+    env_attribute *attr = head;
+    char *proc = data;
+
+    memset(attr, 0, sizeof(env_attribute));
+    while (1) {
+        char *next = proc + strlen(proc) + 1;
+        char *key = strchr(proc, '=');
+        if (key != NULL) {
+            *key = 0;
+            strcpy(attr->key, proc);
+            strcpy(attr->value, key + 1);
+            *key = '=';
+        }
+        if (!(*next))
+            break;
+        proc = next;
+        attr->next = (env_attribute *)malloc(sizeof(env_attribute));
+        memset(attr->next, 0, sizeof(env_attribute));
+        attr = attr->next;
+    }
+    return head;
+}
+
+static const char *listGet(env_attribute *attr, const char *key) {
+    while (attr) {
+        if (!strcmp(key, attr->key))
+            return attr->value;
+        attr = attr->next;
+    }
+    return NULL;
+}
+
+static void listFree(env_attribute *attr) {
+    while (attr) {
+        env_attribute *next = attr->next;
+        free(attr);
+        attr = next;
+    }
+}
+
+static int runEntries(int entries) {
+    static char data[ENV_DATA_SIZE];
+    static char out[ENV_DATA_SIZE];
+    int nmodes = sizeof(modes)/sizeof(modes[0]);
+    const char *axis[] = {"x", "y", "w", "h"};
+    char keys[nmodes*4 + 4][32];
+    int nkeys = 0;
+    int failed = 0;
+
+    uint32_t size = buildEnvData(data, entries);
+
+    //the keys of DisplayMode::getPosition for every mode, and some missing ones
+    for (int i = 0; i < nmodes*4; i++)
+        sprintf(keys[nkeys++], "%s_%s", modes[i/4], axis[i%4]);
+    for (int i = 0; i < 4; i++)
+        sprintf(keys[nkeys++], "missing_%d", i);
+
+    long rss = rssKB();
+    env_attribute *list = listParse(data);
+    long listRss = rssKB() - rss;
+
+    rss = rssKB();
+    env_index_t index;
+    env_index_init(&index);
+    if (env_index_parse(&index, data, ENV_DATA_SIZE) < 0) {
+        printf("FAIL parse %d entries\n", entries);
+        listFree(list);
+        return 1;
+    }
+    long indexRss = rssKB() - rss;
+
+    for (int i = 0; i < nkeys; i++) {
+        const char *a = listGet(list, keys[i]);
+        const char *b = env_index_get(&index, keys[i]);
+        if ((a == NULL) != (b == NULL) || (a && strcmp(a, b))) {
+            printf("FAIL key %s: list [%s] index [%s]\n", keys[i], a?a:"null", b?b:"null");
+            failed++;
+        }
+    }
+
+    if (env_index_serialize(&index, out, ENV_DATA_SIZE) != (int)size || memcmp(data, out, ENV_DATA_SIZE)) {
+        printf("FAIL serialize %d entries\n", entries);
+        failed++;
+    }
+
+    volatile const char *sink = NULL;
+    int64_t start = nowNs();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++)
+        for (int i = 0; i < nkeys; i++)
+            sink = listGet(list, keys[i]);
+    int64_t listNs = nowNs() - start;
+
+    start = nowNs();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++)
+        for (int i = 0; i < nkeys; i++)
+            sink = env_index_get(&index, keys[i]);
+    int64_t indexNs = nowNs() - start;
+    (void)sink;
+
+    int lookups = LOOKUP_ROUNDS*nkeys;
+    printf("%5d entries, %5d env bytes | list: %6.1f ns/lookup, %7d heap bytes, %5ld KB rss"
+        " | index: %6.1f ns/lookup, %6d heap bytes, %5ld KB rss\n",
+        entries, size,
+        (double)listNs/lookups, entries*(int)sizeof(env_attribute), listRss,
+        (double)indexNs/lookups, env_index_bytes(&index), indexRss);
+
+    listFree(list);
+    env_index_free(&index);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    int failed = 0;
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++)
+            failed += runEntries(atoi(argv[i]));
+    } else {
+        //a usual env is about 150 entries, 1000 still fit the 64KB partition
+        int sizes[] = {64, 150, 400, 1000};
+        for (int i = 0; i < (int)(sizeof(sizes)/sizeof(sizes[0])); i++)
+            failed += runEntries(sizes[i]);
+    }
+
+    printf("%s\n", (failed == 0)?"PASS":"FAIL");
+    return (failed == 0)?0:1;
+}
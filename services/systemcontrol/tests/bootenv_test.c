@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/09
+ *  @par function description:
+ *  - 1 bootenv on a tmpfs file stand for the env partition
+ *  - 2 check the write count of direct, deferred, transaction and commit
+ *  - 3 report the update latency of a mode switch
+ *  - 4 A/B copies with seq trailer, repair of a broken copy, skip of the same image
+ *  - usage: bootenv_test [tmpfs dir], default /dev
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "ubootenv.h"
+
+#define ENV_FILE_SIZE           0x10000
+#define FLUSH_DELAY_MS          100
+//copy B after copy A
+#define AB_FILE_SIZE            (ENV_FILE_SIZE*2)
+#define SEQ_MAGIC               0x51455342
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+static char sPath[32];
+
+static int64_t nowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static int writes(void) {
+    int updates, count, pending;
+    bootenv_get_stats(&updates, &count, &pending);
+    return count;
+}
+
+//a legacy image as written by uboot, without trailer
+static void buildImage(uint8_t *image, const char *outputmode) {
+    char data[256];
+    int len = snprintf(data, sizeof(data), "bootcmd=run storeboot%coutputmode=%s%c"
+        "hdmimode=1080p60hz%ccvbsmode=576cvbs%cfirstboot=0%c", 0, outputmode, 0, 0, 0, 0);
+
+    memset(image, 0, ENV_FILE_SIZE);
+    memcpy(image + sizeof(uint32_t), data, len + 1);
+    uint32_t crc = crc32(0, image + sizeof(uint32_t), ENV_FILE_SIZE - sizeof(uint32_t));
+    memcpy(image, &crc, sizeof(crc));
+}
+
+static int createEnvFile(const char *dir, int size) {
+    uint8_t *image = (uint8_t *)malloc(ENV_FILE_SIZE);
+
+    snprintf(sPath, sizeof(sPath), "%s/bootenv_XXXXXX", dir);
+    int fd = mkstemp(sPath);
+    if (fd < 0 || image == NULL) {
+        free(image);
+        return -1;
+    }
+
+    buildImage(image, "1080p60hz");
+    int ret = (write(fd, image, ENV_FILE_SIZE) == ENV_FILE_SIZE)?0:-1;
+    //copy B is empty
+    if (ret == 0 && size > ENV_FILE_SIZE)
+        ret = ftruncate(fd, size);
+    close(fd);
+    free(image);
+    return ret;
+}
+
+static int readCopy(int copy, uint8_t *image) {
+    int fd = open(sPath, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    int ret = (pread(fd, image, ENV_FILE_SIZE, copy*ENV_FILE_SIZE) == ENV_FILE_SIZE)?0:-1;
+    close(fd);
+    return ret;
+}
+
+static int writeCopy(int copy, const uint8_t *image) {
+    int fd = open(sPath, O_WRONLY);
+    if (fd < 0)
+        return -1;
+    int ret = (pwrite(fd, image, ENV_FILE_SIZE, copy*ENV_FILE_SIZE) == ENV_FILE_SIZE)?0:-1;
+    close(fd);
+    return ret;
+}
+
+//seq of the copy, -1 if the crc is wrong, 0 if no trailer
+static int64_t copySeq(int copy) {
+    uint8_t *image = (uint8_t *)malloc(ENV_FILE_SIZE);
+    int64_t seq = -1;
+    uint32_t crc, trailer[2];
+    if (readCopy(copy, image) == 0) {
+        memcpy(&crc, image, sizeof(crc));
+        memcpy(trailer, image + ENV_FILE_SIZE - sizeof(trailer), sizeof(trailer));
+        if (crc == crc32(0, image + sizeof(uint32_t), ENV_FILE_SIZE - sizeof(uint32_t)))
+            seq = (trailer[0] == SEQ_MAGIC)?trailer[1]:0;
+    }
+    free(image);
+    return seq;
+}
+
+//the copy has a valid crc and the key=value
+static int copyHas(int copy, const char *pair) {
+    uint8_t *image = (uint8_t *)malloc(ENV_FILE_SIZE);
+    int found = 0;
+    if (readCopy(copy, image) == 0) {
+        uint32_t crc;
+        memcpy(&crc, image, sizeof(crc));
+        if (crc == crc32(0, image + sizeof(uint32_t), ENV_FILE_SIZE - sizeof(uint32_t))) {
+            const char *p = (const char *)image + sizeof(uint32_t);
+            const char *end = (const char *)image + ENV_FILE_SIZE;
+            while (p < end && *p) {
+                if (!strcmp(p, pair))
+                    found = 1;
+                p += strlen(p) + 1;
+            }
+        }
+    }
+    free(image);
+    return found;
+}
+
+static int fileHas(const char *pair) {
+    return copyHas(0, pair);
+}
+
+static int64_t writtenBytes(void) {
+    int64_t bytes;
+    int skipped, redundant;
+    uint32_t seq;
+    bootenv_get_write_stats(&bytes, &skipped, &seq, &redundant);
+    return bytes;
+}
+
+static int skippedWrites(void) {
+    int64_t bytes;
+    int skipped, redundant;
+    uint32_t seq;
+    bootenv_get_write_stats(&bytes, &skipped, &seq, &redundant);
+    return skipped;
+}
+
+//the same updates as DisplayMode::setMboxOutputMode and setPosition
+static int64_t modeSwitch(const char *mode, int n) {
+    char value[32];
+    int64_t start = nowUs();
+    bootenv_update("ubootenv.var.outputmode", mode);
+    bootenv_update("ubootenv.var.hdmimode", mode);
+    snprintf(value, sizeof(value), "%d", n);
+    bootenv_update("ubootenv.var.1080p_x", value);
+    bootenv_update("ubootenv.var.1080p_y", value);
+    return nowUs() - start;
+}
+
+static void testDirect(void) {
+    int count = writes();
+    int64_t us = modeSwitch("720p60hz", 1);
+    printf("direct: mode switch %lld us, %d writes\n", (long long)us, writes() - count);
+    CHECK(writes() - count == 4);
+    CHECK(fileHas("outputmode=720p60hz"));
+    CHECK(fileHas("1080p_y=1"));
+
+    //the same value is not written again
+    count = writes();
+    bootenv_update("ubootenv.var.outputmode", "720p60hz");
+    CHECK(writes() == count);
+}
+
+static void testTransaction(void) {
+    int count = writes();
+    bootenv_transaction_begin();
+    modeSwitch("1080p60hz", 2);
+    CHECK(writes() == count);
+    CHECK(!fileHas("outputmode=1080p60hz"));
+    bootenv_transaction_end();
+    CHECK(writes() - count == 1);
+    CHECK(fileHas("outputmode=1080p60hz"));
+    CHECK(fileHas("1080p_x=2"));
+}
+
+static void testDeferred(void) {
+    bootenv_set_flush_delay(FLUSH_DELAY_MS);
+
+    int count = writes();
+    int64_t us = 0;
+    //several switches in the quiet time, one write
+    for (int i = 0; i < 5; i++)
+        us += modeSwitch((i%2)?"1080p50hz":"2160p60hz", 10 + i);
+    printf("deferred: mode switch %lld us, %d writes before the delay\n",
+        (long long)us/5, writes() - count);
+    CHECK(writes() == count);
+
+    usleep(FLUSH_DELAY_MS*3*1000);
+    printf("deferred: %d writes after the delay\n", writes() - count);
+    CHECK(writes() - count == 1);
+    CHECK(fileHas("outputmode=2160p60hz"));
+    CHECK(fileHas("1080p_x=14"));
+
+    //transaction end write at once, not after the delay
+    count = writes();
+    bootenv_transaction_begin();
+    modeSwitch("720p50hz", 20);
+    bootenv_transaction_end();
+    usleep(FLUSH_DELAY_MS/2*1000);
+    CHECK(writes() - count == 1);
+    CHECK(fileHas("outputmode=720p50hz"));
+
+    //commit is synchronous
+    count = writes();
+    bootenv_update("ubootenv.var.cvbsmode", "480cvbs");
+    CHECK(writes() == count);
+    CHECK(bootenv_commit() == 0);
+    CHECK(writes() - count == 1);
+    CHECK(fileHas("cvbsmode=480cvbs"));
+
+    //nothing pending, commit do not write
+    count = writes();
+    CHECK(bootenv_commit() == 0);
+    CHECK(writes() == count);
+}
+
+//a failed write keep the changes pending, the next flush write them
+static void testWriteFail(void) {
+    char moved[40];
+    int updates, count, pending;
+    snprintf(moved, sizeof(moved), "%s.moved", sPath);
+
+    CHECK(rename(sPath, moved) == 0);
+    bootenv_update("ubootenv.var.cvbsmode", "576cvbs");
+    CHECK(bootenv_commit() < 0);
+    bootenv_get_stats(&updates, &count, &pending);
+    CHECK(pending == 1);
+    CHECK(rename(moved, sPath) == 0);
+
+    //the flush thread try again after the delay
+    usleep(FLUSH_DELAY_MS*3*1000);
+    bootenv_get_stats(&updates, &count, &pending);
+    CHECK(pending == 0);
+    CHECK(fileHas("cvbsmode=576cvbs"));
+}
+
+static void testReload(void) {
+    bootenv_update("ubootenv.var.firstboot", "1");
+    bootenv_commit();
+    CHECK(bootenv_init_file(sPath, ENV_FILE_SIZE) == 0);
+
+    const char *value = bootenv_get("ubootenv.var.firstboot");
+    CHECK(value != NULL && !strcmp(value, "1"));
+    value = bootenv_get("ubootenv.var.outputmode");
+    CHECK(value != NULL && !strcmp(value, "720p50hz"));
+}
+
+static void testRedundant(const char *dir) {
+    uint8_t *image = (uint8_t *)malloc(ENV_FILE_SIZE);
+
+    if (createEnvFile(dir, AB_FILE_SIZE) < 0 || bootenv_init_file(sPath, ENV_FILE_SIZE) < 0) {
+        printf("FAIL can not create A/B env file in %s\n", dir);
+        sFailed++;
+        free(image);
+        return;
+    }
+    bootenv_set_flush_delay(0);
+
+    //copy B is written at init, both copies have a seq
+    CHECK(copySeq(0) == 1 && copySeq(1) == 1);
+    CHECK(copyHas(1, "outputmode=1080p60hz"));
+
+    int64_t bytes = writtenBytes();
+    bootenv_update("ubootenv.var.outputmode", "720p60hz");
+    bytes = writtenBytes() - bytes;
+    printf("redundant: %lld bytes for one update of two copies, legacy write %d bytes\n",
+        (long long)bytes, ENV_FILE_SIZE);
+    CHECK(bytes < ENV_FILE_SIZE);
+    CHECK(copySeq(0) == 2 && copySeq(1) == 2);
+    CHECK(copyHas(0, "outputmode=720p60hz") && copyHas(1, "outputmode=720p60hz"));
+
+    //the same image as the flash is not written
+    int skipped = skippedWrites();
+    bytes = writtenBytes();
+    bootenv_transaction_begin();
+    bootenv_update("ubootenv.var.outputmode", "1080p50hz");
+    bootenv_update("ubootenv.var.outputmode", "720p60hz");
+    bootenv_transaction_end();
+    CHECK(skippedWrites() - skipped == 1);
+    CHECK(writtenBytes() == bytes);
+    CHECK(copySeq(0) == 2);
+
+    //broken copy A, load copy B and repair A
+    CHECK(readCopy(0, image) == 0);
+    image[100] ^= 0xff;
+    CHECK(writeCopy(0, image) == 0);
+    CHECK(copySeq(0) == -1);
+    CHECK(bootenv_init_file(sPath, ENV_FILE_SIZE) == 0);
+    const char *value = bootenv_get("ubootenv.var.outputmode");
+    CHECK(value != NULL && !strcmp(value, "720p60hz"));
+    CHECK(copySeq(0) == 3 && copySeq(1) == 3);
+    CHECK(copyHas(0, "outputmode=720p60hz"));
+
+    //copy A written by uboot has no trailer, it wins over copy B
+    buildImage(image, "576cvbs");
+    CHECK(writeCopy(0, image) == 0);
+    CHECK(bootenv_init_file(sPath, ENV_FILE_SIZE) == 0);
+    value = bootenv_get("ubootenv.var.outputmode");
+    CHECK(value != NULL && !strcmp(value, "576cvbs"));
+    CHECK(copySeq(0) == 4 && copySeq(1) == 4);
+    CHECK(copyHas(1, "outputmode=576cvbs"));
+
+    free(image);
+    unlink(sPath);
+}
+
+int main(int argc, char **argv) {
+    const char *dir = (argc > 1)?argv[1]:"/dev";
+
+    if (createEnvFile(dir, ENV_FILE_SIZE) < 0 || bootenv_init_file(sPath, ENV_FILE_SIZE) < 0) {
+        printf("FAIL can not create env file in %s\n", dir);
+        return 1;
+    }
+
+    testDirect();
+    testTransaction();
+    testDeferred();
+    testWriteFail();
+    testReload();
+    unlink(sPath);
+
+    testRedundant(dir);
+    printf("%s, %d failed\n", (sFailed == 0)?"PASS":"FAIL", sFailed);
+    return (sFailed == 0)?0:1;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/20
+ *  @par function description:
+ *  - 1 permission and process name of the callers are read once
+ *  - 2 a dead caller or a caller with another uid is dropped
+ *  - usage: caller_cache_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "CallerCache.h"
+
+using namespace android;
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+static void testHits(CallerCache *cache) {
+    caller_stats_t stats;
+    char name[CALLER_NAME_LEN];
+    pid_t pid = getpid();
+    uid_t uid = getuid();
+
+    CHECK(cache->getPermission(pid, uid) == -1);
+    cache->setPermission(pid, uid, true);
+    CHECK(cache->getProcName(pid, uid, name, sizeof(name)) == 0);
+    CHECK(name[0] != 0);
+
+    //position updates of the video playback
+    for (int i = 0; i < 1000; i++) {
+        CHECK(cache->getPermission(pid, uid) == 1);
+        CHECK(cache->getProcName(pid, uid, name, sizeof(name)) == 0);
+    }
+
+    cache->getStats(&stats);
+    printf("1000 calls: %lld permission hits, %lld name hits, %lld /proc reads\n",
+        (long long)stats.permissionHits, (long long)stats.nameHits, (long long)stats.procReads);
+    CHECK(stats.permissionHits == 1000 && stats.permissionMisses == 1);
+    CHECK(stats.nameHits == 1000 && stats.nameMisses == 1);
+    //the start time and the cmdline
+    CHECK(stats.procReads == 2);
+}
+
+static void testInvalidate(CallerCache *cache) {
+    caller_stats_t stats;
+    char name[CALLER_NAME_LEN];
+    uid_t uid = getuid();
+
+    pid_t child = fork();
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+
+    cache->setPermission(child, uid, false);
+    CHECK(cache->getPermission(child, uid) == 0);
+
+    //another uid with the same pid is a new caller
+    cache->getStats(&stats);
+    int64_t invalidations = stats.invalidations;
+    CHECK(cache->getPermission(child, uid + 1) == -1);
+    cache->getStats(&stats);
+    CHECK(stats.invalidations - invalidations == 1);
+    cache->setPermission(child, uid, false);
+
+    //checked again after CALLER_CHECK_MS, the process is dead
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    usleep((CALLER_CHECK_MS + 100)*1000);
+    CHECK(cache->getPermission(child, uid) == -1);
+    CHECK(cache->getProcName(child, uid, name, sizeof(name)) < 0);
+    CHECK(!strcmp(name, "unknown"));
+    //uid + 1, back to uid, then the dead process
+    cache->getStats(&stats);
+    CHECK(stats.invalidations - invalidations == 3);
+
+    //alive caller is still cached after the check
+    CHECK(cache->getPermission(getpid(), uid) == 1);
+}
+
+static void testEvict(CallerCache *cache) {
+    caller_stats_t stats;
+
+    for (int i = 0; i < CALLER_CACHE_SIZE*2; i++)
+        cache->setPermission(1000000 + i, 0, true);
+
+    cache->getStats(&stats);
+    CHECK(stats.callers == CALLER_CACHE_SIZE);
+    //the least recently used ones are dropped
+    CHECK(cache->getPermission(1000000, 0) == -1);
+}
+
+int main(int argc __unused, char **argv __unused) {
+    CallerCache *cache = new CallerCache();
+
+    testHits(cache);
+    testInvalidate(cache);
+    testEvict(cache);
+
+    char buf[8192] = {0};
+    cache->dump(buf);
+    printf("%s", buf);
+
+    delete cache;
+    printf("%s, %d failed\n", (sFailed == 0)?"PASS":"FAIL", sFailed);
+    return (sFailed == 0)?0:1;
+}
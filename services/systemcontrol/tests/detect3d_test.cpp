@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   XiaoLiang.Wang
+ *  @version  1.0
+ *  @date     2016/06/13
+ *  @par function description:
+ *  - 1 3d auto detect on a fake video device, the format changes on a timeline
+ *  - 2 a steady source is detected in the stable samples, not in 5x200ms
+ *  - 3 the video layer event sample at once, a flapping source time out to 3d off
+ *  - 4 2d before the first frame is not taken, only after the event or at the timeout
+ *  - usage: detect3d_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "Detect3D.h"
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+//vpp 3d formats, see Dimension.h
+#define VPP_NULL    0
+#define VPP_LR      1
+#define VPP_TB      2
+
+static int64_t nowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+//the source is formatBefore until switchUs after reset, then formatAfter
+typedef struct fake_video {
+    int64_t startUs;
+    int64_t switchUs;
+    int formatBefore;
+    int formatAfter;
+    bool flapping;              //every read return the other format
+    int failReads;              //the next reads fail, the device is reopened
+    int opens;
+    int closes;
+    int reads;
+} fake_video_t;
+
+static int fakeOpen(void *data) {
+    fake_video_t *video = (fake_video_t *)data;
+    video->opens++;
+    return 3;
+}
+
+static int fakeGetFormat(void *data, int handle, int *vppFormat) {
+    fake_video_t *video = (fake_video_t *)data;
+    CHECK(handle == 3);
+    video->reads++;
+    if (video->failReads > 0) {
+        video->failReads--;
+        return -1;
+    }
+    if (video->flapping)
+        *vppFormat = (video->reads & 1)?VPP_LR:VPP_TB;
+    else
+        *vppFormat = (nowUs() - video->startUs < video->switchUs)?video->formatBefore:video->formatAfter;
+    return 0;
+}
+
+static void fakeClose(void *data, int handle) {
+    (void)handle;
+    fake_video_t *video = (fake_video_t *)data;
+    video->closes++;
+}
+
+static void fakeReset(fake_video_t *video, int before, int after, int switchUs) {
+    video->startUs = nowUs();
+    video->switchUs = switchUs;
+    video->formatBefore = before;
+    video->formatAfter = after;
+    video->flapping = false;
+}
+
+typedef struct result {
+    pthread_mutex_t lock;
+    int count;
+    int vppFormat;
+    bool timeout;
+    int64_t us;
+    int64_t startUs;
+} result_t;
+
+static result_t sResult;
+
+static void onResult(int vppFormat, bool timeout, void *data) {
+    result_t *result = (result_t *)data;
+    pthread_mutex_lock(&result->lock);
+    result->count++;
+    result->vppFormat = vppFormat;
+    result->timeout = timeout;
+    result->us = nowUs() - result->startUs;
+    pthread_mutex_unlock(&result->lock);
+}
+
+static void startDetect(Detect3D *detect) {
+    pthread_mutex_lock(&sResult.lock);
+    sResult.count = 0;
+    sResult.startUs = nowUs();
+    pthread_mutex_unlock(&sResult.lock);
+    CHECK(detect->start(onResult, &sResult) == 0);
+}
+
+//wait the callback at most 3s, return the count of the results
+static int waitResult() {
+    pthread_mutex_lock(&sResult.lock);
+    int64_t deadline = nowUs() + 3000000;
+    while (sResult.count == 0 && nowUs() < deadline) {
+        pthread_mutex_unlock(&sResult.lock);
+        usleep(1000);
+        pthread_mutex_lock(&sResult.lock);
+    }
+    int count = sResult.count;
+    pthread_mutex_unlock(&sResult.lock);
+    return count;
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    fake_video_t video;
+    memset(&video, 0, sizeof(video));
+    pthread_mutex_init(&sResult.lock, NULL);
+
+    detect3d_backend_t backend = { fakeOpen, fakeGetFormat, fakeClose, &video };
+    Detect3D detect(&backend);
+    detect3d_policy_t defaults;
+    detect3d_policy_t policy;
+    detect3d_stats_t stats;
+    detect.getPolicy(&defaults);
+
+    //steady side by side source, the default policy
+    fakeReset(&video, VPP_LR, VPP_LR, 0);
+    startDetect(&detect);
+    CHECK(waitResult() == 1);
+    CHECK(sResult.vppFormat == VPP_LR && !sResult.timeout);
+    CHECK(sResult.us < 150000);
+    printf("steady source detected in %lldus, the 5x200ms vote took 1000000us\n", (long long)sResult.us);
+
+    //no video yet, the default policy read 2d in the stable samples before the first frame,
+    //the video layer event come at 300ms with top bottom
+    fakeReset(&video, VPP_NULL, VPP_TB, 300000);
+    startDetect(&detect);
+    usleep(300000);
+    detect.kick();
+    CHECK(waitResult() == 1);
+    CHECK(sResult.vppFormat == VPP_TB && !sResult.timeout);
+    CHECK(sResult.us >= 300000 && sResult.us < 400000);
+    printf("video layer event at 300ms, detected in %lldus\n", (long long)sResult.us);
+
+    //a 2d source without event is taken at the timeout, it is not a timeout
+    fakeReset(&video, VPP_NULL, VPP_NULL, 0);
+    startDetect(&detect);
+    CHECK(waitResult() == 1);
+    CHECK(sResult.vppFormat == VPP_NULL && !sResult.timeout);
+    CHECK(sResult.us >= defaults.timeoutUs);
+
+    //the format never settle, 3d off at the timeout
+    policy = defaults;
+    policy.sampleUs = 20000;
+    policy.timeoutUs = 200000;
+    detect.setPolicy(&policy);
+    video.flapping = true;
+    startDetect(&detect);
+    CHECK(waitResult() == 1);
+    CHECK(sResult.vppFormat == VPP_NULL && sResult.timeout);
+    CHECK(sResult.us >= 200000 && sResult.us < 400000);
+
+    //a restart before the result, only the last detection report
+    fakeReset(&video, VPP_TB, VPP_TB, 0);
+    policy.stableSamples = 3;
+    detect.setPolicy(&policy);
+    startDetect(&detect);
+    usleep(10000);
+    startDetect(&detect);
+    CHECK(waitResult() == 1);
+    usleep(100000);
+    CHECK(sResult.count == 1);
+    CHECK(sResult.vppFormat == VPP_TB);
+
+    //the device is opened once for all the samples, a failed read reopen it
+    CHECK(video.opens == 1);
+    CHECK(video.closes == 0);
+    video.failReads = 1;
+    CHECK(detect.read() == -1);
+    CHECK(video.closes == 1);
+    CHECK(detect.read() == VPP_TB);
+    CHECK(video.opens == 2);
+
+    //a kick without detection only count the event
+    detect.kick();
+
+    detect.getStats(&stats);
+    CHECK(stats.detections == 4);
+    CHECK(stats.timeouts == 1);
+    CHECK(stats.events == 2);
+    CHECK(stats.opens == 2);
+    int64_t counted = 0;
+    for (int i = 0; i < DETECT3D_BUCKETS; i++)
+        counted += stats.count[i];
+    CHECK(counted == 5);
+
+    char buf[4096] = {0};
+    detect.dump(buf);
+    printf("%s", buf);
+
+    detect.stop();
+    CHECK(video.closes == 2);
+
+    printf("%s, %d failed\n", (sFailed == 0)?"PASS":"FAIL", sFailed);
+    return (sFailed == 0)?0:1;
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/06/20
+ *  @par function description:
+ *  - 1 boot the display of a box in the simulator, with a TV plugged
+ *  - 2 time setMboxOutputMode, hotplug to output, hotplug to hdcp and 3d set end to end
+ *  - 3 check the box output the highest mode of every TV in tests/edid after plug,
+ *       also when the edid crc is not ready
+ *  - usage: display_benchmark [-r rounds] [-d hdcp22 ms] [edid dir], default ./edid
+ *  - run it before and after a change, the numbers are in the same host
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "display_sim.h"
+#include "Dimension.h"
+#include "SysfsCache.h"
+#include "ubootenv.h"
+
+#define MAX_TVS                 16
+#define HDCP_WAIT_US            3000000
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+typedef struct timing {
+    const char *name;
+    int count;
+    int64_t totalUs;
+    int64_t minUs;
+    int64_t maxUs;
+} timing_t;
+
+static void addTiming(timing_t *timing, int64_t us) {
+    if (timing->count == 0 || us < timing->minUs)
+        timing->minUs = us;
+    if (us > timing->maxUs)
+        timing->maxUs = us;
+    timing->totalUs += us;
+    timing->count++;
+}
+
+static void printTiming(const timing_t *timing) {
+    if (timing->count == 0) {
+        printf("  %-28s     -\n", timing->name);
+        return;
+    }
+    printf("  %-28s %5d %9.2f %9.2f %9.2f\n", timing->name, timing->count,
+        (double)timing->totalUs/timing->count/1000, (double)timing->minUs/1000,
+        (double)timing->maxUs/1000);
+}
+
+static void currentMode(char *mode) {
+    simReadNode(SYSFS_DISPLAY_MODE, mode, MODE_LEN);
+}
+
+static int loadTvs(const char *dir, sim_tv_t *tvs) {
+    DIR *d = opendir(dir);
+    if (d == NULL)
+        return 0;
+
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL && count < MAX_TVS) {
+        if (strstr(entry->d_name, ".txt") == NULL)
+            continue;
+        char path[SIM_PATH_LEN];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (simLoadTv(path, &tvs[count]) == 0)
+            count++;
+    }
+    closedir(d);
+    return count;
+}
+
+//the TV the box is switched on with, a 1080p one if there is
+static int bootTv(const sim_tv_t *tvs, int count) {
+    for (int i = 0; i < count; i++) {
+        if (!strcmp(tvs[i].output, "1080p60hz"))
+            return i;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int rounds = 10;
+    const char *edidDir = "edid";
+    sim_config_t config;
+    simDefaultConfig(&config);
+    strcpy(config.hdcpKey, "14 22");
+
+    int argi = 1;
+    while (argi + 1 < argc && argv[argi][0] == '-') {
+        if (!strcmp(argv[argi], "-r"))
+            rounds = atoi(argv[argi + 1]);
+        else if (!strcmp(argv[argi], "-d"))
+            config.hdcp22Us = atoi(argv[argi + 1])*1000;
+        argi += 2;
+    }
+    if (argi < argc)
+        edidDir = argv[argi];
+
+    static sim_tv_t tvs[MAX_TVS];
+    int tvCount = loadTvs(edidDir, tvs);
+    if (tvCount == 0) {
+        printf("FAIL no TV captured in %s\n", edidDir);
+        return 1;
+    }
+    if (simInit("/tmp", &config) < 0) {
+        printf("FAIL can not create the simulator in /tmp\n");
+        return 1;
+    }
+
+    timing_t boot = { "boot init", 0, 0, 0, 0 };
+    timing_t bootLogo = { "boot to logo off", 0, 0, 0, 0 };
+    timing_t bootHdcp = { "boot to hdcp", 0, 0, 0, 0 };
+    timing_t modeSwitch = { "setMboxOutputMode switch", 0, 0, 0, 0 };
+    timing_t modeSame = { "setMboxOutputMode same", 0, 0, 0, 0 };
+    timing_t plugOutput = { "hotplug to output", 0, 0, 0, 0 };
+    timing_t plugHdcp = { "hotplug to hdcp", 0, 0, 0, 0 };
+    timing_t unplugOutput = { "unplug to cvbs", 0, 0, 0, 0 };
+    timing_t set3d = { "3d set 3dlr", 0, 0, 0, 0 };
+    timing_t unset3d = { "3d set 3doff", 0, 0, 0, 0 };
+    char mode[MODE_LEN];
+
+    //boot with the TV plugged, the nodes are there before the service
+    int tv = bootTv(tvs, tvCount);
+    simPlug(&tvs[tv], false);
+    int64_t start = simNowUs();
+    DisplayMode *displayMode = new DisplayMode(simConfigPath());
+    simAttach(displayMode);
+    displayMode->init();
+    addTiming(&boot, simNowUs() - start);
+    currentMode(mode);
+    CHECK(!strcmp(mode, tvs[tv].output));
+    int64_t us = simWaitNode(DISPLAY_LOGO_INDEX, "-1", HDCP_WAIT_US);
+    CHECK(us >= 0);
+    if (us >= 0)
+        addTiming(&bootLogo, simNowUs() - start);
+    for (us = 0; simHdcpAuthUs() == 0 && us < HDCP_WAIT_US; us += 1000)
+        usleep(1000);
+    CHECK(simHdcpAuthUs() > 0);
+    if (simHdcpAuthUs() > 0)
+        addTiming(&bootHdcp, simHdcpAuthUs());
+
+    //switch between two modes of the TV, then set the same one again
+    for (int i = 0; i < rounds; i++) {
+        const char *to = (i & 1)?tvs[tv].output:"720p60hz";
+        start = simNowUs();
+        displayMode->setMboxOutputMode(to);
+        addTiming(&modeSwitch, simNowUs() - start);
+        currentMode(mode);
+        CHECK(!strcmp(mode, to));
+
+        start = simNowUs();
+        displayMode->setMboxOutputMode(to);
+        addTiming(&modeSame, simNowUs() - start);
+    }
+
+    //unplug and plug every TV, the box output the highest mode of it
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < tvCount; i++) {
+            start = simNowUs();
+            simUnplug(true);
+            addTiming(&unplugOutput, simNowUs() - start);
+            currentMode(mode);
+            CHECK(strstr(mode, "cvbs") != NULL);
+
+            start = simNowUs();
+            simPlug(&tvs[i], true);
+            addTiming(&plugOutput, simNowUs() - start);
+            currentMode(mode);
+            //the TVs without edid are driven in the default mode
+            if (strlen(tvs[i].output) > 0) {
+                if (strcmp(mode, tvs[i].output))
+                    printf("%s: output %s, expect %s\n", tvs[i].name, mode, tvs[i].output);
+                CHECK(!strcmp(mode, tvs[i].output));
+            }
+
+            for (us = 0; simHdcpAuthUs() == 0 && us < HDCP_WAIT_US; us += 1000)
+                usleep(1000);
+            if (simHdcpAuthUs() > 0)
+                addTiming(&plugHdcp, simHdcpAuthUs());
+        }
+    }
+
+    //the edid crc not ready in the plug, the table of a TV is not kept for the next one
+    for (int i = 0; i < tvCount; i++) {
+        if (strlen(tvs[i].output) == 0 || !strcmp(tvs[i].output, tvs[tv].output))
+            continue;
+        const sim_tv_t *order[2] = { &tvs[tv], &tvs[i] };
+        for (int j = 0; j < 2; j++) {
+            sim_tv_t notReady = *order[j];
+            strcpy(notReady.crc, "0x00000000");
+            simUnplug(true);
+            simPlug(&notReady, true);
+            currentMode(mode);
+            CHECK(!strcmp(mode, notReady.output));
+        }
+        break;
+    }
+
+    //3d on the boot TV, the TV say it support 3d
+    simPlug(&tvs[tv], true);
+    simWriteNode(AV_HDMI_3D_SUPPORT, "1");
+    SysWrite sysWrite;
+    android::Dimension dimension(displayMode, &sysWrite);
+    for (int i = 0; i < rounds; i++) {
+        start = simNowUs();
+        dimension.set3DMode(VIDEO_3D_SIDE_BY_SIDE);
+        addTiming(&set3d, simNowUs() - start);
+        simReadNode(AV_HDMI_CONFIG, mode, sizeof(mode));
+        CHECK(!strcmp(mode, VIDEO_3D_SIDE_BY_SIDE));
+
+        start = simNowUs();
+        dimension.set3DMode(VIDEO_3D_OFF);
+        addTiming(&unset3d, simNowUs() - start);
+    }
+
+    printf("display simulator, %d TVs, %d rounds, hdcp 2.2 %dms 1.4 %dms\n",
+        tvCount, rounds, config.hdcp22Us/1000, config.hdcp14Us/1000);
+    printf("  %-28s %5s %9s %9s %9s\n", "ms", "count", "avg", "min", "max");
+    printTiming(&boot);
+    printTiming(&bootLogo);
+    printTiming(&bootHdcp);
+    printTiming(&modeSwitch);
+    printTiming(&modeSame);
+    printTiming(&plugOutput);
+    printTiming(&plugHdcp);
+    printTiming(&unplugOutput);
+    printTiming(&set3d);
+    printTiming(&unset3d);
+
+    int updates, writes, pending;
+    bootenv_get_stats(&updates, &writes, &pending);
+    printf("  bootenv: %d updates, %d writes\n", updates, writes);
+    char buf[8192] = {0};
+    SysfsCache::getInstance()->dump(buf);
+    printf("%s", buf);
+
+    simExit();
+    printf("%s, %d failed\n", (sFailed == 0)?"PASS":"FAIL", sFailed);
+    //the threads of the display mode are not stopped
+    fflush(stdout);
+    _exit((sFailed == 0)?0:1);
+}
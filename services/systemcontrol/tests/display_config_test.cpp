@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/07/04
+ *  @par function description:
+ *  - 1 mesondisplay.cfg of a box, a TV and a tablet parsed, checked and compiled
+ *  - 2 a text changed after the compile or a bad binary fall back to the text,
+ *       a text with another time but the same bytes still use the binary
+ *  - 3 time of the text parse and the binary load, with the stat and the crc check
+ *  - usage: display_config_test [tmp dir], default /tmp
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "DisplayConfig.h"
+
+#define ROUNDS      1000
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+static int64_t nowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static void writeFile(const char *path, const char *text) {
+    FILE *fp = fopen(path, "w");
+    if (fp != NULL) {
+        fputs(text, fp);
+        fclose(fp);
+    }
+}
+
+int main(int argc, char **argv) {
+    //the config path is cut to DISPLAY_CFG_PATH_LEN in the service, the dir leave room for the name
+    char dir[DISPLAY_CFG_PATH_LEN - sizeof("/mesondisplay.cfg") + 1];
+    char cfg[DISPLAY_CFG_PATH_LEN];
+    char bin[DISPLAY_CFG_PATH_LEN];
+    char error[MAX_STR_LEN];
+    display_config_t config;
+    display_config_t loaded;
+    int status;
+
+    const char *tmp = (argc > 1)?argv[1]:"/tmp";
+    if (snprintf(dir, sizeof(dir), "%s/display_config_XXXXXX", tmp) >= (int)sizeof(dir)
+        || mkdtemp(dir) == NULL) {
+        printf("FAIL can not create %s/display_config_XXXXXX\n", tmp);
+        return 1;
+    }
+    snprintf(cfg, sizeof(cfg), "%s/mesondisplay.cfg", dir);
+    displayCfgBinPath(cfg, bin);
+    CHECK(strstr(bin, "/mesondisplay.bin") != NULL);
+
+    //a box, with comments and blank lines
+    writeFile(cfg, "# mbox config\n\n  MBOX gxbaby 1080p   # 1080 UI\n");
+    CHECK(displayCfgParse(cfg, &config, error, sizeof(error)) == 0);
+    CHECK(displayCfgCheck(&config, error, sizeof(error)) == 0);
+    CHECK(config.type == DISPLAY_TYPE_MBOX);
+    CHECK(!strcmp(config.socType, "gxbaby"));
+    CHECK(!strcmp(config.defaultUI, "1080p"));
+
+    //no binary, the text is parsed
+    CHECK(displayCfgLoad(cfg, &loaded, &status) == DISPLAY_CFG_FROM_TEXT);
+    CHECK(status == DISPLAY_CFG_BIN_MISSING);
+    CHECK(!memcmp(&loaded, &config, sizeof(config)));
+
+    //compiled, the binary is used
+    CHECK(displayCfgWriteBin(bin, &config, cfg) == 0);
+    memset(&loaded, 0, sizeof(loaded));
+    CHECK(displayCfgLoad(cfg, &loaded, &status) == DISPLAY_CFG_FROM_BIN);
+    CHECK(status == DISPLAY_CFG_BIN_OK);
+    CHECK(!memcmp(&loaded, &config, sizeof(config)));
+
+    //the time of the text parse and of the load, the text is only stat
+    int64_t start = nowUs();
+    for (int i = 0; i < ROUNDS; i++)
+        displayCfgParse(cfg, &loaded, NULL, 0);
+    int64_t textUs = nowUs() - start;
+    start = nowUs();
+    for (int i = 0; i < ROUNDS; i++)
+        displayCfgLoad(cfg, &loaded, &status);
+    int64_t binUs = nowUs() - start;
+
+    //the text edited after the compile, it is parsed
+    writeFile(cfg, "TV gxtvbb 1080p\n");
+    CHECK(displayCfgReadBin(bin, cfg, &loaded) == DISPLAY_CFG_BIN_STALE);
+    CHECK(displayCfgLoad(cfg, &loaded, &status) == DISPLAY_CFG_FROM_TEXT);
+    CHECK(status == DISPLAY_CFG_BIN_STALE);
+    CHECK(loaded.type == DISPLAY_TYPE_TV);
+
+    //the same size, another soc
+    writeFile(cfg, "MBOX gxbaby 1080p\n");
+    CHECK(displayCfgParse(cfg, &config, error, sizeof(error)) == 0);
+    CHECK(displayCfgWriteBin(bin, &config, cfg) == 0);
+    CHECK(displayCfgLoad(cfg, &loaded, &status) == DISPLAY_CFG_FROM_BIN);
+    writeFile(cfg, "MBOX gxtvbb 1080p\n");
+    CHECK(displayCfgLoad(cfg, &loaded, &status) == DISPLAY_CFG_FROM_TEXT);
+    CHECK(status == DISPLAY_CFG_BIN_STALE);
+    CHECK(!strcmp(loaded.socType, "gxtvbb"));
+
+    //as in the system image, the text has the bytes it was compiled from but a fixed time
+    writeFile(cfg, "MBOX gxbaby 1080p\n");
+    CHECK(displayCfgWriteBin(bin, &config, cfg) == 0);
+    struct timespec times[2] = { { 0, UTIME_OMIT }, { 1230768000, 0 } };
+    CHECK(utimensat(AT_FDCWD, cfg, times, 0) == 0);
+    CHECK(displayCfgReadBin(bin, cfg, &loaded) == DISPLAY_CFG_BIN_OK);
+    CHECK(displayCfgLoad(cfg, &loaded, &status) == DISPLAY_CFG_FROM_BIN);
+    CHECK(status == DISPLAY_CFG_BIN_OK);
+    CHECK(!memcmp(&loaded, &config, sizeof(config)));
+    start = nowUs();
+    for (int i = 0; i < ROUNDS; i++)
+        displayCfgLoad(cfg, &loaded, &status);
+    int64_t binCrcUs = nowUs() - start;
+
+    //without the text, the binary is the config
+    unlink(cfg);
+    CHECK(displayCfgLoad(cfg, &loaded, &status) == DISPLAY_CFG_FROM_BIN);
+    CHECK(loaded.type == DISPLAY_TYPE_MBOX);
+
+    //a flipped byte in the config
+    writeFile(cfg, "MBOX gxbaby 1080p\n");
+    CHECK(displayCfgWriteBin(bin, &config, cfg) == 0);
+    int fd = open(bin, O_RDWR);
+    char c = 'x';
+    pwrite(fd, &c, 1, sizeof(display_cfg_header_t) + 4);
+    close(fd);
+    CHECK(displayCfgReadBin(bin, cfg, &loaded) == DISPLAY_CFG_BIN_CORRUPT);
+    CHECK(displayCfgLoad(cfg, &loaded, &status) == DISPLAY_CFG_FROM_TEXT);
+    CHECK(!strcmp(loaded.socType, "gxbaby"));
+
+    //a binary of another version
+    CHECK(displayCfgWriteBin(bin, &config, cfg) == 0);
+    uint32_t version = DISPLAY_CFG_VERSION + 1;
+    fd = open(bin, O_RDWR);
+    pwrite(fd, &version, sizeof(version), 4);
+    close(fd);
+    CHECK(displayCfgReadBin(bin, cfg, &loaded) == DISPLAY_CFG_BIN_VERSION);
+
+    //truncated
+    CHECK(displayCfgWriteBin(bin, &config, cfg) == 0);
+    CHECK(truncate(bin, sizeof(display_cfg_header_t) + 8) == 0);
+    CHECK(displayCfgReadBin(bin, cfg, &loaded) == DISPLAY_CFG_BIN_CORRUPT);
+
+    //a tablet
+    writeFile(cfg, "MID m8 1280 720 32 1 1280 720 32 0\n");
+    CHECK(displayCfgParse(cfg, &config, error, sizeof(error)) == 0);
+    CHECK(displayCfgCheck(&config, error, sizeof(error)) == 0);
+    CHECK(config.type == DISPLAY_TYPE_TABLET);
+    CHECK(config.fb0Width == 1280 && config.fb1Height == 720 && config.fb0Bits == 32);
+    CHECK(config.fb0Triple == 1 && config.fb1Triple == 0);
+
+    //the checker: a bad keyword, a missing field, an extra token, bad values
+    writeFile(cfg, "MBOX gxbaby 1080p\nBOX gxl 720p\n");
+    CHECK(displayCfgParse(cfg, &config, error, sizeof(error)) == 1);
+    CHECK(strstr(error, ":2: expected keyword") != NULL);
+    //the lines before the bad one are kept
+    CHECK(!strcmp(config.socType, "gxbaby"));
+
+    writeFile(cfg, "TV gxtvbb\n");
+    CHECK(displayCfgParse(cfg, &config, error, sizeof(error)) == 1);
+    CHECK(strstr(error, "default UI") != NULL);
+
+    writeFile(cfg, "MBOX gxl 720p 60hz\n");
+    CHECK(displayCfgParse(cfg, &config, error, sizeof(error)) == 1);
+    CHECK(strstr(error, "extra token") != NULL);
+
+    writeFile(cfg, "MBOX gxl 576p\n");
+    CHECK(displayCfgParse(cfg, &config, error, sizeof(error)) == 0);
+    CHECK(displayCfgCheck(&config, error, sizeof(error)) == 1);
+    CHECK(strstr(error, "unknown default UI") != NULL);
+
+    writeFile(cfg, "MID m8 1280 720 8 1 0 720 32 0\n");
+    CHECK(displayCfgParse(cfg, &config, error, sizeof(error)) == 0);
+    CHECK(displayCfgCheck(&config, error, sizeof(error)) == 2);
+
+    //no text and no binary
+    unlink(cfg);
+    unlink(bin);
+    CHECK(displayCfgLoad(cfg, &loaded, &status) == DISPLAY_CFG_FROM_NONE);
+    rmdir(dir);
+
+    printf("%d loads: text parse %.2fus, binary with the text stat %.2fus, with its crc %.2fus\n",
+        ROUNDS, (double)textUs/ROUNDS, (double)binUs/ROUNDS, (double)binCrcUs/ROUNDS);
+    printf("%s, %d failed\n", (sFailed == 0)?"PASS":"FAIL", sFailed);
+    return (sFailed == 0)?0:1;
+}
@@ -0,0 +1,540 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/06/20
+ *  @par function description:
+ *  - 1 the display stack of a box on the host: a fake sysfs tree, a bootenv file on tmpfs
+ *  - 2 the system properties and init services in memory
+ *  - 3 a fake kernel: hdcp authenticated after a delay, with the hdcp uevent
+ *  - 4 the TVs captured in tests/edid are plugged with the hdmi uevent
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include <cutils/properties.h>
+#include <cutils/klog.h>
+#include "display_sim.h"
+#include "SysfsCache.h"
+#include "UeventDispatcher.h"
+#include "ubootenv.h"
+
+#define SIM_ENV_SIZE            0x10000
+#define SIM_PROPERTIES          128
+#define SIM_KERNEL_POLL_US      1000
+
+typedef struct sim_node {
+    const char *path;
+    const char *value;
+} sim_node_t;
+
+//the nodes of a box without TV, the ones DisplayMode and Dimension use
+static const sim_node_t NODES[] = {
+    { SYSFS_DISPLAY_MODE,               "576cvbs" },
+    { SYSFS_DISPLAY_MODE2,              "null" },
+    { SYSFS_DISPLAY_AXIS,               "0 0 1919 1079 0 0 18 18" },
+    { SYSFS_VIDEO_AXIS,                 "0 0 0 0" },
+    { SYSFS_BOOT_TYPE,                  "normal" },
+    { SYSFS_VIDEO_LAYER_STATE,          "0" },
+    { DISPLAY_FB0_BLANK,                "0" },
+    { DISPLAY_FB1_BLANK,                "0" },
+    { DISPLAY_LOGO_INDEX,               "1" },
+    { SYS_DISABLE_VIDEO,                "1" },
+    { DISPLAY_FB0_FREESCALE,            "0" },
+    { DISPLAY_FB1_FREESCALE,            "0" },
+    { DISPLAY_FB0_FREESCALE_MODE,       "1" },
+    { DISPLAY_FB1_FREESCALE_MODE,       "0" },
+    { DISPLAY_FB0_SCALE_AXIS,           "0 0 1919 1079" },
+    { DISPLAY_FB1_SCALE_AXIS,           "0 0 1919 1079" },
+    { DISPLAY_FB1_SCALE,                "0" },
+    { DISPLAY_FB0_FREESCALE_AXIS,       "0 0 1919 1079" },
+    { DISPLAY_FB0_WINDOW_AXIS,          "0 0 719 575" },
+    { DISPLAY_FB0_FREESCALE_SWTICH,     "0" },
+    { DISPLAY_HDMI_HDCP_VER,            "00" },
+    { DISPLAY_HDMI_HDCP_MODE,           "0" },
+    { DISPLAY_HDMI_HDCP_AUTH,           "0" },
+    { DISPLAY_HDMI_HDCP_CONF,           "" },
+    { DISPLAY_HDMI_HDCP_KEY,            "00" },
+    { DISPLAY_HDMI_HDCP_POWER,          "0" },
+    { DISPLAY_HPD_STATE,                "0" },
+    { DISPLAY_HDMI_EDID,                "" },
+    { DISPLAY_HDMI_DEEP_COLOR,          "" },
+    { DISPLAY_HDMI_HDR,                 "" },
+    { DISPLAY_HDMI_VIC,                 "0" },
+    { DISPLAY_HDMI_AVMUTE,              "0" },
+    { DISPLAY_EDID_VALUE,               "" },
+    { DISPLAY_HDMI_PHY,                 "1" },
+    { AUDIO_DSP_DIGITAL_RAW,            "0" },
+    { AV_HDMI_CONFIG,                   "" },
+    { AV_HDMI_3D_SUPPORT,               "0" },
+    { HDMI_TX_PLUG_STATE,               "0" },
+    { HDMI_RX_HPD_STATE,                "0" },
+    { HDMI_RX_KEY_COMBINE,              "0" },
+};
+
+typedef struct sim_property {
+    char key[PROPERTY_KEY_MAX*2];
+    char value[PROPERTY_VALUE_MAX];
+} sim_property_t;
+
+static pthread_mutex_t sPropLock = PTHREAD_MUTEX_INITIALIZER;
+static sim_property_t sProps[SIM_PROPERTIES];
+static int sPropCount = 0;
+
+static char sRoot[SIM_ROOT_LEN];
+static char sCfgPath[SIM_PATH_LEN];
+static char sEnvPath[32];
+static sim_config_t sConfig;
+static DisplayMode *sDisplayMode = NULL;
+static int sSeqnum = 1000;
+
+static pthread_t sKernel;
+static volatile bool sKernelExit = false;
+//the hdcp nodes as created, a write before the kernel thread run is not missed
+static int64_t sModeTime = 0;
+static int64_t sCtrlTime = 0;
+static volatile int64_t sPlugUs = 0;
+static volatile int64_t sHdcpAuthUs = 0;
+
+int64_t simNowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+//SYS_LOG of RECOVERY_MODE, the libcutils of the host has no klog. the errors go to stderr
+extern "C" void klog_write(int level, const char *fmt, ...) {
+    if (level > KLOG_ERROR_LEVEL)
+        return;
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+
+//the properties of the box, init start and stop the services on ctl.start and ctl.stop
+extern "C" int property_get(const char *key, char *value, const char *default_value) {
+    pthread_mutex_lock(&sPropLock);
+    for (int i = 0; i < sPropCount; i++) {
+        if (!strcmp(sProps[i].key, key)) {
+            strcpy(value, sProps[i].value);
+            pthread_mutex_unlock(&sPropLock);
+            return strlen(value);
+        }
+    }
+    pthread_mutex_unlock(&sPropLock);
+
+    if (default_value == NULL) {
+        value[0] = 0;
+        return 0;
+    }
+    //the callers pass buffers shorter than PROPERTY_VALUE_MAX, copy the string only
+    int len = strlen(default_value);
+    if (len > PROPERTY_VALUE_MAX - 1)
+        len = PROPERTY_VALUE_MAX - 1;
+    memcpy(value, default_value, len);
+    value[len] = 0;
+    return len;
+}
+
+extern "C" int property_set(const char *key, const char *value) {
+    char svc[PROPERTY_KEY_MAX*2];
+    if (!strcmp(key, "ctl.start") || !strcmp(key, "ctl.stop")) {
+        snprintf(svc, sizeof(svc), "init.svc.%s", value);
+        simSetProperty(svc, strcmp(key, "ctl.start")?"stopped":"running");
+        return 0;
+    }
+    simSetProperty(key, value);
+    return 0;
+}
+
+void simSetProperty(const char *key, const char *value) {
+    pthread_mutex_lock(&sPropLock);
+    int i = 0;
+    while (i < sPropCount && strcmp(sProps[i].key, key))
+        i++;
+    if (i == sPropCount && sPropCount < SIM_PROPERTIES) {
+        strncpy(sProps[i].key, key, sizeof(sProps[i].key) - 1);
+        sPropCount++;
+    }
+    if (i < SIM_PROPERTIES) {
+        strncpy(sProps[i].value, value, PROPERTY_VALUE_MAX - 1);
+        sProps[i].value[PROPERTY_VALUE_MAX - 1] = 0;
+    }
+    pthread_mutex_unlock(&sPropLock);
+}
+
+static void nodePath(char *path, const char *node) {
+    snprintf(path, SIM_PATH_LEN, "%s%s", sRoot, node);
+}
+
+//the sysfs nodes of SysfsCache are the files under sRoot
+static int simOpen(const char *node, int flags) {
+    char path[SIM_PATH_LEN];
+    if (strncmp(node, "/sys/", 5))
+        return open(node, flags);
+    nodePath(path, node);
+    return open(path, flags);
+}
+
+//sysfs replace the value in a write, a file keep the tail of a longer one
+static ssize_t simPwrite(int fd, const void *buf, size_t count, off_t offset) {
+    ssize_t ret = pwrite(fd, buf, count, offset);
+    if (ret >= 0 && ftruncate(fd, offset + ret) < 0)
+        return -1;
+    return ret;
+}
+
+static const sysfs_ops_t SIM_OPS = { simOpen, pread, simPwrite };
+
+static int mkdirs(const char *path) {
+    char dir[SIM_PATH_LEN];
+    strcpy(dir, path);
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/')
+            continue;
+        *p = 0;
+        mkdir(dir, 0755);
+        *p = '/';
+    }
+    return 0;
+}
+
+int simWriteNode(const char *node, const char *value) {
+    char path[SIM_PATH_LEN];
+    nodePath(path, node);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    int len = strlen(value);
+    int ret = (write(fd, value, len) == len)?0:-1;
+    close(fd);
+    return ret;
+}
+
+int simReadNode(const char *node, char *value, int size) {
+    char path[SIM_PATH_LEN];
+    nodePath(path, node);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    int len = read(fd, value, size - 1);
+    close(fd);
+    if (len < 0)
+        return -1;
+    value[len] = 0;
+    while (len > 0 && value[len - 1] == '\n')
+        value[--len] = 0;
+    return len;
+}
+
+int64_t simWaitNode(const char *node, const char *value, int timeoutUs) {
+    char buf[MAX_STR_LEN];
+    int64_t start = simNowUs();
+    while (simNowUs() - start < timeoutUs) {
+        if (simReadNode(node, buf, sizeof(buf)) >= 0 && !strcmp(buf, value))
+            return simNowUs() - start;
+        usleep(1000);
+    }
+    return -1;
+}
+
+//last modify time of the node, a write of the same value is seen
+static int64_t nodeTime(const char *node) {
+    char path[SIM_PATH_LEN];
+    struct stat st;
+    nodePath(path, node);
+    if (stat(path, &st) < 0)
+        return 0;
+    return (int64_t)st.st_mtim.tv_sec*1000000000 + st.st_mtim.tv_nsec;
+}
+
+//the hdcp of the driver and the hdcp_tx22 service: authenticated after the delay of the config
+static void *kernelLoop(void *data) {
+    (void)data;
+    int64_t modeTime = sModeTime;
+    int64_t ctrlTime = sCtrlTime;
+    int64_t startUs = 0;
+    bool hdcp22 = false;
+
+    while (!sKernelExit) {
+        char value[MODE_LEN];
+        int64_t mode = nodeTime(DISPLAY_HDMI_HDCP_MODE);
+        int64_t ctrl = nodeTime(DISPLAY_HDMI_HDCP_CONF);
+        //both written since the last poll are done in their order, a stop then a start or the other way
+        bool stopLast = (ctrl != ctrlTime) && (mode == modeTime || ctrl > mode);
+        if (ctrl != ctrlTime && !stopLast) {
+            startUs = 0;
+            simWriteNode(DISPLAY_HDMI_HDCP_AUTH, "0");
+        }
+        ctrlTime = ctrl;
+
+        if (mode != modeTime) {
+            modeTime = mode;
+            simReadNode(DISPLAY_HDMI_HDCP_MODE, value, sizeof(value));
+            if (!strcmp(value, DISPLAY_HDMI_HDCP_22) || !strcmp(value, DISPLAY_HDMI_HDCP_14)) {
+                hdcp22 = !strcmp(value, DISPLAY_HDMI_HDCP_22);
+                startUs = simNowUs();
+            } else {
+                startUs = 0;
+                simWriteNode(DISPLAY_HDMI_HDCP_AUTH, "0");
+            }
+        }
+
+        if (stopLast) {
+            startUs = 0;
+            simWriteNode(DISPLAY_HDMI_HDCP_AUTH, "0");
+        }
+
+        if (startUs > 0) {
+            //2.2 is done by the hdcp_tx22 service
+            char svc[PROPERTY_VALUE_MAX];
+            property_get(PROP_HDCP_TX22_SVC, svc, "stopped");
+            bool ready = !hdcp22 || !strcmp(svc, "running");
+            if (ready && simNowUs() - startUs >= (hdcp22?sConfig.hdcp22Us:sConfig.hdcp14Us)) {
+                startUs = 0;
+                simWriteNode(DISPLAY_HDMI_HDCP_AUTH, "1");
+                sHdcpAuthUs = simNowUs() - sPlugUs;
+                simUevent(HDMI_TX_HDCP_UEVENT, "hdcp", HDMI_TX_HDCP_AUTH_OK, false);
+            }
+        }
+        usleep(SIM_KERNEL_POLL_US);
+    }
+    return NULL;
+}
+
+//a legacy image as written by uboot on the first boot
+static int createEnv(const char *dir) {
+    char data[256];
+    uint8_t *image = (uint8_t *)calloc(1, SIM_ENV_SIZE);
+    if (image == NULL)
+        return -1;
+
+    int len = snprintf(data, sizeof(data), "bootcmd=run storeboot%coutputmode=576cvbs%c"
+        "hdmimode=1080p60hz%ccvbsmode=576cvbs%cdigitaudiooutput=PCM%cfirstboot=1%c",
+        0, 0, 0, 0, 0, 0);
+    memcpy(image + sizeof(uint32_t), data, len + 1);
+    uint32_t crc = crc32(0, image + sizeof(uint32_t), SIM_ENV_SIZE - sizeof(uint32_t));
+    memcpy(image, &crc, sizeof(crc));
+
+    snprintf(sEnvPath, sizeof(sEnvPath), "%s/simenv_XXXXXX", dir);
+    int fd = mkstemp(sEnvPath);
+    int ret = -1;
+    if (fd >= 0) {
+        ret = (write(fd, image, SIM_ENV_SIZE) == SIM_ENV_SIZE)?0:-1;
+        close(fd);
+    }
+    free(image);
+    if (ret < 0)
+        return -1;
+    return bootenv_init_file(sEnvPath, SIM_ENV_SIZE);
+}
+
+void simDefaultConfig(sim_config_t *config) {
+    memset(config, 0, sizeof(sim_config_t));
+    strcpy(config->cfg, "MBOX gxbaby 1080p\n");
+    strcpy(config->hdcpKey, "22");
+    config->hdcp22Us = 300000;
+    config->hdcp14Us = 150000;
+    config->bootanim = true;
+}
+
+int simInit(const char *dir, const sim_config_t *config) {
+    sConfig = *config;
+    int len = snprintf(sRoot, sizeof(sRoot), "%s/display_sim_XXXXXX", dir);
+    if (len < 0 || len >= (int)sizeof(sRoot) || mkdtemp(sRoot) == NULL)
+        return -1;
+
+    char path[SIM_PATH_LEN];
+    for (unsigned int i = 0; i < sizeof(NODES)/sizeof(NODES[0]); i++) {
+        nodePath(path, NODES[i].path);
+        mkdirs(path);
+        if (simWriteNode(NODES[i].path, NODES[i].value) < 0)
+            return -1;
+    }
+    simWriteNode(DISPLAY_HDMI_HDCP_KEY, config->hdcpKey);
+
+    snprintf(sCfgPath, sizeof(sCfgPath), "%s/mesondisplay.cfg", sRoot);
+    FILE *fp = fopen(sCfgPath, "w");
+    if (fp == NULL)
+        return -1;
+    fputs(config->cfg, fp);
+    fclose(fp);
+
+    //the env partition on tmpfs, it is written as often as the flash
+    const char *envDir = (access("/dev/shm", W_OK) == 0)?"/dev/shm":dir;
+    if (createEnv(envDir) < 0)
+        return -1;
+    bootenv_set_flush_delay(BOOTENV_FLUSH_DELAY_MS);
+
+    SysfsCache::getInstance()->setOps(&SIM_OPS);
+    SysfsCache::getInstance()->reset();
+
+    //the bootanimation is up at once, without delay
+    simSetProperty(PROP_BOOTANIM, config->bootanim?"running":"stopped");
+    simSetProperty(PROP_BOOTANIM_DELAY, "0");
+
+    sModeTime = nodeTime(DISPLAY_HDMI_HDCP_MODE);
+    sCtrlTime = nodeTime(DISPLAY_HDMI_HDCP_CONF);
+    sKernelExit = false;
+    return pthread_create(&sKernel, NULL, kernelLoop, NULL);
+}
+
+static int removeNode(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+void simExit() {
+    sKernelExit = true;
+    pthread_join(sKernel, NULL);
+    bootenv_commit();
+    nftw(sRoot, removeNode, 16, FTW_DEPTH | FTW_PHYS);
+    unlink(sEnvPath);
+    sDisplayMode = NULL;
+}
+
+const char *simConfigPath() {
+    return sCfgPath;
+}
+
+void simAttach(DisplayMode *displayMode) {
+    sDisplayMode = displayMode;
+}
+
+int simUevent(const char *devpath, const char *name, const char *state, bool wait) {
+    char line[UEVENT_MSG_LEN];
+    char buf[UEVENT_MSG_LEN];
+
+    //devpath is "DEVPATH=/devices/...", as the defines of DisplayMode
+    const char *path = strchr(devpath, '=') + 1;
+    snprintf(line, sizeof(line), "change@%s ACTION=change DEVPATH=%s SUBSYSTEM=switch "
+        "SWITCH_NAME=%s SWITCH_STATE=%s SEQNUM=%d", path, path, name, state, sSeqnum++);
+    int len = ueventFromText(line, buf, sizeof(buf));
+    if (sDisplayMode == NULL)
+        return -1;
+    return sDisplayMode->injectUevent(buf, len, wait);
+}
+
+//the sections of a capture, "#disp_cap" followed by the text of the node
+int simLoadTv(const char *path, sim_tv_t *tv) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return -1;
+
+    memset(tv, 0, sizeof(sim_tv_t));
+    const char *name = strrchr(path, '/');
+    strncpy(tv->name, (name != NULL)?name + 1:path, sizeof(tv->name) - 1);
+    char *dot = strrchr(tv->name, '.');
+    if (dot != NULL)
+        *dot = 0;
+
+    char line[512];
+    char *section = NULL;
+    int size = 0;
+    bool expect = false;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\n")] = 0;
+        if (line[0] == '#') {
+            expect = false;
+            section = NULL;
+            if (!strcmp(line, "#crc")) {
+                section = tv->crc;
+                size = sizeof(tv->crc);
+            } else if (!strcmp(line, "#disp_cap")) {
+                section = tv->dispCap;
+                size = sizeof(tv->dispCap);
+            } else if (!strcmp(line, "#dc_cap")) {
+                section = tv->dcCap;
+                size = sizeof(tv->dcCap);
+            } else if (!strcmp(line, "#support_3d")) {
+                section = tv->support3d;
+                size = sizeof(tv->support3d);
+            } else if (!strcmp(line, "#hdr_cap")) {
+                section = tv->hdrCap;
+                size = sizeof(tv->hdrCap);
+            } else if (!strcmp(line, "#expect")) {
+                expect = true;
+            }
+            continue;
+        }
+
+        if (expect) {
+            if (!strncmp(line, "highest ", 8)) {
+                size_t len = strnlen(line + 8, sizeof(tv->output) - 1);
+                memcpy(tv->output, line + 8, len);
+                tv->output[len] = '\0';
+            }
+        } else if (section != NULL && (int)(strlen(section) + strlen(line) + 2) < size) {
+            //crc and support_3d are one line, the others keep the lines
+            if (section != tv->crc && section != tv->support3d)
+                strcat(line, "\n");
+            strcat(section, line);
+        }
+    }
+    fclose(fp);
+
+    strcpy(tv->hdcpVer, (strstr(tv->hdrCap, "SMPTE ST 2084: 1") != NULL)?"22":"14");
+    return 0;
+}
+
+void simPlug(const sim_tv_t *tv, bool wait) {
+    char edid[128];
+    snprintf(edid, sizeof(edid), "%s%s\n", DEFAULT_EDID_CRCHEAD, tv->crc);
+
+    simWriteNode(DISPLAY_HDMI_EDID, tv->dispCap);
+    simWriteNode(DISPLAY_HDMI_DEEP_COLOR, tv->dcCap);
+    simWriteNode(AV_HDMI_3D_SUPPORT, tv->support3d);
+    simWriteNode(DISPLAY_HDMI_HDR, tv->hdrCap);
+    simWriteNode(DISPLAY_EDID_VALUE, edid);
+    simWriteNode(DISPLAY_HDMI_HDCP_VER, tv->hdcpVer);
+    simWriteNode(DISPLAY_HPD_STATE, "1");
+    simWriteNode(HDMI_TX_PLUG_STATE, "1");
+
+    sHdcpAuthUs = 0;
+    sPlugUs = simNowUs();
+    simUevent(HDMI_TX_PLUG_UEVENT, "hdmi", "1", wait);
+}
+
+void simUnplug(bool wait) {
+    simWriteNode(DISPLAY_HDMI_EDID, "");
+    simWriteNode(DISPLAY_HDMI_DEEP_COLOR, "");
+    simWriteNode(DISPLAY_HDMI_HDR, "");
+    simWriteNode(DISPLAY_EDID_VALUE, "");
+    simWriteNode(DISPLAY_HDMI_HDCP_VER, "00");
+    simWriteNode(DISPLAY_HDMI_HDCP_AUTH, "0");
+    simWriteNode(DISPLAY_HPD_STATE, "0");
+    simWriteNode(HDMI_TX_PLUG_STATE, "0");
+
+    sHdcpAuthUs = 0;
+    sPlugUs = simNowUs();
+    simUevent(HDMI_TX_PLUG_UEVENT, "hdmi", "0", wait);
+}
+
+int64_t simHdcpAuthUs() {
+    return sHdcpAuthUs;
+}
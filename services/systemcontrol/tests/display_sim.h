@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/06/20
+ *  @par function description:
+ *  - 1 the display stack of a box on the host: a fake sysfs tree, a bootenv file on tmpfs
+ *  - 2 the system properties and init services in memory
+ *  - 3 a fake kernel: hdcp authenticated after a delay, with the hdcp uevent
+ *  - 4 the TVs captured in tests/edid are plugged with the hdmi uevent
+ */
+
+#ifndef DISPLAY_SIM_H
+#define DISPLAY_SIM_H
+
+#include <stdint.h>
+#include <limits.h>
+
+#include "DisplayMode.h"
+
+//the root stays short so a node path under it always fits
+#define SIM_ROOT_LEN            256
+#define SIM_PATH_LEN            PATH_MAX
+
+//a TV of tests/edid, its nodes are written on plug
+typedef struct sim_tv {
+    char name[64];
+    char crc[EDID_CRC_LEN];
+    char dispCap[MAX_STR_LEN];
+    char dcCap[MAX_STR_LEN];
+    char support3d[MODE_LEN];
+    char hdrCap[MAX_STR_LEN];
+    char output[MODE_LEN];      //"highest" of the #expect section, the box is built without USE_BEST_MODE
+    char hdcpVer[MODE_LEN];     //"22" for the TVs with hdr, "14" for the others
+} sim_tv_t;
+
+typedef struct sim_config {
+    char cfg[MAX_STR_LEN];      //the text of mesondisplay.cfg
+    char hdcpKey[MODE_LEN];     //hdcp_lstore of the box
+    int hdcp22Us;               //the fake hdcp_tx22 authenticate after this delay
+    int hdcp14Us;
+    bool bootanim;              //init.svc.bootanim is running at boot
+} sim_config_t;
+
+void simDefaultConfig(sim_config_t *config);
+
+//create the sysfs tree and the bootenv file under dir, start the fake kernel
+int simInit(const char *dir, const sim_config_t *config);
+//stop the fake kernel and remove the files
+void simExit();
+const char *simConfigPath();
+
+//the uevents of the fake kernel are injected into the display mode
+void simAttach(DisplayMode *displayMode);
+
+//node is the path on the box, /sys/class/...
+int simWriteNode(const char *node, const char *value);
+int simReadNode(const char *node, char *value, int size);
+//poll the node every 1ms, return the time it took or -1
+int64_t simWaitNode(const char *node, const char *value, int timeoutUs);
+
+int simLoadTv(const char *path, sim_tv_t *tv);
+//write the nodes of the tv and send the hdmi uevent, wait the handlers if wait
+void simPlug(const sim_tv_t *tv, bool wait);
+void simUnplug(bool wait);
+//a switch uevent, as the kernel send it
+int simUevent(const char *devpath, const char *name, const char *state, bool wait);
+
+void simSetProperty(const char *key, const char *value);
+//0 if the hdcp was not authenticated by the fake kernel since the last plug
+int64_t simHdcpAuthUs();
+
+int64_t simNowUs();
+
+#endif // DISPLAY_SIM_H
@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/24
+ *  @par function description:
+ *  - 1 parse the captured hdmi tx nodes of the TVs in the corpus dir
+ *  - 2 check the mode decisions with the #expect section of each capture
+ *  - 3 the table give the same best and highest mode as the old text scan
+ *  - usage: edid_caps_test [corpus dir], default ./edid
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <time.h>
+
+#include "EdidCaps.h"
+
+#define DECISION_ROUNDS         1000
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+//the nodes of a TV, as "#disp_cap" followed by the text of the node
+typedef struct capture {
+    char crc[EDID_CRC_LEN];
+    char dispCap[MAX_STR_LEN];
+    char dcCap[MAX_STR_LEN];
+    char support3d[MODE_LEN];
+    char hdrCap[MAX_STR_LEN];
+    char expect[MAX_STR_LEN];
+} capture_t;
+
+static int64_t nowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static int loadCapture(const char *path, capture_t *cap) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return -1;
+
+    memset(cap, 0, sizeof(capture_t));
+    char line[256];
+    char *section = NULL;
+    int size = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (line[0] == '#') {
+            line[strcspn(line, "\n")] = 0;
+            if (!strcmp(line, "#crc")) {
+                section = cap->crc;
+                size = EDID_CRC_LEN;
+            } else if (!strcmp(line, "#disp_cap")) {
+                section = cap->dispCap;
+                size = MAX_STR_LEN;
+            } else if (!strcmp(line, "#dc_cap")) {
+                section = cap->dcCap;
+                size = MAX_STR_LEN;
+            } else if (!strcmp(line, "#support_3d")) {
+                section = cap->support3d;
+                size = MODE_LEN;
+            } else if (!strcmp(line, "#hdr_cap")) {
+                section = cap->hdrCap;
+                size = MAX_STR_LEN;
+            } else if (!strcmp(line, "#expect")) {
+                section = cap->expect;
+                size = MAX_STR_LEN;
+            }
+            //others are comments
+            continue;
+        }
+
+        if (section != NULL && (int)(strlen(section) + strlen(line)) < size)
+            strcat(section, line);
+    }
+    fclose(fp);
+
+    cap->crc[strcspn(cap->crc, "\n")] = 0;
+    return 0;
+}
+
+//the text scan of DisplayMode::getBestHdmiMode before the table
+static void oldBestMode(char *mode, const char *edid) {
+    const char *pos = strchr(edid, '*');
+    mode[0] = 0;
+    if (pos != NULL) {
+        const char *findReturn = pos;
+        while (findReturn >= edid && *findReturn != 0x0a) {
+            findReturn--;
+        }
+        findReturn = findReturn + 1;
+        strncpy(mode, findReturn, pos - findReturn);
+        mode[pos - findReturn] = 0;
+    }
+}
+
+//the text scan of DisplayMode::getHighestHdmiMode before the table
+static void oldHighestMode(char *mode, const char *edid) {
+    int lenmode = 0, intmode = 0, higmode = 0;
+    char value[MODE_LEN] = {0};
+    char *type;
+    const char *start;
+    const char *pos = edid;
+    mode[0] = 0;
+    do {
+        pos = strstr(pos, "hz");
+        if (pos == NULL) break;
+        start = pos;
+        while (start >= edid && *start != '\n') {
+            start--;
+        }
+        start++;
+        int len = pos - start;
+        strncpy(value, start, len);
+        pos = strstr(pos, "\n");
+
+        if ((type = strchr(value, 'p')) != NULL && type - value >= 3) {
+            value[type - value] = '1';
+        } else if ((type = strchr(value, 'i')) != NULL) {
+            value[type - value] = '0';
+        } else {
+            continue;
+        }
+        value[len] = '\0';
+
+        if ((intmode = atoi(value)) >= higmode) {
+            len = pos - start;
+            if (intmode == higmode && lenmode >= len) continue;
+            lenmode = len;
+            higmode = intmode;
+            strncpy(mode, start, len);
+            if (mode[len - 1] == '*')  mode[len - 1] = '\0';
+            else mode[len] = '\0';
+        }
+    } while (pos != NULL && strlen(pos) > 0);
+}
+
+static const char *modeName(const edid_caps_t *caps, int index) {
+    return (index >= 0)?caps->modes[index].name:"none";
+}
+
+static void checkExpect(const char *name, const edid_caps_t *caps, const char *expect) {
+    char text[MAX_STR_LEN];
+    strcpy(text, expect);
+
+    for (char *line = strtok(text, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+        char key[MODE_LEN] = {0};
+        char value[MODE_LEN] = {0};
+        sscanf(line, "%63s %63s", key, value);
+
+        bool ok = true;
+        if (!strcmp(key, "invalid"))
+            ok = !caps->valid;
+        else if (!strcmp(key, "modes"))
+            ok = (caps->modeCount == atoi(value));
+        else if (!strcmp(key, "best"))
+            ok = !strcmp(modeName(caps, caps->preferred), value);
+        else if (!strcmp(key, "highest"))
+            ok = !strcmp(modeName(caps, caps->highest), value);
+        else if (!strcmp(key, "has"))
+            ok = (edidFindMode(caps, value) != NULL);
+        else if (!strcmp(key, "miss"))
+            ok = (edidFindMode(caps, value) == NULL);
+        else if (!strcmp(key, "10bit"))
+            ok = edidSupportDepth(caps, value, EDID_DEPTH_10BIT);
+        else if (!strcmp(key, "no10bit"))
+            ok = !edidSupportDepth(caps, value, EDID_DEPTH_10BIT);
+        else if (!strcmp(key, "3d"))
+            ok = (caps->support3d == (atoi(value) != 0));
+        else if (!strcmp(key, "hdr10"))
+            ok = (caps->hdr10 == (atoi(value) != 0));
+        else if (!strcmp(key, "hlg"))
+            ok = (caps->hlg == (atoi(value) != 0));
+        else
+            printf("%s: unknown expect %s\n", name, key);
+
+        if (!ok) {
+            printf("FAIL %s: expect %s\n", name, line);
+            sFailed++;
+        }
+    }
+}
+
+static void testCapture(const char *name, const capture_t *cap, EdidCapsCache *cache) {
+    edid_caps_t caps;
+    memset(&caps, 0, sizeof(caps));
+    strcpy(caps.crc, cap->crc);
+
+    int64_t start = nowUs();
+    edidParseCaps(&caps, cap->dispCap, cap->dcCap, cap->support3d, cap->hdrCap);
+    int64_t parseUs = nowUs() - start;
+    cache->countParse(parseUs);
+    cache->put(&caps);
+
+    checkExpect(name, &caps, cap->expect);
+
+    //same decisions as the text scan
+    if (caps.valid) {
+        char mode[MODE_LEN];
+        oldBestMode(mode, cap->dispCap);
+        CHECK(!strcmp((mode[0] != 0)?mode:"none", modeName(&caps, caps.preferred)));
+        oldHighestMode(mode, cap->dispCap);
+        CHECK(!strcmp((mode[0] != 0)?mode:"none", modeName(&caps, caps.highest)));
+    }
+
+    //plugged again: table from the cache, then the best, highest and filter decisions
+    edid_caps_t cached;
+    const char *current = (caps.modeCount > 0)?caps.modes[caps.modeCount - 1].name:"1080p60hz";
+    int found = 0;
+    start = nowUs();
+    for (int i = 0; i < DECISION_ROUNDS; i++) {
+        if (!cache->get(caps.crc, &cached)) {
+            memset(&cached, 0, sizeof(cached));
+            edidParseCaps(&cached, cap->dispCap, cap->dcCap, cap->support3d, cap->hdrCap);
+        }
+        if (edidFindMode(&cached, current) != NULL)
+            found++;
+    }
+    double decisionUs = (double)(nowUs() - start)/DECISION_ROUNDS;
+
+    printf("%-24s crc:%-10s %2d modes, best:%-12s highest:%-14s parse:%lldus decision:%.2fus\n",
+        name, (caps.crc[0] != 0)?caps.crc:"-", caps.modeCount, modeName(&caps, caps.preferred),
+        modeName(&caps, caps.highest), (long long)parseUs, decisionUs);
+    CHECK(found == ((caps.modeCount > 0)?DECISION_ROUNDS:0));
+    CHECK(decisionUs < 1000);
+}
+
+static void testCache(void) {
+    EdidCapsCache cache;
+    edid_caps_t caps;
+    edid_cache_stats_t stats;
+
+    //no crc, or no edid, is never kept
+    memset(&caps, 0, sizeof(caps));
+    edidParseCaps(&caps, "1080p60hz*\n", NULL, NULL, NULL);
+    cache.put(&caps);
+    CHECK(!cache.get("", &caps));
+    strcpy(caps.crc, "0x1");
+    edidParseCaps(&caps, "", NULL, NULL, NULL);
+    cache.put(&caps);
+    CHECK(!cache.get("0x1", &caps));
+
+    //the least recently used TV is dropped
+    for (int i = 0; i <= EDID_CACHE_SIZE; i++) {
+        memset(&caps, 0, sizeof(caps));
+        sprintf(caps.crc, "0x%d", i);
+        edidParseCaps(&caps, "720p60hz\n1080p60hz*\n", NULL, NULL, NULL);
+        cache.put(&caps);
+        //0x0 is used again before the last TV
+        if (i == EDID_CACHE_SIZE - 1)
+            CHECK(cache.get("0x0", &caps));
+    }
+    CHECK(cache.get("0x0", &caps));
+    CHECK(!cache.get("0x1", &caps));
+    CHECK(cache.get("0x4", &caps) && !strcmp(caps.crc, "0x4") && caps.preferred == 1);
+
+    cache.getStats(&stats);
+    CHECK(stats.hits == 3 && stats.misses == 3);
+}
+
+int main(int argc, char **argv) {
+    const char *dirPath = (argc > 1)?argv[1]:"edid";
+    EdidCapsCache cache;
+    capture_t *cap = new capture_t;
+    int count = 0;
+
+    DIR *dir = opendir(dirPath);
+    if (dir == NULL) {
+        printf("FAIL can not open corpus dir %s\n", dirPath);
+        delete cap;
+        return 1;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strstr(entry->d_name, ".txt") == NULL)
+            continue;
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dirPath, entry->d_name);
+        if (loadCapture(path, cap) < 0) {
+            printf("FAIL can not read %s\n", path);
+            sFailed++;
+            continue;
+        }
+        testCapture(entry->d_name, cap, &cache);
+        count++;
+    }
+    closedir(dir);
+    CHECK(count > 0);
+
+    testCache();
+
+    char buf[4096] = {0};
+    cache.dump(buf);
+    printf("%s", buf);
+
+    delete cap;
+    printf("%s, %d captures, %d failed\n", (sFailed == 0)?"PASS":"FAIL", count, sFailed);
+    return (sFailed == 0)?0:1;
+}
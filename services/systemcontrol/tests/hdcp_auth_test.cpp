@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/06/02
+ *  @par function description:
+ *  - 1 the hdcp tx wait return as soon as the uevent thread post the result
+ *  - 2 explicit failure, timeout and thread exit end the wait
+ *  - usage: hdcp_auth_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "HdcpAuth.h"
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+typedef struct poster {
+    HdcpAuthWaiter *waiter;
+    int delayUs;
+    int result;                 //HDCP_AUTH_EXIT to cancel
+} poster_t;
+
+static void *postLoop(void *data) {
+    poster_t *poster = (poster_t *)data;
+    usleep(poster->delayUs);
+    if (HDCP_AUTH_EXIT == poster->result)
+        poster->waiter->cancel();
+    else
+        poster->waiter->post(poster->result);
+    return NULL;
+}
+
+static int waitPosted(HdcpAuthWaiter *waiter, int delayUs, int result, int timeoutUs,
+    int pollUs, hdcp_auth_poll_t poll, void *data, int64_t *elapsedUs) {
+    pthread_t id;
+    poster_t poster = { waiter, delayUs, result };
+
+    pthread_create(&id, NULL, postLoop, &poster);
+    int ret = waiter->wait(timeoutUs, pollUs, poll, data, elapsedUs);
+    pthread_join(id, NULL);
+    return ret;
+}
+
+//the driver report authenticated on the count-th read
+static int pollCount(void *data) {
+    int *count = (int *)data;
+    return (--(*count) <= 0)?HDCP_AUTH_OK:HDCP_AUTH_NONE;
+}
+
+static int pollFail(void *data) {
+    (void)data;
+    return HDCP_AUTH_FAIL;
+}
+
+static int pollNone(void *data) {
+    (void)data;
+    return HDCP_AUTH_NONE;
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    HdcpAuthWaiter waiter;
+    hdcp_auth_stats_t stats;
+    int64_t us = 0;
+
+    //uevent after 30ms, the slow poll of the old kernels do not delay it
+    CHECK(waitPosted(&waiter, 30000, HDCP_AUTH_OK, 8000000, 1000000, pollNone, NULL, &us) == HDCP_AUTH_OK);
+    CHECK(us >= 30000 && us < 80000);
+    printf("uevent after 30ms, wait return in %lldus, 200ms polling took up to 200000us\n", (long long)us);
+    waiter.record(HDCP_AUTH_22_OK, us);
+
+    //without the uevent the driver read find it
+    waiter.clear();
+    int count = 3;
+    CHECK(waiter.wait(8000000, 10000, pollCount, &count, &us) == HDCP_AUTH_OK);
+    CHECK(us >= 20000 && us < 100000);
+    waiter.record(HDCP_AUTH_14_OK, us);
+
+    //hdcp_tx22 quit, fall back at once, not after 8s
+    CHECK(waiter.wait(8000000, 10000, pollFail, NULL, &us) == HDCP_AUTH_FAIL);
+    CHECK(us < 10000);
+    waiter.record(HDCP_AUTH_22_FAIL, us);
+
+    CHECK(waiter.wait(100000, 20000, pollNone, NULL, &us) == HDCP_AUTH_TIMEOUT);
+    CHECK(us >= 100000 && us < 200000);
+    waiter.record(HDCP_AUTH_14_FAIL, us);
+
+    //the result of the last attempt is dropped
+    waiter.post(HDCP_AUTH_OK);
+    waiter.clear();
+    CHECK(waiter.wait(50000, 10000, pollNone, NULL, &us) == HDCP_AUTH_TIMEOUT);
+
+    //thread exit wake the wait up
+    CHECK(waitPosted(&waiter, 20000, HDCP_AUTH_EXIT, 8000000, 1000000, NULL, NULL, &us) == HDCP_AUTH_EXIT);
+    CHECK(us < 80000);
+    CHECK(waiter.wait(8000000, 10000, pollCount, &count, &us) == HDCP_AUTH_EXIT);
+    waiter.reset();
+    count = 1;
+    CHECK(waiter.wait(8000000, 10000, pollCount, &count, &us) == HDCP_AUTH_OK);
+
+    waiter.getStats(&stats);
+    CHECK(stats.count[HDCP_AUTH_22_OK][0] == 1);
+    CHECK(stats.count[HDCP_AUTH_14_OK][0] == 1);
+    CHECK(stats.count[HDCP_AUTH_22_FAIL][0] == 1);
+    CHECK(stats.count[HDCP_AUTH_14_FAIL][2] == 1);
+    CHECK(stats.events == 2);
+
+    char buf[4096] = {0};
+    waiter.dump(buf);
+    printf("%s", buf);
+
+    printf("%s, %d failed\n", (sFailed == 0)?"PASS":"FAIL", sFailed);
+    return (sFailed == 0)?0:1;
+}
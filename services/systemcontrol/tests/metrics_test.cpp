@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/07/11
+ *  @par function description:
+ *  - 1 the entries are found by name, the histograms and percentiles of the latencies
+ *  - 2 the text, key=value and json dumps, the dump is cut at its size
+ *  - 3 records from several threads, a full registry, the cost of a record
+ *  - usage: metrics_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "Metrics.h"
+
+#define THREADS         4
+#define THREAD_RECORDS  100000
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+static void *recordThread(void *data) {
+    int id = *(int *)data;
+    for (int i = 0; i < THREAD_RECORDS; i++)
+        metrics_record(id, i % 100);
+    return NULL;
+}
+
+int main() {
+    metrics_stats_t stats;
+
+    //the same name is the same entry
+    int method = metrics_id("binder.getProperty");
+    CHECK(method >= 0);
+    CHECK(metrics_id("binder.getProperty") == method);
+    CHECK(metrics_id("binder.setProperty") != method);
+    CHECK(metrics_get("binder.none", &stats) < 0);
+
+    //a counter has no latency
+    int counter = metrics_id("bootenv.update");
+    metrics_count(counter, 3);
+    metrics_count(counter, 2);
+    CHECK(metrics_get("bootenv.update", &stats) == 0);
+    CHECK(stats.count == 5 && !stats.timed);
+
+    //0us, 1us, [2, 3]us, [4, 7]us ... buckets
+    for (int i = 0; i < 98; i++)
+        metrics_record(method, 5);
+    metrics_record(method, 0);
+    metrics_record(method, 3000000);
+    CHECK(metrics_get("binder.getProperty", &stats) == 0);
+    CHECK(stats.count == 100 && stats.timed);
+    CHECK(stats.totalUs == 98*5 + 3000000);
+    CHECK(stats.maxUs == 3000000);
+    CHECK(stats.buckets[0] == 1);
+    CHECK(stats.buckets[3] == 98);
+    CHECK(stats.buckets[22] == 1);
+    //the time out of the range is in the last bucket
+    metrics_record(method, (int64_t)1 << 40);
+    CHECK(metrics_get("binder.getProperty", &stats) == 0);
+    CHECK(stats.buckets[METRICS_BUCKETS - 1] == 1);
+    //a negative time is 0
+    metrics_record(method, -5);
+    CHECK(metrics_get("binder.getProperty", &stats) == 0);
+    CHECK(stats.buckets[0] == 2);
+
+    //the dumps
+    char buf[8192] = {0};
+    metrics_dump(buf, sizeof(buf), METRICS_DUMP_TEXT);
+    CHECK(strstr(buf, "binder.getProperty count:102") != NULL);
+    CHECK(strstr(buf, "p50:7us") != NULL);
+    CHECK(strstr(buf, "bootenv.update count:5\n") != NULL);
+    //never used, not in the table
+    CHECK(strstr(buf, "binder.setProperty") == NULL);
+
+    buf[0] = 0;
+    metrics_dump(buf, sizeof(buf), METRICS_DUMP_KV);
+    CHECK(strstr(buf, "binder.getProperty.count=102\n") != NULL);
+    CHECK(strstr(buf, "binder.getProperty.p50_us=7\n") != NULL);
+    CHECK(strstr(buf, "binder.getProperty.buckets=2,0,0,98,") != NULL);
+    CHECK(strstr(buf, "binder.setProperty.count=0\n") != NULL);
+    CHECK(strstr(buf, "bootenv.update.total_us") == NULL);
+
+    buf[0] = 0;
+    metrics_dump(buf, sizeof(buf), METRICS_DUMP_JSON);
+    CHECK(!strncmp(buf, "{\"dropped\": 0, \"metrics\": {", 26));
+    CHECK(strstr(buf, "\"binder.getProperty\": {\"count\": 102, \"total_us\":") != NULL);
+    CHECK(strstr(buf, "\"bootenv.update\": {\"count\": 5}") != NULL);
+    CHECK(!strcmp(buf + strlen(buf) - 4, "\n}}\n"));
+
+    //the dump is appended, and cut at the size
+    char small[64];
+    strcpy(small, "head\n");
+    int len = metrics_dump(small, sizeof(small), METRICS_DUMP_KV);
+    CHECK(len == (int)sizeof(small) - 1);
+    CHECK(len == (int)strlen(small));
+    CHECK(!strncmp(small, "head\nmetrics.dropped=0\n", 23));
+
+    //the ids are kept by reset
+    metrics_reset();
+    CHECK(metrics_get("binder.getProperty", &stats) == 0);
+    CHECK(stats.count == 0 && stats.maxUs == 0);
+    CHECK(metrics_id("binder.getProperty") == method);
+
+    //no record is lost with several threads
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, recordThread, &method);
+    for (int i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+    CHECK(metrics_get("binder.getProperty", &stats) == 0);
+    CHECK(stats.count == THREADS*THREAD_RECORDS);
+    CHECK(stats.maxUs == 99);
+
+    //the cost of a scope, a lookup and a record
+    int64_t start = metrics_now_us();
+    for (int i = 0; i < THREAD_RECORDS; i++) {
+        MetricsScope scope(method);
+    }
+    int64_t scopeUs = metrics_now_us() - start;
+    start = metrics_now_us();
+    for (int i = 0; i < THREAD_RECORDS; i++)
+        metrics_id("sysfs.write./sys/class/display/mode");
+    int64_t lookupUs = metrics_now_us() - start;
+
+    //the names of the paths stop before the reserved entries
+    char name[METRICS_NAME_LEN];
+    int added = 0;
+    for (int i = 0; i < METRICS_MAX; i++) {
+        snprintf(name, sizeof(name), "sysfs.read./sys/node%d", i);
+        if (metrics_id_limited(name) >= 0)
+            added++;
+    }
+    CHECK(added < METRICS_MAX - METRICS_RESERVED);
+    CHECK(metrics_id_limited("sysfs.read./sys/node0") >= 0);
+    CHECK(metrics_id("hdcp.auth22.ok") >= 0);
+
+    //the registry is full, the new names are dropped and the records ignored
+    for (int i = 0; i < METRICS_MAX; i++) {
+        snprintf(name, sizeof(name), "hdcp.kind%d", i);
+        metrics_id(name);
+    }
+    CHECK(metrics_id("sysfs.read./sys/other") < 0);
+    metrics_record(-1, 10);
+    metrics_count(-1, 1);
+    CHECK(metrics_id("binder.getProperty") == method);
+    buf[0] = 0;
+    metrics_dump(buf, sizeof(buf), METRICS_DUMP_KV);
+    CHECK(strstr(buf, "metrics.dropped=") != NULL && strstr(buf, "metrics.dropped=0") == NULL);
+
+    printf("scope %.1fns, lookup %.1fns\n",
+        scopeUs*1000.0/THREAD_RECORDS, lookupUs*1000.0/THREAD_RECORDS);
+    printf("%s, %d failed\n", (sFailed == 0)?"PASS":"FAIL", sFailed);
+    return (sFailed == 0)?0:1;
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/30
+ *  @par function description:
+ *  - 1 plan the mode switches of a mbox and check the steps
+ *  - 2 same mode and axis only switches have no waits and cost a few ms
+ *  - usage: mode_plan_test [-v], -v print the plans
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ModePlan.h"
+
+static int sFailed = 0;
+static bool sVerbose = false;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+static const mode_plan_nodes_t NODES = {
+    "display/mode",
+    "display2/mode",
+    "fb0/free_scale_axis",
+    "fb0/window_axis",
+    "fb0/blank",
+    "fb0/free_scale",
+    "amhdmitx0/avmute",
+    "amhdmitx0/hdcp_mode",
+    "hdmitx20/hdmi_authenticated",
+    "amhdmitx0/phy",
+    "amhdmitx0/vic",
+    "outputmode",
+    "hdmimode",
+    "cvbsmode",
+};
+
+//a 1080p60hz box as the driver report it
+static void currentState(display_state_t *cur) {
+    memset(cur, 0, sizeof(display_state_t));
+    strcpy(cur->mode, "1080p60hz");
+    strcpy(cur->freeScaleAxis, "0 0 1919 1079");
+    strcpy(cur->windowAxis, "window axis is [0 0 1919 1079]");
+    strcpy(cur->fb0Blank, "0");
+    strcpy(cur->fb0FreeScale, "free_scale_enable:[0x10001]");
+    strcpy(cur->envOutputMode, "1080p60hz");
+    strcpy(cur->envHdmiMode, "1080p60hz");
+    strcpy(cur->envCvbsMode, "576cvbs");
+}
+
+static void wantState(display_state_t *want, const char *mode, int w, int h) {
+    memset(want, 0, sizeof(display_state_t));
+    strcpy(want->mode, mode);
+    strcpy(want->freeScaleAxis, "0 0 1919 1079");
+    sprintf(want->windowAxis, "%d %d %d %d", 0, 0, w - 1, h - 1);
+    strcpy(want->fb0Blank, "0");
+    strcpy(want->fb0FreeScale, "0x10001");
+    strcpy(want->envOutputMode, mode);
+    strcpy(want->envHdmiMode, mode);
+}
+
+static int countSteps(const mode_plan_t *plan, int type, const char *path) {
+    int count = 0;
+    for (int i = 0; i < plan->count; i++) {
+        if (plan->steps[i].type == type && (path == NULL || !strcmp(plan->steps[i].path, path)))
+            count++;
+    }
+    return count;
+}
+
+static void printPlan(const char *name, const mode_plan_t *plan) {
+    char buf[8192] = {0};
+    modePlanDump(plan, buf);
+    printf("%-24s %2d steps, %d skipped, cost %d.%03dms\n",
+        name, plan->count, plan->skipped, plan->costUs/1000, plan->costUs%1000);
+    if (sVerbose)
+        printf("%s", buf);
+}
+
+static void testSameValue() {
+    CHECK(modePlanSameValue("0 0 1919 1079", "0 0 1919 1079"));
+    CHECK(modePlanSameValue("window axis is [0 0 1919 1079]", "0 0 1919 1079"));
+    CHECK(modePlanSameValue("free_scale_enable:[0x10001]", "0x10001"));
+    CHECK(modePlanSameValue("-1", "-1"));
+    CHECK(!modePlanSameValue("0 0 1279 719", "0 0 1919 1079"));
+    CHECK(!modePlanSameValue("0x0", "0x10001"));
+    CHECK(!modePlanSameValue("", "0"));
+    //fb0 in the text is a number too, the write is done
+    CHECK(!modePlanSameValue("fb0 blank 0", "0"));
+}
+
+static void testModeSwitch() {
+    display_state_t cur, want;
+    mode_plan_t plan;
+
+    currentState(&cur);
+    wantState(&want, "2160p60hz420", 1920, 1080);
+    want.clearVic = true;
+    modePlanBuild(&plan, &NODES, &cur, &want, OUPUT_MODE_STATE_SWITCH);
+    printPlan("switch to 2160p60hz420", &plan);
+
+    CHECK(plan.writeMode);
+    CHECK(countSteps(&plan, PLAN_STEP_WRITE, NODES.mode) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_WRITE, NODES.avmute) == 2);
+    CHECK(countSteps(&plan, PLAN_STEP_WRITE, NODES.vic) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_WAIT, NODES.hdcpAuth) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_WAIT, NODES.phy) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_HDCP_START, NULL) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_ENV, NULL) == 2);
+    //the axis, blank and free scale are kept
+    CHECK(countSteps(&plan, PLAN_STEP_WRITE, NODES.windowAxis) == 0);
+    CHECK(countSteps(&plan, PLAN_STEP_WRITE, NODES.fb0Blank) == 0);
+    CHECK(plan.skipped == 4);
+    //avmute on is the first step, off is after the notify
+    CHECK(plan.count > 0 && !strcmp(plan.steps[0].path, NODES.avmute));
+    CHECK(plan.steps[plan.count - 3].type == PLAN_STEP_WRITE &&
+        !strcmp(plan.steps[plan.count - 3].value, "-1"));
+}
+
+static void testSameMode() {
+    display_state_t cur, want;
+    mode_plan_t plan;
+
+    currentState(&cur);
+    wantState(&want, "1080p60hz", 1920, 1080);
+    modePlanBuild(&plan, &NODES, &cur, &want, OUPUT_MODE_STATE_SWITCH);
+    printPlan("same mode", &plan);
+    CHECK(plan.count == 0);
+    CHECK(!plan.writeMode);
+}
+
+static void testAxisOnly() {
+    display_state_t cur, want;
+    mode_plan_t plan;
+
+    currentState(&cur);
+    wantState(&want, "1080p60hz", 1900, 1060);
+    modePlanBuild(&plan, &NODES, &cur, &want, OUPUT_MODE_STATE_SWITCH);
+    printPlan("axis only", &plan);
+    CHECK(!plan.writeMode);
+    CHECK(countSteps(&plan, PLAN_STEP_WRITE, NULL) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_WRITE, NODES.windowAxis) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_WAIT, NULL) == 0);
+    CHECK(countSteps(&plan, PLAN_STEP_HDCP_START, NULL) == 0);
+    CHECK(countSteps(&plan, PLAN_STEP_VIDEO_AXIS, NULL) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_OSD_MOUSE, NULL) == 1);
+    CHECK(plan.costUs < 2000);
+}
+
+static void testPowerSameMode() {
+    display_state_t cur, want;
+    mode_plan_t plan;
+
+    currentState(&cur);
+    wantState(&want, "1080p60hz", 1920, 1080);
+    modePlanBuild(&plan, &NODES, &cur, &want, OUPUT_MODE_STATE_POWER);
+    printPlan("plug in same mode", &plan);
+    //the mode is written again after plug in, without the hdcp and phy off waits
+    CHECK(plan.writeMode);
+    CHECK(countSteps(&plan, PLAN_STEP_WRITE, NODES.mode) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_WAIT, NULL) == 0);
+    CHECK(countSteps(&plan, PLAN_STEP_HDCP_START, NULL) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_ENV, NULL) == 0);
+}
+
+static void testInitSameMode() {
+    display_state_t cur, want;
+    mode_plan_t plan;
+
+    currentState(&cur);
+    wantState(&want, "1080p60hz", 1920, 1080);
+    modePlanBuild(&plan, &NODES, &cur, &want, OUPUT_MODE_STATE_INIT);
+    printPlan("boot with uboot mode", &plan);
+    CHECK(!plan.writeMode);
+    CHECK(countSteps(&plan, PLAN_STEP_WRITE, NULL) == 0);
+    CHECK(countSteps(&plan, PLAN_STEP_HDCP_START, NULL) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_BOOTANIM, NULL) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_AUDIO, NULL) == 1);
+}
+
+static void testCvbs() {
+    display_state_t cur, want;
+    mode_plan_t plan;
+
+    currentState(&cur);
+    wantState(&want, "480cvbs", 720, 480);
+    strcpy(want.mode2, "null");
+    strcpy(want.envOutputMode, "480i60hz");
+    strcpy(want.envHdmiMode, "480i60hz");
+    want.cvbs = true;
+    modePlanBuild(&plan, &NODES, &cur, &want, OUPUT_MODE_STATE_SWITCH);
+    printPlan("480i of a cvbs board", &plan);
+    CHECK(countSteps(&plan, PLAN_STEP_WRITE, NODES.mode2) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_HDCP_STOP, NULL) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_HDCP_START, NULL) == 0);
+    CHECK(countSteps(&plan, PLAN_STEP_ENV, NODES.envHdmiMode) == 1);
+    CHECK(countSteps(&plan, PLAN_STEP_ENV, NODES.envCvbsMode) == 0);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && !strcmp(argv[1], "-v"))
+        sVerbose = true;
+
+    testSameValue();
+    testModeSwitch();
+    testSameMode();
+    testAxisOnly();
+    testPowerSameMode();
+    testInitSameMode();
+    testCvbs();
+
+    printf("%s, %d failed\n", (sFailed == 0)?"PASS":"FAIL", sFailed);
+    return (sFailed == 0)?0:1;
+}
@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/05/16
+ *  @par function description:
+ *  - 1 SysWrite read and write a fake sysfs tree in a tmp dir
+ *  - 2 compare the syscalls and latency per read with and without the fd cache
+ *  - 3 only a fd gone with the node is opened again, a refused write is not repeated
+ *  - usage: sysfs_cache_test [tmp dir], default /tmp
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "SysWrite.h"
+#include "SysfsCache.h"
+#include "common.h"
+
+#define POLL_ROUNDS             1000
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+static char sRoot[64];
+
+//the nodes read by the hdcp and mode switch loops
+static const char *sNodes[] = {
+    "display/mode", "amhdmitx0/hpd_state", "amhdmitx0/disp_cap",
+    "amhdmitx0/hdcp_mode", "amhdmitx0/rawedid", "graphics/fb0/blank",
+};
+
+static void nodePath(char *path, const char *node) {
+    sprintf(path, "%s/%s", sRoot, node);
+}
+
+static int writeNode(const char *node, const char *value) {
+    char path[128];
+    nodePath(path, node);
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL)
+        return -1;
+    fputs(value, fp);
+    fclose(fp);
+    return 0;
+}
+
+static int createTree(const char *dir) {
+    char path[128];
+    snprintf(sRoot, sizeof(sRoot), "%s/sysfs_XXXXXX", dir);
+    if (mkdtemp(sRoot) == NULL)
+        return -1;
+
+    sprintf(path, "%s/display", sRoot);
+    mkdir(path, 0755);
+    sprintf(path, "%s/amhdmitx0", sRoot);
+    mkdir(path, 0755);
+    sprintf(path, "%s/graphics", sRoot);
+    mkdir(path, 0755);
+    sprintf(path, "%s/graphics/fb0", sRoot);
+    mkdir(path, 0755);
+
+    writeNode("display/mode", "1080p60hz\n");
+    writeNode("amhdmitx0/hpd_state", "1\n");
+    writeNode("amhdmitx0/disp_cap", "480p60hz\n720p60hz\n1080p60hz*\n2160p30hz\n");
+    writeNode("amhdmitx0/hdcp_mode", "off\n");
+    writeNode("amhdmitx0/rawedid", "00ffffffffffff00");
+    writeNode("graphics/fb0/blank", "0\n");
+    for (int i = 0; i < SYSFS_CACHE_NODES + 16; i++) {
+        char node[32];
+        sprintf(node, "many_%d", i);
+        writeNode(node, "0");
+    }
+    return 0;
+}
+
+static void removeTree(void) {
+    char cmd[96];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", sRoot);
+    if (system(cmd) != 0)
+        printf("can not remove %s\n", sRoot);
+}
+
+static int openFds(void) {
+    int count = 0;
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir == NULL)
+        return -1;
+    while (readdir(dir) != NULL)
+        count++;
+    closedir(dir);
+    return count;
+}
+
+//read the nodes like the hdcp poll loop, return syscalls per read
+static double pollNodes(SysWrite *sysWrite, const char *name) {
+    SysfsCache *cache = SysfsCache::getInstance();
+    sysfs_stats_t stats;
+    char path[128];
+    char value[MAX_STR_LEN + 1];
+    int nodes = sizeof(sNodes)/sizeof(sNodes[0]);
+
+    cache->reset();
+    for (int r = 0; r < POLL_ROUNDS; r++) {
+        for (int i = 0; i < nodes; i++) {
+            nodePath(path, sNodes[i]);
+            CHECK(sysWrite->readSysfs(path, value));
+        }
+    }
+
+    cache->getStats(&stats);
+    double perRead = (double)stats.syscalls/stats.reads;
+    printf("%s: %lld reads, %.2f syscalls per read, %lld hits, avg %.2f us\n",
+        name, (long long)stats.reads, perRead, (long long)stats.hits,
+        (double)stats.readUs/stats.reads);
+    return perRead;
+}
+
+static void testSyscalls(SysWrite *sysWrite) {
+    SysfsCache *cache = SysfsCache::getInstance();
+
+    cache->setEnable(false);
+    double uncached = pollNodes(sysWrite, "open/read/close");
+    CHECK(uncached == 3.0);
+
+    cache->setEnable(true);
+    double cached = pollNodes(sysWrite, "cached fd");
+    CHECK(cached < 1.01);
+}
+
+static void testReadWrite(SysWrite *sysWrite) {
+    char path[128];
+    char value[MAX_STR_LEN + 1];
+
+    //the value written is read back on the same cached fds
+    nodePath(path, "display/mode");
+    CHECK(sysWrite->writeSysfs(path, "720p60hz\n"));
+    CHECK(sysWrite->readSysfs(path, value));
+    CHECK(!strcmp(value, "720p60hz"));
+    CHECK(sysWrite->writeSysfs(path, "576cvbs\n\n"));
+    CHECK(sysWrite->readSysfs(path, value));
+    CHECK(!strcmp(value, "576cvbs"));
+
+    //changed behind the cached fd, pread at 0 get the new value
+    writeNode("amhdmitx0/hpd_state", "0\n");
+    nodePath(path, "amhdmitx0/hpd_state");
+    CHECK(sysWrite->readSysfs(path, value));
+    CHECK(!strcmp(value, "0"));
+
+    //original data keep the new line
+    CHECK(sysWrite->readSysfsOriginal(path, value));
+    CHECK(!strcmp(value, "0\n"));
+}
+
+static void testErrors(SysWrite *sysWrite) {
+    SysfsCache *cache = SysfsCache::getInstance();
+    sysfs_stats_t stats;
+    char path[128];
+    char value[MAX_STR_LEN + 1];
+
+    //failed open do not leak or close a wrong fd
+    cache->reset();
+    int fds = openFds();
+    nodePath(path, "amhdmitx0/not_exist");
+    for (int i = 0; i < 10; i++) {
+        CHECK(!sysWrite->readSysfs(path, value));
+        CHECK(!sysWrite->writeSysfs(path, "1"));
+    }
+    cache->getStats(&stats);
+    CHECK(stats.errors == 20);
+    CHECK(openFds() == fds);
+
+    //nodes out of the prefix are not kept open
+    cache->setPrefix("/sys/");
+    nodePath(path, "display/mode");
+    CHECK(sysWrite->readSysfs(path, value));
+    CHECK(openFds() == fds);
+    cache->setPrefix(sRoot);
+}
+
+//the next writes fail with sFailErrno, the opens and writes are counted
+static int sFailErrno = 0;
+static int sFailWrites = 0;
+static int sOpens = 0;
+static int sWrites = 0;
+
+static int countOpen(const char *path, int flags) {
+    sOpens++;
+    return open(path, flags);
+}
+
+static ssize_t failPwrite(int fd, const void *buf, size_t count, off_t offset) {
+    sWrites++;
+    if (sFailWrites > 0) {
+        sFailWrites--;
+        errno = sFailErrno;
+        return -1;
+    }
+    return pwrite(fd, buf, count, offset);
+}
+
+static const sysfs_ops_t FAIL_OPS = { countOpen, pread, failPwrite };
+
+static void testRetry(SysWrite *sysWrite) {
+    SysfsCache *cache = SysfsCache::getInstance();
+    char path[128];
+
+    cache->setOps(&FAIL_OPS);
+    nodePath(path, "amhdmitx0/hdcp_mode");
+    CHECK(sysWrite->writeSysfs(path, "off"));
+    CHECK(sOpens == 1 && sWrites == 1);
+
+    //the driver refuse the value, it is written once and the fd is kept
+    sFailErrno = EINVAL;
+    sFailWrites = 1;
+    CHECK(!sysWrite->writeSysfs(path, "22"));
+    CHECK(sOpens == 1 && sWrites == 2);
+    sFailErrno = EBUSY;
+    sFailWrites = 1;
+    CHECK(!sysWrite->writeSysfs(path, "22"));
+    CHECK(sOpens == 1 && sWrites == 3);
+    CHECK(sysWrite->writeSysfs(path, "22"));
+    CHECK(sOpens == 1 && sWrites == 4);
+
+    //the node removed and added again, the cached fd is opened once more
+    sFailErrno = ENODEV;
+    sFailWrites = 1;
+    CHECK(sysWrite->writeSysfs(path, "14"));
+    CHECK(sOpens == 2 && sWrites == 6);
+    cache->setOps(NULL);
+}
+
+static void testEvict(SysWrite *sysWrite) {
+    SysfsCache *cache = SysfsCache::getInstance();
+    sysfs_stats_t stats;
+    char path[128];
+    char value[MAX_STR_LEN + 1];
+
+    for (int i = 0; i < SYSFS_CACHE_NODES + 16; i++) {
+        char node[32];
+        sprintf(node, "many_%d", i);
+        nodePath(path, node);
+        CHECK(sysWrite->readSysfs(path, value));
+    }
+    cache->getStats(&stats);
+    CHECK(stats.opened == SYSFS_CACHE_NODES);
+
+    //the last used node is kept, the first one is closed
+    int64_t hits = stats.hits;
+    int64_t misses = stats.misses;
+    sprintf(value, "many_%d", SYSFS_CACHE_NODES + 15);
+    nodePath(path, value);
+    CHECK(sysWrite->readSysfs(path, value));
+    nodePath(path, "many_0");
+    CHECK(sysWrite->readSysfs(path, value));
+    cache->getStats(&stats);
+    CHECK(stats.hits - hits == 1 && stats.misses - misses == 1);
+
+    cache->setEnable(false);
+    cache->getStats(&stats);
+    CHECK(stats.opened == 0);
+    cache->setEnable(true);
+}
+
+int main(int argc, char **argv) {
+    const char *dir = (argc > 1)?argv[1]:"/tmp";
+
+    if (createTree(dir) < 0) {
+        printf("FAIL can not create fake sysfs in %s\n", dir);
+        return 1;
+    }
+
+    SysfsCache::getInstance()->setPrefix(sRoot);
+    SysWrite *sysWrite = new SysWrite();
+    sysWrite->setLogLevel(LOG_LEVEL_0);
+
+    testSyscalls(sysWrite);
+    testReadWrite(sysWrite);
+    testErrors(sysWrite);
+    testRetry(sysWrite);
+    testEvict(sysWrite);
+
+    char buf[1024] = {0};
+    SysfsCache::getInstance()->dump(buf);
+    printf("%s", buf);
+
+    delete sysWrite;
+    removeTree();
+    printf("%s, %d failed\n", (sFailed == 0)?"PASS":"FAIL", sFailed);
+    return (sFailed == 0)?0:1;
+}
@@ -16,6 +16,10 @@
 
 #define LOG_TAG "SystemControlTest"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <../ISystemControlService.h>
 
 #include <binder/Binder.h>
@@ -27,9 +31,81 @@
 #include <utils/RefBase.h>
 #include <utils/String8.h>
 #include <utils/String16.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
 
 using namespace android;
 
+//the keys read by the settings display page at startup
+static const char *sBenchProps[] = {
+    "ro.product.model", "ro.build.version.release", "ro.board.platform",
+    "ro.ui.cursor", "ro.platform.has.realoutputmode", "ro.platform.has.cvbsmode",
+    "ro.platform.hdmionly", "ro.sf.lcd_density", "persist.sys.hdmi.keep_awake",
+    "ubootenv.var.outputmode", "ubootenv.var.hdmimode", "ubootenv.var.cvbsmode",
+    "ubootenv.var.digitaudiooutput", "ubootenv.var.hdmi_colordepth", "ubootenv.var.1080p_x",
+    "ubootenv.var.1080p_y", "ubootenv.var.1080p_w", "ubootenv.var.1080p_h",
+    "persist.sys.cec.enable", "persist.sys.hdr.mode", "ro.sf.fullscreen",
+    "sys.hdmi.resolution", "persist.sys.app.rotation", "ro.platform.has.tvuimode",
+};
+
+static const char *sBenchNodes[] = {
+    "/sys/class/display/mode", "/sys/class/amhdmitx/amhdmitx0/disp_cap",
+    "/sys/class/amhdmitx/amhdmitx0/hpd_state", "/sys/class/amhdmitx/amhdmitx0/hdcp_mode",
+    "/sys/class/amhdmitx/amhdmitx0/aud_cap", "/sys/class/amhdmitx/amhdmitx0/dc_cap",
+    "/sys/class/graphics/fb0/blank", "/sys/class/graphics/fb0/free_scale",
+    "/sys/class/graphics/fb0/window_axis", "/sys/class/video/disable_video",
+};
+
+//the same keys one by one and in one batch
+static void benchmark(const sp<ISystemControlService>& sysWrite, int rounds)
+{
+    int nprops = sizeof(sBenchProps)/sizeof(sBenchProps[0]);
+    int nnodes = sizeof(sBenchNodes)/sizeof(sBenchNodes[0]);
+    Vector<String16> props, nodes, values;
+    Vector<int32_t> status;
+
+    for (int i = 0; i < nprops; i++)
+        props.push_back(String16(sBenchProps[i]));
+    for (int i = 0; i < nnodes; i++)
+        nodes.push_back(String16(sBenchNodes[i]));
+
+    nsecs_t start = systemTime();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < nprops; i++) {
+            String16 value;
+            sysWrite->getProperty(props[i], value);
+        }
+    }
+    nsecs_t single = systemTime() - start;
+
+    start = systemTime();
+    int found = 0;
+    for (int r = 0; r < rounds; r++)
+        found = sysWrite->getProperties(props, values, status);
+    nsecs_t batch = systemTime() - start;
+    printf("getProperty   %2d keys: %8.1f us single, %8.1f us batch, %d set\n",
+        nprops, (double)single/rounds/1000, (double)batch/rounds/1000, found);
+
+    start = systemTime();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < nnodes; i++) {
+            String16 value;
+            sysWrite->readSysfs(nodes[i], value);
+        }
+    }
+    single = systemTime() - start;
+
+    start = systemTime();
+    for (int r = 0; r < rounds; r++)
+        found = sysWrite->readSysfsBatch(nodes, values, status);
+    batch = systemTime() - start;
+    printf("readSysfs     %2d nodes: %7.1f us single, %8.1f us batch, %d read\n",
+        nnodes, (double)single/rounds/1000, (double)batch/rounds/1000, found);
+
+    for (int i = 0; i < nnodes && i < (int)values.size(); i++)
+        printf("  %s [%d]: %s\n", sBenchNodes[i], status[i], String8(values[i]).string());
+}
+
 class DeathNotifier: public IBinder::DeathRecipient
 {
 public:
@@ -41,7 +117,7 @@ public:
     }
 };
 
-int main(int argc __unused, char** argv __unused)
+int main(int argc, char** argv)
 {
     sp<IServiceManager> sm = defaultServiceManager();
     if (sm == NULL) {
@@ -62,6 +138,13 @@ int main(int argc __unused, char** argv __unused)
         return -1;
     }
 
+    //test-systemcontrol bench [rounds]
+    if (argc > 1 && !strcmp(argv[1], "bench")) {
+        int rounds = (argc > 2)?atoi(argv[2]):100;
+        benchmark(sysWrite, (rounds > 0)?rounds:100);
+        return 0;
+    }
+
     ALOGI("system control test entry\n");
     //while (true)
     //    usleep(200*1000);//sleep 200ms
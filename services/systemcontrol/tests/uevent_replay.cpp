@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *  @author   Tellen Yu
+ *  @version  1.0
+ *  @date     2016/06/06
+ *  @par function description:
+ *  - 1 feed recorded uevent streams through the dispatcher with the handler table of DisplayMode
+ *  - 2 time the parse and match against the old isMatch scan of every pattern
+ *  - 3 the hdmi handlers are slow like a mode switch, the video layer one must not wait for them
+ *  - record a stream on the box: setprop sys.systemcontrol.uevent_record /data/uevent.txt
+ *  - usage: uevent_replay [-d hdmi handler ms] [-r rounds] [stream files], default ./uevent/ *.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+
+#include "UeventDispatcher.h"
+
+#define MAX_EVENTS              256
+
+static int sFailed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            sFailed++; \
+        } \
+    } while (0)
+
+typedef struct stream {
+    int count;
+    int len[MAX_EVENTS];
+    char buf[MAX_EVENTS][UEVENT_MSG_LEN];
+} stream_t;
+
+//what the handlers saw, the last state and the runs
+typedef struct sink {
+    int handlerUs;
+    int runs;
+    char lastState[UEVENT_VALUE_LEN];
+} sink_t;
+
+//the patterns of DisplayMode, in the order the old loop tried them
+static const char *PATTERNS[] = {
+    "DEVPATH=/devices/virtual/switch/hdmi_power",
+    "DEVPATH=/devices/virtual/switch/hdmirx_hpd",
+    "DEVPATH=/devices/virtual/switch/hdmirx_hdcp_auth",
+    "DEVPATH=/devices/virtual/switch/hdcp",
+    "DEVPATH=/devices/virtual/switch/hdmi",
+    "DEVPATH=/devices/virtual/switch/video_layer1",
+};
+
+enum {
+    SINK_POWER = 0,
+    SINK_RX_PLUG,
+    SINK_RX_AUTH,
+    SINK_HDCP,
+    SINK_PLUG,
+    SINK_VIDEO,
+    SINK_TOTAL
+};
+
+static sink_t sSinks[SINK_TOTAL];
+
+static int64_t nowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static void onEvent(const uevent_msg_t *msg, void *data) {
+    sink_t *sink = (sink_t *)data;
+    if (sink->handlerUs > 0)
+        usleep(sink->handlerUs);
+    strcpy(sink->lastState, msg->state);
+    sink->runs++;
+}
+
+//the old loop: every pattern scan all the fields and copy the switch fields again
+typedef struct legacy_data {
+    int len;
+    char buf[UEVENT_MSG_LEN];
+    char name[128];
+    char state[128];
+} legacy_data_t;
+
+static bool legacyMatch(legacy_data_t *data, const char *matchName) {
+    bool matched = false;
+    const char *field = data->buf;
+    const char *end = data->buf + data->len + 1;
+    do {
+        if (!strcmp(field, matchName)) {
+            matched = true;
+        } else if (strstr(field, "SWITCH_STATE=")) {
+            strcpy(data->state, field + strlen("SWITCH_STATE="));
+        } else if (strstr(field, "SWITCH_NAME=")) {
+            strcpy(data->name, field + strlen("SWITCH_NAME="));
+        }
+        field += strlen(field) + 1;
+    } while (field != end);
+    return matched;
+}
+
+static int legacyDispatch(const char *buf, int len) {
+    legacy_data_t data;
+    memset(&data, 0, sizeof(data));
+    memcpy(data.buf, buf, len);
+    data.len = len;
+    for (unsigned int i = 0; i < sizeof(PATTERNS)/sizeof(PATTERNS[0]); i++) {
+        if (legacyMatch(&data, PATTERNS[i]))
+            return i;
+    }
+    return -1;
+}
+
+static int loadStream(const char *path, stream_t *stream) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return -1;
+
+    char line[UEVENT_MSG_LEN];
+    stream->count = 0;
+    while (fgets(line, sizeof(line), fp) != NULL && stream->count < MAX_EVENTS) {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        int i = stream->count++;
+        stream->len[i] = ueventFromText(line, stream->buf[i], UEVENT_MSG_LEN);
+    }
+    fclose(fp);
+    return 0;
+}
+
+static void addHandlers(UeventDispatcher *dispatcher, int handlerUs) {
+    memset(sSinks, 0, sizeof(sSinks));
+    sSinks[SINK_POWER].handlerUs = handlerUs;
+    sSinks[SINK_PLUG].handlerUs = handlerUs;
+    sSinks[SINK_RX_PLUG].handlerUs = handlerUs;
+    sSinks[SINK_RX_AUTH].handlerUs = handlerUs;
+
+    int hdmi = dispatcher->addQueue("hdmi");
+    int video = dispatcher->addQueue("video");
+    const char *base = "/devices/virtual/switch/";
+    char path[UEVENT_PATH_LEN];
+#define ADD(name, queue, flags, sink) \
+    sprintf(path, "%s%s", base, name); \
+    dispatcher->add(path, NULL, queue, flags, onEvent, &sSinks[sink], name)
+    ADD("hdmi_power", hdmi, UEVENT_COALESCE, SINK_POWER);
+    ADD("hdmi", hdmi, UEVENT_COALESCE, SINK_PLUG);
+    ADD("hdmirx_hpd", hdmi, UEVENT_COALESCE, SINK_RX_PLUG);
+    ADD("hdmirx_hdcp_auth", hdmi, 0, SINK_RX_AUTH);
+    ADD("hdcp", UEVENT_QUEUE_INLINE, 0, SINK_HDCP);
+    ADD("video_layer1", video, UEVENT_COALESCE, SINK_VIDEO);
+#undef ADD
+}
+
+//the last switch state of the stream for a name
+static const char *lastState(const stream_t *stream, const char *name) {
+    static uevent_msg_t msg;
+    static char state[UEVENT_VALUE_LEN];
+    state[0] = '\0';
+    for (int i = 0; i < stream->count; i++) {
+        ueventParse(&msg, stream->buf[i], stream->len[i]);
+        if (!strcmp(msg.name, name))
+            strcpy(state, msg.state);
+    }
+    return state;
+}
+
+static void replay(const char *name, const stream_t *stream, int handlerUs, int rounds) {
+    //parse and match only, no handler work
+    int64_t start = nowUs();
+    int legacyMatched = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < stream->count; i++)
+            legacyMatched += (legacyDispatch(stream->buf[i], stream->len[i]) >= 0);
+    }
+    int64_t legacyUs = nowUs() - start;
+
+    UeventDispatcher *table = new UeventDispatcher();
+    addHandlers(table, 0);
+    uevent_stats_t stats;
+    int matched = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < stream->count; i++)
+            matched += (table->dispatch(stream->buf[i], stream->len[i]) > 0);
+        table->waitIdle();
+    }
+    table->getStats(&stats);
+    delete table;
+    CHECK(matched == legacyMatched);
+
+    //the stream as the kernel send it, the hdmi handlers are slow
+    UeventDispatcher dispatcher;
+    addHandlers(&dispatcher, handlerUs);
+    start = nowUs();
+    for (int i = 0; i < stream->count; i++)
+        dispatcher.dispatch(stream->buf[i], stream->len[i]);
+    dispatcher.waitIdle();
+    int64_t totalUs = nowUs() - start;
+
+    uevent_handler_stats_t video;
+    dispatcher.getHandlerStats(5, &video);
+    int hdmiRuns = sSinks[SINK_PLUG].runs + sSinks[SINK_POWER].runs +
+        sSinks[SINK_RX_PLUG].runs + sSinks[SINK_RX_AUTH].runs;
+
+    printf("%-20s %3d events, %d matched, match %.2fus (isMatch %.2fus), "
+        "%d hdmi handler runs, total %lldms, video layer max wait %lldus\n",
+        name, stream->count, matched/rounds,
+        (double)stats.parseUs/(rounds*stream->count),
+        (double)legacyUs/(rounds*stream->count),
+        hdmiRuns, (long long)totalUs/1000, (long long)video.maxWaitUs);
+
+    //the handler see the last state of every switch
+    const char *names[] = { "hdmi_power", "hdmirx_hpd", "hdmirx_hdcp_auth", "hdcp", "hdmi", "video_layer1" };
+    for (int i = 0; i < SINK_TOTAL; i++) {
+        const char *state = lastState(stream, names[i]);
+        if (strlen(state) > 0)
+            CHECK(!strcmp(sSinks[i].lastState, state));
+    }
+    //the video layer repaint do not wait for a mode switch
+    if (handlerUs > 0 && sSinks[SINK_VIDEO].runs > 0)
+        CHECK(video.maxWaitUs < handlerUs);
+
+    char buf[4096] = {0};
+    dispatcher.dump(buf);
+    printf("%s", buf);
+}
+
+int main(int argc, char **argv) {
+    int handlerMs = 20;
+    int rounds = 1000;
+    int argi = 1;
+
+    while (argi + 1 < argc && argv[argi][0] == '-') {
+        if (!strcmp(argv[argi], "-d"))
+            handlerMs = atoi(argv[argi + 1]);
+        else if (!strcmp(argv[argi], "-r"))
+            rounds = atoi(argv[argi + 1]);
+        argi += 2;
+    }
+
+    static stream_t stream;
+    int count = 0;
+    if (argi < argc) {
+        for (; argi < argc; argi++) {
+            if (loadStream(argv[argi], &stream) < 0) {
+                printf("FAIL can not read %s\n", argv[argi]);
+                sFailed++;
+                continue;
+            }
+            replay(argv[argi], &stream, handlerMs*1000, rounds);
+            count++;
+        }
+    } else {
+        DIR *dir = opendir("uevent");
+        if (dir == NULL) {
+            printf("FAIL can not open stream dir uevent\n");
+            return 1;
+        }
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strstr(entry->d_name, ".txt") == NULL)
+                continue;
+            char path[512];
+            snprintf(path, sizeof(path), "uevent/%s", entry->d_name);
+            if (loadStream(path, &stream) < 0)
+                continue;
+            replay(entry->d_name, &stream, handlerMs*1000, rounds);
+            count++;
+        }
+        closedir(dir);
+    }
+
+    printf("%s, %d streams, %d failed\n", (sFailed == 0)?"PASS":"FAIL", count, sFailed);
+    return (sFailed == 0)?0:1;
+}
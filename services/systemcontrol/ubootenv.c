@@ -10,6 +10,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <stdint.h>
+#include <time.h>
+#include <pthread.h>
 #include <zlib.h>
 
 #include <cutils/properties.h>
@@ -24,12 +26,27 @@
 #endif
 
 #include "ubootenv.h"
+#include "bootenv_index.h"
 #include "common.h"
 
 #define ERROR(x...)     SYS_LOGE(x)
 #define NOTICE(x...)    SYS_LOGV(x)
 #define INFO(x...)      SYS_LOGI(x)
-static mutex_t  env_lock = MUTEX_INITIALIZER;
+
+//"BSEQ", the trailer of a copy written with a sequence number
+#define ENV_SEQ_MAGIC           0x51455342
+//block devices are written in pages, only the changed ones
+#define ENV_WRITE_PAGE          4096
+
+typedef struct env_trailer {
+    uint32_t magic;
+    uint32_t seq;
+} env_trailer_t;
+
+//env_lock guard the index and the flush state, save_lock serialize the writes
+static pthread_mutex_t env_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t save_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t env_flush_cond = PTHREAD_COND_INITIALIZER;
 
 char BootenvPartitionName[32]={0};
 char PROFIX_UBOOTENV_VAR[32]={0};
@@ -41,94 +58,143 @@ static unsigned int ENV_SIZE = 0;
 static int ENT_INIT_DONE = 0;
 
 static struct environment env_data;
-static struct env_attribute env_attribute_header;
+static env_index_t env_index;
+
+//deferred flush, 0 delay write every update at once
+static int env_flush_delay_ms = 0;
+static int env_flush_thread_started = 0;
+static int env_dirty = 0;
+static int env_flush_now = 0;
+static int env_transaction = 0;
+static int64_t env_last_update_ms = 0;
+static int env_updates = 0;
+static int env_writes = 0;
+
+/*
+ * copy A at offset 0 is the legacy image read by uboot, copy B follow it
+ * if the partition has room. Both end with a trailer inside the crc area,
+ * the parser stop at the empty string before it.
+ */
+static int env_redundant_allowed = 1;
+static int env_redundant = 0;
+static off_t env_copy_offset[2] = {0, 0};
+static int env_is_mtd = 0;
+static unsigned int env_erase_size = 0;
+static uint32_t env_seq = 0;
+//what is on copy A, NULL if it is not known
+static char *env_flash_image = NULL;
+//copy B is the same as copy A
+static int env_b_synced = 0;
+static int env_need_repair = 0;
+static int64_t env_bytes_written = 0;
+static int env_skipped = 0;
+static bootenv_flush_listener_t env_flush_listener = NULL;
 //static char env_arg_buf[ENV_PARTITIONS_SIZE+sizeof(uint32_t)];
 
 
 /*************************for demo uboot arg areas write uboot args read and write*********************/
 
-/* Parse a session attribute */
-static env_attribute * env_parse_attribute(void) {
-    char *value,*key;
-    char *line;
-    char *proc = env_data.data;
-    char *next_proc;
-    env_attribute *attr = &env_attribute_header;
-    int n_char,n_char_end;
-
-    memset(attr, 0, sizeof(env_attribute));
-
-    do {
-        next_proc = proc+strlen(proc)+sizeof(char);
-        //NOTICE("process %s\n",proc);
-        key = strchr(proc, (int)'=');
-        if (key != NULL) {
-            *key=0;
-            strcpy(attr->key, proc);
-            strcpy(attr->value, key+sizeof(char));
-        } else {
-            ERROR("[ubootenv] error need '=' skip this value\n");
-        }
-
-        if (!(*next_proc)) {
-            //NOTICE("process end \n");
-            break;
-        }
-        proc = next_proc;
+static int env_flush(void);
 
-        attr->next =(env_attribute *)malloc(sizeof(env_attribute));
-        if (attr->next == NULL) {
-            ERROR("[ubootenv] exit malloc error \n");
-            break;
-        }
-        memset(attr->next, 0, sizeof(env_attribute));
-        attr = attr->next;
-    }while(1);
+/* Parse a session attribute */
+static int env_parse_attribute(void) {
+    pthread_mutex_lock(&env_lock);
+    int ret = env_index_parse(&env_index, env_data.data, ENV_SIZE);
+    pthread_mutex_unlock(&env_lock);
+    return ret;
+}
 
-    //NOTICE("*********key: [%s]\n",env_attribute_header.next->key);
-    return &env_attribute_header;
+static env_trailer_t *env_trailer(void *image) {
+    return (env_trailer_t *)((char *)image + ENV_PARTITIONS_SIZE - sizeof(env_trailer_t));
 }
 
 /*  attribute revert to sava data*/
 static int env_revert_attribute(void) {
-    int len;
-    env_attribute *attr = &env_attribute_header;
-    char *data = env_data.data;
-    memset(env_data.data,0,ENV_SIZE);
-    do {
-        len = sprintf(data, "%s=%s", attr->key, attr->value);
-        if (len < (int)(sizeof(char)*3)) {
-            ERROR("[ubootenv] Invalid data\n");
-        }
-        else
-            data += len+sizeof(char);
+    if (!env_redundant)
+        return env_index_serialize(&env_index, env_data.data, ENV_SIZE);
 
-        attr=attr->next;
-    }while(attr);
-    return 0;
+    int ret = env_index_serialize(&env_index, env_data.data, ENV_SIZE - sizeof(env_trailer_t));
+    env_trailer_t *trailer = env_trailer(env_data.image);
+    trailer->magic = ENV_SEQ_MAGIC;
+    trailer->seq = env_seq;
+    return ret;
 }
 
-env_attribute *bootenv_get_attr(void) {
-    return &env_attribute_header;
+void bootenv_list(void (*fn)(const char *key, const char *value, void *cookie), void *cookie) {
+    pthread_mutex_lock(&env_lock);
+    for (uint32_t i = 0; i < env_index.count; i++) {
+        fn(env_index.entries[i].key, env_index.entries[i].value, cookie);
+    }
+    pthread_mutex_unlock(&env_lock);
 }
 
 void bootenv_print(void) {
-    env_attribute *attr=&env_attribute_header;
-    while (attr != NULL) {
-        SYS_LOGI("[ubootenv] key: [%s]\n", attr->key);
-        SYS_LOGI("[ubootenv] value: [%s]\n\n", attr->value);
-        attr = attr->next;
+    pthread_mutex_lock(&env_lock);
+    for (uint32_t i = 0; i < env_index.count; i++) {
+        SYS_LOGI("[ubootenv] key: [%s]\n", env_index.entries[i].key);
+        SYS_LOGI("[ubootenv] value: [%s]\n\n", env_index.entries[i].value);
     }
+    SYS_LOGI("[ubootenv] %d entries, index %d bytes\n", env_index.count, env_index_bytes(&env_index));
+    pthread_mutex_unlock(&env_lock);
+}
+
+//copy B is used when the partition has room for two copies
+static void env_probe_layout(int fd) {
+    struct mtd_info_user info;
+    off_t total = 0;
+    off_t offset = ENV_PARTITIONS_SIZE;
+
+    env_is_mtd = (strstr(BootenvPartitionName, "mtd") != NULL);
+    env_erase_size = 0;
+    if (env_is_mtd) {
+        memset(&info, 0, sizeof(info));
+        if (ioctl(fd, MEMGETINFO, &info) == 0) {
+            env_erase_size = info.erasesize;
+            total = info.size;
+        }
+    } else {
+        total = lseek(fd, 0, SEEK_END);
+        lseek(fd, 0, SEEK_SET);
+    }
+
+    //copies never share an erase block
+    if (env_erase_size > 0)
+        offset = (offset + env_erase_size - 1)/env_erase_size*env_erase_size;
+    env_copy_offset[1] = offset;
+    env_redundant = env_redundant_allowed && (total >= offset + (off_t)ENV_PARTITIONS_SIZE);
+}
+
+//0 if the copy has a valid crc, seq is 0 for the copy written by a legacy writer
+static int env_read_copy(int fd, int copy, char *image, uint32_t *seq, int *has_trailer) {
+    struct env_image *env = (struct env_image *)image;
+    int ret = pread(fd, image, ENV_PARTITIONS_SIZE, env_copy_offset[copy]);
+    if (ret != (int)ENV_PARTITIONS_SIZE) {
+        NOTICE("[ubootenv] read copy %d error 0x%x \n", copy, ret);
+        return -5;
+    }
+
+    uint32_t crc_calc = crc32(0, (uint8_t *)env->data, ENV_SIZE);
+    if (crc_calc != env->crc) {
+        ERROR("[ubootenv] copy %d CRC Check ERROR save_crc=%08x,calc_crc = %08x \n",
+            copy, env->crc, crc_calc);
+        return -3;
+    }
+
+    env_trailer_t *trailer = env_trailer(image);
+    *has_trailer = (trailer->magic == ENV_SEQ_MAGIC);
+    *seq = *has_trailer?trailer->seq:0;
+    return 0;
 }
 
 int read_bootenv() {
     int fd;
     int ret;
-    uint32_t crc_calc;
-    env_attribute *attr;
-    struct mtd_info_user info;
+    int ret_b = -1;
+    uint32_t seq_a = 0, seq_b = 0;
+    int trailer_a = 0, trailer_b = 0;
     struct env_image *image;
     char *addr;
+    char *copy_b = NULL;
 
     if ((fd = open(BootenvPartitionName,O_RDONLY)) < 0) {
         ERROR("[ubootenv] open devices error: %s\n" ,strerror(errno));
@@ -148,43 +214,75 @@ int read_bootenv() {
     env_data.crc = &(image->crc);
     env_data.data = image->data;
 
-    ret = read(fd ,env_data.image, ENV_PARTITIONS_SIZE);
-    if (ret == (int)ENV_PARTITIONS_SIZE) {
-        crc_calc = crc32(0,(uint8_t *)env_data.data, ENV_SIZE);
-        if (crc_calc != *(env_data.crc)) {
-            ERROR("[ubootenv] CRC Check ERROR save_crc=%08x,calc_crc = %08x \n",
-                *env_data.crc, crc_calc);
-            close(fd);
-            return -3;
-        }
-        attr = env_parse_attribute();
-        if (attr == NULL) {
-            close(fd);
-            return -4;
-        }
-        //bootenv_print();
-    } else {
-        NOTICE("[ubootenv] read error 0x%x \n",ret);
-        close(fd);
-        return -5;
+    env_probe_layout(fd);
+    ret = env_read_copy(fd, 0, addr, &seq_a, &trailer_a);
+    if (env_redundant) {
+        copy_b = malloc(ENV_PARTITIONS_SIZE);
+        if (copy_b != NULL)
+            ret_b = env_read_copy(fd, 1, copy_b, &seq_b, &trailer_b);
     }
     close(fd);
+
+    free(env_flash_image);
+    env_flash_image = NULL;
+    env_b_synced = 0;
+    env_need_repair = 0;
+    env_seq = seq_a;
+
+    //copy A written by uboot has no trailer, it is always the newest
+    if (ret_b == 0 && trailer_b && (ret < 0 || (trailer_a && seq_b > seq_a))) {
+        INFO("[ubootenv] copy A %s, load copy B seq %u\n", (ret < 0)?"broken":"older", seq_b);
+        if (ret == 0) {
+            env_flash_image = malloc(ENV_PARTITIONS_SIZE);
+            if (env_flash_image != NULL)
+                memcpy(env_flash_image, addr, ENV_PARTITIONS_SIZE);
+        }
+        memcpy(addr, copy_b, ENV_PARTITIONS_SIZE);
+        env_seq = seq_b;
+        env_need_repair = 1;
+        ret = 0;
+    } else if (ret == 0) {
+        env_flash_image = malloc(ENV_PARTITIONS_SIZE);
+        if (env_flash_image != NULL)
+            memcpy(env_flash_image, addr, ENV_PARTITIONS_SIZE);
+        env_b_synced = (ret_b == 0 && !memcmp(addr, copy_b, ENV_PARTITIONS_SIZE));
+        //the next seq must be newer than copy B too
+        if (ret_b == 0 && seq_b > env_seq)
+            env_seq = seq_b;
+        env_need_repair = env_redundant && !env_b_synced;
+    }
+    free(copy_b);
+
+    if (ret < 0)
+        return ret;
+
+    if (env_parse_attribute() < 0)
+        return -4;
+    //bootenv_print();
     return 0;
 }
 
+//write the loaded copy back to the broken or older one
+static void env_repair(void) {
+    if (!env_need_repair)
+        return;
+
+    pthread_mutex_lock(&env_lock);
+    env_dirty = 1;
+    env_need_repair = 0;
+    pthread_mutex_unlock(&env_lock);
+    env_flush();
+}
+
 const char * bootenv_get_value(const char * key) {
     if (!ENT_INIT_DONE) {
         return NULL;
     }
 
-    env_attribute *attr = &env_attribute_header;
-    while (attr) {
-        if (!strcmp(key,attr->key)) {
-            return attr->value;
-        }
-        attr = attr->next;
-    }
-    return NULL;
+    pthread_mutex_lock(&env_lock);
+    const char *value = env_index_get(&env_index, key);
+    pthread_mutex_unlock(&env_lock);
+    return value;
 }
 
 /*
@@ -192,105 +290,351 @@ creat_args_flag : if true , if envvalue don't exists Creat it .
               if false , if envvalue don't exists just exit .
 */
 int bootenv_set_value(const char * key,  const char * value,int creat_args_flag) {
-    env_attribute *attr = &env_attribute_header;
-    env_attribute *last = attr;
-    while (attr) {
-        if (!strcmp(key,attr->key)) {
-            strcpy(attr->value,value);
-            return 2;
-        }
-        last = attr;
-        attr = attr->next;
-    }
-
-    if (creat_args_flag) {
+    int ret = env_index_set(&env_index, key, value, creat_args_flag);
+    if (ret == 1)
         NOTICE("[ubootenv] ubootenv.var.%s not found, create it.\n", key);
-        /*******Creat a New args*********************/
-        attr =(env_attribute *)malloc(sizeof(env_attribute));
-        last->next = attr;
-        memset(attr, 0, sizeof(env_attribute));
-        strcpy(attr->key,key);
-        strcpy(attr->value,value);
-        return 1;
-    }else {
-        return 0;
-    }
+    else if (ret < 0)
+        ERROR("[ubootenv] set %s out of memory\n", key);
+    return ret;
 }
 
-int save_bootenv() {
-    int fd;
-    int err;
+static int64_t env_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+static int64_t env_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+//erase and program only the erase blocks which are changed
+static int env_write_mtd(int fd, off_t base, const char *image, const char *old) {
     struct erase_info_user erase;
     struct mtd_info_user info;
     unsigned char *data = NULL;
-    env_revert_attribute();
-    *(env_data.crc) = crc32(0, (uint8_t *)env_data.data, ENV_SIZE);
-
-    if ((fd = open (BootenvPartitionName, O_RDWR)) < 0) {
-        ERROR("[ubootenv] open devices error\n");
-        return -1;
-    }
+    int err;
 
-    if (strstr (BootenvPartitionName, "mtd")) {
+    if (env_erase_size == 0) {
         memset(&info, 0, sizeof(info));
         err = ioctl(fd, MEMGETINFO, &info);
         if (err < 0) {
             ERROR("[ubootenv] Get MTD info error\n");
-            close(fd);
             return -4;
         }
+        env_erase_size = info.erasesize;
+    }
 
-        erase.start = 0;
-        if (info.erasesize > ENV_PARTITIONS_SIZE) {
-            data = (unsigned char*)malloc(info.erasesize);
-            if (data == NULL) {
-                ERROR("[ubootenv] Out of memory!!!\n");
-                close(fd);
-                return -5;
-            }
-            memset(data, 0, info.erasesize);
-            err = read(fd, (void*)data, info.erasesize);
-            if (err != (int)info.erasesize) {
+    data = (unsigned char*)malloc(env_erase_size);
+    if (data == NULL) {
+        ERROR("[ubootenv] Out of memory!!!\n");
+        return -5;
+    }
+
+    off_t end = base + ENV_PARTITIONS_SIZE;
+    off_t block = base/env_erase_size*env_erase_size;
+    for (; block < end; block += env_erase_size) {
+        //the part of the image in this erase block
+        off_t start = (block > base)?block:base;
+        off_t stop = (block + (off_t)env_erase_size < end)?block + (off_t)env_erase_size:end;
+        const char *src = image + (start - base);
+        if (old != NULL && !memcmp(src, old + (start - base), stop - start))
+            continue;
+
+        //the erase block is larger than the env, keep the other bytes
+        if (start != block || stop != block + (off_t)env_erase_size) {
+            memset(data, 0, env_erase_size);
+            err = pread(fd, (void*)data, env_erase_size, block);
+            if (err != (int)env_erase_size) {
                 ERROR("[ubootenv] Read access failed !!!\n");
                 free(data);
-                close(fd);
                 return -6;
             }
-            memcpy(data, env_data.image, ENV_PARTITIONS_SIZE);
-            erase.length = info.erasesize;
-        }
-        else {
-            erase.length = ENV_PARTITIONS_SIZE;
         }
+        memcpy(data + (start - block), src, stop - start);
 
+        erase.start = block;
+        erase.length = env_erase_size;
         err = ioctl (fd,MEMERASE,&erase);
         if (err < 0) {
             ERROR ("[ubootenv] MEMERASE ERROR %d\n",err);
-            close(fd);
+            free(data);
             return  -2;
         }
 
-        if (info.erasesize > ENV_PARTITIONS_SIZE) {
-            lseek(fd, 0L, SEEK_SET);
-            err = write(fd , data, info.erasesize);
+        err = pwrite(fd, data, env_erase_size, block);
+        if (err != (int)env_erase_size) {
+            ERROR ("[ubootenv] ERROR write, size %d \n", env_erase_size);
             free(data);
+            return -3;
         }
-        else
-            err = write(fd ,env_data.image, ENV_PARTITIONS_SIZE);
+        env_bytes_written += env_erase_size;
+    }
 
-    } else {
-        //emmc and nand needn't erase
-        err = write(fd ,env_data.image, ENV_PARTITIONS_SIZE);
+    free(data);
+    return 0;
+}
+
+//emmc and nand needn't erase, write the pages which are changed
+static int env_write_pages(int fd, off_t base, const char *image, const char *old) {
+    for (unsigned int off = 0; off < ENV_PARTITIONS_SIZE; off += ENV_WRITE_PAGE) {
+        unsigned int len = ENV_PARTITIONS_SIZE - off;
+        if (len > ENV_WRITE_PAGE)
+            len = ENV_WRITE_PAGE;
+        if (old != NULL && !memcmp(image + off, old + off, len))
+            continue;
+
+        if (pwrite(fd, image + off, len, base + off) != (int)len) {
+            ERROR ("[ubootenv] ERROR write, size %d \n", ENV_PARTITIONS_SIZE);
+            return -3;
+        }
+        env_bytes_written += len;
+    }
+    fsync(fd);
+    return 0;
+}
+
+static int env_write_copy(int fd, int copy, const char *image, const char *old) {
+    if (env_is_mtd)
+        return env_write_mtd(fd, env_copy_offset[copy], image, old);
+    return env_write_pages(fd, env_copy_offset[copy], image, old);
+}
+
+/*
+ * return 1 if the image is the same as the flash. With two copies,
+ * copy B is written first, so one copy is always valid.
+ */
+static int write_bootenv(void) {
+    int fd;
+    int err;
+    const char *image = (const char *)env_data.image;
+
+    if (env_flash_image != NULL && (!env_redundant || env_b_synced)
+        && !memcmp(image, env_flash_image, ENV_PARTITIONS_SIZE)) {
+        env_skipped++;
+        return 1;
+    }
+
+    if (env_redundant) {
+        env_trailer(env_data.image)->seq = env_seq + 1;
+        *(env_data.crc) = crc32(0, (uint8_t *)env_data.data, ENV_SIZE);
+    }
+
+    if ((fd = open (BootenvPartitionName, O_RDWR)) < 0) {
+        ERROR("[ubootenv] open devices error\n");
+        return -1;
     }
 
+    if (env_redundant) {
+        err = env_write_copy(fd, 1, image, env_b_synced?env_flash_image:NULL);
+        if (err < 0) {
+            env_b_synced = 0;
+            close(fd);
+            return err;
+        }
+    }
+
+    err = env_write_copy(fd, 0, image, env_flash_image);
     close(fd);
     if (err < 0) {
-        ERROR ("[ubootenv] ERROR write, size %d \n", ENV_PARTITIONS_SIZE);
-        return -3;
+        //copy A is not known any more, copy B has the new image
+        free(env_flash_image);
+        env_flash_image = NULL;
+        env_b_synced = 0;
+        return err;
+    }
+
+    if (env_flash_image == NULL)
+        env_flash_image = malloc(ENV_PARTITIONS_SIZE);
+    if (env_flash_image != NULL)
+        memcpy(env_flash_image, image, ENV_PARTITIONS_SIZE);
+    env_b_synced = env_redundant;
+    if (env_redundant)
+        env_seq++;
+    return 0;
+}
+
+int save_bootenv() {
+    if (env_revert_attribute() < 0)
+        return -7;
+    *(env_data.crc) = crc32(0, (uint8_t *)env_data.data, ENV_SIZE);
+    return (write_bootenv() < 0)?-3:0;
+}
+
+/*
+ * write the env if it is changed, the updates since the last flush
+ * go to the partition in one write
+ */
+static int env_flush(void) {
+    int i = 0;
+    int ret = -1;
+
+    pthread_mutex_lock(&save_lock);
+    pthread_mutex_lock(&env_lock);
+    if (!env_dirty || !env_data.image) {
+        pthread_mutex_unlock(&env_lock);
+        pthread_mutex_unlock(&save_lock);
+        return 0;
+    }
+
+    env_flush_now = 0;
+    if (env_revert_attribute() < 0) {
+        //keep it dirty, the flush thread try again after the delay
+        env_last_update_ms = env_now_ms();
+        pthread_mutex_unlock(&env_lock);
+        pthread_mutex_unlock(&save_lock);
+        return -7;
+    }
+    //an update while writing set it again
+    env_dirty = 0;
+    *(env_data.crc) = crc32(0, (uint8_t *)env_data.data, ENV_SIZE);
+    pthread_mutex_unlock(&env_lock);
+
+    //the image is only changed with save_lock, update can go on while writing
+    int64_t start = env_now_us();
+    while (i < MAX_UBOOT_RWRETRY && ret < 0) {
+        i ++;
+        ret = write_bootenv();
+        if (ret < 0)
+            ERROR("[ubootenv] Cannot write %s: %d.\n", BootenvPartitionName, ret);
+    }
+    if (env_flush_listener != NULL)
+        env_flush_listener(ret, env_now_us() - start);
+
+    if (ret == 0) {
+        env_writes++;
+        INFO("[ubootenv] Save ubootenv to %s succeed!\n",  BootenvPartitionName);
+    } else if (ret == 1) {
+        NOTICE("[ubootenv] env is the same as %s, skip write\n", BootenvPartitionName);
+        ret = 0;
+    } else {
+        //the changes are not on the partition, write them again on the next flush
+        pthread_mutex_lock(&env_lock);
+        env_dirty = 1;
+        env_last_update_ms = env_now_ms();
+        pthread_mutex_unlock(&env_lock);
+    }
+    pthread_mutex_unlock(&save_lock);
+    return ret;
+}
+
+static void env_wait_ms(int64_t ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms/1000;
+    ts.tv_nsec += (ms%1000)*1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(&env_flush_cond, &env_lock, &ts);
+}
+
+//flush after the updates are quiet for the delay, or at once when a transaction end
+static void *env_flush_thread(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&env_lock);
+    while (1) {
+        if (!env_dirty || env_transaction > 0 || env_flush_delay_ms == 0) {
+            pthread_cond_wait(&env_flush_cond, &env_lock);
+            continue;
+        }
+
+        if (!env_flush_now && env_flush_delay_ms > 0) {
+            int64_t wait = env_last_update_ms + env_flush_delay_ms - env_now_ms();
+            if (wait > 0) {
+                env_wait_ms(wait);
+                continue;
+            }
+        }
+
+        pthread_mutex_unlock(&env_lock);
+        env_flush();
+        pthread_mutex_lock(&env_lock);
+    }
+    return NULL;
+}
+
+static void env_flush_at_exit(void) {
+    env_flush();
+}
+
+void bootenv_set_flush_listener(bootenv_flush_listener_t listener) {
+    pthread_mutex_lock(&save_lock);
+    env_flush_listener = listener;
+    pthread_mutex_unlock(&save_lock);
+}
+
+void bootenv_set_flush_delay(int delay_ms) {
+    pthread_mutex_lock(&env_lock);
+    env_flush_delay_ms = (delay_ms > 0)?delay_ms:0;
+    if (env_flush_delay_ms > 0 && !env_flush_thread_started) {
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&thread, &attr, env_flush_thread, NULL) == 0) {
+            env_flush_thread_started = 1;
+            atexit(env_flush_at_exit);
+        } else {
+            ERROR("[ubootenv] create flush thread fail, write every update\n");
+            env_flush_delay_ms = 0;
+        }
+        pthread_attr_destroy(&attr);
     }
+    INFO("[ubootenv] flush delay %d ms\n", env_flush_delay_ms);
+    pthread_mutex_unlock(&env_lock);
+
+    if (env_flush_delay_ms == 0)
+        env_flush();
+}
+
+int bootenv_commit(void) {
+    return env_flush();
+}
+
+void bootenv_transaction_begin(void) {
+    pthread_mutex_lock(&env_lock);
+    env_transaction++;
+    pthread_mutex_unlock(&env_lock);
+}
+
+int bootenv_transaction_end(void) {
+    pthread_mutex_lock(&env_lock);
+    if (env_transaction > 0)
+        env_transaction--;
+    int flush = (env_transaction == 0) && env_dirty;
+    int sync = (env_flush_delay_ms == 0);
+    if (flush && !sync) {
+        env_flush_now = 1;
+        pthread_cond_signal(&env_flush_cond);
+    }
+    pthread_mutex_unlock(&env_lock);
+
+    if (flush && sync)
+        return env_flush();
     return 0;
 }
 
+void bootenv_get_stats(int *updates, int *writes, int *pending) {
+    pthread_mutex_lock(&env_lock);
+    *updates = env_updates;
+    *writes = env_writes;
+    *pending = env_dirty;
+    pthread_mutex_unlock(&env_lock);
+}
+
+void bootenv_get_write_stats(int64_t *bytes, int *skipped, uint32_t *seq, int *redundant) {
+    pthread_mutex_lock(&save_lock);
+    *bytes = env_bytes_written;
+    *skipped = env_skipped;
+    *seq = env_seq;
+    *redundant = env_redundant;
+    pthread_mutex_unlock(&save_lock);
+}
+
 static int is_bootenv_varible(const char* prop_name) {
     if (!prop_name || !(*prop_name))
         return 0;
@@ -320,6 +664,7 @@ static void bootenv_prop_init(const char *key, const char *value, void *cookie)
 
 int bootenv_property_list(void (*propfn)(const char *key, const char *value, void *cookie),
                 void *cookie) {
+#ifdef __BIONIC__
     char name[PROP_NAME_MAX];
     char value[PROP_VALUE_MAX];
     const prop_info *pi;
@@ -329,6 +674,11 @@ int bootenv_property_list(void (*propfn)(const char *key, const char *value, voi
         __system_property_read(pi, name, value);
         propfn(name, value, cookie);
     }
+#else
+    //no property area on the host, the display simulator keep them in memory
+    (void)propfn;
+    (void)cookie;
+#endif
     return 0;
 }
 
@@ -417,6 +767,10 @@ int bootenv_init(void) {
         ENV_SIZE = ENV_PARTITIONS_SIZE - sizeof(long);
     }
 
+    char redundant[PROP_VALUE_MAX] = {0};
+    property_get("ro.ubootenv.redundant", redundant, "true");
+    env_redundant_allowed = strcmp(redundant, "false");
+
     while (i < MAX_UBOOT_RWRETRY && ret < 0) {
         i ++;
         ret = read_bootenv();
@@ -430,6 +784,7 @@ int bootenv_init(void) {
         ERROR("[ubootenv] read %s failed \n", BootenvPartitionName);
         return -2;
     }
+    env_repair();
 
     char prefix[PROP_VALUE_MAX] = {0};
     property_get("ro.ubootenv.varible.prefix", prefix, "");
@@ -470,26 +825,62 @@ int bootenv_init(void) {
 }
 
 int bootenv_reinit(void) {
-   mutex_lock(&env_lock);
+   //the pending updates would be lost by reading the partition again
+   env_flush();
+
+   pthread_mutex_lock(&save_lock);
+   pthread_mutex_lock(&env_lock);
    if (env_data.image) {
        free(env_data.image);
        env_data.image = NULL;
        env_data.crc = NULL;
        env_data.data = NULL;
    }
-   env_attribute * pAttr = env_attribute_header.next;
-   memset(&env_attribute_header, 0, sizeof(env_attribute));
-   env_attribute * pTmp = NULL;
-   while (pAttr) {
-       pTmp = pAttr;
-       pAttr = pAttr->next;
-       free(pTmp);
-   }
+   env_index_free(&env_index);
+   pthread_mutex_unlock(&env_lock);
+   pthread_mutex_unlock(&save_lock);
+   //init may repair a copy, it takes save_lock again
    bootenv_init();
-   mutex_unlock(&env_lock);
    return 0;
 }
 
+int bootenv_init_file(const char *path, unsigned int size) {
+    if (strlen(path) >= sizeof(BootenvPartitionName) || size <= sizeof(uint32_t)) {
+        ERROR("[ubootenv] invalid env file %s size %d\n", path, size);
+        return -1;
+    }
+
+    //drop the env loaded before, pending updates of it are written first
+    env_flush();
+    pthread_mutex_lock(&save_lock);
+    pthread_mutex_lock(&env_lock);
+    free(env_data.image);
+    env_data.image = NULL;
+    env_data.crc = NULL;
+    env_data.data = NULL;
+    env_index_free(&env_index);
+    pthread_mutex_unlock(&env_lock);
+    pthread_mutex_unlock(&save_lock);
+
+    strcpy(BootenvPartitionName, path);
+    ENV_PARTITIONS_SIZE = size;
+    ENV_SIZE = ENV_PARTITIONS_SIZE - sizeof(uint32_t);
+
+    int ret = read_bootenv();
+    if (ret < 0) {
+        ERROR("[ubootenv] Cannot read %s: %d.\n", BootenvPartitionName, ret);
+        if (ret < -2)
+            free(env_data.image);
+        return ret;
+    }
+    env_repair();
+
+    if (!(*PROFIX_UBOOTENV_VAR))
+        strcpy(PROFIX_UBOOTENV_VAR, "ubootenv.var.");
+    ENT_INIT_DONE = 1;
+    return 0;
+}
+
 int bootenv_update(const char* name, const char* value) {
     if (!ENT_INIT_DONE) {
         ERROR("[ubootenv] bootenv do not init\n");
@@ -509,28 +900,34 @@ int bootenv_update(const char* name, const char* value) {
         varible_name = name + strlen(PROFIX_UBOOTENV_VAR);
     }
 
-    const char *varible_value = bootenv_get_value(varible_name);
+    pthread_mutex_lock(&env_lock);
+    const char *varible_value = env_index_get(&env_index, varible_name);
     if (!varible_value)
         varible_value = "";
 
-    if (!strcmp(value, varible_value))
+    if (!strcmp(value, varible_value)) {
+        pthread_mutex_unlock(&env_lock);
         return 0;
-
-    bootenv_set_value(varible_name, value, 1);
-
-    int i = 0;
-    int ret = -1;
-    while (i < MAX_UBOOT_RWRETRY && ret < 0) {
-        i ++;
-        ret = save_bootenv();
-        if (ret < 0)
-            ERROR("[ubootenv] Cannot write %s: %d.\n", BootenvPartitionName, ret);
     }
 
-    if (i < MAX_UBOOT_RWRETRY) {
-        INFO("[ubootenv] Save ubootenv to %s succeed!\n",  BootenvPartitionName);
+    if (bootenv_set_value(varible_name, value, 1) < 0) {
+        pthread_mutex_unlock(&env_lock);
+        return -1;
     }
 
+    env_dirty = 1;
+    env_updates++;
+    env_last_update_ms = env_now_ms();
+    //written later by the flush thread or at the end of the transaction
+    int deferred = (env_flush_delay_ms > 0) || (env_transaction > 0);
+    if (deferred)
+        pthread_cond_signal(&env_flush_cond);
+    pthread_mutex_unlock(&env_lock);
+
+    int ret = 0;
+    if (!deferred)
+        ret = env_flush();
+
 #if BOOT_ARGS_CHECK
     NOTICE( "[ubootenv] E03LOG ----update_bootenv_varible %s = %s \n" , name , value );
     if (strcmp(name, ARGS_ETHADDR_WHOLE) == 0 ||
@@ -7,6 +7,8 @@ extern "C" {
 #endif
 
 #define MAX_UBOOT_RWRETRY       5
+//quiet time before the updates are written, used by the service
+#define BOOTENV_FLUSH_DELAY_MS  500
 
 typedef	struct env_image {
 	uint32_t  crc;			/* CRC32 over data bytes	*/
@@ -19,19 +21,36 @@ typedef struct environment {
 	char			*data;
 }environment_t;
 
-typedef struct env_attribute {
-        struct env_attribute *next;
-        char key[256];
-        char value[1024];
-}env_attribute;
-
 int bootenv_init();
 int bootenv_reinit();
+//load the env from a file instead of the partition, for the tools and tests
+int bootenv_init_file(const char *path, unsigned int size);
 const char * bootenv_get(const char * key);
 int bootenv_update(const char* name, const char* value);
 void bootenv_print(void);
 
-env_attribute *bootenv_get_attr(void);
+/*
+ * 0 (default) write the partition in every update, otherwise the updates
+ * are written together when no update come in delay_ms
+ */
+void bootenv_set_flush_delay(int delay_ms);
+//write the pending updates now, call it before shutdown or reboot
+int bootenv_commit(void);
+//updates between begin and end are written once at the end
+void bootenv_transaction_begin(void);
+int bootenv_transaction_end(void);
+void bootenv_get_stats(int *updates, int *writes, int *pending);
+//bytes programmed, writes skipped as the same as the flash, seq of the A/B copies
+void bootenv_get_write_stats(int64_t *bytes, int *skipped, uint32_t *seq, int *redundant);
+
+void bootenv_list(void (*fn)(const char *key, const char *value, void *cookie), void *cookie);
+
+/*
+ * called after every flush which had changes, result is 0 written, 1 the same as the flash
+ * or < 0 the write failed, us the time of the write with its retries
+ */
+typedef void (*bootenv_flush_listener_t)(int result, int64_t us);
+void bootenv_set_flush_listener(bootenv_flush_listener_t listener);
 
 #if BOOT_ARGS_CHECK
 void 	check_boot_args();